@@ -44,6 +44,16 @@ void get_cpu_features(void)
       f->avx2 = !!(b & (1 << 5)) && !!(b & (1 << 3)) && !!(b & (1 << 8));
    }
 
+   if (f->max_basic_cpuid_cmd < 0xD)
+      goto ext_features;
+
+   /* CPUID[0xD] supported */
+   if (f->ecx1.xsave) {
+      cpuid_count(0xD, 1, &a, &b, &c, &d);
+      f->xsaveopt = !!(a & (1 << 0));
+      f->xsavec = !!(a & (1 << 1));
+   }
+
 ext_features:
 
    cpuid(0x80000000, &a, &b, &c, &d);
@@ -179,6 +189,12 @@ void dump_x86_features(void)
    if (x86_cpu_features.avx2)
       w += (u32)snprintk(buf + w, sizeof(buf) - w, "avx2 ");
 
+   if (x86_cpu_features.xsaveopt)
+      w += (u32)snprintk(buf + w, sizeof(buf) - w, "xsaveopt ");
+
+   if (x86_cpu_features.xsavec)
+      w += (u32)snprintk(buf + w, sizeof(buf) - w, "xsavec ");
+
    if (w)
       printk("%s\n", buf);
 }
@@ -5,6 +5,7 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/assert.h>
 #include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
 #include <tilck/kernel/errno.h>
 
 const s8 digit_to_val[128] =
@@ -43,42 +44,190 @@ const s8 digit_to_val[128] =
    [103 ... 127] = -1,
 };
 
-/* Compile-in strcmp() and strncmp() only when there's no libc */
+/* Compile-in the functions below only when there's no libc */
 #if !defined(TESTING) && !defined(USERMODE_APP)
 
-int strcmp(const char *s1, const char *s2)
+/*
+ * Word-at-a-time string functions
+ * ---------------------------------
+ *
+ * The functions below check a whole word (ulong) per iteration, once the
+ * pointers are aligned. Reading an aligned word is always safe, even if part of
+ * it is past the end of the string, because it cannot cross a page boundary.
+ * Unaligned words are read only when the whole word is within the buffer.
+ */
+
+typedef ulong __attribute__((__may_alias__)) aliased_ulong;
+
+#define WORD_SIZE                   sizeof(ulong)
+#define WORD_ONES                   ((ulong)-1 / 255)
+
+static ALWAYS_INLINE bool is_word_aligned(const void *p) {
+   return ((ulong)p & (WORD_SIZE - 1)) == 0;
+}
+
+static ALWAYS_INLINE ulong load_word(const void *p) {
+   return *(const aliased_ulong *)p;
+}
+
+size_t tilck_strlen(const char *str)
 {
-   while(*s1 && *s1 == *s2) {
-      s1++; s2++;
+   const char *p = str;
+
+   for (; !is_word_aligned(p); p++)
+      if (!*p)
+         return (size_t)(p - str);
+
+   while (!has_zero_byte(load_word(p)))
+      p += WORD_SIZE;
+
+   while (*p)
+      p++;
+
+   return (size_t)(p - str);
+}
+
+size_t tilck_strnlen(const char *str, size_t max_len)
+{
+   const char *p = str;
+   const char *end;
+
+   /* Avoid overflowing the pointer with max_len = SIZE_MAX and similar */
+   end = str + MIN(max_len, (size_t)~(ulong)str);
+
+   for (; p < end && !is_word_aligned(p); p++)
+      if (!*p)
+         return (size_t)(p - str);
+
+   for (; (size_t)(end - p) >= WORD_SIZE; p += WORD_SIZE)
+      if (has_zero_byte(load_word(p)))
+         break;
+
+   while (p < end && *p)
+      p++;
+
+   return (size_t)(p - str);
+}
+
+int tilck_strcmp(const char *s1, const char *s2)
+{
+   const u8 *a = (const u8 *)s1;
+   const u8 *b = (const u8 *)s2;
+   ulong w;
+
+   /* Going word by word is possible only when the alignment is the same */
+   if ((((ulong)a ^ (ulong)b) & (WORD_SIZE - 1)) == 0) {
+
+      for (; !is_word_aligned(a); a++, b++)
+         if (!*a || *a != *b)
+            return (int)*a - (int)*b;
+
+      for (; ; a += WORD_SIZE, b += WORD_SIZE) {
+
+         w = load_word(a);
+
+         if (w != load_word(b) || has_zero_byte(w))
+            break;
+      }
+   }
+
+   while (*a && *a == *b) {
+      a++; b++;
    }
 
-   return (int)*s1 - (int)*s2;
+   return (int)*a - (int)*b;
 }
 
-int strncmp(const char *s1, const char *s2, size_t n)
+int tilck_strncmp(const char *s1, const char *s2, size_t n)
 {
-   size_t i = 0;
+   const u8 *a = (const u8 *)s1;
+   const u8 *b = (const u8 *)s2;
+   ulong w;
+
+   if ((((ulong)a ^ (ulong)b) & (WORD_SIZE - 1)) == 0) {
+
+      for (; n > 0 && !is_word_aligned(a); a++, b++, n--)
+         if (!*a || *a != *b)
+            return (int)*a - (int)*b;
 
-   while(i < n && *s1 && *s1 == *s2) {
-      s1++; s2++; i++;
+      for (; n >= WORD_SIZE; a += WORD_SIZE, b += WORD_SIZE, n -= WORD_SIZE) {
+
+         w = load_word(a);
+
+         if (w != load_word(b) || has_zero_byte(w))
+            break;
+      }
    }
 
-   return i == n ? 0 : (int)*s1 - (int)*s2;
+   for (; n > 0; a++, b++, n--)
+      if (!*a || *a != *b)
+         return (int)*a - (int)*b;
+
+   return 0;
 }
 
-int memcmp(const void *_m1, const void *_m2, size_t n)
+int tilck_memcmp(const void *m1, const void *m2, size_t n)
 {
-   size_t i = 0;
-   const char *m1 = _m1;
-   const char *m2 = _m2;
+   const u8 *a = m1;
+   const u8 *b = m2;
+   ulong wa, wb;
 
-   while(i < n && *m1 == *m2) {
-      m1++; m2++; i++;
+   /* No alignment requirements here: we never read past `n` bytes */
+   for (; n >= WORD_SIZE; a += WORD_SIZE, b += WORD_SIZE, n -= WORD_SIZE) {
+
+      __builtin_memcpy(&wa, a, WORD_SIZE);
+      __builtin_memcpy(&wb, b, WORD_SIZE);
+
+      if (wa != wb)
+         break;
    }
 
-   return i == n ? 0 : (int)*m1 - (int)*m2;
+   for (; n > 0; a++, b++, n--)
+      if (*a != *b)
+         return (int)*a - (int)*b;
+
+   return 0;
 }
 
+void *tilck_memchr(const void *s, int c, size_t n)
+{
+   const u8 *p = s;
+   const u8 *end = p + n;
+   const ulong mask = WORD_ONES * (u8)c;
+
+   for (; p < end && !is_word_aligned(p); p++)
+      if (*p == (u8)c)
+         return (void *)p;
+
+   for (; (size_t)(end - p) >= WORD_SIZE; p += WORD_SIZE)
+      if (has_zero_byte(load_word(p) ^ mask))
+         break;
+
+   for (; p < end; p++)
+      if (*p == (u8)c)
+         return (void *)p;
+
+   return NULL;
+}
+
+size_t strlen(const char *str) \
+   __attribute__((alias("tilck_strlen")));
+
+size_t strnlen(const char *str, size_t max_len) \
+   __attribute__((alias("tilck_strnlen")));
+
+int strcmp(const char *s1, const char *s2) \
+   __attribute__((alias("tilck_strcmp")));
+
+int strncmp(const char *s1, const char *s2, size_t n) \
+   __attribute__((alias("tilck_strncmp")));
+
+int memcmp(const void *m1, const void *m2, size_t n) \
+   __attribute__((alias("tilck_memcmp")));
+
+void *memchr(const void *s, int c, size_t n) \
+   __attribute__((alias("tilck_memchr")));
+
 char *tilck_strstr(const char *haystack, const char *needle)
 {
    size_t sl, nl;
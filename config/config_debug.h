@@ -19,6 +19,9 @@
 
 /* disabled by default */
 #cmakedefine01 PANIC_SHOW_REGS
+#cmakedefine01 KERNEL_LOCKSTAT
+#cmakedefine01 KERNEL_SYSCALL_STATS
+#cmakedefine01 KERNEL_IRQSOFF_TRACER
 
 
 /*
@@ -40,6 +43,12 @@
 #define KMUTEX_STATS_ENABLED                    0
 #define SLOW_DEBUG_REF_COUNT                    0
 
+/* Max number of lock classes (call sites) tracked by KERNEL_LOCKSTAT */
+#define LOCKSTAT_MAX_CLASSES                  256   /* must be a power of 2 */
+
+/* Number of worst offenders (call sites) kept by KERNEL_IRQSOFF_TRACER */
+#define IRQSOFF_MAX_OFFENDERS                  16
+
 /* ------------------------------- */
 
 #if !KERNEL_GCOV
@@ -48,3 +48,28 @@
 #define WTH_MAX_PRIO_QUEUE_SIZE                    32
 #define WTH_KB_QUEUE_SIZE                          32
 #define WTH_SERIAL_QUEUE_SIZE                      32
+#define WTH_VTERM_QUEUE_SIZE                        4
+#define WTH_PRINTK_QUEUE_SIZE                       4
+
+/* Max yields before sleeping on a KMUTEX_FL_ADAPTIVE mutex (see sync.h) */
+#define KMUTEX_ADAPTIVE_MAX_YIELDS                  4
+
+/* Sampling profiler: samples in the per-boot buffer and max stack depth */
+#define PROF_MAX_SAMPLES                         4096
+#define PROF_MAX_FRAMES                             8
+
+/* Kernel log store: number of records (power of 2) and max text length */
+#if !TINY_KERNEL
+   #define KMSG_RECORDS                           256
+#else
+   #define KMSG_RECORDS                            32
+#endif
+
+#define KMSG_TEXT_MAX                             224
+
+/* Min size for kmemcpy() and kmemset() to use the FPU */
+#define KMEMCPY_FPU_MIN_SIZE                     2048
+
+/* Default ramfs quotas (see ramfs_create()) */
+#define RAMFS_DEF_MEM_PERCENT                      50
+#define RAMFS_BYTES_PER_INODE                     512
@@ -32,4 +32,23 @@
  * variable.
  */
 
-/* --- NOTHING HERE at the moment --- */
+/*
+ * Free heap memory reserved to the kernel: when the free memory gets below
+ * MAX(KMALLOC_LOW_MEM_RESERVE_MIN, <total heap memory> / DIV), optional
+ * consumers like ramfs refuse to allocate more memory. See kmalloc_is_low_mem().
+ */
+#define KMALLOC_LOW_MEM_RESERVE_MIN                  (1 * MB)
+#define KMALLOC_LOW_MEM_RESERVE_DIV                        16
+
+/*
+ * Small-allocation magazines: LIFO stacks of recently freed small-heap blocks,
+ * one per size class (powers of 2, from SMALL_HEAP_MBS to KMALLOC_MAG_MAX_BLOCK
+ * bytes), each holding up to KMALLOC_MAG_SIZE blocks. In the worst case, the
+ * magazines keep allocated less than:
+ *
+ *    2 * KMALLOC_MAG_SIZE * KMALLOC_MAG_MAX_BLOCK bytes.
+ *
+ * See kmalloc_magazines.c.h.
+ */
+#define KMALLOC_MAG_MAX_BLOCK                      256
+#define KMALLOC_MAG_SIZE                            32
@@ -15,7 +15,9 @@
 /* --------- Boolean config variables --------- */
 
 #cmakedefine01 FORK_NO_COW
+#cmakedefine01 FORK_LAZY_PT_COPY
 #cmakedefine01 MMAP_NO_COW
+#cmakedefine01 MMAP_TRANSP_BIG_PAGES
 
 
 /*
@@ -39,8 +41,8 @@
 #define USERMODE_VADDR_END   (KERNEL_BASE_VA) /* biggest user vaddr + 1 */
 #define MAX_BRK                  (0x40000000) /* +1 GB (virtual memory) */
 #define USER_MMAP_BEGIN               MAX_BRK /* +1 GB (virtual memory) */
-#define USER_MMAP_MIN_SZ            (16 * MB)
 #define USER_MMAP_MAX_SZ          (1024 * MB)
+#define USER_MMAP_END  (USER_MMAP_BEGIN + USER_MMAP_MAX_SZ) /* +2 GB */
 #define USERMODE_STACK_ALIGN              16u
 
 #define USERMODE_STACK_MAX \
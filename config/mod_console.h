@@ -16,6 +16,7 @@
 
 #cmakedefine01    MOD_console
 #cmakedefine01    TERM_BIG_SCROLL_BUF
+#cmakedefine01    TERM_DEFERRED_RENDER
 #cmakedefine01    KERNEL_SHOW_LOGO
 #cmakedefine01    SERIAL_CON_IN_VIDEO_MODE
 #cmakedefine01    KRN_PRINTK_ON_CURR_TTY
@@ -36,3 +37,5 @@
 #define TTY_INPUT_BS                                              1024
 #define FAILSAFE_COLS                                              80u
 #define FAILSAFE_ROWS                                              25u
+#define TERM_RENDER_FPS                                             30
+#define TERM_RENDER_MAX_ROWS                                       256
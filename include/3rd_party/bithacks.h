@@ -77,3 +77,13 @@ sign_extend(long val, ulong w)
    ulong m = (sizeof(long) * 8) - w;
    return (val << m) >> m;
 }
+
+/*
+ * Determine if a word has a zero byte
+ */
+CONSTEXPR static ALWAYS_INLINE bool
+has_zero_byte(ulong v)
+{
+   const ulong ones = (ulong)-1 / 255;    /* 0x01 in every byte */
+   return ((v - ones) & ~v & (ones << 7)) != 0;
+}
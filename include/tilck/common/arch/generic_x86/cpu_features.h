@@ -92,6 +92,8 @@ struct x86_cpu_features {
    } ecx1;
 
    bool avx2;
+   bool xsaveopt;       /* CPUID[0xD, 1].EAX[0] */
+   bool xsavec;         /* CPUID[0xD, 1].EAX[1] */
    bool invariant_TSC;
    u8 phys_addr_bits;
    u8 virt_addr_bits;
@@ -19,6 +19,17 @@
 #define __X86INTRIN_H            /* for clang */
 #include <ia32intrin.h>
 
+#if defined(__TILCK_KERNEL__) && !defined(UNIT_TEST_ENVIRONMENT)
+   #include <tilck_gen_headers/config_debug.h>
+   #define IRQSOFF_HOOKS                 KERNEL_IRQSOFF_TRACER
+#else
+   #define IRQSOFF_HOOKS                 0
+#endif
+
+/* Kernel-only hooks, see <tilck/kernel/irqsoff.h> */
+void irqsoff_irqs_disabled(void);
+void irqsoff_irqs_enabled(void);
+
 #define X86_PC_TIMER_IRQ           0
 #define X86_PC_KEYBOARD_IRQ        1
 #define X86_PC_COM2_COM4_IRQ       3
@@ -239,13 +250,21 @@ static ALWAYS_INLINE void disable_interrupts(ulong *const var)
    *var = get_eflags();
 
    if (*var & EFLAGS_IF) {
+
       disable_interrupts_forced();
+
+      if (IRQSOFF_HOOKS)
+         irqsoff_irqs_disabled();
    }
 }
 
 static ALWAYS_INLINE void enable_interrupts(const ulong *const var)
 {
    if (*var & EFLAGS_IF) {
+
+      if (IRQSOFF_HOOKS)
+         irqsoff_irqs_enabled();
+
       enable_interrupts_forced();
    }
 }
@@ -266,14 +285,21 @@ static ALWAYS_INLINE void write_back_and_invl_cache(void)
    asmVolatile("wbinvd");
 }
 
-static ALWAYS_INLINE void cpuid(u32 code, u32 *a, u32 *b, u32 *c, u32 *d)
+/* Like cpuid(), but for the leaves having sub-leaves (selected by ECX) */
+static ALWAYS_INLINE void
+cpuid_count(u32 code, u32 subcode, u32 *a, u32 *b, u32 *c, u32 *d)
 {
     asm("cpuid"
         : "=a"(*a), "=b" (*b), "=c" (*c), "=d"(*d)
-        : "a"(code), "b" (0), "c" (0), "d" (0)
+        : "a"(code), "b" (0), "c" (subcode), "d" (0)
         : "memory");
 }
 
+static ALWAYS_INLINE void cpuid(u32 code, u32 *a, u32 *b, u32 *c, u32 *d)
+{
+   cpuid_count(code, 0, a, b, c, d);
+}
+
 static ALWAYS_INLINE ulong read_cr0(void)
 {
    ulong res;
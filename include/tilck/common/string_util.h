@@ -29,9 +29,12 @@
 
 #endif
 
+size_t strlen(const char *str);
+size_t strnlen(const char *str, size_t max_len);
 int strcmp(const char *s1, const char *s2);
 int strncmp(const char *s1, const char *s2, size_t n);
 int memcmp(const void *m1, const void *m2, size_t n);
+void *memchr(const void *s, int c, size_t n);
 char *strstr(const char *haystack, const char *needle);
 char *strcpy(char *dest, const char *src);
 char *strncpy(char *dest, const char *src, size_t n);
@@ -113,9 +116,12 @@ void uitoaN_hex_fixed(ulong value, char *buf);    /* pointer-size */
 
 long tilck_strtol(const char *str, const char **endptr, int base, int *error);
 ulong tilck_strtoul(const char *str, const char **endptr, int base, int *error);
+size_t tilck_strlen(const char *str);
+size_t tilck_strnlen(const char *str, size_t max_len);
 int tilck_strcmp(const char *s1, const char *s2);
 int tilck_strncmp(const char *s1, const char *s2, size_t n);
 int tilck_memcmp(const void *m1, const void *m2, size_t n);
+void *tilck_memchr(const void *s, int c, size_t n);
 char *tilck_strstr(const char *haystack, const char *needle);
 char *tilck_strcpy(char *dest, const char *src);
 char *tilck_strncpy(char *dest, const char *src, size_t n);
@@ -17,9 +17,10 @@ enum tilck_cmd {
    TILCK_CMD_TRACING_TOOL        = 7,
    TILCK_CMD_PS_TOOL             = 8,
    TILCK_CMD_DEBUGGER_TOOL       = 9,
+   TILCK_CMD_FIND_SYM            = 10,
 
    /* Number of elements in the enum */
-   TILCK_CMD_COUNT               = 10,
+   TILCK_CMD_COUNT               = 11,
 };
 
 #if defined(__x86_64__)
@@ -16,6 +16,9 @@
 #define TILCK_IOCTL_SOUND_CONTINUE           5
 #define TILCK_IOCTL_SOUND_GET_INFO           6
 #define TILCK_IOCTL_SOUND_WAIT_COMPLETION    7
+#define TILCK_IOCTL_SOUND_RING_SETUP         8
+#define TILCK_IOCTL_SOUND_RING_COMMIT        9
+#define TILCK_IOCTL_SOUND_GET_POS           10
 
 /* Used with TILCK_IOCTL_SOUND_GET_INFO */
 struct tilck_sound_card_info {
@@ -34,3 +37,40 @@ struct tilck_sound_params {
    u8 channels;      /* 1 or 2 */
    u8 sign;          /* 0 = unsigned, 1 = signed */
 };
+
+/*
+ * Ring-buffer mode
+ *
+ * After TILCK_IOCTL_SOUND_SETUP, TILCK_IOCTL_SOUND_RING_SETUP switches the
+ * device to ring-buffer mode: the card plays in loop the whole DMA buffer
+ * (`ring_size` bytes), which the application maps with mmap(), raising an IRQ
+ * every `period_size` bytes. The application writes samples in the ring and
+ * then commits them with TILCK_IOCTL_SOUND_RING_COMMIT (argument: pointer to
+ * u32, number of bytes). Playback starts as soon as one whole period has been
+ * committed and pauses (underrun) when the card reaches a period which is not
+ * fully committed. The device is ready for writing (poll(), select()) when at
+ * least one period is free. TILCK_IOCTL_SOUND_WAIT_COMPLETION pads the last
+ * period with silence and waits for the playback to end.
+ *
+ * When the owner releases the device (or exits), the ring is unmapped from all
+ * the processes that mapped it: touching those mappings causes SIGBUS.
+ */
+
+/* Used with TILCK_IOCTL_SOUND_RING_SETUP */
+struct tilck_sound_ring_params {
+
+   u32 period_size;  /* [in]  power of 2, from 1 KB to ring_size / 2 */
+   u32 ring_size;    /* [out] size of the ring buffer */
+};
+
+/*
+ * Used with TILCK_IOCTL_SOUND_GET_POS. The positions are byte counters which
+ * wrap around at 2^32: the offset in the ring is `pos % ring_size`.
+ */
+struct tilck_sound_pos {
+
+   u32 hw_pos;       /* bytes played by the card */
+   u32 appl_pos;     /* bytes committed by the application */
+   u32 period_size;
+   u32 xruns;        /* underruns since TILCK_IOCTL_SOUND_RING_SETUP */
+};
@@ -64,6 +64,19 @@ bintree_find_internal(void *root_obj,
                       cmpfun_ptr objval_cmpfun,   // cmp(root_obj, value_ptr)
                       long bintree_offset);
 
+/*
+ * bintree_lower_bound_internal() returns the smallest object `obj` in the tree
+ * such that objval_cmpfun(obj, value_ptr) >= 0, or NULL if there's no such
+ * object. In other words, it returns the exact match, if any, or the first
+ * object "bigger" than the given value. The compare function has the same
+ * semantics as the one used by bintree_find_internal().
+ */
+void *
+bintree_lower_bound_internal(void *root_obj,
+                             const void *value_ptr,
+                             cmpfun_ptr objval_cmpfun, // cmp(root_obj, val)
+                             long bintree_offset);
+
 
 /*
  * returns a pointer to the removed object (if found) or NULL.
@@ -151,6 +164,12 @@ bintree_remove_ptr_internal(void **root_obj_ref,
                              OFFSET_OF(struct_type, elem_name),               \
                              OFFSET_OF(struct_type, field_name))
 
+#define bintree_lower_bound(root_obj, value, objval_cmpfun,                   \
+                            struct_type, elem_name)                           \
+   bintree_lower_bound_internal((void*)(root_obj),                            \
+                                (value), (objval_cmpfun),                     \
+                                OFFSET_OF(struct_type, elem_name))
+
 #define bintree_remove(rootref, value, objval_cmpfun, struct_type, elem_name) \
    bintree_remove_internal((void**)(rootref),                                 \
                            (value), (objval_cmpfun),                          \
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Boot-time profiler
+ *
+ * Records the start and the duration of each boot phase (the init steps in
+ * kmain() and do_async_init(), each kernel module and a few other steps like
+ * the bogoMips measurement) in TSC cycles, relative to the beginning of
+ * kmain(). Phases can run concurrently (e.g. modules initialized on worker
+ * threads): that's why each phase records the tid of the task running it.
+ *
+ * At the end of the boot, the TSC frequency is estimated by comparing the TSC
+ * with the timer ticks elapsed since the scheduler started, in order to show
+ * the phases in microseconds as well.
+ */
+
+#define BOOT_PROF_MAX_PHASES           64
+
+#define BOOT_PH_MODULE                  (1 << 0)   /* a kernel module */
+#define BOOT_PH_ASYNC                   (1 << 1)   /* not on the init thread */
+
+struct boot_phase {
+
+   const char *name;
+   u64 start;              /* TSC cycles since the beginning of kmain() */
+   u64 cycles;             /* duration, 0 while running */
+   int tid;
+   u32 flags;
+};
+
+struct boot_prof_info {
+
+   u32 count;              /* number of phases recorded */
+   u32 lost;               /* phases not recorded (table full) */
+   u64 total_cycles;       /* from kmain() to boot_prof_done(), 0 before */
+   u64 tsc_hz;             /* estimated TSC frequency, 0 if unknown */
+};
+
+void init_boot_prof(void);
+
+/*
+ * Start a new phase, returning its id (or -1, if the table is full). The
+ * `name` string must be static.
+ */
+int boot_prof_begin(const char *name, u32 flags);
+void boot_prof_end(int id);
+
+/* Called at the end of the boot, before running init (or a selftest) */
+void boot_prof_done(void);
+
+void boot_prof_get_info(struct boot_prof_info *info);
+u32 boot_prof_get_phases(struct boot_phase *buf, u32 off, u32 max);
+u64 boot_prof_cycles_to_us(u64 cycles, u64 tsc_hz);
+
+/* Run `func()` as a boot phase named after it */
+#define BOOT_STEP(func)                                           \
+   do {                                                           \
+      const int __bp_id = boot_prof_begin(#func, 0);              \
+      func();                                                     \
+      boot_prof_end(__bp_id);                                     \
+   } while (0)
@@ -21,7 +21,12 @@ extern bool kopt_panic_nobt;
 extern bool kopt_panic_regs;
 extern bool kopt_panic_mmap;
 extern bool kopt_big_scroll_buf;
+extern bool kopt_deferred_render;
 extern bool kopt_ps2_log;
 extern bool kopt_ps2_selftest;
+extern long kopt_ramfs_max_mb;
+extern long kopt_ramfs_max_inodes;
+extern bool kopt_bootprof;
+extern bool kopt_no_par_mods;
 
 void parse_kernel_cmdline(const char *cmdline);
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/paging.h>
+
+/*
+ * Shared page cache for file systems whose data is not already stored in
+ * page-aligned memory (e.g. FAT with clusters not aligned at PAGE_SIZE).
+ *
+ * Pages are identified by the tuple (fs, inode, page index) and are filled
+ * on-demand by a fs-specific callback. Once in the cache, a page is shared by
+ * all the mappings of the same file range, in all the processes.
+ */
+
+/*
+ * Fills `buf` (PAGE_SIZE bytes) with the content of the page `pg` of `inode`.
+ * The part of the page past the EOF, if any, must be zero-filled. `arg` is an
+ * opaque pointer passed as-it-is from the caller of pcache_mmap().
+ */
+typedef int (*pcache_fill_func)(struct mnt_fs *fs,
+                                vfs_inode_ptr_t inode,
+                                ulong pg,
+                                void *buf,
+                                void *arg);
+
+struct pcache_stats {
+
+   size_t pages;              /* pages currently in the cache */
+   u64 hits;
+   u64 misses;
+   u64 evictions;
+};
+
+int
+pcache_mmap(struct mnt_fs *fs,
+            vfs_inode_ptr_t inode,
+            offt fsize,
+            struct user_mapping *um,
+            pdir_t *pdir,
+            pcache_fill_func fill,
+            void *arg);
+
+size_t pcache_shrink(void);
+void pcache_drop_fs(struct mnt_fs *fs);
+void pcache_get_stats(struct pcache_stats *stats);
@@ -22,6 +22,12 @@ struct vfs_dent64 {
    enum vfs_entry_type type;
    u8 name_len;               /* NODE: includes the final '\0' */
    const char *name;
+
+   /*
+    * Opaque position of the next entry, as accepted by the fs' seek(). Zero
+    * means that positions are just sequential entry numbers.
+    */
+   offt next_off;
 };
 
 typedef int (*get_dents_func_cb) (struct vfs_dent64 *, void *);
@@ -63,6 +69,8 @@ typedef int     (*func_stat)   (struct mnt_fs *,
                                 vfs_inode_ptr_t,
                                 struct k_stat64 *);
 
+typedef int     (*func_statfs) (struct mnt_fs *, struct k_statfs64 *);
+
 typedef int     (*func_trunc)  (struct mnt_fs *,
                                 vfs_inode_ptr_t,
                                 offt);
@@ -141,6 +149,7 @@ struct fs_ops {
    func_rr_inode retain_inode;
    func_rr_inode release_inode;
    func_syncfs syncfs;
+   func_statfs statfs;                 /* if NULL, just generic info */
 
    /* file system structure lock funcs */
    func_fslock_t fs_exlock;
@@ -200,10 +209,12 @@ int vfs_chmod(const char *path, mode_t mode);
 int vfs_rename(const char *oldpath, const char *newpath);
 int vfs_link(const char *oldpath, const char *newpath);
 int vfs_utimens(const char *path, const struct k_timespec64 times[2]);
+int vfs_statfs(const char *path, struct k_statfs64 *buf);
 
 int vfs_ftruncate(fs_handle h, offt length);
 int vfs_ioctl(fs_handle h, ulong request, void *argp);
 int vfs_fstat64(fs_handle h, struct k_stat64 *statbuf);
+int vfs_fstatfs(fs_handle h, struct k_statfs64 *buf);
 int vfs_getdents64(fs_handle h, struct linux_dirent64 *dirp, u32 bs);
 int vfs_fchmod(fs_handle h, mode_t mode);
 int vfs_futimens(fs_handle h, const struct k_timespec64 times[2]);
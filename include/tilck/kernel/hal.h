@@ -51,9 +51,9 @@ void set_kernel_stack(ulong stack);
 void enable_cpu_features(void);
 void fpu_context_begin(void);
 void fpu_context_end(void);
-void save_current_fpu_regs(bool in_kernel);
-void restore_fpu_regs(void *task, bool in_kernel);
-void restore_current_fpu_regs(bool in_kernel);
+bool fpu_context_try_begin(void);
+bool fpu_is_task_owner(void *task);
+void fpu_forget_task(void *task);
 int get_irq_num(regs_t *context);
 int get_int_num(regs_t *context);
 void on_first_pdir_update(void);
@@ -61,9 +61,27 @@ void hw_read_clock(struct datetime *out);
 u32 hw_timer_setup(u32 hz);
 
 bool allocate_fpu_regs(arch_task_members_t *arch_fields);
+void reset_fpu_regs(arch_task_members_t *arch_fields);
 void copy_main_tss_on_regs(regs_t *ctx);
 void arch_add_initial_mem_regions();
 bool arch_add_final_mem_regions();
 
+/*
+ * Size-dispatched memcpy() and memset() for potentially large buffers: they use
+ * the FPU (see fpu_memcpy.h) when it's possible and worth it, falling back to
+ * the regular functions otherwise. Not for user pointers: see copy_to_user().
+ */
+void kmemcpy(void *dest, const void *src, size_t n);
+void kmemset(void *dest, int c, size_t n);
+
+/*
+ * The pieces kmemcpy() is made of, for callers which need to do something
+ * inside the FPU context: fpu_memcpy_begin() starts the context only when an
+ * FPU copy of `n` bytes from `src` to `dest` is possible and worth it. In that
+ * case, the caller must use fpu_memcpy() and then call fpu_context_end().
+ */
+bool fpu_memcpy_begin(void *dest, const void *src, size_t n);
+void fpu_memcpy(void *dest, const void *src, size_t n);
+
 #define get_task_arch_fields(ti) ((arch_task_members_t*)(void*)((ti)->ti_arch))
 #define get_proc_arch_fields(pi) ((arch_proc_members_t*)(void*)((pi)->pi_arch))
@@ -9,6 +9,12 @@
 
 void set_fault_handler(int fault, void *ptr);
 
+/*
+ * Registers of the context interrupted by the current IRQ. Valid only while
+ * running an IRQ handler (e.g. used by the sampling profiler).
+ */
+regs_t *get_irq_regs(void);
+
 static ALWAYS_INLINE bool in_irq(void)
 {
    extern ATOMIC(int) __in_irq_count;
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * IRQs-off and preemption-off sections tracer (KERNEL_IRQSOFF_TRACER)
+ *
+ * The tracer timestamps the transitions of the IRQs from enabled to disabled
+ * (and back) made by disable_interrupts() and enable_interrupts() and the
+ * transitions of the preemption counter from 0 to 1 (and back). For each
+ * kind of section, it keeps the worst offenders, identified by the call site
+ * where the section started.
+ *
+ * The raw disable_interrupts_forced() and enable_interrupts_forced() calls,
+ * used by the low-level entry/exit paths, are not tracked.
+ *
+ * All the times are measured in TSC cycles.
+ */
+
+enum irqsoff_type {
+
+   IRQSOFF_IRQS,
+   IRQSOFF_PREEMPT,
+
+   IRQSOFF_TYPES_COUNT
+};
+
+struct irqsoff_offender {
+
+   ulong start_site;          /* where the section started */
+   ulong end_site;            /* where the longest section ended */
+   u64 count;                 /* number of sections started here */
+   u64 max_cycles;            /* duration of the longest section */
+};
+
+struct irqsoff_info {
+
+   u64 sections;
+   u64 tot_cycles;
+   u64 max_cycles;
+};
+
+/*
+ * Hooks, called by the IRQ and preemption primitives. Except for
+ * irqsoff_preempt_enabled_at(), they use their return address as call site.
+ */
+void irqsoff_irqs_disabled(void);
+void irqsoff_irqs_enabled(void);
+void irqsoff_preempt_disabled(void);
+void irqsoff_preempt_enabled(void);
+void irqsoff_preempt_enabled_at(ulong site);
+
+#if KERNEL_IRQSOFF_TRACER
+
+   /* Start tracking the sections (the early boot ones are not interesting) */
+   void irqsoff_tracer_enable(void);
+
+   /*
+    * Copy up to `max` offenders of type `t` in `buf`, sorted by the longest
+    * section (desc). Returns the number of offenders copied.
+    */
+   int
+   irqsoff_get_offenders(enum irqsoff_type t,
+                         struct irqsoff_offender *buf,
+                         int max);
+
+   void irqsoff_get_info(enum irqsoff_type t, struct irqsoff_info *info);
+   void irqsoff_reset(void);
+   const char *irqsoff_type_str(enum irqsoff_type t);
+
+#else
+
+   static inline void irqsoff_tracer_enable(void) { }
+
+#endif
@@ -120,6 +120,19 @@ kmalloc_get_heap_struct_size(void);
 size_t
 kmalloc_get_max_tot_heap_free(void);
 
+size_t
+kmalloc_get_tot_heap_free(void);
+
+size_t
+kmalloc_get_low_mem_reserve(void);
+
+/* Releases to the heaps all the blocks cached in the kmalloc magazines */
+void
+kmalloc_flush_magazines(void);
+
+bool
+kmalloc_is_low_mem(void);
+
 void *
 aligned_kmalloc(size_t size, u32 align);
 
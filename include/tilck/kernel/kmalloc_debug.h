@@ -24,6 +24,45 @@ struct kmalloc_small_heaps_stats {
    int lifetime_created_heaps_count;
 };
 
+#define KMALLOC_FRAG_ORDERS                  (8 * sizeof(ulong))
+
+/*
+ * Fragmentation info for a heap (or for the small heaps as a whole), obtained
+ * by walking its tree of blocks. A free block is a node of the tree that is
+ * free while its parent is not: it's the largest allocation that could be
+ * satisfied with that memory.
+ */
+struct debug_kmalloc_frag_info {
+
+   size_t free_mem;              /* sum of the sizes of all the free blocks */
+   size_t largest_free_block;    /* the largest possible allocation */
+   size_t free_blocks_count;
+
+   /* Number of free blocks, per order: free_blocks[i] = count of size 2^i */
+   size_t free_blocks[KMALLOC_FRAG_ORDERS];
+};
+
+/*
+ * How much of the free memory is NOT usable for a single allocation, in
+ * percents: 0 means that all the free memory is in one block.
+ */
+static inline int
+debug_kmalloc_frag_percent(const struct debug_kmalloc_frag_info *fi)
+{
+   if (!fi->free_mem)
+      return 0;
+
+   return (int)(100 - (u64)fi->largest_free_block * 100 / fi->free_mem);
+}
+
+/* Allocations made from a given call site (KMALLOC_HEAVY_STATS only) */
+struct debug_kmalloc_site {
+
+   ulong site;                   /* return address of general_kmalloc() */
+   size_t count;
+   size_t bytes;
+};
+
 struct debug_kmalloc_chunks_ctx {
    struct bintree_walk_ctx ctx;
 };
@@ -44,6 +83,27 @@ debug_kmalloc_get_heap_info_by_ptr(struct kmalloc_heap *h,
 void
 debug_kmalloc_get_stats(struct debug_kmalloc_stats *stats);
 
+bool
+debug_kmalloc_get_heap_frag(int heap_num, struct debug_kmalloc_frag_info *fi);
+
+void
+debug_kmalloc_get_heap_frag_by_ptr(struct kmalloc_heap *h,
+                                   struct debug_kmalloc_frag_info *fi);
+
+void
+debug_kmalloc_get_small_heaps_frag(struct debug_kmalloc_frag_info *fi);
+
+/*
+ * Copies in `buf` up to `max` allocation sites, sorted by allocated bytes
+ * (desc), and returns their number. Always 0 without KMALLOC_HEAVY_STATS.
+ */
+int
+debug_kmalloc_get_sites(struct debug_kmalloc_site *buf, int max);
+
+/* Number of allocations not attributed because the sites table was full */
+size_t
+debug_kmalloc_get_sites_dropped(void);
+
 void
 debug_kmalloc_chunks_stats_start_read(struct debug_kmalloc_chunks_ctx *ctx);
 
@@ -60,3 +120,6 @@ void debug_kmalloc_stop_leak_detector(bool show_leaks);
 
 void debug_kmalloc_start_log(void);
 void debug_kmalloc_stop_log(void);
+
+/* Enables/disables the small-allocation magazines. Returns the old state. */
+bool debug_kmalloc_set_magazines(bool enabled);
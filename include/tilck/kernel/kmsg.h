@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Kernel log store
+ *
+ * Every printk() message becomes a record in a fixed-size array of slots,
+ * indexed by a monotonic sequence number (starting from 1). Writers reserve
+ * a sequence number with an atomic increment and commit the record when it's
+ * complete: no locks are involved, therefore printk() can be called from any
+ * context, including IRQ handlers. When the store is full, the oldest records
+ * get overwritten. Readers (the console flusher and /dev/kmsg) keep their own
+ * cursor and detect both not-yet-committed and overwritten records.
+ */
+
+#define KMSG_LVL_EMERG                 0
+#define KMSG_LVL_ALERT                 1
+#define KMSG_LVL_CRIT                  2
+#define KMSG_LVL_ERR                   3
+#define KMSG_LVL_WARN                  4
+#define KMSG_LVL_NOTICE                5
+#define KMSG_LVL_INFO                  6
+#define KMSG_LVL_DEBUG                 7
+
+#define KMSG_FL_CONT                   (1 << 0)   /* continues prev. line */
+#define KMSG_FL_NO_PREFIX              (1 << 1)   /* no timestamp prefix */
+#define KMSG_FL_LOWSS                  (1 << 2)   /* low stack space */
+
+struct tty;
+
+struct kmsg_record {
+
+   u32 seq;
+   int tid;
+   u64 ts;                 /* system time, in TS_SCALE units */
+   struct tty *tty;        /* tty to write on, NULL for the current term */
+   u8 level;
+   u8 flags;
+   u16 len;                /* text length, without the final \0 */
+   char text[KMSG_TEXT_MAX];
+};
+
+/* Appends a record (truncating `text`, if necessary) and returns its seq */
+u32 kmsg_append(u8 level, u8 flags, struct tty *t, const char *text, u32 len);
+
+/*
+ * Copies the record `seq` in `r`. Returns 0 in case of success, -ENOENT if the
+ * record has not been committed yet and -EPIPE if it has been overwritten.
+ */
+int kmsg_read(u32 seq, struct kmsg_record *r);
+
+/* Like kmsg_read(), but without copying the record */
+int kmsg_peek(u32 seq);
+
+/* Returns the seq the next record will get */
+u32 kmsg_next_seq(void);
+
+/* Returns the seq of the oldest record still (potentially) in the store */
+u32 kmsg_first_seq(void);
+
+void init_kmsg_dev(void);
+
+/* printk.c */
+void printk_log_text(u8 level, const char *text, u32 len);
+void init_printk_async_flush(void);
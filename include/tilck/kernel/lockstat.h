@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Lock contention statistics (KERNEL_LOCKSTAT)
+ *
+ * Each lock class is identified by the call site of the lock function (e.g.
+ * the return address of kmutex_lock()) and by the type of lock operation. That
+ * allows to tell apart locks of the same type used for different purposes: for
+ * example ramfs' per-fs rwlock and the per-inode ones.
+ *
+ * All the times are measured in TSC cycles.
+ */
+
+enum lockstat_type {
+
+   LOCKSTAT_KMUTEX,
+   LOCKSTAT_RWLOCK_RP_SH,
+   LOCKSTAT_RWLOCK_RP_EX,
+   LOCKSTAT_RWLOCK_WP_SH,
+   LOCKSTAT_RWLOCK_WP_EX,
+   LOCKSTAT_KCOND,
+};
+
+struct lockstat_class {
+
+   ulong site;                   /* call site of the lock function */
+   enum lockstat_type type;
+   u64 acquired;                 /* for kcond: number of waits */
+   u64 contended;                /* acquisitions that had to wait */
+   u64 wait_cycles;              /* total time spent waiting */
+   u64 max_hold_cycles;          /* only for exclusive locks */
+};
+
+/* Per-lock state, used to measure the time it's held */
+struct lockstat_hold {
+
+   struct lockstat_class *c;
+   u64 start;
+};
+
+#if KERNEL_LOCKSTAT
+
+   #define LOCKSTAT_ONLY(x) x
+   #define LOCKSTAT_SITE() ((ulong)__builtin_return_address(0))
+
+   u64 lockstat_now(void);
+
+   /*
+    * Record an acquisition at `site`, started at `start` (see lockstat_now()).
+    * The wait time is accounted only when `contended` is true. When `h` is not
+    * NULL, it starts measuring the hold time as well.
+    */
+   void
+   lockstat_acquired(struct lockstat_hold *h,
+                     ulong site,
+                     enum lockstat_type type,
+                     bool contended,
+                     u64 start);
+
+   void lockstat_released(struct lockstat_hold *h);
+
+   /*
+    * Copy up to `max` classes in `buf`, sorted by total wait time (desc).
+    * Returns the number of classes copied.
+    */
+   int lockstat_get_classes(struct lockstat_class *buf, int max);
+
+   u32 lockstat_get_dropped(void);
+   void lockstat_reset(void);
+   const char *lockstat_type_str(enum lockstat_type type);
+
+#else
+
+   #define LOCKSTAT_ONLY(x)
+
+#endif
@@ -5,11 +5,24 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/list.h>
 
+#define MOD_MAX_DEPS                             4
+
 struct module {
 
    const char *name;
    int priority;
    void (*init)(void);
+
+   /*
+    * By default, modules are initialized one by one on the init thread, in
+    * priority order: each module can rely on all the modules with a lower
+    * priority. An `async` module, instead, declares the modules it depends on
+    * in `deps` (by name: the modules not compiled-in are ignored) and it's
+    * initialized on a worker thread as soon as they're ready, concurrently
+    * with the others.
+    */
+   bool async;
+   const char *deps[MOD_MAX_DEPS];
 };
 
 void init_modules(void);
@@ -31,6 +44,7 @@ void register_module(struct module *m);
 #define MOD_kb_prio                           50
 #define MOD_tracing_prio                     100
 #define MOD_tty_prio                         200
+#define MOD_vterm_prio                       210
 #define MOD_fbdev_prio                       300
 #define MOD_serial_prio                      400
 #define MOD_sb16_prio                        410
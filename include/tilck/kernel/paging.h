@@ -8,6 +8,9 @@
 
 #ifdef __i386__
    #define PAGE_DIR_SIZE (PAGE_SIZE)
+   #define BIG_PAGE_SIZE (4 * MB)
+#else
+   #define BIG_PAGE_SIZE (2 * MB)
 #endif
 
 #define OFFSET_IN_PAGE_MASK                        (PAGE_SIZE - 1)
@@ -77,6 +80,26 @@ map_zero_pages(pdir_t *pdir,
                size_t page_count,
                u32 pg_flags);
 
+/*
+ * Map a big page (BIG_PAGE_SIZE bytes) at `vaddr`, which has to be aligned at
+ * BIG_PAGE_SIZE. Supports the same `pg_flags` as map_page(), but it's meant to
+ * be used only for user mappings: the kernel uses map_pages() with
+ * PAGING_FL_BIG_PAGES_ALLOWED for its own mappings. The ref-count of a big
+ * pageframe is the one of its first pageframe.
+ */
+
+NODISCARD int
+map_big_page(pdir_t *pdir, void *vaddr, ulong paddr, u32 pg_flags);
+
+void unmap_big_page(pdir_t *pdir, void *vaddr, bool do_free);
+
+/*
+ * Allocate/free a physically-contiguous block of BIG_PAGE_SIZE bytes, aligned
+ * at BIG_PAGE_SIZE, usable as pageframe for map_big_page().
+ */
+void *alloc_big_pageframe(void);
+void free_big_pageframe(void *ptr);
+
 void init_paging(void);
 bool is_mapped(pdir_t *pdir, void *vaddr);
 bool is_rw_mapped(pdir_t *pdir, void *vaddrp);
@@ -93,6 +116,7 @@ void invalidate_page(ulong vaddr);
 void set_page_rw(pdir_t *pdir, void *vaddr, bool rw);
 void retain_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
 void release_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
+u32 get_pageframe_ref_count_at(pdir_t *pdir, void *vaddr);
 
 static ALWAYS_INLINE pdir_t *get_kernel_pdir(void)
 {
@@ -26,11 +26,16 @@ struct kernel_alloc {
    size_t size;
 };
 
+struct user_vgap;
+
 struct mappings_info {
 
-   struct kmalloc_heap *mmap_heap;
-   size_t mmap_heap_size;
-   struct list mappings;
+   struct list mappings;                  /* all the mappings, unordered */
+   struct user_mapping *mappings_tree;    /* all the mappings, by vaddr */
+
+   /* Free ranges in the mmap area. See kernel/mm/user_vspace.c */
+   struct user_vgap *gaps_by_end;
+   struct user_vgap *gaps_by_size;
 };
 
 struct process {
@@ -53,7 +58,7 @@ struct process {
    bool did_call_execve;
    bool automatic_reaping;       /* the parent explicitly ignored SIGCHLD */
    bool vforked;                 /* after vfork(), before execve() */
-   bool inherited_mmap_heap;
+   bool inherited_mi;
    bool did_set_tty_medium_raw;
 
    int *set_child_tid;                    /* NOTE: this is an user pointer */
@@ -5,9 +5,13 @@
 #include <tilck/kernel/fs/vfs_base.h>
 #include <tilck/kernel/paging.h>
 #include <tilck/kernel/list.h>
+#include <tilck/kernel/bintree.h>
+
+struct mappings_info;
 
 struct user_mapping {
 
+   struct bintree_node tree_node;
    struct list_node pi_node;
    struct list_node inode_node;
    struct process *pi;
@@ -22,12 +26,12 @@ struct user_mapping {
    };
 
    int prot;
-
+   bool big_pages;     /* anonymous mapping backed by BIG_PAGE_SIZE pages */
 };
 
 struct user_mapping *
 process_add_user_mapping(fs_handle h, void *v, size_t ln, size_t off, int prot);
-void process_remove_user_mapping(struct user_mapping *um);
+void process_remove_user_mapping(struct process *pi, struct user_mapping *um);
 void full_remove_user_mapping(struct process *pi, struct user_mapping *um);
 void remove_all_mappings_of_handle(struct process *pi, fs_handle h);
 void remove_all_user_zero_mem_mappings(struct process *pi);
@@ -42,7 +46,17 @@ bool user_valloc_and_map(ulong user_vaddr, size_t page_count);
 void user_vfree_and_unmap(ulong user_vaddr, size_t page_count);
 void user_unmap_zero_page(ulong user_vaddr, size_t page_count);
 bool user_map_zero_page(ulong user_vaddr, size_t page_count);
+bool user_map_big_pages(ulong user_vaddr, size_t page_count);
+void user_unmap_big_pages(ulong user_vaddr, size_t page_count);
+bool user_map_anon_mem(ulong user_vaddr, size_t page_count, bool big_pages);
+void user_unmap_anon_mem(ulong user_vaddr, size_t page_count, bool big_pages);
 int generic_fs_munmap(struct user_mapping *um, void *vaddrp, size_t len);
 
+int user_vspace_init(struct mappings_info *mi);
+void user_vspace_destroy(struct mappings_info *mi);
+int user_vspace_dup(struct mappings_info *dst, struct mappings_info *src);
+ulong user_vspace_alloc(struct mappings_info *mi, size_t len, size_t align);
+void user_vspace_free(struct mappings_info *mi, ulong vaddr, size_t len);
+
 /* Special one-time funcs */
 void set_kernel_process_pdir(pdir_t *pdir);
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_kernel.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Sampling profiler
+ *
+ * When enabled, on every timer tick the profiler records the interrupted
+ * instruction pointer (kernel or user), the current tid and, for kernel
+ * samples, a frame-pointer backtrace. The samples are stored in a per-boot
+ * buffer of PROF_MAX_SAMPLES entries, allocated the first time the profiler
+ * is enabled. Once the buffer is full, new samples are just counted as lost.
+ */
+
+#define PROF_SAMPLE_USER                  (1 << 0)
+
+struct prof_sample {
+
+   ulong ip;
+   int tid;
+   u16 flags;
+   u16 depth;                       /* number of valid `frames` */
+   ulong frames[PROF_MAX_FRAMES];   /* return addresses, innermost first */
+};
+
+struct prof_info {
+
+   bool enabled;
+   u32 count;                       /* number of samples in the buffer */
+   u32 lost;                        /* samples lost because of a full buffer */
+};
+
+int prof_start(void);
+void prof_stop(void);
+void prof_get_info(struct prof_info *info);
+
+/*
+ * Copy up to `max` samples starting from the index `start` in `buf`.
+ * Returns the number of samples copied.
+ */
+u32 prof_get_samples(struct prof_sample *buf, u32 start, u32 max);
+
+/* Called by the timer IRQ handler */
+void prof_timer_tick(void);
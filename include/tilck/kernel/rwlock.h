@@ -17,6 +17,7 @@ struct rwlock_rp {
    struct task *ex_owner;
 #endif
 
+   LOCKSTAT_ONLY(struct lockstat_hold ls_hold;)
 };
 
 void rwlock_rp_init(struct rwlock_rp *r);
@@ -51,6 +52,8 @@ struct rwlock_wp {
    bool w;    /* writer waiting */
    bool rec;  /* is exlock operation recursive */
    u16 rc;    /* recursive locking count */
+
+   LOCKSTAT_ONLY(struct lockstat_hold ls_hold;)
 };
 
 void rwlock_wp_init(struct rwlock_wp *rw, bool recursive);
@@ -10,6 +10,8 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/irqsoff.h>
 
 #include <tilck_gen_headers/config_sched.h>
 
@@ -133,6 +135,11 @@ struct task {
    /* Old blocked signals mask, saved by sys_rt_sigsuspend() */
    ulong sa_old_mask[K_SIGACTION_MASK_WORDS];
 
+#if KERNEL_SYSCALL_STATS
+   /* Number of syscalls and time spent in them (see syscall_stats.h) */
+   struct syscall_task_stats sys_stats;
+#endif
+
    /* See the comment above struct process' pi_arch */
    char ti_arch[ARCH_TASK_MEMBERS_SIZE] ALIGNED_AT(ARCH_TASK_MEMBERS_ALIGN);
 };
@@ -180,12 +187,22 @@ static ALWAYS_INLINE bool need_reschedule(void)
 static ALWAYS_INLINE void disable_preemption(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
-   atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed);
+   int oldval = atomic_fetch_add_explicit(&__disable_preempt, 1, mo_relaxed);
+
+   if (KERNEL_IRQSOFF_TRACER && !oldval)
+      irqsoff_preempt_disabled();
 }
 
 static ALWAYS_INLINE void enable_preemption_nosched(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+
+   if (KERNEL_IRQSOFF_TRACER &&
+       atomic_load_explicit(&__disable_preempt, mo_relaxed) == 1)
+   {
+      irqsoff_preempt_enabled();
+   }
+
    atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 }
 
@@ -198,6 +215,10 @@ void enable_preemption(void);
 static ALWAYS_INLINE void force_enable_preemption(void)
 {
    extern ATOMIC(int) __disable_preempt; /* see docs/atomics.md */
+
+   if (KERNEL_IRQSOFF_TRACER)
+      irqsoff_preempt_enabled();
+
    atomic_store_explicit(&__disable_preempt, 0, mo_relaxed);
 }
 
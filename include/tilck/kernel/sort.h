@@ -6,6 +6,9 @@
 void
 insertion_sort_ptr(void *arr, u32 elem_count, cmpfun_ptr cmp);
 
+void
+heap_sort_ptr(void *arr, u32 elem_count, cmpfun_ptr cmp);
+
 void
 insertion_sort_generic(void *a, ulong elem_sz, u32 elem_count, cmpfun_ptr cmp);
 
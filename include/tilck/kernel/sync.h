@@ -2,9 +2,12 @@
 
 #pragma once
 
+#include <tilck_gen_headers/config_debug.h>
+
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
 #include <tilck/kernel/list.h>
+#include <tilck/kernel/lockstat.h>
 
 struct task;
 
@@ -151,18 +154,39 @@ struct kmutex {
    u32 num_waiters;
    u32 max_num_waiters;
 #endif
+
+   LOCKSTAT_ONLY(struct lockstat_hold ls_hold;)
 };
 
 #define STATIC_KMUTEX_INIT(m, fl)                 \
    {                                              \
       .owner_task = NULL,                         \
-      .flags = 0,                                 \
+      .flags = (fl),                              \
       .lock_count = 0,                            \
       .wait_list = STATIC_LIST_INIT(m.wait_list), \
    }
 
 #define KMUTEX_FL_RECURSIVE                                (1 << 0)
 
+/*
+ * Adaptive mutex: when the owner has been preempted (it's runnable), yield up
+ * to KMUTEX_ADAPTIVE_MAX_YIELDS times hoping it will release the mutex, before
+ * going to sleep. Useful for mutexes held only for short periods of time.
+ */
+#define KMUTEX_FL_ADAPTIVE                                 (1 << 2)
+
+/*
+ * Don't collect lock statistics for this mutex (see KERNEL_LOCKSTAT). Used for
+ * the mutexes internal to other lock types, which have their own statistics.
+ */
+#define KMUTEX_FL_NO_LOCKSTAT                              (1 << 3)
+
+/*
+ * Internal flag, not to be passed to kmutex_init(): the owner of the mutex (a
+ * worker thread) has inherited a priority from its waiters. See wth.c.
+ */
+#define KMUTEX_FL_PI_BOOSTED                               (1 << 4)
+
 #if KERNEL_SELFTESTS
 
    /*
@@ -183,6 +207,22 @@ void kmutex_destroy(struct kmutex *m);
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m);
 #endif
 
+#if KMUTEX_STATS_ENABLED
+
+/* Global counters, for all the kmutex objects */
+struct kmutex_stats {
+
+   u64 acquired;           /* successful kmutex_lock() and kmutex_trylock() */
+   u64 contended;          /* kmutex_lock() calls finding the mutex taken */
+   u64 adaptive_acquired;  /* contended, but acquired after yielding */
+   u64 slept;              /* contended, had to sleep */
+   u64 pi_boosts;          /* worker threads boosted by prio inheritance */
+   u32 max_num_waiters;    /* max num_waiters among all the mutexes */
+};
+
+void kmutex_get_stats(struct kmutex_stats *s);
+#endif
+
 /*
  * A basic implementation of condition variables similar to the pthread ones.
  */
@@ -179,6 +179,52 @@ struct k_stat64 {
 
 #endif
 
+#ifdef BITS32
+
+/* The statfs64 struct for 32-bit systems */
+struct k_statfs64 {
+
+   u32 f_type;
+   u32 f_bsize;
+   u64 f_blocks;
+   u64 f_bfree;
+   u64 f_bavail;
+   u64 f_files;
+   u64 f_ffree;
+   s32 f_fsid[2];
+   u32 f_namelen;
+   u32 f_frsize;
+   u32 f_flags;
+   u32 f_spare[4];
+};
+
+STATIC_ASSERT(sizeof(struct k_statfs64) == 84);
+
+#else
+
+/* On 64-bit systems, statfs64 is the same as the regular statfs struct */
+struct k_statfs64 {
+
+   long f_type;
+   long f_bsize;
+   ulong f_blocks;
+   ulong f_bfree;
+   ulong f_bavail;
+   ulong f_files;
+   ulong f_ffree;
+   s32 f_fsid[2];
+   long f_namelen;
+   long f_frsize;
+   long f_flags;
+   long f_spare[4];
+};
+
+#endif
+
+/* Values for k_statfs64's f_flags */
+#define K_ST_RDONLY                                0x0001
+#define K_ST_VALID                                 0x0020
+
 #ifndef O_DIRECTORY
    #define O_DIRECTORY __O_DIRECTORY
 #endif
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Syscall latency statistics (KERNEL_SYSCALL_STATS)
+ *
+ * For each syscall number, the dispatcher records the number of calls, the
+ * total and the max latency plus a log2 histogram of the latencies: bucket `i`
+ * counts the calls that took [2^i, 2^(i+1)) cycles. The per-task totals are
+ * kept in struct task.
+ *
+ * All the times are measured in TSC cycles, from the entry to the exit of the
+ * syscall function. Therefore, they're wall-clock times which include the time
+ * spent sleeping or preempted.
+ */
+
+#define SYSCALL_HIST_BUCKETS                   32
+
+struct syscall_stats {
+
+   u64 count;
+   u64 tot_cycles;
+   u64 max_cycles;
+   u32 hist[SYSCALL_HIST_BUCKETS];
+};
+
+/* Per-task totals, in struct task */
+struct syscall_task_stats {
+
+   u64 count;
+   u64 tot_cycles;
+};
+
+#if KERNEL_SYSCALL_STATS
+
+   #define SYSCALL_STATS_ONLY(x) x
+
+   /* Record a call to syscall `sn`, started at `start` (a RDTSC() value) */
+   void syscall_stats_record(u32 sn, u64 start);
+
+   /* Copy the stats of syscall `sn` in `s`. Returns false if `sn` is invalid */
+   bool syscall_stats_get(u32 sn, struct syscall_stats *s);
+
+   /*
+    * Fill `sns` with the numbers of up to `max` syscalls called at least once,
+    * sorted by total time (desc). Returns the number of syscalls in `sns`.
+    */
+   u32 syscall_stats_get_top(u32 *sns, u32 max);
+
+   void syscall_stats_reset(void);
+
+#else
+
+   #define SYSCALL_STATS_ONLY(x)
+
+#endif
@@ -392,8 +392,9 @@ int sys_clock_gettime32(clockid_t clk_id, struct k_timespec32 *tp);
 int sys_clock_getres_time32(clockid_t clk_id, struct k_timespec32 *res);
 
 CREATE_STUB_SYSCALL_IMPL(sys_clock_nanosleep_time32)
-CREATE_STUB_SYSCALL_IMPL(sys_statfs64)
-CREATE_STUB_SYSCALL_IMPL(sys_fstatfs64)
+
+int sys_statfs64(const char *u_path, size_t sz, struct k_statfs64 *u_buf);
+int sys_fstatfs64(int fd, size_t sz, struct k_statfs64 *u_buf);
 
 int sys_tgkill(int pid /* linux: tgid */, int tid, int sig);
 int sys_utimes(const char *u_path, const struct k_timeval u_times[2]);
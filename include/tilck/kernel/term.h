@@ -29,6 +29,7 @@ struct video_interface {
    void (*redraw_static_elements)(void);
    void (*disable_static_elems_refresh)(void);
    void (*enable_static_elems_refresh)(void);
+   void (*flush_buffers)(void);
 };
 
 enum term_type {
@@ -5,3 +5,4 @@
 #include <tilck/kernel/fs/vfs_base.h>
 
 struct mnt_fs *ramfs_create(void);
+struct mnt_fs *ramfs_create_with_quota(size_t max_bytes, size_t max_inodes);
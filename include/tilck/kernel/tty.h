@@ -13,6 +13,7 @@ static ALWAYS_INLINE struct tty *get_curr_tty(void)
 }
 
 void tty_send_keyevent(struct tty *t, struct key_event ke, bool block);
+void tty_send_input(struct tty *t, const char *buf, size_t len, bool block);
 void tty_setup_for_panic(struct tty *t);
 int tty_get_num(struct tty *t);
 void tty_restore_kd_text_mode(struct tty *t);
@@ -20,7 +21,7 @@ struct tty *get_serial_tty(int n);
 void tty_reset_termios(struct tty *t);
 struct tty *get_curr_process_tty(void);
 int get_curr_proc_tty_term_type(void);
-ssize_t tty_curr_proc_write(const char *buf, size_t size);
+ssize_t tty_kernel_write(struct tty *t, const char *buf, size_t size);
 void tty_write_on_all_ttys(const char *buf, size_t size);
 
 static inline int get_curr_tty_num(void)
@@ -10,6 +10,7 @@ static inline bool user_out_of_range(const void *user_ptr, size_t n)
 
 int copy_from_user(void *dest, const void *user_ptr, size_t n);
 int copy_to_user(void *user_ptr, const void *src, size_t n);
+long strnlen_user(const char *user_ptr, size_t max_len);
 
 int copy_str_from_user(void *dest,
                        const void *user_ptr,
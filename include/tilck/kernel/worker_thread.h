@@ -7,6 +7,7 @@
 #define WTH_PRIO_LOWEST           255
 
 struct worker_thread;
+struct kmutex;
 
 void
 init_worker_threads();
@@ -20,6 +21,9 @@ wth_get_queue_size(struct worker_thread *wth);
 int
 wth_get_priority(struct worker_thread *wth);
 
+int
+wth_get_eff_priority(struct worker_thread *wth);
+
 const char *
 wth_get_name(struct worker_thread *wth);
 
@@ -40,3 +44,16 @@ wth_enqueue_anywhere(int lowest_prio, void (*func)(void *), void *arg);
 
 void
 wth_wait_for_completion(struct worker_thread *wth);
+
+/*
+ * Priority inheritance: a worker thread holding the kmutex `m` inherits the
+ * priority `prio` of a worker thread waiting for it. With nested mutexes, it
+ * keeps the highest inherited priority until it releases the last mutex it
+ * has inherited a priority from. Both the functions must be called with
+ * preemption disabled.
+ */
+bool
+wth_inherit_priority(struct worker_thread *wth, int prio, struct kmutex *m);
+
+void
+wth_drop_inherited_priority(struct worker_thread *wth, struct kmutex *m);
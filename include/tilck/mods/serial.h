@@ -5,6 +5,7 @@
 #include <tilck/common/basic_defs.h>
 
 void init_serial_port(u16 port);
+bool serial_port_exists(u16 port);
 
 bool serial_read_ready(u16 port);
 void serial_wait_for_read(u16 port);
@@ -13,6 +14,17 @@ char serial_read(u16 port);
 bool serial_write_ready(u16 port);
 void serial_wait_for_write(u16 port);
 void serial_write(u16 port, char c);
+void serial_write_no_wait(u16 port, char c);
+u32 serial_get_tx_fifo_size(u16 port);
+void serial_enable_tx_intr(u16 port, bool enabled);
+void serial_enable_rx_intr(u16 port, bool enabled);
+
+/*
+ * Buffered, interrupt-driven, write on a serial port. It falls back to polling
+ * the UART in panic, before the serial module is initialized and when the
+ * buffer is full but the current context cannot sleep.
+ */
+void serial_tx_write(u16 port, const char *buf, size_t len);
 
 #if MOD_serial
    void early_init_serial_ports(void);
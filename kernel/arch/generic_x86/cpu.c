@@ -22,15 +22,28 @@ static void handle_no_coproc_fault(regs_t *r);
 #define CPU_FXSAVE_AREA_SIZE   512
 
 /*
- * NOTE: calculating the exact area save area for XSAVE is tricky since it
- * depends on the features currently supported by the CPU (it is necessary
- * to iterate with CPUID calls to do the right calculation). For the moment,
- * just using a large buffer is a good-enough solution.
- *
- * TODO (future): calculate the exact size for the XSAVE area.
+ * Upper bound for the XSAVE area: the exact size, depending on the features
+ * enabled in XCR0, is read with CPUID once AVX has been enabled (see
+ * compute_xsave_area_size()). The in-kernel save area always uses this size.
  */
 #define CPU_XSAVE_AREA_SIZE   8192
 
+static u32 xsave_area_size = CPU_XSAVE_AREA_SIZE;
+
+static void compute_xsave_area_size(void)
+{
+   u32 a, b, c, d;
+
+   /* EBX: size of the XSAVE area for the features currently set in XCR0 */
+   cpuid_count(0xD, 0, &a, &b, &c, &d);
+
+   if (!b || b > CPU_XSAVE_AREA_SIZE)
+      return;             /* Keep using the large buffer */
+
+   xsave_area_size = round_up_at(b, 64);
+   printk("CPU: XSAVE area size: %u bytes\n", xsave_area_size);
+}
+
 static bool enable_sse(void)
 {
    u32 res = fault_resumable_call(ALL_FAULTS_MASK, &asm_enable_sse, 0);
@@ -140,9 +153,13 @@ void enable_cpu_features(void)
       if (!enable_osxsave())
          goto out;
 
-      if (x86_cpu_features.ecx1.avx)
+      if (x86_cpu_features.ecx1.avx) {
+
          if (!enable_avx())
             goto out;
+
+         compute_xsave_area_size();
+      }
    }
 
 out:
@@ -182,17 +199,31 @@ out:
 
 static char fpu_kernel_regs[CPU_XSAVE_AREA_SIZE] ALIGNED_AT(64);
 
-void save_current_fpu_regs(bool in_kernel)
-{
-   if (UNLIKELY(!x86_cpu_features.can_use_sse))
-      return;
-
-   if (UNLIKELY(in_panic()))
-      return;
+/*
+ * Lazy FPU switching
+ * ---------------------
+ *
+ * The FPU registers are NOT saved and restored on each task switch. Instead,
+ * `fpu_owner` is the task whose (user) FPU state is live in the registers and
+ * the FPU is enabled (TS = 0) when returning to user space only for it. When
+ * any other task uses the FPU, it gets a "No coprocessor" fault: only then, the
+ * handler saves the state of the owner in its buffer and loads the state of the
+ * current task, which becomes the new owner.
+ *
+ * Invariant: REGS_FL_FPU_ENABLED is set in the user regs (at the top of the
+ * kernel stack) of a task if and only if the task is the owner.
+ */
+static struct task *fpu_owner;
 
-   arch_task_members_t *arch_fields = get_task_arch_fields(get_curr_task());
-   void *buf = in_kernel ? fpu_kernel_regs : arch_fields->aligned_fpu_regs;
+static regs_t *get_task_user_regs(struct task *ti)
+{
+   return ((regs_t *)(
+      ((ulong)ti->kernel_stack + KERNEL_STACK_SIZE - 1) & POINTER_ALIGN_MASK
+   )) - 1;
+}
 
+static void fpu_save_regs(void *buf)
+{
    ASSERT(buf != NULL);
 
    if (x86_cpu_features.can_use_avx) {
@@ -201,32 +232,46 @@ void save_current_fpu_regs(bool in_kernel)
        * In eax:edx we're supposed to specific which reg sets to save/restore
        * using a bitmask. Setting all bits to 1 works well to save/restore
        * "everything".
+       *
+       * XSAVEOPT skips the components not modified since the last XRSTOR
+       * from the same buffer, while XSAVEC skips the components in their
+       * initial state, using a compacted layout. Both are understood by the
+       * plain XRSTOR below.
        */
 
-      asmVolatile("xsave (%0)"
-                  : /* no output */
-                  : "r" (buf), "a" (-1), "d" (-1)
-                  : /* no clobber */);
+      if (x86_cpu_features.xsaveopt) {
+
+         asmVolatile("xsaveopt (%0)"
+                     : /* no output */
+                     : "r" (buf), "a" (-1), "d" (-1)
+                     : "memory");
+
+      } else if (x86_cpu_features.xsavec) {
+
+         asmVolatile("xsavec (%0)"
+                     : /* no output */
+                     : "r" (buf), "a" (-1), "d" (-1)
+                     : "memory");
+
+      } else {
+
+         asmVolatile("xsave (%0)"
+                     : /* no output */
+                     : "r" (buf), "a" (-1), "d" (-1)
+                     : "memory");
+      }
+
    } else {
 
       asmVolatile("fxsave (%0)"
                   : /* no output */
                   : "r" (buf)
-                  : /* no clobber */);
+                  : "memory");
    }
 }
 
-void restore_fpu_regs(void *task, bool in_kernel)
+static void fpu_restore_regs(void *buf)
 {
-   if (UNLIKELY(!x86_cpu_features.can_use_sse))
-      return;
-
-   if (UNLIKELY(in_panic()))
-      return;
-
-   arch_task_members_t *arch_fields = get_task_arch_fields((struct task *)task);
-   void *buf = in_kernel ? fpu_kernel_regs : arch_fields->aligned_fpu_regs;
-
    ASSERT(buf != NULL);
 
    if (x86_cpu_features.can_use_avx) {
@@ -234,20 +279,30 @@ void restore_fpu_regs(void *task, bool in_kernel)
       asmVolatile("xrstor (%0)"
                   : /* no output */
                   : "r" (buf), "a" (-1), "d" (-1)
-                  : /* no clobber */);
+                  : "memory");
 
    } else {
 
       asmVolatile("fxrstor (%0)"
                   : /* no output */
                   : "r" (buf)
-                  : /* no clobber */);
+                  : "memory");
    }
 }
 
-void restore_current_fpu_regs(bool in_kernel)
+bool fpu_is_task_owner(void *task)
 {
-   restore_fpu_regs(get_curr_task(), in_kernel);
+   return task == fpu_owner;
+}
+
+void fpu_forget_task(void *task)
+{
+   /*
+    * The task is dying or its FPU state is being reset (execve): its live
+    * FPU state does not need to be saved anymore.
+    */
+   if (task == fpu_owner)
+      fpu_owner = NULL;
 }
 
 bool allocate_fpu_regs(arch_task_members_t *arch_fields)
@@ -256,10 +311,11 @@ bool allocate_fpu_regs(arch_task_members_t *arch_fields)
 
    if (x86_cpu_features.can_use_avx) {
 
+      /* NOTE: XSAVE requires the area to be aligned at 64 bytes */
       arch_fields->aligned_fpu_regs =
-         aligned_kmalloc(CPU_XSAVE_AREA_SIZE, 8 * sizeof(void *));
+         aligned_kmalloc(xsave_area_size, 64);
 
-      arch_fields->fpu_regs_size = CPU_XSAVE_AREA_SIZE;
+      arch_fields->fpu_regs_size = (u16)xsave_area_size;
 
    } else {
 
@@ -272,14 +328,32 @@ bool allocate_fpu_regs(arch_task_members_t *arch_fields)
    if (!arch_fields->aligned_fpu_regs)
       return false;
 
-   bzero(arch_fields->aligned_fpu_regs, arch_fields->fpu_regs_size);
+   reset_fpu_regs(arch_fields);
    return true;
 }
 
+void reset_fpu_regs(arch_task_members_t *arch_fields)
+{
+   void *buf = arch_fields->aligned_fpu_regs;
+
+   /*
+    * A zeroed XSAVE header means "all the components in the initial state",
+    * but XRSTOR loads MXCSR from the legacy area anyway, while the FXSAVE
+    * format has no such concept at all. Therefore, in both the cases, the
+    * control words have to be set explicitly, as after FNINIT.
+    */
+   bzero(buf, arch_fields->fpu_regs_size);
+   ((u16 *)buf)[0] = 0x37f;         /* FCW */
+   ((u32 *)buf)[6] = 0x1f80;        /* MXCSR */
+}
+
 static void
 handle_no_coproc_fault(regs_t *r)
 {
-   if (is_kernel_thread(get_curr_task())) {
+   struct task *curr = get_curr_task();
+   ulong var;
+
+   if (is_kernel_thread(curr)) {
       panic("FPU instructions used in kernel outside an fpu_context!");
    }
 
@@ -298,47 +372,71 @@ handle_no_coproc_fault(regs_t *r)
        panic("x87 FPU instructions not supported on CPUs without SSE");
    }
 
-   arch_task_members_t *arch_fields = get_task_arch_fields(get_curr_task());
+   arch_task_members_t *arch_fields = get_task_arch_fields(curr);
    ASSERT(!(r->custom_flags & REGS_FL_FPU_ENABLED));
 
 #if FORK_NO_COW
 
    ASSERT(arch_fields->aligned_fpu_regs != NULL);
 
+#else
+
+   /* The first time the task uses the FPU, allocate its buffer */
+   if (!arch_fields->aligned_fpu_regs) {
+      if (!allocate_fpu_regs(arch_fields)) {
+         panic("Cannot allocate memory for the FPU context");
+      }
+   }
+
+#endif
+
    /*
-    * With the current implementation, even when the aligned_fpu_regs are
-    * pre-allocated tasks cannot by default use the FPU. This approach has PROs
-    * and CONs.
-    *
-    *    PROs:
-    *       - the kernel doesn't have to save/restore unnecessarily the FPU ctx
-    *       - tasks using the FPU can be distinguished from the others
-    *       - it is simpler to make aligned_fpu_regs pre-allocated work this way
-    *
-    *    CONs:
-    *       - paying the overhead of a not-strictly necessary fault, once.
+    * NOTE: the kernel disabled the preemption on entry, but an IRQ handler
+    * could still use an fpu_context while we're switching the owner.
     */
+   disable_interrupts(&var);
+   {
+      if (fpu_owner != curr) {
 
-#else
-
-    /*
-     * We can hit this fault at MOST once in the lifetime of a task. These
-     * sanity checks ensures that, in no case, we allocated the aligned_fpu_regs
-     * and then, for any reason, we scheduled the task with FPU disabled.
-     */
+         hw_fpu_enable();
 
-   ASSERT(arch_fields->aligned_fpu_regs == NULL);
+         if (fpu_owner) {
+            struct task *owner = fpu_owner;
+            fpu_save_regs(get_task_arch_fields(owner)->aligned_fpu_regs);
+            get_task_user_regs(owner)->custom_flags &= ~REGS_FL_FPU_ENABLED;
+         }
 
-   if (!allocate_fpu_regs(arch_fields)) {
-      panic("Cannot allocate memory for the FPU context");
+         fpu_restore_regs(arch_fields->aligned_fpu_regs);
+         fpu_owner = curr;
+      }
    }
+   enable_interrupts(&var);
 
-#endif
-
+   /*
+    * `r` is the user regs frame: the FPU will be enabled (TS = 0) by
+    * pop_custom_flags on the way back to user space.
+    */
    r->custom_flags |= REGS_FL_FPU_ENABLED;
 }
 
 static volatile bool in_fpu_context;
+static bool fpu_context_saved;
+
+static void fpu_context_begin_int(void)
+{
+   in_fpu_context = true;
+   hw_fpu_enable();
+
+   /*
+    * Save the live FPU state only if there's an owner: otherwise, nobody
+    * cares about the current contents of the FPU registers.
+    */
+   fpu_context_saved =
+      fpu_owner && x86_cpu_features.can_use_sse && !in_panic();
+
+   if (fpu_context_saved)
+      fpu_save_regs(fpu_kernel_regs);
+}
 
 void fpu_context_begin(void)
 {
@@ -350,16 +448,35 @@ void fpu_context_begin(void)
       ASSERT(!in_fpu_context);
    }
 
-   in_fpu_context = true;
-   hw_fpu_enable();
-   save_current_fpu_regs(true);
+   fpu_context_begin_int();
+}
+
+/*
+ * Like fpu_context_begin(), but for opportunistic users (e.g. kmemcpy()): it
+ * fails instead of asserting when an FPU context cannot be used. That's the
+ * case of IRQ handlers, of panic and of nested contexts, like CoW page faults
+ * while copying data to user space.
+ */
+bool fpu_context_try_begin(void)
+{
+   disable_preemption();
+
+   if (in_fpu_context || in_irq() || in_panic()) {
+      enable_preemption();
+      return false;
+   }
+
+   fpu_context_begin_int();
+   return true;
 }
 
 void fpu_context_end(void)
 {
    ASSERT(in_fpu_context);
 
-   restore_current_fpu_regs(true);
+   if (fpu_context_saved)
+      fpu_restore_regs(fpu_kernel_regs);
+
    hw_fpu_disable();
 
    in_fpu_context = false;
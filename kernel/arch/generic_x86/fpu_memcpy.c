@@ -19,6 +19,7 @@
 #endif
 
 #include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/config_kernel.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/string_util.h>
@@ -26,8 +27,11 @@
 
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/hal.h>
 #include <tilck/kernel/arch/generic_x86/fpu_memcpy.h>
 
+static bool fpu_memcpy_enabled;
+
 void
 memcpy256_failsafe(void *dest, const void *src, u32 n)
 {
@@ -143,6 +147,70 @@ void fpu_memset256_avx2(void *dest, u32 val32, u32 n)
       fpu_cpy_single_256_nt_avx2(dest, val256);
 }
 
+bool fpu_memcpy_begin(void *dest, const void *src, size_t n)
+{
+   if (n < KMEMCPY_FPU_MIN_SIZE || !fpu_memcpy_enabled)
+      return false;
+
+   /*
+    * The aligned loads and stores of the fpu_cpy_single_* funcs require both
+    * the buffers to be 32-byte aligned, once we've copied the same head.
+    */
+   if (((ulong)dest ^ (ulong)src) & 31)
+      return false;
+
+   return fpu_context_try_begin();
+}
+
+void fpu_memcpy(void *dest, const void *src, size_t n)
+{
+   const size_t head = MIN(n, (size_t)(-(ulong)dest & 31));
+   size_t bulk;
+
+   memcpy(dest, src, head);
+   dest += head;
+   src += head;
+   n -= head;
+
+   bulk = n & ~(size_t)31;
+   fpu_memcpy256(dest, src, (u32)(bulk >> 5));
+   memcpy(dest + bulk, src + bulk, n - bulk);
+}
+
+void kmemcpy(void *dest, const void *src, size_t n)
+{
+   if (!fpu_memcpy_begin(dest, src, n)) {
+      memcpy(dest, src, n);
+      return;
+   }
+
+   fpu_memcpy(dest, src, n);
+   fpu_context_end();
+}
+
+void kmemset(void *dest, int c, size_t n)
+{
+   size_t head, bulk;
+
+   if (n < KMEMCPY_FPU_MIN_SIZE ||
+       !fpu_memcpy_enabled ||
+       !fpu_context_try_begin())
+   {
+      memset(dest, c, n);
+      return;
+   }
+
+   head = MIN(n, (size_t)(-(ulong)dest & 31));
+   memset(dest, c, head);
+   dest += head;
+   n -= head;
+
+   bulk = n & ~(size_t)31;
+   fpu_memset256(dest, 0x01010101u * (u8)c, (u32)(bulk >> 5));
+   memset(dest + bulk, c, n - bulk);
+   fpu_context_end();
+}
+
 static void
 init_fpu_memcpy_internal_check(void *func, const char *fname, u32 size)
 {
@@ -260,4 +328,6 @@ void init_fpu_memcpy(void)
    if ((func = get_fpu_cpy_single_256_nt_read_func())) {
       simple_hot_patch(&__asm_fpu_cpy_single_256_nt_read, func, 128);
    }
+
+   fpu_memcpy_enabled = !kopt_no_fpu_memcpy && x86_cpu_features.can_use_sse;
 }
@@ -57,6 +57,61 @@ void release_pageframes_mapped_at(pdir_t *pdir, void *vaddrp, size_t len)
    }
 }
 
+u32 get_pageframe_ref_count_at(pdir_t *pdir, void *vaddrp)
+{
+   ulong paddr;
+   ASSERT(IS_PAGE_ALIGNED(vaddrp));
+
+   if (get_mapping2(pdir, vaddrp, &paddr) < 0)
+      return 0;
+
+   return pf_ref_count_get(paddr);
+}
+
+static void free_pages_in_range(char *begin, char *end)
+{
+   for (char *p = begin; p < end; p += PAGE_SIZE)
+      kfree2(p, PAGE_SIZE);
+}
+
+void *alloc_big_pageframe(void)
+{
+   size_t size = BIG_PAGE_SIZE;
+   char *block, *res;
+
+   /*
+    * The kmalloc heaps are not necessarily aligned at BIG_PAGE_SIZE. Therefore,
+    * first try with a block of exactly BIG_PAGE_SIZE bytes: if we're lucky and
+    * it's aligned, we're done. Otherwise, allocate a block twice as big and
+    * free the parts of it outside of the aligned area. In both cases, the block
+    * is split in PAGE_SIZE sub-blocks, in order to make possible to free the
+    * unused parts and, later, the whole big pageframe, page by page.
+    */
+
+   if (!(block = general_kmalloc(&size, PAGE_SIZE)))
+      return NULL;
+
+   if (!((ulong)block & (BIG_PAGE_SIZE - 1)))
+      return block;
+
+   general_kfree(block, &size, KFREE_FL_ALLOW_SPLIT);
+   size = 2 * BIG_PAGE_SIZE;
+
+   if (!(block = general_kmalloc(&size, PAGE_SIZE)))
+      return NULL;
+
+   res = (char *)pow2_round_up_at((ulong)block, BIG_PAGE_SIZE);
+   free_pages_in_range(block, res);
+   free_pages_in_range(res + BIG_PAGE_SIZE, block + size);
+   return res;
+}
+
+void free_big_pageframe(void *ptr)
+{
+   ASSERT(!((ulong)ptr & (BIG_PAGE_SIZE - 1)));
+   free_pages_in_range(ptr, (char *)ptr + BIG_PAGE_SIZE);
+}
+
 void invalidate_page(ulong vaddr)
 {
    invalidate_page_hw(vaddr);
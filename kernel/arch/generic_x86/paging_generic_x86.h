@@ -23,6 +23,14 @@
  */
 #define PAGE_SHARED                            (1 << 1)
 
+/*
+ * When this flag is set in the 'avail' bits of a page directory entry, it
+ * means that its page table is shared with other page directories (lazy copy
+ * on fork) and that the entry has been made read-only. The page table has to
+ * be copied before altering it or on the first write in its range.
+ */
+#define PDE_SHARED_PT                          (1 << 2)
+
 
 /* ---------------------------------------------- */
 
@@ -15,6 +15,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/syscall_stats.h>
 #include <tilck/mods/tracing.h>
 
 #include "idt_int.h"
@@ -555,7 +556,9 @@ static void do_special_syscall(regs_t *r)
    if (traceable)
       trace_sys_enter(sn,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
 
+   SYSCALL_STATS_ONLY(const u64 start = RDTSC());
    r->eax = (u32) fptr(r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
+   SYSCALL_STATS_ONLY(syscall_stats_record(sn, start));
 
    if (traceable)
       trace_sys_exit(sn,r->eax,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
@@ -577,7 +580,9 @@ static void do_syscall(regs_t *r)
    enable_preemption();
    {
       trace_sys_enter(sn,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
+      SYSCALL_STATS_ONLY(const u64 start = RDTSC());
       r->eax = (u32) fptr(r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
+      SYSCALL_STATS_ONLY(syscall_stats_record(sn, start));
       trace_sys_exit(sn,r->eax,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
    }
    disable_preemption();
@@ -40,6 +40,150 @@ pdir_get_page_table(pdir_t *pdir, u32 i)
    return KERNEL_PA_TO_VA(pdir->entries[i].ptaddr << PAGE_SHIFT);
 }
 
+/*
+ * Mark all the non-shared pages in the page table as CoW and increase the
+ * ref-count of all of its pages, because they're going to be referenced by
+ * one more page table.
+ */
+static void pt_mark_pages_cow(page_table_t *pt)
+{
+   for (u32 j = 0; j < 1024; j++) {
+
+      page_t *const p = &pt->pages[j];
+
+      if (!p->present)
+         continue;
+
+      const ulong orig_paddr = (ulong)p->pageAddr << PAGE_SHIFT;
+
+      /* Sanity-check: a mapped page MUST have ref-count > 0 */
+      ASSERT(pf_ref_count_get(orig_paddr) > 0);
+
+      if (!(p->avail & PAGE_SHARED)) {
+
+         if (p->rw)
+            p->avail |= PAGE_COW_ORIG_RW;
+
+         p->rw = false;
+      }
+
+      pf_ref_count_inc(orig_paddr);
+   }
+}
+
+/*
+ * Make the page table of the `pd_index` entry private to `pdir`. While a page
+ * table is shared (see pdir_clone_lazy()), the ref-count of its pageframe is
+ * the number of page directories using it, while its pages are counted only
+ * once. Therefore, when we have to copy it, its pages must become CoW exactly
+ * as in the regular pdir_clone() case.
+ */
+static int unshare_page_table(pdir_t *pdir, u32 pd_index)
+{
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   page_table_t *pt = pdir_get_page_table(pdir, pd_index);
+   const ulong pt_paddr = KERNEL_VA_TO_PA(pt);
+   page_table_t *new_pt;
+
+   ASSERT(e->present && !e->psize);
+   ASSERT(e->avail & PDE_SHARED_PT);
+   ASSERT(pf_ref_count_get(pt_paddr) > 0);
+
+   if (pf_ref_count_get(pt_paddr) > 1) {
+
+      if (!(new_pt = kalloc_obj(page_table_t)))
+         return -ENOMEM;
+
+      ASSERT(IS_PAGE_ALIGNED(new_pt));
+      pt_mark_pages_cow(pt);
+      memcpy32(new_pt, pt, sizeof(page_table_t) / 4);
+      e->ptaddr = SHR_BITS(KERNEL_VA_TO_PA(new_pt), PAGE_SHIFT, u32);
+
+   } else {
+
+      /*
+       * All the other page directories already un-shared this page table or
+       * have been destroyed: it's all ours now, no need to copy it.
+       */
+   }
+
+   pf_ref_count_dec(pt_paddr);
+   e->avail &= ~PDE_SHARED_PT;
+   e->rw = true;
+
+   /* The permissions of all the pages in the range changed: flush the TLB */
+   if (pdir == get_curr_pdir())
+      set_curr_pdir(pdir);
+
+   return 0;
+}
+
+static ALWAYS_INLINE int ensure_private_pt(pdir_t *pdir, u32 pd_index)
+{
+   if (LIKELY(!(pdir->entries[pd_index].avail & PDE_SHARED_PT)))
+      return 0;
+
+   return unshare_page_table(pdir, pd_index);
+}
+
+static void handle_cow_oom(void)
+{
+   struct task *curr = get_curr_task();
+
+   if (!curr->running_in_kernel) {
+
+      // The task was not running in kernel: we can safely kill it.
+      printk("Out-of-memory: killing pid %d\n", get_curr_pid());
+      send_signal(get_curr_pid(), SIGKILL, SIG_FL_PROCESS | SIG_FL_FAULT);
+
+   } else {
+
+      // We cannot kill a task running in kernel during a CoW page fault
+      // In this case (but in the one above too), Linux puts the process to
+      // sleep, while the OOM killer runs and frees some memory.
+      panic("Out-of-memory: can't copy a CoW page [pid %d]", get_curr_pid());
+   }
+}
+
+static bool handle_big_page_cow(page_dir_entry_t *e, u32 vaddr)
+{
+   const ulong orig_paddr = (ulong)e->big_4mb_page.paddr << BIG_PAGE_SHIFT;
+   const void *const page_vaddr = (void *)(vaddr & ~(BIG_PAGE_SIZE - 1));
+   void *new_page_vaddr;
+   ulong paddr;
+
+   if (!(e->avail & PAGE_COW_ORIG_RW))
+      return false; /* Not a COW page */
+
+   if (pf_ref_count_get(orig_paddr) == 1) {
+
+      /* This page is not shared anymore. No need for copying it. */
+      e->rw = true;
+      e->avail = 0;
+      invalidate_page_hw(vaddr);
+      return true;
+   }
+
+   if (!(new_page_vaddr = alloc_big_pageframe())) {
+      handle_cow_oom();
+      return true;
+   }
+
+   kmemcpy(new_page_vaddr, page_vaddr, BIG_PAGE_SIZE);
+   paddr = KERNEL_VA_TO_PA(new_page_vaddr);
+
+   ASSERT(pf_ref_count_get(paddr) == 0);
+   pf_ref_count_inc(paddr);
+   pf_ref_count_dec(orig_paddr);
+
+   e->big_4mb_page.paddr = SHR_BITS(paddr, BIG_PAGE_SHIFT, u32);
+   e->rw = true;
+   e->avail = 0;
+
+   invalidate_page_hw(vaddr);
+   return true;
+}
+
 bool handle_potential_cow(void *context)
 {
    regs_t *r = context;
@@ -53,7 +197,32 @@ bool handle_potential_cow(void *context)
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
    const void *const page_vaddr = (void *)(vaddr & PAGE_MASK);
-   page_table_t *pt = pdir_get_page_table(get_curr_pdir(), pd_index);
+   page_dir_entry_t *e = &get_curr_pdir()->entries[pd_index];
+   page_table_t *pt;
+
+   if (e->psize)
+      return handle_big_page_cow(e, vaddr);
+
+   if (e->avail & PDE_SHARED_PT) {
+
+      /* First write in the range of a shared page table: copy the table */
+      if (unshare_page_table(get_curr_pdir(), pd_index) < 0) {
+         handle_cow_oom();
+         return true;
+      }
+
+      pt = pdir_get_page_table(get_curr_pdir(), pd_index);
+
+      /*
+       * If the page itself is not a CoW page, the fault was caused just by
+       * the read-only page directory entry: let the CPU retry the access. In
+       * case of a real violation, we'll get another fault.
+       */
+      if (!(pt->pages[pt_index].avail & PAGE_COW_ORIG_RW))
+         return true;
+   }
+
+   pt = pdir_get_page_table(get_curr_pdir(), pd_index);
 
    if (!(pt->pages[pt_index].avail & PAGE_COW_ORIG_RW))
       return false; /* Not a COW page */
@@ -82,30 +251,14 @@ bool handle_potential_cow(void *context)
    void *new_page_vaddr = kmalloc(PAGE_SIZE);
 
    if (!new_page_vaddr) {
-
-      // Out-of-memory case
-      struct task *curr = get_curr_task();
-
-      if (!curr->running_in_kernel) {
-
-         // The task was not running in kernel: we can safely kill it.
-         printk("Out-of-memory: killing pid %d\n", get_curr_pid());
-         send_signal(get_curr_pid(), SIGKILL, SIG_FL_PROCESS | SIG_FL_FAULT);
-         return true;
-
-      } else {
-
-         // We cannot kill a task running in kernel during a CoW page fault
-         // In this case (but in the one above too), Linux puts the process to
-         // sleep, while the OOM killer runs and frees some memory.
-         panic("Out-of-memory: can't copy a CoW page [pid %d]", get_curr_pid());
-      }
+      handle_cow_oom();
+      return true;
    }
 
    ASSERT(IS_PAGE_ALIGNED(new_page_vaddr));
 
    // Copy page's contents
-   memcpy32(new_page_vaddr, page_vaddr, PAGE_SIZE / 4);
+   kmemcpy(new_page_vaddr, page_vaddr, PAGE_SIZE);
 
    // Get the paddr of the new page
    const ulong paddr = KERNEL_VA_TO_PA(new_page_vaddr);
@@ -249,6 +402,9 @@ void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
 
+   /* Never used on page directories created by fork() */
+   ASSERT(!(pdir->entries[pd_index].avail & PDE_SHARED_PT));
+
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
    ASSERT(KERNEL_VA_TO_PA(pt) != 0);
    pt->pages[pt_index].rw = rw;
@@ -262,6 +418,15 @@ __unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
    const ulong vaddr = (ulong) vaddrp;
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   int rc;
+
+   if (UNLIKELY(rc = ensure_private_pt(pdir, pd_index))) {
+
+      if (permissive)
+         return rc;
+
+      panic("Out-of-memory: can't un-share a page table");
+   }
 
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
 
@@ -413,10 +578,14 @@ map_page_int(pdir_t *pdir, void *vaddrp, ulong paddr, u32 hw_flags)
    const u32 vaddr = (u32) vaddrp;
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   int rc;
 
    ASSERT(!(vaddr & OFFSET_IN_PAGE_MASK)); // the vaddr must be page-aligned
    ASSERT(!(paddr & OFFSET_IN_PAGE_MASK)); // the paddr must be page-aligned
 
+   if (UNLIKELY(rc = ensure_private_pt(pdir, pd_index)))
+      return rc;
+
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
    ASSERT(IS_PAGE_ALIGNED(pt));
 
@@ -606,7 +775,141 @@ map_pages(pdir_t *pdir,
                     (u32)((!us) << PG_GLOBAL_BIT_POS));
 }
 
-pdir_t *pdir_clone(pdir_t *pdir)
+static bool is_page_table_empty(page_table_t *pt)
+{
+   for (u32 i = 0; i < 1024; i++) {
+      if (pt->pages[i].present)
+         return false;
+   }
+
+   return true;
+}
+
+NODISCARD int
+map_big_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
+{
+   const u32 vaddr = (u32) vaddrp;
+   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   const bool rw = !!(pg_flags & PAGING_FL_RW);
+   const bool us = !!(pg_flags & PAGING_FL_US);
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   page_table_t *old_pt = NULL;
+   bool old_pt_shared = false;
+   u32 avail_bits = 0;
+
+   ASSERT(us);
+   ASSERT(pd_index < KERNEL_BASE_PD_IDX);
+   ASSERT(!(vaddr & (BIG_PAGE_SIZE - 1)));
+
+   if (e->present) {
+
+      if (e->psize)
+         return -EADDRINUSE;
+
+      /*
+       * Page tables are never freed when their pages get un-mapped: we might
+       * find here an empty page table. In that case, it can be replaced by
+       * the big page.
+       */
+      old_pt = pdir_get_page_table(pdir, pd_index);
+      old_pt_shared = !!(e->avail & PDE_SHARED_PT);
+
+      if (!is_page_table_empty(old_pt))
+         return -EADDRINUSE;
+   }
+
+   if (pg_flags & PAGING_FL_SHARED)
+      avail_bits |= PAGE_SHARED;
+
+   if (pg_flags & PAGING_FL_DO_ALLOC) {
+
+      void *va;
+      ASSERT(paddr == 0);
+
+      if (!(va = alloc_big_pageframe()))
+         return -ENOMEM;
+
+      if (pg_flags & PAGING_FL_ZERO_PG)
+         bzero(va, BIG_PAGE_SIZE);
+
+      paddr = KERNEL_VA_TO_PA(va);
+
+   } else {
+
+      /* PAGING_FL_ZERO_PG cannot be used without PAGING_FL_DO_ALLOC */
+      ASSERT(~pg_flags & PAGING_FL_ZERO_PG);
+   }
+
+   ASSERT(!(paddr & (BIG_PAGE_SIZE - 1)));
+
+   e->raw = PG_PRESENT_BIT                       |
+            PG_4MB_BIT                           |
+            (u32)(avail_bits << PG_CUSTOM_B0_POS) |
+            (u32)(us << PG_US_BIT_POS)            |
+            (u32)(rw << PG_RW_BIT_POS)            |
+            paddr;
+
+   pf_ref_count_inc(paddr);
+   invalidate_page_hw(vaddr);
+
+   if (old_pt) {
+
+      /* A shared page table must be freed only by its last user */
+      if (!old_pt_shared || !pf_ref_count_dec(KERNEL_VA_TO_PA(old_pt)))
+         kfree_obj(old_pt, page_table_t);
+   }
+
+   return 0;
+}
+
+void unmap_big_page(pdir_t *pdir, void *vaddrp, bool free_pageframe)
+{
+   const u32 vaddr = (u32) vaddrp;
+   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   const ulong paddr = (ulong)e->big_4mb_page.paddr << BIG_PAGE_SHIFT;
+
+   ASSERT(!(vaddr & (BIG_PAGE_SIZE - 1)));
+   ASSERT(e->present && e->psize);
+
+   e->raw = 0;
+   invalidate_page_hw(vaddr);
+
+   if (!pf_ref_count_dec(paddr) && free_pageframe)
+      free_big_pageframe(KERNEL_PA_TO_VA(paddr));
+}
+
+static void
+pdir_clone_big_page(pdir_t *pdir, pdir_t *new_pdir, u32 i)
+{
+   page_dir_entry_t *e = &pdir->entries[i];
+   const ulong paddr = (ulong)e->big_4mb_page.paddr << BIG_PAGE_SHIFT;
+
+   ASSERT(pf_ref_count_get(paddr) > 0);
+
+   /* Mark the big page as CoW, unless it's shared: see pt_mark_pages_cow() */
+   if (!(e->avail & PAGE_SHARED)) {
+
+      if (e->rw)
+         e->avail |= PAGE_COW_ORIG_RW;
+
+      e->rw = false;
+   }
+
+   pf_ref_count_inc(paddr);
+   new_pdir->entries[i].raw = e->raw;
+}
+
+/*
+ * Clone `pdir` sharing all of its page tables, instead of copying them. Each
+ * shared entry is made read-only (in both the page directories), while the
+ * ref-count of the page table's pageframe counts its users. The first write
+ * in the range of the entry, or any change to its mappings, will make the
+ * page table private again (see unshare_page_table()). That makes the cost of
+ * fork() independent from the amount of memory used by the process, which is
+ * great in the very common fork() + execve() case.
+ */
+static pdir_t *pdir_clone_lazy(pdir_t *pdir)
 {
    pdir_t *new_pdir = kalloc_obj(pdir_t);
 
@@ -618,10 +921,52 @@ pdir_t *pdir_clone(pdir_t *pdir)
 
    for (u32 i = 0; i < KERNEL_BASE_PD_IDX; i++) {
 
-      /* User-space cannot use 4-MB pages */
-      ASSERT(!pdir->entries[i].psize);
+      page_dir_entry_t *e = &pdir->entries[i];
 
-      if (!pdir->entries[i].present)
+      if (!e->present)
+         continue;
+
+      if (e->psize) {
+         pdir_clone_big_page(pdir, new_pdir, i);
+         continue;
+      }
+
+      const ulong pt_paddr = (ulong)e->ptaddr << PAGE_SHIFT;
+
+      if (!(e->avail & PDE_SHARED_PT)) {
+
+         /* The page table is not shared yet: count its current user */
+         ASSERT(pf_ref_count_get(pt_paddr) == 0);
+         pf_ref_count_inc(pt_paddr);
+
+         e->avail |= PDE_SHARED_PT;
+         e->rw = false;
+      }
+
+      pf_ref_count_inc(pt_paddr);
+      new_pdir->entries[i].raw = e->raw;
+   }
+
+   return new_pdir;
+}
+
+pdir_t *pdir_clone(pdir_t *pdir)
+{
+   if (FORK_LAZY_PT_COPY)
+      return pdir_clone_lazy(pdir);
+
+   pdir_t *new_pdir = kalloc_obj(pdir_t);
+
+   if (!new_pdir)
+      return NULL;
+
+   ASSERT(IS_PAGE_ALIGNED(new_pdir));
+   memcpy32(new_pdir, pdir, sizeof(pdir_t) / 4);
+
+   for (u32 i = 0; i < KERNEL_BASE_PD_IDX; i++) {
+
+      /* Skip the non-present entries and the big pages: no page table */
+      if (!pdir->entries[i].present || pdir->entries[i].psize)
          continue;
 
       page_table_t *pt = kalloc_obj(page_table_t);
@@ -629,8 +974,11 @@ pdir_t *pdir_clone(pdir_t *pdir)
       if (UNLIKELY(!pt)) {
 
          for (; i > 0; i--) {
-            if (pdir->entries[i - 1].present)
-               kfree_obj(pdir_get_page_table(pdir, i - 1), page_table_t);
+
+            page_dir_entry_t *e = &pdir->entries[i - 1];
+
+            if (e->present && !e->psize)
+               kfree_obj(pdir_get_page_table(new_pdir, i - 1), page_table_t);
          }
 
          kfree_obj(new_pdir, pdir_t);
@@ -646,32 +994,15 @@ pdir_t *pdir_clone(pdir_t *pdir)
       if (!pdir->entries[i].present)
          continue;
 
+      if (pdir->entries[i].psize) {
+         pdir_clone_big_page(pdir, new_pdir, i);
+         continue;
+      }
+
       page_table_t *orig_pt = pdir_get_page_table(pdir, i);
       page_table_t *new_pt = pdir_get_page_table(new_pdir, i);
 
-      /* Mark all the non-shared pages in that page-table as COW. */
-      for (u32 j = 0; j < 1024; j++) {
-
-         page_t *const p = &orig_pt->pages[j];
-
-         if (!p->present)
-            continue;
-
-         const ulong orig_paddr = (ulong)p->pageAddr << PAGE_SHIFT;
-
-         /* Sanity-check: a mapped page MUST have ref-count > 0 */
-         ASSERT(pf_ref_count_get(orig_paddr) > 0);
-
-         if (!(p->avail & PAGE_SHARED)) {
-
-            if (p->rw)
-               p->avail |= PAGE_COW_ORIG_RW;
-
-            p->rw = false;
-         }
-
-         pf_ref_count_inc(orig_paddr);
-      }
+      pt_mark_pages_cow(orig_pt);
 
       // copy the page table
       memcpy(new_pt, orig_pt, sizeof(page_table_t));
@@ -700,12 +1031,35 @@ pdir_deep_clone(pdir_t *pdir)
 
       new_pdir->entries[i].raw = pdir->entries[i].raw;
 
-      /* User-space cannot use 4-MB pages */
-      ASSERT(!pdir->entries[i].psize);
-
       if (!pdir->entries[i].present)
          continue;
 
+      /* FORK_NO_COW is not compatible with shared page tables */
+      ASSERT(!(pdir->entries[i].avail & PDE_SHARED_PT));
+
+      if (pdir->entries[i].psize) {
+
+         const ulong orig_paddr =
+            (ulong)pdir->entries[i].big_4mb_page.paddr << BIG_PAGE_SHIFT;
+
+         void *new_page = alloc_big_pageframe();
+
+         if (!new_page) {
+            new_pdir->entries[i].raw = 0;
+            goto oom_exit;
+         }
+
+         const ulong new_page_paddr = KERNEL_VA_TO_PA(new_page);
+         ASSERT(pf_ref_count_get(new_page_paddr) == 0);
+         pf_ref_count_inc(new_page_paddr);
+
+         memcpy32(new_page, KERNEL_PA_TO_VA(orig_paddr), BIG_PAGE_SIZE / 4);
+         new_pdir->entries[i].big_4mb_page.paddr =
+            SHR_BITS(new_page_paddr, BIG_PAGE_SHIFT, u32);
+
+         continue;
+      }
+
       page_table_t *orig_pt = pdir_get_page_table(pdir, i);
       page_table_t *new_pt = kmalloc_accelerator_get_elem(&acc);
 
@@ -772,8 +1126,29 @@ void pdir_destroy(pdir_t *pdir)
       if (!pdir->entries[i].present)
          continue;
 
+      if (pdir->entries[i].psize) {
+
+         const ulong paddr =
+            (ulong)pdir->entries[i].big_4mb_page.paddr << BIG_PAGE_SHIFT;
+
+         if (pf_ref_count_dec(paddr) == 0)
+            free_big_pageframe(KERNEL_PA_TO_VA(paddr));
+
+         continue;
+      }
+
       page_table_t *pt = pdir_get_page_table(pdir, i);
 
+      if (pdir->entries[i].avail & PDE_SHARED_PT) {
+
+         /*
+          * Shared page table: its pages are counted only once, no matter how
+          * many page directories use it. Only its last user can free them.
+          */
+         if (pf_ref_count_dec(KERNEL_VA_TO_PA(pt)) > 0)
+            continue;
+      }
+
       for (u32 j = 0; j < 1024; j++) {
 
          if (!pt->pages[j].present)
@@ -845,6 +1220,7 @@ static void set_4kb_page_pat_wc(pdir_t *pdir, void *vaddrp)
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
 
    ASSERT(!(vaddr & OFFSET_IN_PAGE_MASK)); // the vaddr must be page-aligned
+   ASSERT(!(pdir->entries[pd_index].avail & PDE_SHARED_PT));
 
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
    ASSERT(IS_PAGE_ALIGNED(pt));
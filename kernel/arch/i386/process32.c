@@ -166,6 +166,7 @@ static int save_regs_on_user_stack(regs_t *r)
 
 static void restore_regs_from_user_stack(regs_t *r)
 {
+   const ulong fpu_flag = r->custom_flags & REGS_FL_FPU_ENABLED;
    ulong old_regs = r->useresp;
    int rc;
 
@@ -182,6 +183,10 @@ static void restore_regs_from_user_stack(regs_t *r)
    /* Don't trust user space */
    r->cs = X86_USER_CODE_SEL;
    r->eflags |= EFLAGS_IF;
+
+   /* The FPU flag depends on the FPU ownership (see cpu.c), not on the past */
+   r->custom_flags &= ~REGS_FL_FPU_ENABLED;
+   r->custom_flags |= fpu_flag;
 }
 
 void setup_pause_trampoline(regs_t *r)
@@ -577,23 +582,6 @@ set_current_task_in_user_mode(void)
    set_kernel_stack((u32)curr->state_regs);
 }
 
-static inline bool
-is_fpu_enabled_for_task(struct task *ti)
-{
-   return get_task_arch_fields(ti)->aligned_fpu_regs &&
-          (ti->state_regs->custom_flags & REGS_FL_FPU_ENABLED);
-}
-
-static inline void
-save_curr_fpu_ctx_if_enabled(void)
-{
-   if (is_fpu_enabled_for_task(get_curr_task())) {
-      hw_fpu_enable();
-      save_current_fpu_regs(false);
-      hw_fpu_disable();
-   }
-}
-
 static inline void
 switch_to_task_pop_nested_interrupts(void)
 {
@@ -668,9 +656,6 @@ switch_to_task(struct task *ti)
    task_change_state_idempotent(ti, TASK_STATE_RUNNING);
    ti->ticks.timeslice = 0;
 
-   if (!is_kernel_thread(curr) && curr->state != TASK_STATE_ZOMBIE)
-      save_curr_fpu_ctx_if_enabled();
-
    if (!is_kernel_thread(ti)) {
 
       if (get_curr_pdir() != ti->pi->pdir) {
@@ -685,10 +670,17 @@ switch_to_task(struct task *ti)
       if (!ti->running_in_kernel)
          process_signals(ti, sig_in_usermode, state);
 
-      if (is_fpu_enabled_for_task(ti)) {
-         hw_fpu_enable();
-         restore_fpu_regs(ti, false);
-         /* leave FPU enabled */
+      /*
+       * Lazy FPU: the FPU regs are switched only by the "No coprocessor"
+       * fault handler (see cpu.c). Here, just make sure that the FPU will be
+       * enabled on the way back to user space only for its owner (e.g. a
+       * forked child inherits its parent's flags).
+       */
+      if (!ti->running_in_kernel) {
+         if (fpu_is_task_owner(ti))
+            state->custom_flags |= REGS_FL_FPU_ENABLED;
+         else
+            state->custom_flags &= ~REGS_FL_FPU_ENABLED;
       }
    }
 
@@ -726,6 +718,11 @@ arch_specific_new_task_setup(struct task *ti, struct task *parent)
 {
    arch_task_members_t *arch = get_task_arch_fields(ti);
 
+   if (!parent) {
+      /* execve(): the live FPU state (if any) belongs to the old image */
+      fpu_forget_task(ti);
+   }
+
    if (FORK_NO_COW) {
 
       if (parent) {
@@ -744,10 +741,10 @@ arch_specific_new_task_setup(struct task *ti, struct task *parent)
       if (arch->aligned_fpu_regs) {
 
          /*
-          * We already have an FPU regs buffer: just clear its contents and
+          * We already have an FPU regs buffer: just reset its contents and
           * keep it allocated.
           */
-         bzero(arch->aligned_fpu_regs, arch->fpu_regs_size);
+         reset_fpu_regs(arch);
 
       } else {
 
@@ -779,6 +776,7 @@ void
 arch_specific_free_task(struct task *ti)
 {
    arch_task_members_t *arch = get_task_arch_fields(ti);
+   fpu_forget_task(ti);
    aligned_kfree2(arch->aligned_fpu_regs, arch->fpu_regs_size);
    arch->aligned_fpu_regs = NULL;
    arch->fpu_regs_size = 0;
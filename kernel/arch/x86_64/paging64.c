@@ -88,6 +88,17 @@ map_zero_page(pdir_t *pdir, void *vaddrp, u32 pg_flags)
    NOT_IMPLEMENTED();
 }
 
+NODISCARD int
+map_big_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
+{
+   NOT_IMPLEMENTED();
+}
+
+void unmap_big_page(pdir_t *pdir, void *vaddrp, bool free_pageframe)
+{
+   NOT_IMPLEMENTED();
+}
+
 static inline int
 __unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
 {
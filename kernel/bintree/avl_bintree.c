@@ -217,6 +217,36 @@ bintree_get_last_obj_internal(void *root_obj, long bintree_offset)
    return root_obj;
 }
 
+void *
+bintree_lower_bound_internal(void *root_obj,
+                             const void *value_ptr,
+                             cmpfun_ptr objval_cmpfun,
+                             long bintree_offset)
+{
+   void *res = NULL;
+   long c;
+
+   while (root_obj) {
+
+      if (!(c = objval_cmpfun(root_obj, value_ptr)))
+         return root_obj;
+
+      if (c < 0) {
+
+         /* root_obj is smaller than val: the lower bound is on the right */
+         root_obj = RIGHT_OF(root_obj);
+
+      } else {
+
+         /* root_obj is a candidate, but there might be a smaller one */
+         res = root_obj;
+         root_obj = LEFT_OF(root_obj);
+      }
+   }
+
+   return res;
+}
+
 static ALWAYS_INLINE long
 bintree_insrem_ptr_cmp(const void *a, const void *b, long field_off)
 {
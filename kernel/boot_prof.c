@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/boot_prof.h>
+#include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/hal.h>
+
+/* Min number of ticks to measure, in order to estimate the TSC frequency */
+#define BOOT_PROF_CALIB_TICKS          (TIMER_HZ / 20)
+
+static struct boot_phase phases[BOOT_PROF_MAX_PHASES];
+static u32 phases_count;
+static u32 phases_lost;
+
+static u64 boot_start;
+static u64 boot_cycles;
+
+/* TSC and ticks at the first phase started after the timer was running */
+static u64 calib_tsc;
+static u64 calib_ticks;
+static u64 tsc_hz;
+
+static void boot_prof_calib_start(void)
+{
+   u64 ticks;
+
+   if (calib_ticks)
+      return;
+
+   if ((ticks = get_ticks())) {
+      calib_ticks = ticks;
+      calib_tsc = RDTSC();
+   }
+}
+
+/* Must be called with preemption disabled */
+static u64 boot_prof_get_tsc_hz(void)
+{
+   u64 ticks;
+
+   if (tsc_hz || !calib_ticks)
+      return tsc_hz;
+
+   ticks = get_ticks() - calib_ticks;
+
+   if (ticks >= BOOT_PROF_CALIB_TICKS)
+      tsc_hz = (RDTSC() - calib_tsc) * TIMER_HZ / ticks;
+
+   return tsc_hz;
+}
+
+void init_boot_prof(void)
+{
+   boot_start = RDTSC();
+}
+
+int boot_prof_begin(const char *name, u32 flags)
+{
+   const u64 now = RDTSC() - boot_start;
+   struct boot_phase *ph;
+   int id = -1;
+
+   disable_preemption();
+   {
+      boot_prof_calib_start();
+
+      if (phases_count < ARRAY_SIZE(phases)) {
+
+         id = (int)phases_count++;
+         ph = &phases[id];
+
+         ph->name = name;
+         ph->start = now;
+         ph->cycles = 0;
+         ph->tid = get_curr_tid();
+         ph->flags = flags;
+
+      } else {
+
+         phases_lost++;
+      }
+   }
+   enable_preemption();
+   return id;
+}
+
+void boot_prof_end(int id)
+{
+   const u64 now = RDTSC() - boot_start;
+
+   if (id < 0)
+      return;
+
+   disable_preemption();
+   {
+      /* Zero-length phases are recorded as 1 cycle, to mark them as done */
+      phases[id].cycles = MAX(now - phases[id].start, 1ull);
+   }
+   enable_preemption();
+}
+
+u64 boot_prof_cycles_to_us(u64 cycles, u64 hz)
+{
+   if (hz < 1000)
+      return 0;
+
+   /* Not cycles * 10^6 / hz, in order to avoid overflows */
+   return cycles * 1000 / (hz / 1000);
+}
+
+void boot_prof_get_info(struct boot_prof_info *info)
+{
+   disable_preemption();
+   {
+      *info = (struct boot_prof_info) {
+         .count = phases_count,
+         .lost = phases_lost,
+         .total_cycles = boot_cycles,
+         .tsc_hz = boot_prof_get_tsc_hz(),
+      };
+   }
+   enable_preemption();
+}
+
+u32 boot_prof_get_phases(struct boot_phase *buf, u32 off, u32 max)
+{
+   u32 n = 0;
+
+   disable_preemption();
+   {
+      if (off < phases_count) {
+         n = MIN(max, phases_count - off);
+         memcpy(buf, &phases[off], sizeof(buf[0]) * n);
+      }
+   }
+   enable_preemption();
+   return n;
+}
+
+static void boot_prof_dump(u64 hz)
+{
+   const char *unit = hz ? "us" : "cycles";
+   struct boot_phase ph;
+   u64 start, dur;
+
+   printk("Boot phases (start, duration in %s; * = async):\n", unit);
+   printk("%12s %12s %5s  %s\n", "Start", "Duration", "Tid", "Phase");
+
+   for (u32 i = 0; boot_prof_get_phases(&ph, i, 1); i++) {
+
+      start = hz ? boot_prof_cycles_to_us(ph.start, hz) : ph.start;
+      dur = hz ? boot_prof_cycles_to_us(ph.cycles, hz) : ph.cycles;
+
+      printk("%12" PRIu64 " %12" PRIu64 " %5d %c%s%s%s\n",
+             start, dur, ph.tid,
+             ph.flags & BOOT_PH_ASYNC ? '*' : ' ',
+             ph.flags & BOOT_PH_MODULE ? "mod:" : "",
+             ph.name,
+             ph.cycles ? "" : " (running)");
+   }
+}
+
+void boot_prof_done(void)
+{
+   struct boot_prof_info info;
+
+   disable_preemption();
+   {
+      boot_cycles = RDTSC() - boot_start;
+   }
+   enable_preemption();
+
+   boot_prof_get_info(&info);
+
+   if (kopt_bootprof)
+      boot_prof_dump(info.tsc_hz);
+
+   if (info.tsc_hz) {
+      printk("*** Kernel init completed in %" PRIu64 " ms\n",
+             boot_prof_cycles_to_us(info.total_cycles, info.tsc_hz) / 1000);
+   } else {
+      printk("*** Kernel init completed in %" PRIu64 " cycles\n",
+             info.total_cycles);
+   }
+}
@@ -152,8 +152,13 @@ ALL_KOPTS_BEGIN
    DEFINE_KOPT(panic_regs        , pr  , bool, PANIC_SHOW_REGS)
    DEFINE_KOPT(panic_mmap        , pm  , bool, false)
    DEFINE_KOPT(big_scroll_buf    , bb  , bool, TERM_BIG_SCROLL_BUF)
+   DEFINE_KOPT(deferred_render   , dr  , bool, TERM_DEFERRED_RENDER)
    DEFINE_KOPT(ps2_log           , plg , bool, PS2_VERBOSE_DEBUG_LOG)
    DEFINE_KOPT(ps2_selftest      , pse , bool, PS2_DO_SELFTEST)
+   DEFINE_KOPT(ramfs_max_mb      , rmb , long, 0)
+   DEFINE_KOPT(ramfs_max_inodes  , rmi , long, 0)
+   DEFINE_KOPT(bootprof          , bp  , bool, false)
+   DEFINE_KOPT(no_par_mods       , npm , bool, false)
 
 ALL_KOPTS_END
 
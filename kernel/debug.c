@@ -10,6 +10,7 @@
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/self_tests.h>
+#include <tilck/kernel/irqsoff.h>
 
 #include <elf.h>         // system header
 #include <multiboot.h>   // system header in include/system_headers
@@ -41,6 +42,8 @@ static void sched_alive_thread()
 
 void init_extra_debug_features(void)
 {
+   irqsoff_tracer_enable();
+
    if (kopt_sched_alive_thread)
       if (kthread_create(&sched_alive_thread, 0, NULL) < 0)
          panic("Unable to create a kthread for sched_alive_thread()");
@@ -5,6 +5,7 @@
 
 #include <tilck/common/string_util.h>
 #include <tilck/common/utils.h>
+#include <tilck/common/printk.h>
 
 #include <tilck/kernel/elf_loader.h>
 #include <tilck/kernel/paging.h>
@@ -16,6 +17,7 @@
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/fs/flock.h>
+#include <tilck/kernel/sort.h>
 
 #include <sys/mman.h>      // system header
 
@@ -505,35 +507,138 @@ void get_symtab_and_strtab(Elf_Shdr **symtab, Elf_Shdr **strtab)
    VERIFY(*strtab != NULL);
 }
 
+/*
+ * Kernel symbol indexes, built once at boot by init_kernel_symbols_index():
+ *
+ *    - sym_by_addr: the symbols with a non-zero size, sorted by address.
+ *      Used by find_sym_at_addr() for a binary search.
+ *
+ *    - sym_by_name: open-addressing hash table (linear probing) with all the
+ *      named symbols. Used by find_addr_of_symbol().
+ *
+ * Before the indexes are built (early boot) or in case there was no memory for
+ * them, both functions fall back to a linear scan of the symtab. In order to
+ * return exactly the same results as the linear scan, symbols with the same
+ * address or the same name are ordered by their position in the symtab.
+ */
+static Elf_Sym **sym_by_addr;
+static u32 sym_by_addr_count;
+static Elf_Sym **sym_by_name;
+static u32 sym_by_name_size;     /* power of 2 */
+static const char *sym_strtab;
+
+static ALWAYS_INLINE const char *sym_name(Elf_Shdr *strtab, Elf_Sym *s)
+{
+   return (char *)strtab->sh_addr + s->st_name;
+}
+
+static Elf_Sym *
+find_sym_at_addr_linear(Elf_Shdr *symtab, ulong vaddr)
+{
+   Elf_Sym *syms = (Elf_Sym *) symtab->sh_addr;
+   const ulong sym_count = symtab->sh_size / sizeof(Elf_Sym);
+
+   for (ulong i = 0; i < sym_count; i++) {
+      Elf_Sym *s = syms + i;
+
+      if (IN_RANGE(vaddr, s->st_value, s->st_value + s->st_size))
+         return s;
+   }
+
+   return NULL;
+}
+
+static Elf_Sym *
+find_sym_at_addr_indexed(ulong vaddr)
+{
+   Elf_Sym *s, *res = NULL;
+   u32 lo = 0, hi = sym_by_addr_count, mid;
+   ulong start;
+
+   /* Find the number of symbols starting at or before `vaddr` */
+   while (lo < hi) {
+
+      mid = lo + (hi - lo) / 2;
+
+      if (sym_by_addr[mid]->st_value <= vaddr)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (!lo)
+      return NULL;
+
+   /*
+    * Among the symbols starting at the closest address before `vaddr`, pick
+    * the first one in the symtab containing `vaddr`. NOTE: nested symbols are
+    * not supported, but the kernel doesn't have any.
+    */
+   start = sym_by_addr[lo - 1]->st_value;
+
+   for (u32 i = lo; i > 0 && sym_by_addr[i - 1]->st_value == start; i--) {
+
+      s = sym_by_addr[i - 1];
+
+      if (IN_RANGE(vaddr, start, start + s->st_size))
+         res = s;
+   }
+
+   return res;
+}
+
 const char *find_sym_at_addr(ulong vaddr, long *offset, u32 *sym_size)
 {
    Elf_Shdr *symtab;
    Elf_Shdr *strtab;
+   Elf_Sym *s;
 
    if (!KERNEL_SYMBOLS)
       return NULL;
 
    get_symtab_and_strtab(&symtab, &strtab);
 
-   Elf_Sym *syms = (Elf_Sym *) symtab->sh_addr;
-   const ulong sym_count = symtab->sh_size / sizeof(Elf_Sym);
+   if (sym_by_addr)
+      s = find_sym_at_addr_indexed(vaddr);
+   else
+      s = find_sym_at_addr_linear(symtab, vaddr);
 
-   for (ulong i = 0; i < sym_count; i++) {
-      Elf_Sym *s = syms + i;
+   if (!s)
+      return NULL;
 
-      if (IN_RANGE(vaddr, s->st_value, s->st_value + s->st_size)) {
+   if (offset)
+      *offset = (long)(vaddr - s->st_value);
 
-         if (offset)
-            *offset = (long)(vaddr - s->st_value);
+   if (sym_size)
+      *sym_size = (u32) s->st_size;
 
-         if (sym_size)
-            *sym_size = (u32) s->st_size;
+   return sym_name(strtab, s);
+}
 
-         return (char *)strtab->sh_addr + s->st_name;
-      }
+static u32 sym_name_hash(const char *name)
+{
+   u32 h = 2166136261u;     /* FNV-1a */
+
+   while (*name) {
+      h ^= (u8)*name++;
+      h *= 16777619u;
    }
 
-   return NULL;
+   return h;
+}
+
+static ulong find_addr_of_symbol_indexed(const char *searched_sym)
+{
+   const u32 mask = sym_by_name_size - 1;
+   u32 i = sym_name_hash(searched_sym) & mask;
+   Elf_Sym *s;
+
+   for (; (s = sym_by_name[i]) != NULL; i = (i + 1) & mask) {
+      if (!strcmp(sym_strtab + s->st_name, searched_sym))
+         return s->st_value;
+   }
+
+   return 0;
 }
 
 ulong find_addr_of_symbol(const char *searched_sym)
@@ -544,19 +649,102 @@ ulong find_addr_of_symbol(const char *searched_sym)
    if (!KERNEL_SYMBOLS)
       return 0;
 
+   if (sym_by_name)
+      return find_addr_of_symbol_indexed(searched_sym);
+
    get_symtab_and_strtab(&symtab, &strtab);
 
    Elf_Sym *syms = (Elf_Sym *) symtab->sh_addr;
    const ulong sym_count = symtab->sh_size / sizeof(Elf_Sym);
 
    for (ulong i = 0; i < sym_count; i++) {
-      if (!strcmp((char *)strtab->sh_addr + syms[i].st_name, searched_sym))
+      if (!strcmp(sym_name(strtab, &syms[i]), searched_sym))
          return syms[i].st_value;
    }
 
    return 0;
 }
 
+static long sym_addr_cmp(const void *a, const void *b)
+{
+   const Elf_Sym *sa = *(Elf_Sym * const *)a;
+   const Elf_Sym *sb = *(Elf_Sym * const *)b;
+
+   if (sa->st_value != sb->st_value)
+      return sa->st_value < sb->st_value ? -1 : 1;
+
+   /* Same address: keep the symtab order */
+   return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+static void sym_by_name_insert(Elf_Sym *s)
+{
+   const char *name = sym_strtab + s->st_name;
+   const u32 mask = sym_by_name_size - 1;
+   u32 i = sym_name_hash(name) & mask;
+
+   for (; sym_by_name[i] != NULL; i = (i + 1) & mask) {
+      if (!strcmp(sym_strtab + sym_by_name[i]->st_name, name))
+         return; /* Keep the first symbol with this name in the symtab */
+   }
+
+   sym_by_name[i] = s;
+}
+
+void init_kernel_symbols_index(void)
+{
+   Elf_Shdr *symtab;
+   Elf_Shdr *strtab;
+   Elf_Sym **by_addr, **by_name;
+   u32 by_addr_count = 0, by_name_size = 2;
+
+   if (!KERNEL_SYMBOLS)
+      return;
+
+   get_symtab_and_strtab(&symtab, &strtab);
+
+   Elf_Sym *syms = (Elf_Sym *) symtab->sh_addr;
+   const u32 sym_count = (u32)(symtab->sh_size / sizeof(Elf_Sym));
+
+   /* Keep the load factor of the hash table <= 50% */
+   while (by_name_size < 2 * sym_count)
+      by_name_size *= 2;
+
+   by_addr = kalloc_array_obj(Elf_Sym *, sym_count);
+   by_name = kzalloc_array_obj(Elf_Sym *, by_name_size);
+
+   if (!by_addr || !by_name) {
+
+      if (by_addr)
+         kfree_array_obj(by_addr, Elf_Sym *, sym_count);
+
+      if (by_name)
+         kfree_array_obj(by_name, Elf_Sym *, by_name_size);
+
+      printk("WARNING: no memory for the kernel symbols index\n");
+      return;
+   }
+
+   sym_strtab = (const char *)strtab->sh_addr;
+   sym_by_name = by_name;
+   sym_by_name_size = by_name_size;
+
+   for (u32 i = 0; i < sym_count; i++) {
+
+      Elf_Sym *s = syms + i;
+
+      if (s->st_size)
+         by_addr[by_addr_count++] = s;
+
+      if (s->st_name && sym_strtab[s->st_name])
+         sym_by_name_insert(s);
+   }
+
+   heap_sort_ptr(by_addr, by_addr_count, &sym_addr_cmp);
+   sym_by_addr_count = by_addr_count;
+   sym_by_addr = by_addr;
+}
+
 int foreach_symbol(int (*cb)(struct elf_symbol_info *, void *), void *arg)
 {
    Elf_Shdr *symtab;
@@ -5,6 +5,7 @@
 
 #include <tilck/kernel/fs/fat32.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/page_cache.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/datetime.h>
@@ -475,7 +476,6 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    struct mnt_fs *fs = p->fs;
    struct fat_fs_path *fp = (struct fat_fs_path *)&p->fs_path;
    struct fat_entry *e = fp->entry;
-   struct fat_fs_device_data *d = fs->device_data;
 
    if (!e) {
 
@@ -500,8 +500,8 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    h->h_fpos = 0;
    h->curr_cluster = fat_get_first_cluster(e);
 
-   if (d->mmap_support)
-      h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
+   /* Without page-aligned clusters, mmap() goes through the page cache */
+   h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
 
    *out = h;
    return 0;
@@ -653,6 +653,7 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 
 void fat_umount_ramdisk(struct mnt_fs *fs)
 {
+   pcache_drop_fs(fs);
    kfree_obj(fs->device_data, struct fat_fs_device_data);
    destory_fs_obj(fs);
 }
@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/paging.h>
@@ -10,6 +11,7 @@
 #include <tilck/kernel/system_mmap.h>
 #include <tilck/kernel/fs/vfs_base.h>
 #include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/page_cache.h>
 
 int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
 {
@@ -93,6 +95,92 @@ int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
    return 0;
 }
 
+/*
+ * Cursor in the cluster chain of a file, used to fill the pages of the page
+ * cache: because the pages are filled in order by pcache_mmap(), remembering
+ * the last cluster saves us from walking the whole chain for each page.
+ */
+struct fat_pcache_cursor {
+
+   struct fat_fs_device_data *d;
+   struct fat_entry *e;
+   u32 clu;                      /* current cluster */
+   size_t clu_off;               /* file offset where `clu` begins */
+};
+
+static int
+fat_pcache_fill(struct mnt_fs *fs,
+                vfs_inode_ptr_t inode,
+                ulong pg,
+                void *buf,
+                void *arg)
+{
+   struct fat_pcache_cursor *c = arg;
+   struct fat_fs_device_data *d = c->d;
+   const size_t pg_off = pg << PAGE_SHIFT;
+   const size_t end = MIN(pg_off + PAGE_SIZE, (size_t)c->e->DIR_FileSize);
+   size_t off = pg_off, n;
+   char *data;
+
+   ASSERT(inode == c->e);
+   ASSERT(pg_off < end);
+
+   if (off < c->clu_off) {
+      c->clu = fat_get_first_cluster(c->e);
+      c->clu_off = 0;
+   }
+
+   while (off < end) {
+
+      if (fat_is_end_of_clusterchain(d->type, c->clu))
+         return -EIO; /* The cluster chain is shorter than the file size */
+
+      if (off >= c->clu_off + d->cluster_size) {
+
+         /* Get the next cluster# from the File Allocation Table */
+         c->clu = fat_read_fat_entry(d->hdr, d->type, 0, c->clu);
+         c->clu_off += d->cluster_size;
+
+         /* We do not expect BAD CLUSTERS */
+         ASSERT(!fat_is_bad_cluster(d->type, c->clu));
+         continue;
+      }
+
+      data = fat_get_pointer_to_cluster_data(d->hdr, c->clu);
+      n = MIN(end, c->clu_off + d->cluster_size) - off;
+      memcpy((char *)buf + (off - pg_off), data + (off - c->clu_off), n);
+      off += n;
+   }
+
+   /* Zero-fill the part of the last page past EOF */
+   bzero((char *)buf + (end - pg_off), PAGE_SIZE - (end - pg_off));
+   return 0;
+}
+
+/*
+ * Our clusters are not page-aligned: we cannot map them directly, so we have to
+ * copy the data in the page cache and map its pages instead.
+ */
+static int
+fat_mmap_via_pcache(struct user_mapping *um, pdir_t *pdir)
+{
+   struct fatfs_handle *fh = um->h;
+   struct fat_pcache_cursor c = {
+      .d = fh->fs->device_data,
+      .e = fh->e,
+      .clu = fat_get_first_cluster(fh->e),
+      .clu_off = 0,
+   };
+
+   return pcache_mmap(fh->fs,
+                      fh->e,
+                      (offt)fh->e->DIR_FileSize,
+                      um,
+                      pdir,
+                      &fat_pcache_fill,
+                      &c);
+}
+
 int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 {
    struct fatfs_handle *fh = um->h;
@@ -103,15 +191,15 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    size_t mapped_cnt, tot_mapped_cnt = 0;
    u32 clu;
 
-   if (!d->mmap_support)
-      return -ENODEV; /* We do NOT support mmap for this "superblock" */
-
    if (fh->e->directory)
       return -EACCES;
 
    if (flags & VFS_MM_DONT_MMAP)
       return 0;
 
+   if (!d->mmap_support)
+      return fat_mmap_via_pcache(um, pdir);
+
    clu = fat_get_first_cluster(fh->e);
 
    do {
@@ -184,11 +272,5 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 
 int fat_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 {
-   struct fatfs_handle *fh = um->h;
-   struct fat_fs_device_data *d = fh->fs->device_data;
-
-   if (!d->mmap_support)
-      return -ENODEV; /* We do NOT support mmap for this "superblock" */
-
    return generic_fs_munmap(um, vaddrp, len);
 }
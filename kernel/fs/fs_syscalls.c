@@ -439,6 +439,54 @@ int sys_fstat64(int fd, struct k_stat64 *u_statbuf)
    return rc;
 }
 
+int sys_statfs64(const char *u_path, size_t sz, struct k_statfs64 *u_buf)
+{
+   struct task *curr = get_curr_task();
+   char *path = curr->args_copybuf;
+   struct k_statfs64 buf;
+   int rc;
+
+   if (sz != sizeof(struct k_statfs64))
+      return -EINVAL;
+
+   rc = copy_str_from_user(path, u_path, MAX_PATH, NULL);
+
+   if (rc < 0)
+      return -EFAULT;
+
+   if (rc > 0)
+      return -ENAMETOOLONG;
+
+   if ((rc = vfs_statfs(path, &buf)))
+      return rc;
+
+   if (copy_to_user(u_buf, &buf, sizeof(struct k_statfs64)))
+      rc = -EFAULT;
+
+   return rc;
+}
+
+int sys_fstatfs64(int fd, size_t sz, struct k_statfs64 *u_buf)
+{
+   struct k_statfs64 buf;
+   fs_handle h;
+   int rc;
+
+   if (sz != sizeof(struct k_statfs64))
+      return -EINVAL;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if ((rc = vfs_fstatfs(h, &buf)))
+      return rc;
+
+   if (copy_to_user(u_buf, &buf, sizeof(struct k_statfs64)))
+      rc = -EFAULT;
+
+   return rc;
+}
+
 int sys_symlink(const char *u_target, const char *u_linkpath)
 {
    struct task *curr     = get_curr_task();
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/fs/page_cache.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * The cached pages are indexed by a fixed-size hash table, chaining the pages
+ * in the same bucket through `hnext`. In addition, all the pages are in the
+ * `lru_list`, ordered by their last use: when the kernel is low on memory, the
+ * least recently used pages not mapped anywhere are evicted.
+ *
+ * Each cached page retains its pageframe: that's what allows us to know if a
+ * page is mapped somewhere else (ref-count > 1) and to keep the page alive
+ * after the last user mapping is gone (unmap never frees shared pages).
+ */
+
+#define PCACHE_BUCKETS                         1024
+
+struct pcache_page {
+
+   struct pcache_page *hnext;          /* next page in the same bucket */
+   struct list_node lru_node;
+   struct mnt_fs *fs;
+   vfs_inode_ptr_t inode;
+   ulong pg;
+   void *vaddr;
+};
+
+static struct kmutex pcache_lock = STATIC_KMUTEX_INIT(pcache_lock, 0);
+static struct list lru_list = STATIC_LIST_INIT(lru_list);
+static struct pcache_page *buckets[PCACHE_BUCKETS];
+static struct pcache_stats stats;
+
+static ALWAYS_INLINE u32 pcache_hash(vfs_inode_ptr_t inode, ulong pg)
+{
+   const ulong h = ((ulong)inode >> 4) ^ (pg * 2654435761u);
+   return (u32)(h ^ (h >> 16)) & (PCACHE_BUCKETS - 1);
+}
+
+static struct pcache_page *
+pcache_lookup(struct mnt_fs *fs, vfs_inode_ptr_t inode, ulong pg)
+{
+   struct pcache_page *p = buckets[pcache_hash(inode, pg)];
+
+   for (; p != NULL; p = p->hnext) {
+      if (p->inode == inode && p->pg == pg && p->fs == fs)
+         return p;
+   }
+
+   return NULL;
+}
+
+static bool pcache_is_page_in_use(struct pcache_page *p)
+{
+   return get_pageframe_ref_count_at(get_kernel_pdir(), p->vaddr) > 1;
+}
+
+static void pcache_remove(struct pcache_page *p)
+{
+   struct pcache_page **pp = &buckets[pcache_hash(p->inode, p->pg)];
+
+   while (*pp != p) {
+      ASSERT(*pp != NULL);
+      pp = &(*pp)->hnext;
+   }
+
+   *pp = p->hnext;
+   list_remove(&p->lru_node);
+
+   release_pageframes_mapped_at(get_kernel_pdir(), p->vaddr, PAGE_SIZE);
+   kfree2(p->vaddr, PAGE_SIZE);
+   kfree_obj(p, struct pcache_page);
+
+   stats.pages--;
+   stats.evictions++;
+}
+
+/*
+ * Evicts the least recently used pages not mapped anywhere: all of them if
+ * `all` is true, otherwise just until we're not low on memory anymore.
+ */
+static size_t pcache_shrink_nolock(bool all)
+{
+   struct pcache_page *p, *tmp;
+   size_t count = 0;
+
+   list_for_each(p, tmp, &lru_list, lru_node) {
+
+      if (!all && !kmalloc_is_low_mem())
+         break;
+
+      if (!pcache_is_page_in_use(p)) {
+         pcache_remove(p);
+         count++;
+      }
+   }
+
+   return count;
+}
+
+/* Evicts all the pages not mapped anywhere. Returns the number of them. */
+size_t pcache_shrink(void)
+{
+   size_t count;
+
+   kmutex_lock(&pcache_lock);
+   {
+      count = pcache_shrink_nolock(true);
+   }
+   kmutex_unlock(&pcache_lock);
+   return count;
+}
+
+static void *
+pcache_get_page_nolock(struct mnt_fs *fs,
+                       vfs_inode_ptr_t inode,
+                       ulong pg,
+                       pcache_fill_func fill,
+                       void *arg)
+{
+   struct pcache_page *p;
+   u32 b;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&pcache_lock));
+
+   if ((p = pcache_lookup(fs, inode, pg))) {
+      list_remove(&p->lru_node);
+      list_add_tail(&lru_list, &p->lru_node);
+      stats.hits++;
+      return p->vaddr;
+   }
+
+   stats.misses++;
+
+   if (kmalloc_is_low_mem())
+      pcache_shrink_nolock(false);
+
+   if (!(p = kalloc_obj(struct pcache_page)))
+      return NULL;
+
+   if (!(p->vaddr = kmalloc(PAGE_SIZE))) {
+      kfree_obj(p, struct pcache_page);
+      return NULL;
+   }
+
+   if (fill(fs, inode, pg, p->vaddr, arg) < 0) {
+      kfree2(p->vaddr, PAGE_SIZE);
+      kfree_obj(p, struct pcache_page);
+      return NULL;
+   }
+
+   retain_pageframes_mapped_at(get_kernel_pdir(), p->vaddr, PAGE_SIZE);
+
+   p->fs = fs;
+   p->inode = inode;
+   p->pg = pg;
+
+   b = pcache_hash(inode, pg);
+   p->hnext = buckets[b];
+   buckets[b] = p;
+
+   list_node_init(&p->lru_node);
+   list_add_tail(&lru_list, &p->lru_node);
+   stats.pages++;
+   return p->vaddr;
+}
+
+/*
+ * Maps read-only the pages of `inode` in the range described by `um`, reading
+ * them from the cache and filling the missing ones with `fill`. The pages past
+ * EOF are left unmapped, like Linux does: accessing them causes SIGBUS.
+ *
+ * NOTE: the pages are mapped while holding the cache's lock, in order to
+ * prevent pcache_shrink() from evicting them in the meanwhile.
+ */
+int
+pcache_mmap(struct mnt_fs *fs,
+            vfs_inode_ptr_t inode,
+            offt fsize,
+            struct user_mapping *um,
+            pdir_t *pdir,
+            pcache_fill_func fill,
+            void *arg)
+{
+   const ulong pg_begin = um->off >> PAGE_SHIFT;
+   const ulong pg_eof = (ulong)((fsize + PAGE_SIZE - 1) >> PAGE_SHIFT);
+   const ulong pg_end = MIN(pg_begin + (um->len >> PAGE_SHIFT), pg_eof);
+   ulong vaddr = um->vaddr;
+   void *page;
+   int rc = 0;
+
+   ASSERT(IS_PAGE_ALIGNED(um->off));
+   ASSERT(IS_PAGE_ALIGNED(um->len));
+
+   kmutex_lock(&pcache_lock);
+
+   for (ulong pg = pg_begin; pg < pg_end; pg++, vaddr += PAGE_SIZE) {
+
+      if (!(page = pcache_get_page_nolock(fs, inode, pg, fill, arg))) {
+         rc = -ENOMEM;
+         break;
+      }
+
+      rc = map_page(pdir,
+                    (void *)vaddr,
+                    KERNEL_VA_TO_PA(page),
+                    PAGING_FL_US | PAGING_FL_SHARED);
+
+      if (rc)
+         break;
+   }
+
+   if (rc) {
+      /* mmap failed, we have to unmap the pages already mapped */
+      unmap_pages_permissive(pdir,
+                             (void *)um->vaddr,
+                             (vaddr - um->vaddr) >> PAGE_SHIFT,
+                             false);
+   }
+
+   kmutex_unlock(&pcache_lock);
+   return rc;
+}
+
+/* Drops all the pages of `fs`. Supposed to be called when unmounting it. */
+void pcache_drop_fs(struct mnt_fs *fs)
+{
+   struct pcache_page *p, *tmp;
+
+   kmutex_lock(&pcache_lock);
+   {
+      list_for_each(p, tmp, &lru_list, lru_node) {
+
+         if (p->fs == fs) {
+            ASSERT(!pcache_is_page_in_use(p));
+            pcache_remove(p);
+         }
+      }
+   }
+   kmutex_unlock(&pcache_lock);
+}
+
+void pcache_get_stats(struct pcache_stats *s)
+{
+   kmutex_lock(&pcache_lock);
+   {
+      *s = stats;
+   }
+   kmutex_unlock(&pcache_lock);
+}
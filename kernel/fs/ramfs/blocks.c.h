@@ -1,52 +1,220 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
-static struct ramfs_block *ramfs_new_block(offt page)
-{
-   struct ramfs_block *b;
+/*
+ * File blocks index
+ * -------------------
+ *
+ * The data pages (blocks) of a file are indexed by their page number in a
+ * radix tree made of `struct ramfs_radix_node` objects. A tree of height `h`
+ * can index the pages in [0, RAMFS_RADIX_SLOTS^h): when a page outside of
+ * that range is needed, the tree grows by adding new roots on top of the
+ * current one. Holes have just NULL slots, at any level.
+ *
+ * Sequential and strided I/O hit the same leaf many times in a row: because of
+ * that, the last leaf used is cached in the inode and, in the common case,
+ * finding a block costs just an array lookup. The cache is invalidated only by
+ * truncate, the only operation freeing nodes.
+ */
 
-   /* Allocate memory for the block object */
-   if (!(b = kalloc_obj(struct ramfs_block)))
-      return NULL;
+static void *ramfs_new_block(void)
+{
+   void *vaddr;
 
    /* Allocate block's data */
-   if (!(b->vaddr = kzmalloc(PAGE_SIZE))) {
-      kfree_obj(b, struct ramfs_block);
+   if (!(vaddr = kzmalloc(PAGE_SIZE)))
       return NULL;
-   }
 
    /* Retain the pageframe used by this block */
-   retain_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
-
-   /* Init the block object */
-   bintree_node_init(&b->node);
-   b->offset = page;
-   return b;
+   retain_pageframes_mapped_at(get_kernel_pdir(), vaddr, PAGE_SIZE);
+   return vaddr;
 }
 
-static void ramfs_destroy_block(struct ramfs_block *b)
+static void ramfs_destroy_block(void *vaddr)
 {
    /* Release the pageframe used by this block */
-   release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   release_pageframes_mapped_at(get_kernel_pdir(), vaddr, PAGE_SIZE);
 
    /* Free the memory pointed by this block */
-   kfree2(b->vaddr, PAGE_SIZE);
+   kfree2(vaddr, PAGE_SIZE);
+}
+
+static ALWAYS_INLINE bool
+ramfs_radix_fits(struct ramfs_inode *i, ulong pg)
+{
+   const u32 bits = i->blocks_height * RAMFS_RADIX_SHIFT;
+   return i->blocks_height > 0 && (bits >= NBITS || !(pg >> bits));
+}
+
+static int ramfs_radix_grow(struct ramfs_inode *i, ulong pg)
+{
+   struct ramfs_radix_node *n;
+
+   if (!i->blocks_root) {
+
+      /* Empty tree: create directly a root having the right height */
+      if (!(i->blocks_root = kzalloc_obj(struct ramfs_radix_node)))
+         return -ENOMEM;
+
+      i->blocks_height = 1;
+
+      while (!ramfs_radix_fits(i, pg))
+         i->blocks_height++;
+
+      return 0;
+   }
+
+   while (!ramfs_radix_fits(i, pg)) {
 
-   /* Free the memory used by the block object itself */
-   kfree_obj(b, struct ramfs_block);
+      if (!(n = kzalloc_obj(struct ramfs_radix_node)))
+         return -ENOMEM;
+
+      n->slots[0] = i->blocks_root;
+      i->blocks_root = n;
+      i->blocks_height++;
+   }
+
+   return 0;
 }
 
+/*
+ * Returns the leaf containing the slot for the page `pg` or NULL, if it does
+ * not exist. When `alloc` is true, the missing nodes are created on the fly
+ * and NULL is returned only in case of out-of-memory.
+ */
+static struct ramfs_radix_node *
+ramfs_find_leaf(struct ramfs_inode *i, ulong pg, bool alloc)
+{
+   const ulong leaf_idx = pg >> RAMFS_RADIX_SHIFT;
+   struct ramfs_radix_node *n;
+   void **slot;
+
+   if (i->last_leaf && i->last_leaf_idx == leaf_idx)
+      return i->last_leaf;
+
+   if (!ramfs_radix_fits(i, pg)) {
+
+      if (!alloc || ramfs_radix_grow(i, pg) < 0)
+         return NULL;
+   }
+
+   n = i->blocks_root;
+
+   for (u32 h = i->blocks_height - 1; h > 0; h--) {
+
+      slot = &n->slots[(pg >> (h * RAMFS_RADIX_SHIFT)) & RAMFS_RADIX_MASK];
+
+      if (!*slot) {
+
+         if (!alloc || !(*slot = kzalloc_obj(struct ramfs_radix_node)))
+            return NULL;
+      }
+
+      n = *slot;
+   }
+
+   i->last_leaf = n;
+   i->last_leaf_idx = leaf_idx;
+   return n;
+}
+
+/* Returns the data page for the page index `pg`, or NULL in case of a hole */
+static void *ramfs_get_block(struct ramfs_inode *i, ulong pg)
+{
+   struct ramfs_radix_node *leaf = ramfs_find_leaf(i, pg, false);
+   return leaf ? leaf->slots[pg & RAMFS_RADIX_MASK] : NULL;
+}
+
+/*
+ * Like ramfs_get_block(), but allocates the block if it does not exist. Returns
+ * NULL when we're out of memory or the fs quota has been exceeded.
+ */
+static void *
+ramfs_get_or_new_block(struct ramfs_data *d, struct ramfs_inode *i, ulong pg)
+{
+   struct ramfs_radix_node *leaf;
+   void **slot;
+
+   if (!(leaf = ramfs_find_leaf(i, pg, true)))
+      return NULL;
+
+   slot = &leaf->slots[pg & RAMFS_RADIX_MASK];
+
+   if (!*slot) {
+
+      if (!ramfs_quota_charge(&d->used_pages, d->max_pages))
+         return NULL;
+
+      if (!(*slot = ramfs_new_block())) {
+         ramfs_quota_uncharge(&d->used_pages, 1);
+         return NULL;
+      }
+
+      i->blocks_count++;
+   }
+
+   return *slot;
+}
+
+/*
+ * Frees all the blocks having page index >= `first` in the sub-tree rooted in
+ * `n`, which has height `h` and covers the pages starting from `base`. The
+ * nodes left without any content are freed as well.
+ */
 static void
-ramfs_append_new_block(struct ramfs_inode *inode, struct ramfs_block *block)
+ramfs_radix_free_from(struct ramfs_inode *i,
+                      struct ramfs_radix_node *n,
+                      u32 h,
+                      ulong base,
+                      ulong first)
 {
-   DEBUG_ONLY_UNSAFE(bool success =)
-      bintree_insert_ptr(&inode->blocks_tree_root,
-                         block,
-                         struct ramfs_block,
-                         node,
-                         offset);
+   const u32 shift = (h - 1) * RAMFS_RADIX_SHIFT;
+
+   for (ulong s = 0; s < RAMFS_RADIX_SLOTS; s++) {
+
+      const ulong child_base = base + (s << shift);
+      const ulong child_last = child_base + ((1ul << shift) - 1);
 
-   ASSERT(success);
-   inode->blocks_count++;
+      if (!n->slots[s] || child_last < first)
+         continue;
+
+      if (h == 1) {
+
+         ramfs_destroy_block(n->slots[s]);
+         i->blocks_count--;
+
+      } else {
+
+         ramfs_radix_free_from(i, n->slots[s], h - 1, child_base, first);
+
+         if (child_base < first)
+            continue; /* the child still has blocks before `first` */
+
+         kfree_obj(n->slots[s], struct ramfs_radix_node);
+      }
+
+      n->slots[s] = NULL;
+   }
+}
+
+/* Frees all the blocks having page index >= `first` */
+static void
+ramfs_free_blocks_from(struct ramfs_data *d, struct ramfs_inode *i, ulong first)
+{
+   const size_t old_count = i->blocks_count;
+
+   if (!i->blocks_root)
+      return;
+
+   ramfs_radix_free_from(i, i->blocks_root, i->blocks_height, 0, first);
+   ramfs_quota_uncharge(&d->used_pages, old_count - i->blocks_count);
+   i->last_leaf = NULL;
+
+   if (!first) {
+      ASSERT(i->blocks_count == 0);
+      kfree_obj(i->blocks_root, struct ramfs_radix_node);
+      i->blocks_root = NULL;
+      i->blocks_height = 0;
+   }
 }
 
 static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
@@ -54,6 +222,9 @@ static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
    ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
    ASSERT(new_len > i->fsize);
 
+   if (new_len > RAMFS_MAX_FSIZE)
+      return -EFBIG;
+
    i->fsize = new_len;
    return 0;
 }
@@ -1,17 +1,183 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
-static long ramfs_insert_remove_entry_cmp(const void *a, const void *b)
+/*
+ * Directory entries
+ * -------------------
+ *
+ * The hash table doubles its size when the number of entries exceeds the number
+ * of buckets, keeping the lookups O(1) on average. If growing the table fails
+ * because we're out of memory, it just keeps working with longer chains.
+ *
+ * The slots of the removed entries are kept in a free list threaded through the
+ * slots themselves: a free slot contains the index + 1 of the next free slot
+ * (0 meaning the end of the list) shifted left by 1, with the lowest bit set.
+ * Free slots are reused by new entries, so `slots` does not grow past the peak
+ * number of entries in the directory. When a directory becomes empty (just "."
+ * and ".." are left), both the tables are shrunk back to their initial size.
+ * Because shrinking compacts `slots`, it's done only when there are no open
+ * handles on the directory: otherwise, it's deferred until the last one gets
+ * closed, keeping the positions of the handles stable.
+ */
+
+#define RAMFS_DIR_MIN_BUCKETS             8
+#define RAMFS_DIR_MIN_SLOTS               8
+
+static ALWAYS_INLINE bool ramfs_slot_is_free(void *slot)
+{
+   return (ulong)slot & 1;
+}
+
+static ALWAYS_INLINE void *ramfs_make_free_slot(u32 next_head)
+{
+   return (void *)(((ulong)next_head << 1) | 1);
+}
+
+static ALWAYS_INLINE u32 ramfs_free_slot_get_next(void *slot)
+{
+   return (u32)((ulong)slot >> 1);
+}
+
+/* FNV-1a hash */
+static u32 ramfs_name_hash(const char *name, size_t len)
+{
+   u32 h = 2166136261u;
+
+   for (size_t i = 0; i < len; i++) {
+      h ^= (u8)name[i];
+      h *= 16777619u;
+   }
+
+   return h;
+}
+
+static int ramfs_dir_alloc_tables(struct ramfs_inode *idir)
+{
+   idir->buckets =
+      kzalloc_array_obj(struct ramfs_entry *, RAMFS_DIR_MIN_BUCKETS);
+
+   if (!idir->buckets)
+      return -ENOMEM;
+
+   idir->slots = kalloc_array_obj(void *, RAMFS_DIR_MIN_SLOTS);
+
+   if (!idir->slots) {
+      kfree_array_obj(idir->buckets, void *, RAMFS_DIR_MIN_BUCKETS);
+      idir->buckets = NULL;
+      return -ENOMEM;
+   }
+
+   idir->buckets_count = RAMFS_DIR_MIN_BUCKETS;
+   idir->slots_cap = RAMFS_DIR_MIN_SLOTS;
+   idir->slots_count = 0;
+   idir->free_slots_head = 0;
+   return 0;
+}
+
+static void ramfs_dir_free_tables(struct ramfs_inode *idir)
+{
+   ASSERT(idir->num_entries == 0);
+
+   if (!idir->buckets)
+      return;
+
+   kfree_array_obj(idir->buckets, void *, idir->buckets_count);
+   kfree_array_obj(idir->slots, void *, idir->slots_cap);
+   idir->buckets = NULL;
+   idir->slots = NULL;
+   idir->buckets_count = 0;
+   idir->slots_cap = 0;
+   idir->slots_count = 0;
+   idir->free_slots_head = 0;
+}
+
+static void ramfs_dir_rehash(struct ramfs_inode *idir, u32 new_count)
+{
+   struct ramfs_entry **nb, *e, *next;
+   u32 b;
+
+   if (!(nb = kzalloc_array_obj(struct ramfs_entry *, new_count)))
+      return; /* Not a problem: just keep using the current table */
+
+   for (u32 i = 0; i < idir->buckets_count; i++) {
+      for (e = idir->buckets[i]; e != NULL; e = next) {
+         next = e->hnext;
+         b = e->hash & (new_count - 1);
+         e->hnext = nb[b];
+         nb[b] = e;
+      }
+   }
+
+   kfree_array_obj(idir->buckets, void *, idir->buckets_count);
+   idir->buckets = nb;
+   idir->buckets_count = new_count;
+}
+
+static ALWAYS_INLINE bool ramfs_dir_can_shrink(struct ramfs_inode *idir)
+{
+   return idir->num_entries == 2 && idir->slots_cap > RAMFS_DIR_MIN_SLOTS;
+}
+
+/*
+ * Called when the directory has just "." and ".." and no open handles:
+ * re-allocate the tables with their minimum size, moving the entries at the
+ * beginning of `slots`.
+ */
+static void ramfs_dir_shrink_tables(struct ramfs_inode *idir)
 {
-   const struct ramfs_entry *e1 = a;
-   const struct ramfs_entry *e2 = b;
-   return strcmp(e1->name, e2->name);
+   struct ramfs_entry *e;
+   void **ns;
+   u32 n = 0;
+
+   if (!(ns = kalloc_array_obj(void *, RAMFS_DIR_MIN_SLOTS)))
+      return; /* Not a problem: just keep the current tables */
+
+   for (u32 i = 0; i < idir->slots_count; i++) {
+
+      if (ramfs_slot_is_free(e = idir->slots[i]))
+         continue;
+
+      e->slot = n;
+      ns[n++] = e;
+   }
+
+   ASSERT(n == idir->num_entries);
+   kfree_array_obj(idir->slots, void *, idir->slots_cap);
+
+   idir->slots = ns;
+   idir->slots_cap = RAMFS_DIR_MIN_SLOTS;
+   idir->slots_count = n;
+   idir->free_slots_head = 0;
+
+   if (idir->buckets_count > RAMFS_DIR_MIN_BUCKETS)
+      ramfs_dir_rehash(idir, RAMFS_DIR_MIN_BUCKETS);
 }
 
-static long ramfs_find_entry_cmp(const void *obj, const void *valptr)
+static int ramfs_dir_get_free_slot(struct ramfs_inode *idir, u32 *slot)
 {
-   const struct ramfs_entry *e = obj;
-   const char *searched_str = valptr;
-   return strcmp(e->name, searched_str);
+   void **ns;
+   u32 new_cap;
+
+   if (idir->free_slots_head) {
+      *slot = idir->free_slots_head - 1;
+      idir->free_slots_head = ramfs_free_slot_get_next(idir->slots[*slot]);
+      return 0;
+   }
+
+   if (idir->slots_count == idir->slots_cap) {
+
+      new_cap = idir->slots_cap * 2;
+
+      if (!(ns = kalloc_array_obj(void *, new_cap)))
+         return -ENOSPC;
+
+      memcpy(ns, idir->slots, sizeof(void *) * idir->slots_count);
+      kfree_array_obj(idir->slots, void *, idir->slots_cap);
+      idir->slots = ns;
+      idir->slots_cap = new_cap;
+   }
+
+   *slot = idir->slots_count++;
+   return 0;
 }
 
 static int
@@ -21,76 +187,81 @@ ramfs_dir_add_entry(struct ramfs_inode *idir,
 {
    struct ramfs_entry *e;
    size_t enl = strlen(iname) + 1;
+   u32 slot, b;
    ASSERT(idir->type == VFS_DIR);
+   ASSERT(idir->buckets != NULL);
 
    if (enl == 1)
       return -ENOENT;
 
-   if (enl > sizeof(e->name))
+   if (iname[enl - 2] == '/')
+      enl--; /* drop the trailing slash */
+
+   if (enl > RAMFS_ENTRY_MAX_LEN)
       return -ENAMETOOLONG;
 
-   if (!(e = kalloc_obj(struct ramfs_entry)))
+   if (!(e = kmalloc(sizeof(struct ramfs_entry) + enl)))
       return -ENOSPC;
 
-   ASSERT(ie->parent_dir != NULL);
+   if (ramfs_dir_get_free_slot(idir, &slot) < 0) {
+      kfree2(e, sizeof(struct ramfs_entry) + enl);
+      return -ENOSPC;
+   }
 
-   bintree_node_init(&e->node);
-   list_node_init(&e->lnode);
+   ASSERT(ie->parent_dir != NULL);
 
    e->inode = ie;
-   memcpy(e->name, iname, enl);
-
-   if (e->name[enl-2] == '/') {
-      e->name[enl-2] = 0; /* drop the trailing slash */
-      enl--;
-   }
-
+   e->hash = ramfs_name_hash(iname, enl - 1);
+   e->slot = slot;
    e->name_len = (u8) enl;
+   memcpy(e->name, iname, enl - 1);
+   e->name[enl - 1] = 0;
 
-   bintree_insert(&idir->entries_tree_root,
-                  e,
-                  ramfs_insert_remove_entry_cmp,
-                  struct ramfs_entry,
-                  node);
-
-   list_add_tail(&idir->entries_list, &e->lnode);
+   b = e->hash & (idir->buckets_count - 1);
+   e->hnext = idir->buckets[b];
+   idir->buckets[b] = e;
+   idir->slots[slot] = e;
 
    ie->nlink++;
    idir->num_entries++;
+
+   if ((u32)idir->num_entries > idir->buckets_count)
+      ramfs_dir_rehash(idir, idir->buckets_count * 2);
+
    return 0;
 }
 
 static void
 ramfs_dir_remove_entry(struct ramfs_inode *idir, struct ramfs_entry *e)
 {
-   struct ramfs_handle *pos;
    struct ramfs_inode *ie = e->inode;
+   struct ramfs_entry **pp;
    ASSERT(idir->type == VFS_DIR);
 
-   /*
-    * Before removing this entry, we have to check if, among the handles opened
-    * for `idir`, there are any having dpos == e. For each one of them, we have
-    * to move `dpos` forward, before removing the entry `e`.
-    */
-
-   list_for_each_ro(pos, &idir->handles_list, node) {
+   pp = &idir->buckets[e->hash & (idir->buckets_count - 1)];
 
-      if (pos->dpos == e)
-         pos->dpos = list_next_obj(pos->dpos, lnode);
+   while (*pp != e) {
+      ASSERT(*pp != NULL);
+      pp = &(*pp)->hnext;
    }
 
-   bintree_remove(&idir->entries_tree_root,
-                  e,
-                  ramfs_insert_remove_entry_cmp,
-                  struct ramfs_entry,
-                  node);
+   *pp = e->hnext;
 
-   list_remove(&e->lnode);
+   /*
+    * Free entry's slot. Note: no matter where the open handles of `idir` are,
+    * they don't need to be updated: their position is just an index in `slots`
+    * and the free slots are skipped by getdents().
+    */
+   idir->slots[e->slot] = ramfs_make_free_slot(idir->free_slots_head);
+   idir->free_slots_head = e->slot + 1;
 
    ASSERT(ie->nlink > 0);
    ie->nlink--;
    idir->num_entries--;
-   kfree_obj(e, struct ramfs_entry);
+   kfree2(e, sizeof(struct ramfs_entry) + e->name_len);
+
+   if (ramfs_dir_can_shrink(idir) && !get_ref_count(idir))
+      ramfs_dir_shrink_tables(idir);
 }
 
 static struct ramfs_entry *
@@ -98,13 +269,18 @@ ramfs_dir_get_entry_by_name(struct ramfs_inode *idir,
                             const char *name,
                             ssize_t len)
 {
-   char buf[RAMFS_ENTRY_MAX_LEN];
-   memcpy(buf, name, (size_t) len);
-   buf[len] = 0;
-
-   return bintree_find(idir->entries_tree_root,
-                       buf,
-                       ramfs_find_entry_cmp,
-                       struct ramfs_entry,
-                       node);
+   const u32 h = ramfs_name_hash(name, (size_t)len);
+   struct ramfs_entry *e = idir->buckets[h & (idir->buckets_count - 1)];
+
+   for (; e != NULL; e = e->hnext) {
+
+      if (e->hash == h &&
+          e->name_len == len + 1 &&
+          !memcmp(e->name, name, (size_t)len))
+      {
+         return e;
+      }
+   }
+
+   return NULL;
 }
@@ -12,13 +12,23 @@ static int ramfs_getdents(fs_handle h, get_dents_func_cb cb, void *arg)
    if ((inode->mode & 0400) != 0400) /* read permission */
       return -EACCES;
 
-   list_for_each_ro_kp(rh->dpos, &inode->entries_list, lnode) {
+   /*
+    * The position of a handle is just an index in the `slots` array: see the
+    * comments in ramfs_int.h and dir_entries.c.h.
+    */
+   for (offt pos = rh->dir_pos; pos < inode->slots_count; pos++) {
+
+      struct ramfs_entry *e = inode->slots[pos];
+
+      if (ramfs_slot_is_free(e))
+         continue;
 
       struct vfs_dent64 dent = {
-         .ino        = rh->dpos->inode->ino,
-         .type       = rh->dpos->inode->type,
-         .name_len   = rh->dpos->name_len,
-         .name       = rh->dpos->name,
+         .ino        = e->inode->ino,
+         .type       = e->inode->type,
+         .name_len   = e->name_len,
+         .name       = e->name,
+         .next_off   = pos + 1,
       };
 
       if ((rc = cb(&dent, arg)))
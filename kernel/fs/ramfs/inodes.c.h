@@ -4,11 +4,16 @@
 
 static struct ramfs_inode *ramfs_new_inode(struct ramfs_data *d)
 {
-   struct ramfs_inode *i = kzalloc_obj(struct ramfs_inode);
+   struct ramfs_inode *i;
 
-   if (!i)
+   if (!ramfs_quota_charge(&d->used_inodes, d->max_inodes))
       return NULL;
 
+   if (!(i = kzalloc_obj(struct ramfs_inode))) {
+      ramfs_quota_uncharge(&d->used_inodes, 1);
+      return NULL;
+   }
+
    rwlock_wp_init(&i->rwlock, true);
    list_init(&i->mappings_list);
 
@@ -22,6 +27,44 @@ static struct ramfs_inode *ramfs_new_inode(struct ramfs_data *d)
    return i;
 }
 
+static int ramfs_destroy_inode(struct ramfs_data *d, struct ramfs_inode *i)
+{
+   /*
+    * We can destroy only inodes referring to NO blocks (= data) in case of
+    * files and no entries in case of directories. Also, we have to be SURE that
+    * no dir entry nor file handle points to it.
+    */
+   ASSERT(get_ref_count(i) == 0);
+   ASSERT(i->nlink == 0);
+
+   switch (i->type) {
+
+      case VFS_NONE:
+         /* do nothing */
+         break;
+
+      case VFS_FILE:
+         ASSERT(i->blocks_root == NULL);
+         break;
+
+      case VFS_DIR:
+         ramfs_dir_free_tables(i);
+         break;
+
+      case VFS_SYMLINK:
+         kfree2(i->path, i->path_len + 1);
+         break;
+
+      default:
+         NOT_IMPLEMENTED();
+   }
+
+   rwlock_wp_destroy(&i->rwlock);
+   kfree_obj(i, struct ramfs_inode);
+   ramfs_quota_uncharge(&d->used_inodes, 1);
+   return 0;
+}
+
 static struct ramfs_inode *
 ramfs_create_inode_dir(struct ramfs_data *d,
                        mode_t mode,
@@ -34,8 +77,6 @@ ramfs_create_inode_dir(struct ramfs_data *d,
 
    i->type = VFS_DIR;
    i->mode = (mode & 0777) | S_IFDIR;
-   list_init(&i->entries_list);
-   list_init(&i->handles_list);
 
    if (!parent) {
       /* root case */
@@ -44,17 +85,22 @@ ramfs_create_inode_dir(struct ramfs_data *d,
 
    i->parent_dir = parent;
 
+   if (ramfs_dir_alloc_tables(i) < 0) {
+      ramfs_destroy_inode(d, i);
+      return NULL;
+   }
+
    if (ramfs_dir_add_entry(i, ".", i) < 0) {
-      kfree_obj(i, struct ramfs_inode);
+      ramfs_destroy_inode(d, i);
       return NULL;
    }
 
    if (ramfs_dir_add_entry(i, "..", parent) < 0) {
 
-      struct ramfs_entry *e = i->entries_tree_root;
+      struct ramfs_entry *e = ramfs_dir_get_entry_by_name(i, ".", 1);
       ramfs_dir_remove_entry(i, e);
 
-      kfree_obj(i, struct ramfs_inode);
+      ramfs_destroy_inode(d, i);
       return NULL;
    }
 
@@ -82,43 +128,6 @@ ramfs_create_inode_file(struct ramfs_data *d,
    return i;
 }
 
-static int ramfs_destroy_inode(struct ramfs_data *d, struct ramfs_inode *i)
-{
-   /*
-    * We can destroy only inodes referring to NO blocks (= data) in case of
-    * files and no entries in case of directories. Also, we have to be SURE that
-    * no dir entry nor file handle points to it.
-    */
-   ASSERT(get_ref_count(i) == 0);
-   ASSERT(i->nlink == 0);
-
-   switch (i->type) {
-
-      case VFS_NONE:
-         /* do nothing */
-         break;
-
-      case VFS_FILE:
-         ASSERT(i->blocks_tree_root == NULL);
-         break;
-
-      case VFS_DIR:
-         ASSERT(i->entries_tree_root == NULL);
-         break;
-
-      case VFS_SYMLINK:
-         kfree2(i->path, i->path_len + 1);
-         break;
-
-      default:
-         NOT_IMPLEMENTED();
-   }
-
-   rwlock_wp_destroy(&i->rwlock);
-   kfree_obj(i, struct ramfs_inode);
-   return 0;
-}
-
 static struct ramfs_inode *
 ramfs_create_inode_symlink(struct ramfs_data *d,
                            struct ramfs_inode *parent,
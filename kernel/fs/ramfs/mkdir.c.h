@@ -29,6 +29,7 @@ static int ramfs_rmdir(struct vfs_path *p)
    struct ramfs_path *rp = (struct ramfs_path *) &p->fs_path;
    struct ramfs_data *d = p->fs->device_data;
    struct ramfs_inode *i = rp->inode;
+   struct ramfs_entry *e;
 
    ASSERT(rwlock_wp_holding_exlock(&d->rwlock));
 
@@ -58,14 +59,15 @@ static int ramfs_rmdir(struct vfs_path *p)
       return -EBUSY;
    }
 
-   ASSERT(i->entries_tree_root != NULL);
-   ramfs_dir_remove_entry(i, i->entries_tree_root);   // drop .
+   e = ramfs_dir_get_entry_by_name(i, ".", 1);
+   ASSERT(e != NULL);
+   ramfs_dir_remove_entry(i, e);                      // drop .
 
-   ASSERT(i->entries_tree_root != NULL);
-   ramfs_dir_remove_entry(i, i->entries_tree_root);   // drop ..
+   e = ramfs_dir_get_entry_by_name(i, "..", 2);
+   ASSERT(e != NULL);
+   ramfs_dir_remove_entry(i, e);                      // drop ..
 
    ASSERT(i->num_entries == 0);
-   ASSERT(i->entries_tree_root == NULL);
 
    /* Remove the dir entry */
    ramfs_dir_remove_entry(rp->dir_inode, rp->dir_entry);
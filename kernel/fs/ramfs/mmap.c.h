@@ -11,13 +11,12 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    struct ramfs_handle *rh = um->h;
    struct ramfs_inode *i = rh->inode;
    ulong vaddr = um->vaddr;
-   struct bintree_walk_ctx ctx;
-   struct ramfs_block *b;
+   void *b;
    u32 pg_flags;
    int rc;
 
-   const size_t off_begin = um->off;
-   const size_t off_end = off_begin + um->len;
+   const ulong pg_begin = um->off >> PAGE_SHIFT;
+   const ulong pg_end = pg_begin + (um->len >> PAGE_SHIFT);
 
    ASSERT(IS_PAGE_ALIGNED(um->len));
 
@@ -27,29 +26,21 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    if (flags & VFS_MM_DONT_MMAP)
       goto register_mapping;
 
-   bintree_in_order_visit_start(&ctx,
-                                i->blocks_tree_root,
-                                struct ramfs_block,
-                                node,
-                                false);
-
    pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
 
    if ((rh->fl_flags & O_RDWR) == O_RDWR)
       pg_flags |= PAGING_FL_RW;
 
-   while ((b = bintree_in_order_visit_next(&ctx))) {
-
-      if ((size_t)b->offset < off_begin)
-         continue; /* skip this block */
+   /*
+    * Map the existing blocks. The holes are left unmapped: they will be
+    * handled on-the-fly by ramfs_handle_fault().
+    */
+   for (ulong pg = pg_begin; pg < pg_end; pg++, vaddr += PAGE_SIZE) {
 
-      if ((size_t)b->offset >= off_end)
-         break;
+      if (!(b = ramfs_get_block(i, pg)))
+         continue;
 
-      rc = map_page(pdir,
-                    (void *)vaddr,
-                    KERNEL_VA_TO_PA(b->vaddr),
-                    pg_flags);
+      rc = map_page(pdir, (void *)vaddr, KERNEL_VA_TO_PA(b), pg_flags);
 
       if (rc) {
 
@@ -62,8 +53,6 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 
          return rc;
       }
-
-      vaddr += PAGE_SIZE;
    }
 
 register_mapping:
@@ -84,7 +73,8 @@ ramfs_handle_fault_int(struct process *pi,
    struct ramfs_handle *rh = um->h;
    ulong vaddr = (ulong) vaddrp;
    ulong abs_off;
-   struct ramfs_block *block;
+   void *block;
+   u32 pg_flags = PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED;
    int rc;
 
    ASSERT(um != NULL);
@@ -108,20 +98,31 @@ ramfs_handle_fault_int(struct process *pi,
       return false; /* Read/write past EOF */
 
    if (rw) {
-      /* Create and map on-the-fly a struct ramfs_block */
-      if (!(block = ramfs_new_block((offt)(abs_off & PAGE_MASK))))
-         panic("Out-of-memory: unable to alloc a ramfs_block. No OOM killer");
 
-      ramfs_append_new_block(rh->inode, block);
+      /* Create (if necessary) and map on-the-fly the block */
+      block = ramfs_get_or_new_block(rh->fs->device_data,
+                                     rh->inode,
+                                     abs_off >> PAGE_SHIFT);
+
+      if (!block)
+         return false; /* Out of quota or low on memory: the task gets SIGBUS */
+
+   } else {
+
+      /* The block might have been created after the mmap() call */
+      block = ramfs_get_block(rh->inode, abs_off >> PAGE_SHIFT);
+
+      if (block && !(um->prot & PROT_WRITE))
+         pg_flags &= ~PAGING_FL_RW;
    }
 
    rc = map_page(pi->pdir,
                  (void *)(vaddr & PAGE_MASK),
-                 KERNEL_VA_TO_PA(rw ? block->vaddr : &zero_page),
-                 PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED);
+                 KERNEL_VA_TO_PA(block ? block : &zero_page),
+                 pg_flags);
 
    if (rc)
-      panic("Out-of-memory: unable to map a ramfs_block. No OOM killer");
+      panic("Out-of-memory: unable to map a ramfs block. No OOM killer");
 
    invalidate_page(vaddr);
    return true;
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Quotas
+ * --------
+ *
+ * Each ramfs instance has a limit for the number of file blocks (pages) and one
+ * for the number of inodes it can use. On top of that, no new block nor inode
+ * is allocated when the kernel is low on heap memory (see kmalloc_is_low_mem()):
+ * because ramfs' memory cannot be reclaimed, it's much better to fail early a
+ * write() with ENOSPC than leaving the rest of the kernel without memory.
+ *
+ * The counters are shared by all the inodes of the fs, while read/write and
+ * truncate lock only the inode they're working on: because of that, the
+ * counters are updated with preemption disabled.
+ */
+
+#define RAMFS_MAGIC                               0x858458f6
+
+static bool ramfs_quota_charge(size_t *used, size_t max)
+{
+   bool ok = false;
+
+   if (kmalloc_is_low_mem())
+      return false;
+
+   disable_preemption();
+   {
+      if (*used < max) {
+         (*used)++;
+         ok = true;
+      }
+   }
+   enable_preemption();
+   return ok;
+}
+
+static void ramfs_quota_uncharge(size_t *used, size_t n)
+{
+   disable_preemption();
+   {
+      ASSERT(*used >= n);
+      *used -= n;
+   }
+   enable_preemption();
+}
+
+static int ramfs_statfs(struct mnt_fs *fs, struct k_statfs64 *buf)
+{
+   struct ramfs_data *d = fs->device_data;
+   const size_t heap_free = kmalloc_get_tot_heap_free();
+   const size_t reserve = kmalloc_get_low_mem_reserve();
+   size_t used_pages, used_inodes, avail_pages;
+
+   disable_preemption();
+   {
+      used_pages = d->used_pages;
+      used_inodes = d->used_inodes;
+   }
+   enable_preemption();
+
+   /* The memory actually available might be less than what the quota allows */
+   avail_pages = d->max_pages - used_pages;
+
+   if (heap_free > reserve)
+      avail_pages = MIN(avail_pages, (heap_free - reserve) >> PAGE_SHIFT);
+   else
+      avail_pages = 0;
+
+   buf->f_type = RAMFS_MAGIC;
+   buf->f_blocks = d->max_pages;
+   buf->f_bfree = d->max_pages - used_pages;
+   buf->f_bavail = avail_pages;
+   buf->f_files = d->max_inodes;
+   buf->f_ffree = d->max_inodes - used_inodes;
+   buf->f_namelen = RAMFS_ENTRY_MAX_LEN - 1;
+   return 0;
+}
@@ -1,20 +1,24 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/config_kernel.h>
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/string_util.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/utils.h>
 
 #include <tilck/kernel/process.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/fs/flock.h>
 #include <tilck/kernel/test/vfs.h>
 
 #include <sys/mman.h>      // system header
 
 #include "ramfs_int.h"
-#include "getdents.c.h"
 #include "locking.c.h"
+#include "quota.c.h"
 #include "dir_entries.c.h"
+#include "getdents.c.h"
 #include "inodes.c.h"
 #include "stat.c.h"
 #include "blocks.c.h"
@@ -52,7 +56,7 @@ static int ramfs_unlink(struct vfs_path *p)
 
       if (i->type == VFS_FILE) {
          DEBUG_ONLY_UNSAFE(int rc =)
-            ramfs_inode_truncate_safe(i, 0, true /* no_perm_check */);
+            ramfs_inode_truncate_safe(d, i, 0, true /* no_perm_check */);
 
          ASSERT(rc == 0);
       }
@@ -66,17 +70,31 @@ static int ramfs_unlink(struct vfs_path *p)
 static void ramfs_on_close(fs_handle h)
 {
    struct ramfs_handle *rh = h;
+   struct ramfs_data *d = rh->fs->device_data;
    struct ramfs_inode *i = rh->inode;
 
-   if (i->type == VFS_DIR) {
-      /* Remove this handle from h->inode->handles_list */
-      list_remove(&rh->node);
+   if (i->type != VFS_DIR || !ramfs_dir_can_shrink(i))
+      return;
+
+   /*
+    * The directory has been emptied while it had open handles, so its tables
+    * haven't been shrunk by ramfs_dir_remove_entry(). Do it now, if this is
+    * the last handle: its position doesn't matter anymore. The unlocked check
+    * above just avoids taking the lock on every close.
+    */
+
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      if (ramfs_dir_can_shrink(i) && get_ref_count(i) == 1)
+         ramfs_dir_shrink_tables(i);
    }
+   rwlock_wp_exunlock(&d->rwlock);
 }
 
 static void ramfs_on_close_last_handle(fs_handle h)
 {
    struct ramfs_handle *rh = h;
+   struct ramfs_data *d = rh->fs->device_data;
    struct ramfs_inode *i = rh->inode;
 
    if (!i->nlink) {
@@ -92,9 +110,9 @@ static void ramfs_on_close_last_handle(fs_handle h)
        */
 
       if (i->type == VFS_FILE)
-         ramfs_inode_truncate_safe(i, 0, true);
+         ramfs_inode_truncate_safe(d, i, 0, true);
 
-      ramfs_destroy_inode(rh->fs->device_data, i);
+      ramfs_destroy_inode(d, i);
    }
 }
 
@@ -330,6 +348,7 @@ static const struct fs_ops static_fsops_ramfs =
    .rename = ramfs_rename,
    .link = ramfs_link,
    .futimens = ramfs_futimens,
+   .statfs = ramfs_statfs,
    .retain_inode = ramfs_retain_inode,
    .release_inode = ramfs_release_inode,
 
@@ -339,7 +358,11 @@ static const struct fs_ops static_fsops_ramfs =
    .fs_shunlock = ramfs_shunlock,
 };
 
-struct mnt_fs *ramfs_create(void)
+/*
+ * Creates a ramfs instance allowed to use at most `max_bytes` for the data of
+ * its files and to have at most `max_inodes` inodes.
+ */
+struct mnt_fs *ramfs_create_with_quota(size_t max_bytes, size_t max_inodes)
 {
    struct mnt_fs *fs;
    struct ramfs_data *d;
@@ -347,6 +370,9 @@ struct mnt_fs *ramfs_create(void)
    if (!(d = kzalloc_obj(struct ramfs_data)))
       return NULL;
 
+   d->max_pages = max_bytes >> PAGE_SHIFT;
+   d->max_inodes = max_inodes;
+
    fs = create_fs_obj("ramfs", &static_fsops_ramfs, d, VFS_FS_RW);
 
    if (!fs) {
@@ -366,3 +392,24 @@ struct mnt_fs *ramfs_create(void)
    return fs;
 }
 
+/*
+ * Creates a ramfs instance with the quotas set on the kernel's cmdline or,
+ * by default, with a fraction of the heap memory.
+ */
+struct mnt_fs *ramfs_create(void)
+{
+   const size_t tot_mb = kmalloc_get_max_tot_heap_free() / MB;
+   size_t max_bytes, max_inodes;
+
+   if (kopt_ramfs_max_mb > 0)
+      max_bytes = MIN((size_t)kopt_ramfs_max_mb, tot_mb) * MB;
+   else
+      max_bytes = tot_mb * RAMFS_DEF_MEM_PERCENT / 100 * MB;
+
+   if (kopt_ramfs_max_inodes > 0)
+      max_inodes = (size_t)kopt_ramfs_max_inodes;
+   else
+      max_inodes = max_bytes / RAMFS_BYTES_PER_INODE;
+
+   return ramfs_create_with_quota(max_bytes, max_inodes);
+}
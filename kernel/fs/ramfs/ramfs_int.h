@@ -20,39 +20,50 @@
 
 struct ramfs_inode;
 
-struct ramfs_block {
+/*
+ * Node of the radix tree indexing file's blocks (see blocks.c.h). In the
+ * leaves, the slots point to the data pages; in all the other nodes, they point
+ * to the children nodes.
+ */
+#define RAMFS_RADIX_SHIFT                 6
+#define RAMFS_RADIX_SLOTS                 (1u << RAMFS_RADIX_SHIFT)
+#define RAMFS_RADIX_MASK                  (RAMFS_RADIX_SLOTS - 1)
 
-   struct bintree_node node;
-   offt offset;                  /* MUST BE divisible by PAGE_SIZE */
-   void *vaddr;
+struct ramfs_radix_node {
+   void *slots[RAMFS_RADIX_SLOTS];
 };
 
+/* Files cannot be bigger than this: their page indexes must fit in a ulong */
+#define RAMFS_MAX_FSIZE                                           \
+   (sizeof(offt) > sizeof(ulong)                                  \
+      ? (offt)((u64)ULONG_MAX << PAGE_SHIFT)                      \
+      : OFFT_MAX)
+
 /*
- * Ramfs entries do not *necessarily* need to have a fixed size, as they are
- * allocated dynamically on the heap. Said that, a fixed-size entry struct is
- * simpler to manage and faster to alloc/free, in particular with Tilck's
- * current kmalloc implementation.
+ * Ramfs entries are variable-size objects: each one is allocated with just the
+ * room necessary for its name. Each directory indexes its entries in two ways:
+ *
+ *    - by name, in a hash table (`buckets`), chaining the entries in the same
+ *      bucket through `hnext`.
+ *
+ *    - by position, in the `slots` array. The index of an entry in that array
+ *      is its position in the directory, used by getdents() and seek(): that
+ *      allows resuming a directory walk in O(1), from any position.
+ *
+ * See dir_entries.c.h for the details.
  */
-#define RAMFS_ENTRY_SIZE 256
-#define RAMFS_ENTRY_MAX_LEN (                   \
-   RAMFS_ENTRY_SIZE                             \
-   - sizeof(struct bintree_node)                \
-   - sizeof(struct list_node)                   \
-   - sizeof(struct ramfs_inode *)               \
-   - sizeof(u8)                                 \
-)
+#define RAMFS_ENTRY_MAX_LEN               255   /* including the final \0 */
 
 struct ramfs_entry {
 
-   struct bintree_node node;
-   struct list_node lnode;
+   struct ramfs_entry *hnext;       /* next entry in the same hash bucket */
    struct ramfs_inode *inode;
+   u32 hash;
+   u32 slot;                        /* index in the dir's `slots` array */
    u8 name_len;                     /* NOTE: includes the final \0 */
-   char name[RAMFS_ENTRY_MAX_LEN];
+   char name[];
 };
 
-STATIC_ASSERT(sizeof(struct ramfs_entry) == RAMFS_ENTRY_SIZE);
-
 struct ramfs_inode {
 
    /*
@@ -75,15 +86,23 @@ struct ramfs_inode {
       /* valid when type == VFS_FILE */
       struct {
          offt fsize;
-         struct ramfs_block *blocks_tree_root;
+         struct ramfs_radix_node *blocks_root;
+         u32 blocks_height;                     /* 0 = no blocks */
+
+         /* Cache of the last leaf used (for sequential access) */
+         struct ramfs_radix_node *last_leaf;
+         ulong last_leaf_idx;                   /* page index >> SHIFT */
       };
 
       /* valid when type == VFS_DIR */
       struct {
          offt num_entries;
-         struct ramfs_entry *entries_tree_root;
-         struct list entries_list;
-         struct list handles_list;
+         struct ramfs_entry **buckets;          /* hash table, by name */
+         void **slots;                          /* entries, by position */
+         u32 buckets_count;                     /* a power of 2 */
+         u32 slots_count;                       /* used slots, incl. free */
+         u32 slots_cap;                         /* allocated slots */
+         u32 free_slots_head;                   /* see dir_entries.c.h */
       };
 
       /* valid when type == VFS_SYMLINK */
@@ -105,12 +124,6 @@ struct ramfs_handle {
 
    /* ramfs-specific fields */
    struct ramfs_inode *inode;
-
-   /* valid only if inode->type == VFS_DIR */
-   struct {
-      struct list_node node;        /* node in inode->handles_list */
-      struct ramfs_entry *dpos;     /* current entry position */
-   };
 };
 
 STATIC_ASSERT(sizeof(struct ramfs_handle) <= MAX_FS_HANDLE_SIZE);
@@ -121,6 +134,12 @@ struct ramfs_data {
 
    tilck_ino_t next_inode_num;
    struct ramfs_inode *root;
+
+   /* Quotas (see quota.c.h) */
+   size_t max_pages;                   /* max number of file blocks */
+   size_t max_inodes;
+   size_t used_pages;
+   size_t used_inodes;
 };
 
 CREATE_FS_PATH_STRUCT(ramfs_path, struct ramfs_inode *, struct ramfs_entry *);
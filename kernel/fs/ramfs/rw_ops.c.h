@@ -7,21 +7,11 @@ static int ramfs_ioctl(fs_handle h, ulong cmd, void *argp)
 
 static offt ramfs_dir_seek(struct ramfs_handle *rh, offt target_off)
 {
-   struct ramfs_inode *i = rh->inode;
-   struct ramfs_entry *dpos;
-   offt off = 0;
-
-   list_for_each_ro(dpos, &i->entries_list, lnode) {
-
-      if (off == target_off) {
-         rh->dir_pos = off;
-         rh->dpos = dpos;
-         break;
-      }
-
-      off++;
-   }
-
+   /*
+    * Directory positions are indexes in the `slots` array: there's nothing to
+    * look for. Positions past the last slot just mean EOF.
+    */
+   rh->dir_pos = target_off;
    return rh->dir_pos;
 }
 
@@ -173,7 +163,8 @@ static void ramfs_unmap_past_eof_mappings(struct ramfs_inode *i, size_t len)
    }
 }
 
-static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
+static int
+ramfs_inode_truncate(struct ramfs_data *d, struct ramfs_inode *i, offt len)
 {
    ASSERT(rwlock_wp_holding_exlock(&i->rwlock));
 
@@ -197,31 +188,18 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
    }
    enable_preemption();
 
-   while (true) {
-
-      struct ramfs_block *b =
-         bintree_get_last_obj(i->blocks_tree_root, struct ramfs_block, node);
-
-      if (!b || b->offset < len)
-         break;
-
-      /* Remove the block object from the tree */
-      bintree_remove_ptr(&i->blocks_tree_root,
-                         b,
-                         struct ramfs_block,
-                         node,
-                         offset);
-
-      ramfs_destroy_block(b);
-   }
+   /* Free all the blocks past the one containing the new EOF, if any */
+   ramfs_free_blocks_from(d, i, (ulong)((len + PAGE_SIZE - 1) >> PAGE_SHIFT));
 
    i->fsize = len;
-   i->blocks_count = pow2_round_up_at((ulong) len, PAGE_SIZE);
    return 0;
 }
 
 static int
-ramfs_inode_truncate_safe(struct ramfs_inode *i, offt len, bool no_perm_check)
+ramfs_inode_truncate_safe(struct ramfs_data *d,
+                          struct ramfs_inode *i,
+                          offt len,
+                          bool no_perm_check)
 {
    int rc;
    rwlock_wp_exlock(&i->rwlock);
@@ -229,7 +207,7 @@ ramfs_inode_truncate_safe(struct ramfs_inode *i, offt len, bool no_perm_check)
       if ((i->mode & 0200) == 0200 || no_perm_check) { /* write permission */
 
          if (len < i->fsize)
-            rc = ramfs_inode_truncate(i, len);
+            rc = ramfs_inode_truncate(d, i, len);
          else if (len > i->fsize)
             rc = ramfs_inode_extend(i, len);
          else
@@ -245,7 +223,7 @@ ramfs_inode_truncate_safe(struct ramfs_inode *i, offt len, bool no_perm_check)
 
 static int ramfs_truncate(struct mnt_fs *fs, vfs_inode_ptr_t i, offt len)
 {
-   return ramfs_inode_truncate_safe(i, len, false);
+   return ramfs_inode_truncate_safe(fs->device_data, i, len, false);
 }
 
 static ssize_t
@@ -262,8 +240,7 @@ ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
 
    while (buf_rem > 0) {
 
-      struct ramfs_block *block;
-      const offt page     = *pos & (offt)PAGE_MASK;
+      char *block;
       const offt page_off = *pos & (offt)OFFSET_IN_PAGE_MASK;
       const offt page_rem = (offt)PAGE_SIZE - page_off;
       const offt file_rem = inode->fsize - *pos;
@@ -277,18 +254,14 @@ ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
       if (!to_read)
          break;
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
+      block = ramfs_get_block(inode, (ulong)(*pos >> PAGE_SHIFT));
 
       if (block) {
          /* reading a regular block */
-         memcpy(buf + tot_read, block->vaddr + page_off, (size_t)to_read);
+         kmemcpy(buf + tot_read, block + page_off, (size_t)to_read);
       } else {
          /* reading a hole */
-         memset(buf + tot_read, 0, (size_t)to_read);
+         kmemset(buf + tot_read, 0, (size_t)to_read);
       }
 
       tot_read += to_read;
@@ -325,34 +298,27 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
    if (rh->fl_flags & O_APPEND)
       *pos = inode->fsize;
 
+   if (len > 0 && *pos >= RAMFS_MAX_FSIZE)
+      return -EFBIG;
+
    while (buf_rem > 0) {
 
-      struct ramfs_block *block;
-      const offt page     = *pos & (offt)PAGE_MASK;
+      char *block;
       const offt page_off = *pos & (offt)OFFSET_IN_PAGE_MASK;
       const offt page_rem = (offt)PAGE_SIZE - page_off;
-      const offt to_write = MIN(page_rem, buf_rem);
+      const offt to_write = MIN3(page_rem, buf_rem, RAMFS_MAX_FSIZE - *pos);
 
-      ASSERT(to_write > 0);
+      if (!to_write)
+         break; /* We reached RAMFS_MAX_FSIZE */
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
+      block = ramfs_get_or_new_block(rh->fs->device_data,
+                                     inode,
+                                     (ulong)(*pos >> PAGE_SHIFT));
 
-      /* Assert that if page_off > 0, the block is present */
-      ASSERT(!page_off || block);
-
-      if (!block) {
-
-         if (!(block = ramfs_new_block(page)))
-            break;
-
-         ramfs_append_new_block(inode, block);
-      }
+      if (!block)
+         break;
 
-      memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
+      kmemcpy(block + page_off, buf + tot_written, (size_t)to_write);
       tot_written += to_write;
       buf_rem     -= to_write;
       *pos     += to_write;
@@ -222,6 +222,30 @@ int vfs_fstat64(fs_handle h, struct k_stat64 *statbuf)
    return fsops->stat(fs, fsops->get_inode(h), statbuf);
 }
 
+static int vfs_statfs_int(struct mnt_fs *fs, struct k_statfs64 *buf)
+{
+   bzero(buf, sizeof(*buf));
+
+   buf->f_bsize = PAGE_SIZE;
+   buf->f_frsize = PAGE_SIZE;
+   buf->f_namelen = MAX_PATH - 1;
+   buf->f_flags = K_ST_VALID | ((fs->flags & VFS_FS_RW) ? 0 : K_ST_RDONLY);
+
+   /* Fill the fs-specific fields, if the fs supports that */
+   if (!fs->fsops->statfs)
+      return 0;
+
+   return fs->fsops->statfs(fs, buf);
+}
+
+int vfs_fstatfs(fs_handle h, struct k_statfs64 *buf)
+{
+   NO_TEST_ASSERT(is_preemption_enabled());
+   ASSERT(h != NULL);
+
+   return vfs_statfs_int(((struct fs_handle_base *)h)->fs, buf);
+}
+
 int vfs_fsync(fs_handle h)
 {
    struct fs_handle_base *hb = h;
@@ -369,6 +393,32 @@ int vfs_stat64(const char *path, struct k_stat64 *statbuf, bool res_last_sl)
    );
 }
 
+static ALWAYS_INLINE int
+vfs_statfs_impl(struct mnt_fs *fs,
+                struct vfs_path *p,
+                struct k_statfs64 *buf,
+                ulong unused1,
+                ulong unused2)
+{
+   if (!p->fs_path.inode)
+      return -ENOENT;
+
+   return vfs_statfs_int(fs, buf);
+}
+
+int vfs_statfs(const char *path, struct k_statfs64 *buf)
+{
+   return vfs_path_funcs_wrapper(
+      path,
+      false,               /* exlock */
+      true,                /* res_last_sl */
+      &vfs_statfs_impl,
+      buf,
+      0,
+      0
+   );
+}
+
 static ALWAYS_INLINE int
 vfs_mkdir_impl(struct mnt_fs *fs,
                struct vfs_path *p,
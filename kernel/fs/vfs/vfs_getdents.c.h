@@ -72,8 +72,10 @@ static int vfs_getdents_cb(struct vfs_dent64 *vde, void *arg)
       return (int) ctx->offset;
    }
 
+   const offt next_off = vde->next_off ? vde->next_off : ctx->off + 1;
+
    ctx->ent.d_ino    = vde->ino;
-   ctx->ent.d_off    = (u64) ctx->off + 1; /* "offset" (=ID) of the next dent */
+   ctx->ent.d_off    = (u64) next_off; /* "offset" (=ID) of the next dent */
    ctx->ent.d_reclen = entry_size;
    ctx->ent.d_type   = vfs_type_to_linux_dirent_type(vde->type);
 
@@ -87,8 +89,8 @@ static int vfs_getdents_cb(struct vfs_dent64 *vde, void *arg)
       return -EFAULT;
 
    ctx->offset += entry_size;
-   ctx->off++;
-   ctx->h->dir_pos++;
+   ctx->off = next_off;
+   ctx->h->dir_pos = next_off;
    return 0;
 }
 
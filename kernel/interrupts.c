@@ -38,6 +38,15 @@ static ALWAYS_INLINE void dec_irq_count(void)
    ASSERT(oldval > 0);
 }
 
+/* Registers of the context interrupted by the innermost IRQ being handled */
+static regs_t *curr_irq_regs;
+
+regs_t *get_irq_regs(void)
+{
+   ASSERT(in_irq());
+   return curr_irq_regs;
+}
+
 #if KRN_TRACK_NESTED_INTERR
 
 static int nested_interrupts_count;
@@ -193,6 +202,8 @@ static void irq_resched(regs_t *r)
 
 void irq_entry(regs_t *r)
 {
+   regs_t *saved_irq_regs;
+
    ASSERT(get_curr_task() != NULL);
    DEBUG_check_not_same_interrupt_nested(regs_intnum(r));
 
@@ -204,11 +215,14 @@ void irq_entry(regs_t *r)
 
    /* Increase the always-enabled in_irq_count counter */
    inc_irq_count();
+   saved_irq_regs = curr_irq_regs;
+   curr_irq_regs = r;
 
    /* Call the arch-dependent IRQ handling logic */
    arch_irq_handling(r);
 
    /* Decrease the always-enabled in_irq_count counter */
+   curr_irq_regs = saved_irq_regs;
    dec_irq_count();
 
    /* Check that arch_irq_handling restored the interrupts state to disabled */
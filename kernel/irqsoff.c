@@ -0,0 +1,245 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/irqsoff.h>
+#include <tilck/kernel/hal.h>
+
+#if KERNEL_IRQSOFF_TRACER
+
+/*
+ * NOTE: this code is called by disable_interrupts(), enable_interrupts() and
+ * by the preemption functions. Therefore, it must NOT use any of them: the
+ * state is protected by disabling the interrupts with the _forced() functions.
+ */
+
+struct irqsoff_state {
+
+   bool open;                 /* a section is in progress */
+   ulong start_site;
+   u64 start;
+
+   struct irqsoff_info info;
+
+   /* Sorted by max_cycles (desc) */
+   struct irqsoff_offender offenders[IRQSOFF_MAX_OFFENDERS];
+   int count;
+};
+
+static bool tracer_enabled;
+static struct irqsoff_state states[IRQSOFF_TYPES_COUNT];
+
+static const char *irqsoff_type_names[IRQSOFF_TYPES_COUNT] = {
+
+   [IRQSOFF_IRQS]    = "irqs",
+   [IRQSOFF_PREEMPT] = "preempt",
+};
+
+const char *irqsoff_type_str(enum irqsoff_type t)
+{
+   return irqsoff_type_names[t];
+}
+
+static inline ulong irqsoff_lock(void)
+{
+   ulong flags = get_eflags();
+   disable_interrupts_forced();
+   return flags;
+}
+
+static inline void irqsoff_unlock(ulong flags)
+{
+   if (flags & EFLAGS_IF)
+      enable_interrupts_forced();
+}
+
+static void irqsoff_start(enum irqsoff_type t, ulong site)
+{
+   struct irqsoff_state *s = &states[t];
+   ulong flags;
+
+   if (!tracer_enabled)
+      return;
+
+   flags = irqsoff_lock();
+   {
+      s->open = true;
+      s->start_site = site;
+      s->start = RDTSC();
+   }
+   irqsoff_unlock(flags);
+}
+
+static void
+irqsoff_add_offender(struct irqsoff_state *s, ulong end_site, u64 cycles)
+{
+   struct irqsoff_offender *arr = s->offenders;
+   struct irqsoff_offender tmp;
+   int i;
+
+   for (i = 0; i < s->count; i++)
+      if (arr[i].start_site == s->start_site)
+         break;
+
+   if (i < s->count) {
+
+      arr[i].count++;
+
+      if (cycles <= arr[i].max_cycles)
+         return;
+
+   } else {
+
+      if (s->count == IRQSOFF_MAX_OFFENDERS) {
+
+         /* Replace the last offender, if the new section is longer */
+         if (cycles <= arr[s->count - 1].max_cycles)
+            return;
+
+         i = s->count - 1;
+
+      } else {
+
+         i = s->count++;
+      }
+
+      arr[i].start_site = s->start_site;
+      arr[i].count = 1;
+   }
+
+   arr[i].end_site = end_site;
+   arr[i].max_cycles = cycles;
+
+   /* Move the updated offender up, keeping the array sorted */
+   for (; i > 0 && arr[i - 1].max_cycles < arr[i].max_cycles; i--) {
+      tmp = arr[i - 1];
+      arr[i - 1] = arr[i];
+      arr[i] = tmp;
+   }
+}
+
+static void irqsoff_stop(enum irqsoff_type t, ulong site)
+{
+   struct irqsoff_state *s = &states[t];
+   const int last = IRQSOFF_MAX_OFFENDERS - 1;
+   ulong flags;
+   u64 cycles;
+
+   if (!tracer_enabled)
+      return;
+
+   flags = irqsoff_lock();
+
+   if (s->open) {
+
+      cycles = RDTSC() - s->start;
+      s->open = false;
+
+      s->info.sections++;
+      s->info.tot_cycles += cycles;
+
+      if (cycles > s->info.max_cycles)
+         s->info.max_cycles = cycles;
+
+      /*
+       * Fast path: when the table is full and the section is shorter than
+       * all the offenders, skip the (linear) lookup by call site.
+       */
+      if (s->count < IRQSOFF_MAX_OFFENDERS ||
+          cycles > s->offenders[last].max_cycles)
+      {
+         irqsoff_add_offender(s, site, cycles);
+
+      } else {
+
+         for (int i = 0; i < s->count; i++) {
+            if (s->offenders[i].start_site == s->start_site) {
+               s->offenders[i].count++;
+               break;
+            }
+         }
+      }
+   }
+
+   irqsoff_unlock(flags);
+}
+
+void irqsoff_irqs_disabled(void)
+{
+   irqsoff_start(IRQSOFF_IRQS, (ulong)__builtin_return_address(0));
+}
+
+void irqsoff_irqs_enabled(void)
+{
+   irqsoff_stop(IRQSOFF_IRQS, (ulong)__builtin_return_address(0));
+}
+
+void irqsoff_preempt_disabled(void)
+{
+   irqsoff_start(IRQSOFF_PREEMPT, (ulong)__builtin_return_address(0));
+}
+
+void irqsoff_preempt_enabled(void)
+{
+   irqsoff_stop(IRQSOFF_PREEMPT, (ulong)__builtin_return_address(0));
+}
+
+void irqsoff_preempt_enabled_at(ulong site)
+{
+   irqsoff_stop(IRQSOFF_PREEMPT, site);
+}
+
+void irqsoff_tracer_enable(void)
+{
+   tracer_enabled = true;
+}
+
+int
+irqsoff_get_offenders(enum irqsoff_type t,
+                      struct irqsoff_offender *buf,
+                      int max)
+{
+   struct irqsoff_state *s = &states[t];
+   ulong flags;
+   int n;
+
+   flags = irqsoff_lock();
+   {
+      n = MIN(max, s->count);
+      memcpy(buf, s->offenders, sizeof(buf[0]) * (size_t)n);
+   }
+   irqsoff_unlock(flags);
+   return n;
+}
+
+void irqsoff_get_info(enum irqsoff_type t, struct irqsoff_info *info)
+{
+   ulong flags = irqsoff_lock();
+   {
+      *info = states[t].info;
+   }
+   irqsoff_unlock(flags);
+}
+
+void irqsoff_reset(void)
+{
+   ulong flags = irqsoff_lock();
+   {
+      for (int t = 0; t < IRQSOFF_TYPES_COUNT; t++) {
+
+         /* Keep the in-progress sections: they will end normally */
+         const bool open = states[t].open;
+         const ulong start_site = states[t].start_site;
+         const u64 start = states[t].start;
+
+         bzero(&states[t], sizeof(states[t]));
+         states[t].open = open;
+         states[t].start_site = start_site;
+         states[t].start = start;
+      }
+   }
+   irqsoff_unlock(flags);
+}
+
+#endif // KERNEL_IRQSOFF_TRACER
@@ -27,6 +27,7 @@ bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks)
    DEBUG_ONLY(check_not_in_irq_handler());
    ASSERT(!m || kmutex_is_curr_task_holding_lock(m));
    struct task *curr = get_curr_task();
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
    bool ret;
 
 panic_retry_hack:
@@ -97,6 +98,11 @@ panic_retry_hack:
          goto panic_retry_hack;
    }
 
+#if KERNEL_LOCKSTAT
+   if (!m || !(m->flags & KMUTEX_FL_NO_LOCKSTAT))
+      lockstat_acquired(NULL, LOCKSTAT_SITE(), LOCKSTAT_KCOND, true, ls_start);
+#endif
+
    return ret;
 }
 
@@ -91,10 +91,36 @@ main_heaps_kfree(void *ptr, size_t *size, u32 flags)
    return 0;
 }
 
-void *general_kmalloc(size_t *size, u32 flags)
+static void *heaps_kmalloc(size_t *size, u32 flags)
 {
    void *res;
    const u32 sub_block_sz = flags & KMALLOC_FL_SUB_BLOCK_MIN_SIZE_MASK;
+
+   if (*size <= SMALL_HEAP_MAX_ALLOC ||
+       UNLIKELY(sub_block_sz && sub_block_sz <= SMALL_HEAP_MAX_ALLOC))
+   {
+      /* Small DMA allocations are not allowed */
+      ASSERT(~flags & KMALLOC_FL_DMA);
+      res = small_heaps_kmalloc(size, flags);
+
+   } else {
+
+      res = main_heaps_kmalloc(size, flags);
+
+      if (UNLIKELY(res == NULL && ~flags & KMALLOC_FL_DMA))
+         res = main_heaps_kmalloc(size, flags | KMALLOC_FL_DMA);
+   }
+
+   return res;
+}
+
+/*
+ * `site` is the return address of the public allocation function called by
+ * the kernel code and it's used only by the heavy stats.
+ */
+static void *general_kmalloc_at(size_t *size, u32 flags, ulong site)
+{
+   void *res = NULL;
    ASSERT(kmalloc_initialized);
    ASSERT(size != NULL);
    ASSERT(*size);
@@ -103,29 +129,37 @@ void *general_kmalloc(size_t *size, u32 flags)
    {
       const size_t orig_size = *size;
 
-      if (*size <= SMALL_HEAP_MAX_ALLOC ||
-          UNLIKELY(sub_block_sz && sub_block_sz <= SMALL_HEAP_MAX_ALLOC))
-      {
-         /* Small DMA allocations are not allowed */
-         ASSERT(~flags & KMALLOC_FL_DMA);
-         res = small_heaps_kmalloc(size, flags);
+      if (*size <= KMALLOC_MAG_MAX_BLOCK && mags_usable(flags))
+         res = mag_pop(size);
 
-      } else {
+      if (!res) {
+
+         res = heaps_kmalloc(size, flags);
 
-         res = main_heaps_kmalloc(size, flags);
+         if (UNLIKELY(!res) && mags_usable(0) && mags_flush_unsafe()) {
 
-         if (UNLIKELY(res == NULL && ~flags & KMALLOC_FL_DMA))
-            res = main_heaps_kmalloc(size, flags | KMALLOC_FL_DMA);
+            /* Memory pressure: retry after releasing the magazines */
+            *size = orig_size;
+            res = heaps_kmalloc(size, flags);
+         }
       }
 
-      if (KMALLOC_HEAVY_STATS && res != NULL)
-         if (~flags & KMALLOC_FL_DONT_ACCOUNT)
+      if (KMALLOC_HEAVY_STATS && res != NULL) {
+         if (~flags & KMALLOC_FL_DONT_ACCOUNT) {
             kmalloc_account_alloc(orig_size);
+            kmalloc_account_site(site, *size);
+         }
+      }
    }
    enable_preemption();
    return res;
 }
 
+void *general_kmalloc(size_t *size, u32 flags)
+{
+   return general_kmalloc_at(size, flags, KMALLOC_CALLER_SITE());
+}
+
 void general_kfree(void *ptr, size_t *size, u32 flags)
 {
    int rc;
@@ -148,7 +182,12 @@ void general_kfree(void *ptr, size_t *size, u32 flags)
          /* We know which heap set contains our chunk */
 
          if (*size <= SMALL_HEAP_MAX_ALLOC) {
-            rc = small_heaps_kfree(ptr, size, flags);
+
+            if (mags_usable(flags) && mag_push(ptr, size))
+               rc = 0;
+            else
+               rc = small_heaps_kfree(ptr, size, flags);
+
          } else {
             rc = main_heaps_kfree(ptr, size, flags);
          }
@@ -180,7 +219,7 @@ void general_kfree(void *ptr, size_t *size, u32 flags)
  */
 void *aligned_kmalloc(size_t size, u32 align)
 {
-   void *res = general_kmalloc(&size, 0);
+   void *res = general_kmalloc_at(&size, 0, KMALLOC_CALLER_SITE());
 
    ASSERT(align > 0);
    ASSERT(align <= size);
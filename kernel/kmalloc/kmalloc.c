@@ -12,6 +12,7 @@
 #include <tilck/kernel/paging.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/sort.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/worker_thread.h>
@@ -40,6 +41,10 @@ static const struct block_node s_new_node; // Just zeros.
 #define NODE_PARENT(n) (HALF(n-1))
 #define NODE_IS_LEFT(n) (((n) & 1) != 0)
 
+#define KMALLOC_CALLER_SITE() ((ulong)__builtin_return_address(0))
+
+static void *general_kmalloc_at(size_t *size, u32 flags, ulong site);
+
 bool is_kmalloc_initialized(void)
 {
    return kmalloc_initialized;
@@ -847,7 +852,7 @@ per_heap_kfree(struct kmalloc_heap *h,
 
 void *kzmalloc(size_t size)
 {
-   void *res = kmalloc(size);
+   void *res = general_kmalloc_at(&size, 0, KMALLOC_CALLER_SITE());
 
    if (!res)
       return NULL;
@@ -870,9 +875,9 @@ void *vmalloc(size_t size)
    void *ptr;
 
    if (!hi_vmem_avail())
-      return kmalloc(size);
+      return general_kmalloc_at(&size, 0, KMALLOC_CALLER_SITE());
 
-   ptr = kmalloc(size);
+   ptr = general_kmalloc_at(&size, 0, KMALLOC_CALLER_SITE());
 
    if (ptr)
       return ptr;
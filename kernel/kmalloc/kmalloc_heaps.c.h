@@ -34,6 +34,7 @@ void *kmalloc_get_first_heap(size_t *size)
 }
 
 #include "kmalloc_leak_detector.c.h"
+#include "kmalloc_magazines.c.h"
 
 static void
 kmalloc_heap_set_pre_calculated_values(struct kmalloc_heap *h)
@@ -341,6 +342,7 @@ void early_init_kmalloc(void)
    ASSERT(!kmalloc_initialized);
    list_init(&small_heaps_list);
    list_init(&avail_small_heaps_list);
+   mags_reset();
 
    used_heaps = 0;
    bzero(heaps, sizeof(heaps));
@@ -412,6 +414,42 @@ size_t kmalloc_get_max_tot_heap_free(void)
    return max_tot_heap_mem_free;
 }
 
+/*
+ * Returns the current amount of free memory in all the heaps. Note: it's just
+ * a snapshot and, because of the fragmentation, not all of that memory might be
+ * usable for a single big allocation.
+ */
+size_t kmalloc_get_tot_heap_free(void)
+{
+   size_t tot = 0;
+
+   disable_preemption();
+   {
+      for (int i = 0; i < used_heaps; i++)
+         tot += heaps[i]->size - heaps[i]->mem_allocated;
+   }
+   enable_preemption();
+   return tot;
+}
+
+/*
+ * Amount of free heap memory that optional consumers (e.g. ramfs file blocks)
+ * are supposed to leave to the rest of the kernel. When the free memory drops
+ * below this threshold, those consumers should fail early (e.g. with ENOSPC)
+ * instead of driving the kernel into an out-of-memory condition it cannot
+ * recover from.
+ */
+size_t kmalloc_get_low_mem_reserve(void)
+{
+   return MAX(KMALLOC_LOW_MEM_RESERVE_MIN,
+              max_tot_heap_mem_free / KMALLOC_LOW_MEM_RESERVE_DIV);
+}
+
+bool kmalloc_is_low_mem(void)
+{
+   return kmalloc_get_tot_heap_free() < kmalloc_get_low_mem_reserve();
+}
+
 void
 debug_kmalloc_get_heap_info_by_ptr(struct kmalloc_heap *h,
                                    struct debug_kmalloc_heap_info *i)
@@ -438,6 +476,92 @@ debug_kmalloc_get_heap_info(int heap_num, struct debug_kmalloc_heap_info *i)
    return true;
 }
 
+static void
+frag_info_add_free_block(struct debug_kmalloc_frag_info *fi, size_t size)
+{
+   fi->free_mem += size;
+   fi->free_blocks_count++;
+   fi->free_blocks[log2_for_power_of_2(size)]++;
+   fi->largest_free_block = MAX(fi->largest_free_block, size);
+}
+
+/*
+ * Visits the tree of blocks in pre-order, without descending in the nodes
+ * that are not split, and accounts all the free blocks in `fi`.
+ */
+static void
+heap_get_frag_info(struct kmalloc_heap *h, struct debug_kmalloc_frag_info *fi)
+{
+   const struct block_node *nodes = h->metadata_nodes;
+   size_t node_size = h->size;
+   int n = 0;
+
+   ASSERT(!is_preemption_enabled());
+
+   while (true) {
+
+      if (nodes[n].split && node_size > h->min_block_size) {
+         n = NODE_LEFT(n);
+         node_size = HALF(node_size);
+         continue;
+      }
+
+      if (is_block_node_free(nodes[n]))
+         frag_info_add_free_block(fi, node_size);
+
+      /* Go up until we find a left child: then, move to its right sibling */
+      while (n && !NODE_IS_LEFT(n)) {
+         n = NODE_PARENT(n);
+         node_size = TWICE(node_size);
+      }
+
+      if (!n)
+         break;
+
+      n++;
+   }
+}
+
+void
+debug_kmalloc_get_heap_frag_by_ptr(struct kmalloc_heap *h,
+                                   struct debug_kmalloc_frag_info *fi)
+{
+   bzero(fi, sizeof(*fi));
+
+   disable_preemption();
+   {
+      heap_get_frag_info(h, fi);
+   }
+   enable_preemption();
+}
+
+bool
+debug_kmalloc_get_heap_frag(int heap_num, struct debug_kmalloc_frag_info *fi)
+{
+   struct kmalloc_heap *h = heaps[heap_num];
+
+   if (!h)
+      return false;
+
+   debug_kmalloc_get_heap_frag_by_ptr(h, fi);
+   return true;
+}
+
+void
+debug_kmalloc_get_small_heaps_frag(struct debug_kmalloc_frag_info *fi)
+{
+   struct small_heap_node *pos;
+   bzero(fi, sizeof(*fi));
+
+   disable_preemption();
+   {
+      list_for_each_ro(pos, &small_heaps_list, node) {
+         heap_get_frag_info(&pos->heap, fi);
+      }
+   }
+   enable_preemption();
+}
+
 void
 debug_kmalloc_get_stats(struct debug_kmalloc_stats *stats)
 {
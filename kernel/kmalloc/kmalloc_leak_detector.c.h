@@ -31,6 +31,8 @@ static void *metadata_copies[KMALLOC_HEAPS_COUNT];
 
 void debug_kmalloc_start_leak_detector(bool save_metadata)
 {
+   /* Blocks in the magazines would look like leaks */
+   kmalloc_flush_magazines();
    disable_preemption();
 
    bzero(alloc_entries, sizeof(alloc_entries));
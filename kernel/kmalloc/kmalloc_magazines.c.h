@@ -0,0 +1,210 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef _KMALLOC_C_
+
+   #error This is NOT a header file and it is not meant to be included
+
+#endif
+
+/*
+ * Magazines: per size-class LIFO stacks of recently freed small-heap blocks.
+ *
+ * Most small allocations are short-lived and get freed soon after. Releasing
+ * each one of them to its small heap requires finding the heap by walking
+ * `small_heaps_list` and then coalescing the nodes in heap's tree, while the
+ * next kmalloc() of the same size walks `avail_small_heaps_list` and descends
+ * a tree again. Instead, freed blocks of up to KMALLOC_MAG_MAX_BLOCK bytes are
+ * pushed on the magazine of their size class and popped by the next allocation
+ * of the same class, in O(1). For the small heaps, the blocks in a magazine are
+ * still allocated. When a magazine is full, its older half gets released to
+ * the heaps, while when an allocation fails, all the magazines are flushed and
+ * the allocation is retried.
+ *
+ * Magazines are not used in IRQ context, because that would require disabling
+ * the interrupts while using them in task context, for allocations with flags
+ * and while the leak detector is running.
+ */
+
+#define MAG_CLASSES                                   4
+
+STATIC_ASSERT((SMALL_HEAP_MBS << (MAG_CLASSES - 1)) == KMALLOC_MAG_MAX_BLOCK);
+STATIC_ASSERT(KMALLOC_MAG_MAX_BLOCK <= SMALL_HEAP_MAX_ALLOC);
+
+struct kmalloc_mag {
+
+   u32 count;
+   void *blocks[KMALLOC_MAG_SIZE];
+};
+
+static struct kmalloc_mag mags[MAG_CLASSES];
+static bool mags_disabled;
+
+static ALWAYS_INLINE bool mags_usable(u32 flags)
+{
+   if (flags || mags_disabled || in_irq())
+      return false;
+
+   if (KMALLOC_SUPPORT_LEAK_DETECTOR && leak_detector_enabled)
+      return false;
+
+   return true;
+}
+
+static ALWAYS_INLINE int mag_class_of(size_t size)
+{
+   if (size > KMALLOC_MAG_MAX_BLOCK)
+      return -1;
+
+   size = MAX(roundup_next_power_of_2(size), (size_t)SMALL_HEAP_MBS);
+
+   return (int)(log2_for_power_of_2(size) -
+                log2_for_power_of_2(SMALL_HEAP_MBS));
+}
+
+/* Releases the `n` oldest blocks of the magazine back to the small heaps */
+static void mag_release(struct kmalloc_mag *m, int class_idx, u32 n)
+{
+   ASSERT(!is_preemption_enabled());
+   ASSERT(n <= m->count);
+
+   for (u32 i = 0; i < n; i++) {
+
+      size_t size = (size_t)SMALL_HEAP_MBS << class_idx;
+
+      if (small_heaps_kfree(m->blocks[i], &size, 0))
+         panic("kfree: Heap not found for block: %p\n", m->blocks[i]);
+   }
+
+   m->count -= n;
+   memmove(m->blocks, m->blocks + n, m->count * sizeof(m->blocks[0]));
+}
+
+/*
+ * The blocks pushed on a magazine don't reach per_heap_kfree(), so check here
+ * that `ptr` is an allocated block of the magazine's size class and that it's
+ * not already in a magazine: otherwise, a double free or a kfree2() with the
+ * wrong size would go unnoticed.
+ */
+static void mag_debug_check_push(void *ptr, int class_idx)
+{
+   const size_t size = (size_t)SMALL_HEAP_MBS << class_idx;
+   const ulong vaddr = (ulong)ptr;
+   struct kmalloc_heap *h = NULL;
+   struct small_heap_node *pos;
+   struct block_node *nodes;
+   int n;
+
+   list_for_each_ro(pos, &small_heaps_list, node) {
+
+      const ulong hva = pos->heap.vaddr;
+      const ulong hend = pos->heap.heap_last_byte-pos->heap.min_block_size+1;
+
+      if (IN_RANGE_INC(vaddr, hva, hend)) {
+         h = &pos->heap;
+         break;
+      }
+   }
+
+   if (!h)
+      panic("kfree: Heap not found for block: %p\n", ptr);
+
+   nodes = h->metadata_nodes;
+   n = ptr_to_node(h, ptr, size);
+
+   if (node_to_ptr(h, n, size) != ptr ||
+       calculate_block_size(h, vaddr) != size ||
+       !nodes[n].full)
+   {
+      panic("kfree: %p is not an allocated block of %zu bytes\n", ptr, size);
+   }
+
+   for (int c = 0; c < MAG_CLASSES; c++)
+      for (u32 i = 0; i < mags[c].count; i++)
+         if (mags[c].blocks[i] == ptr)
+            panic("kfree: double free of block %p\n", ptr);
+}
+
+static void *mag_pop(size_t *size)
+{
+   const int c = mag_class_of(*size);
+   struct kmalloc_mag *m;
+
+   if (c < 0)
+      return NULL;
+
+   m = &mags[c];
+
+   if (!m->count)
+      return NULL;
+
+   *size = (size_t)SMALL_HEAP_MBS << c;
+   return m->blocks[--m->count];
+}
+
+static bool mag_push(void *ptr, size_t *size)
+{
+   const int c = mag_class_of(*size);
+   struct kmalloc_mag *m;
+
+   if (c < 0)
+      return false;
+
+   m = &mags[c];
+
+   if (DEBUG_CHECKS)
+      mag_debug_check_push(ptr, c);
+
+   if (m->count == KMALLOC_MAG_SIZE)
+      mag_release(m, c, KMALLOC_MAG_SIZE / 2);
+
+   *size = (size_t)SMALL_HEAP_MBS << c;
+   m->blocks[m->count++] = ptr;
+   return true;
+}
+
+/* Returns true if at least one block has been released */
+static bool mags_flush_unsafe(void)
+{
+   bool released = false;
+
+   ASSERT(!in_irq());
+
+   for (int c = 0; c < MAG_CLASSES; c++) {
+
+      if (mags[c].count) {
+         mag_release(&mags[c], c, mags[c].count);
+         released = true;
+      }
+   }
+
+   return released;
+}
+
+static void mags_reset(void)
+{
+   bzero(mags, sizeof(mags));
+}
+
+void kmalloc_flush_magazines(void)
+{
+   disable_preemption();
+   {
+      mags_flush_unsafe();
+   }
+   enable_preemption();
+}
+
+bool debug_kmalloc_set_magazines(bool enabled)
+{
+   const bool was_enabled = !mags_disabled;
+
+   disable_preemption();
+   {
+      mags_disabled = !enabled;
+
+      if (!enabled)
+         mags_flush_unsafe();
+   }
+   enable_preemption();
+   return was_enabled;
+}
@@ -74,6 +74,67 @@ static void kmalloc_account_alloc(size_t size)
    );
 }
 
+/*
+ * Allocation-site attribution: like the chunk sizes above, the number of
+ * allocations and the bytes allocated are accumulated per call site (the
+ * return address of general_kmalloc()). Frees cannot be attributed without
+ * per-block metadata: that's what the leak detector is for.
+ */
+
+struct kmalloc_acc_site {
+
+   struct bintree_node node;
+   ulong site;
+   size_t count;
+   size_t bytes;
+};
+
+static size_t sites_arr_elems;
+static size_t sites_arr_used;
+static size_t sites_dropped;
+static struct kmalloc_acc_site *sites_arr;
+static struct kmalloc_acc_site *sites_tree_root;
+
+static void kmalloc_account_site(ulong site, size_t size)
+{
+   struct kmalloc_acc_site *obj;
+
+   if (!sites_arr)
+      return;
+
+   obj = bintree_find_ptr(sites_tree_root,
+                          site,
+                          struct kmalloc_acc_site,
+                          node,
+                          site);
+
+   if (!obj) {
+
+      if (sites_arr_used == sites_arr_elems) {
+         /* Unlike the chunk sizes, the number of sites is not bounded */
+         sites_dropped++;
+         return;
+      }
+
+      obj = &sites_arr[sites_arr_used++];
+      bintree_node_init(&obj->node);
+      obj->site = site;
+      obj->count = 0;
+      obj->bytes = 0;
+
+      DEBUG_CHECKED_SUCCESS(
+         bintree_insert_ptr(&sites_tree_root,
+                            obj,
+                            struct kmalloc_acc_site,
+                            node,
+                            site)
+      );
+   }
+
+   obj->count++;
+   obj->bytes += size;
+}
+
 static void kmalloc_init_heavy_stats(void)
 {
    ASSERT(!is_preemption_enabled());
@@ -94,6 +155,69 @@ static void kmalloc_init_heavy_stats(void)
 
    printk("kmalloc: heavy stats enabled (%zu elems)\n", alloc_arr_elems);
    kmalloc_account_alloc(alloc_arr_bytes);
+
+   const size_t sites_arr_bytes = 4 * PAGE_SIZE;
+   sites_arr_elems = sites_arr_bytes / sizeof(struct kmalloc_acc_site);
+   sites_arr_used = 0;
+
+   sites_arr = kmalloc(sites_arr_bytes);
+
+   if (!sites_arr)
+      panic("Unable to alloc memory for the kmalloc sites stats");
+
+   kmalloc_account_alloc(sites_arr_bytes);
+}
+
+/*
+ * Inserts `obj` in `buf`, kept sorted by bytes (desc), unless `buf` is full
+ * and `obj` is smaller than all the sites in it. Returns the new count.
+ */
+static int
+kmalloc_sites_top_insert(struct debug_kmalloc_site *buf,
+                         int n, int max,
+                         const struct kmalloc_acc_site *obj)
+{
+   int i;
+
+   if (n == max) {
+
+      if (!max || obj->bytes <= buf[max - 1].bytes)
+         return n;
+
+      n--;  /* Drop the smallest site */
+   }
+
+   for (i = n; i > 0 && buf[i - 1].bytes < obj->bytes; i--)
+      buf[i] = buf[i - 1];
+
+   buf[i] = (struct debug_kmalloc_site) {
+      .site = obj->site,
+      .count = obj->count,
+      .bytes = obj->bytes,
+   };
+
+   return n + 1;
+}
+
+int debug_kmalloc_get_sites(struct debug_kmalloc_site *buf, int max)
+{
+   int n = 0;
+
+   if (!KMALLOC_HEAVY_STATS)
+      return 0;
+
+   disable_preemption();
+   {
+      for (size_t i = 0; i < sites_arr_used; i++)
+         n = kmalloc_sites_top_insert(buf, n, max, &sites_arr[i]);
+   }
+   enable_preemption();
+   return n;
+}
+
+size_t debug_kmalloc_get_sites_dropped(void)
+{
+   return sites_dropped;
 }
 
 void debug_kmalloc_chunks_stats_start_read(struct debug_kmalloc_chunks_ctx *ctx)
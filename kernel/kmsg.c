@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+
+STATIC_ASSERT((KMSG_RECORDS & (KMSG_RECORDS - 1)) == 0);
+
+struct kmsg_slot {
+
+   /*
+    * The seq of the record in the slot, once committed. It's 0 while a writer
+    * is filling the slot and it's never 0 otherwise, because seq starts at 1.
+    */
+   ATOMIC(u32) state;
+   struct kmsg_record r;
+};
+
+static struct kmsg_slot kmsg_slots[KMSG_RECORDS];
+static ATOMIC(u32) kmsg_seq = 1;
+
+static ALWAYS_INLINE struct kmsg_slot *kmsg_get_slot(u32 seq)
+{
+   return &kmsg_slots[seq & (KMSG_RECORDS - 1)];
+}
+
+u32 kmsg_next_seq(void)
+{
+   return atomic_load_explicit(&kmsg_seq, mo_relaxed);
+}
+
+u32 kmsg_first_seq(void)
+{
+   const u32 next = kmsg_next_seq();
+   return next > KMSG_RECORDS ? next - KMSG_RECORDS : 1;
+}
+
+u32 kmsg_append(u8 level, u8 flags, struct tty *t, const char *text, u32 len)
+{
+   struct kmsg_slot *s;
+   u32 seq;
+
+   len = MIN(len, (u32)KMSG_TEXT_MAX - 1);
+
+   /*
+    * With preemption disabled, only nested IRQ handlers can append records
+    * while we're filling our slot. Because they're much less than the number
+    * of slots, no other writer can ever get our same slot.
+    */
+   disable_preemption();
+   {
+      seq = atomic_fetch_add_explicit(&kmsg_seq, 1, mo_relaxed);
+      s = kmsg_get_slot(seq);
+
+      atomic_store_explicit(&s->state, 0, mo_relaxed);
+      atomic_thread_fence(mo_release);
+
+      s->r.seq = seq;
+      s->r.tid = get_curr_tid();
+      s->r.ts = get_sys_time();
+      s->r.tty = t;
+      s->r.level = level;
+      s->r.flags = flags;
+      s->r.len = (u16)len;
+      memcpy(s->r.text, text, len);
+      s->r.text[len] = 0;
+
+      atomic_store_explicit(&s->state, seq, mo_release);
+   }
+   enable_preemption();
+   return seq;
+}
+
+int kmsg_peek(u32 seq)
+{
+   u32 state;
+
+   if (seq < kmsg_first_seq())
+      return -EPIPE;
+
+   if (seq >= kmsg_next_seq())
+      return -ENOENT;
+
+   state = atomic_load_explicit(&kmsg_get_slot(seq)->state, mo_acquire);
+
+   if (state != seq)
+      return state > seq ? -EPIPE : -ENOENT;
+
+   return 0;
+}
+
+int kmsg_read(u32 seq, struct kmsg_record *r)
+{
+   struct kmsg_slot *s = kmsg_get_slot(seq);
+   u32 len;
+   int rc;
+
+   if ((rc = kmsg_peek(seq)))
+      return rc;
+
+   /* Copy only the used part of `text`, plus the final \0 */
+   len = MIN((u32)s->r.len, (u32)KMSG_TEXT_MAX - 1);
+   memcpy(r, &s->r, offsetof(struct kmsg_record, text) + len + 1);
+   atomic_thread_fence(mo_acquire);
+
+   /* Check that no writer started overwriting the slot while we copied it */
+   if (atomic_load_explicit(&s->state, mo_relaxed) != seq)
+      return -EPIPE;
+
+   return 0;
+}
+
+/*
+ * /dev/kmsg: access to the log store from user space.
+ *
+ * Each read() returns exactly one record, in the same format used by Linux:
+ *
+ *    <level>,<seq>,<timestamp_us>,<flags>,<tid>;<text>\n
+ *
+ * Where <flags> is 'c' for records continuing the previous line or '-', and
+ * non-printable characters in <text> are escaped as \xNN. The file position
+ * is the seq of the next record to read. When some records have been lost
+ * because of an overwrite, read() fails with -EPIPE once and then continues
+ * from the oldest record available. Unlike Linux, at the end of the log read()
+ * returns 0 (EOF) instead of blocking. Writing to /dev/kmsg appends a record,
+ * with an optional "<level>" prefix.
+ */
+
+static ssize_t
+kmsg_format_record(const struct kmsg_record *r, char *buf, size_t size)
+{
+   static const char hex_digits[] = "0123456789abcdef";
+   const u64 ts_us = r->ts / (TS_SCALE / 1000000);
+   size_t n, len = r->len;
+   char *p, *end;
+
+   n = (size_t)snprintk(buf, size, "%u,%u,%" PRIu64 ",%c,%d;",
+                        r->level, r->seq, ts_us,
+                        (r->flags & KMSG_FL_CONT) ? 'c' : '-', r->tid);
+
+   if (n >= size)
+      return -EINVAL;
+
+   p = buf + n;
+   end = buf + size;
+
+   /* Drop the trailing newline: we always add one at the end */
+   if (len > 0 && r->text[len - 1] == '\n')
+      len--;
+
+   for (size_t i = 0; i < len; i++) {
+
+      const u8 c = (u8)r->text[i];
+
+      if (c >= 32 && c < 127 && c != '\\') {
+
+         if (end - p < 2)
+            return -EINVAL;
+
+         *p++ = (char)c;
+
+      } else {
+
+         if (end - p < 5)
+            return -EINVAL;
+
+         *p++ = '\\';
+         *p++ = 'x';
+         *p++ = hex_digits[c >> 4];
+         *p++ = hex_digits[c & 0xf];
+      }
+   }
+
+   if (end - p < 1)
+      return -EINVAL;
+
+   *p++ = '\n';
+   return p - buf;
+}
+
+static ssize_t kmsg_dev_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kmsg_record *r;
+   const u32 first = kmsg_first_seq();
+   ssize_t rc;
+
+   if (*pos == 0) {
+
+      /* Just opened: start from the oldest record */
+      *pos = first;
+
+   } else if (*pos < first) {
+
+      *pos = first;
+      return -EPIPE;
+   }
+
+   if (!(r = kmalloc(sizeof(*r))))
+      return -ENOMEM;
+
+   rc = kmsg_read((u32)*pos, r);
+
+   if (rc == -EPIPE) {
+
+      /* Overwritten right before we could read it */
+      *pos = kmsg_first_seq();
+
+   } else if (rc == -ENOENT) {
+
+      rc = 0;     /* EOF */
+
+   } else if ((rc = kmsg_format_record(r, buf, size)) > 0) {
+
+      (*pos)++;
+   }
+
+   kfree2(r, sizeof(*r));
+   return rc;
+}
+
+static ssize_t kmsg_dev_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   u8 level = KMSG_LVL_INFO;
+   char *text = buf;
+   u32 len = (u32)MIN(size, (size_t)KMSG_TEXT_MAX - 1);
+
+   if (len >= 3 && buf[0] == '<' && isdigit(buf[1]) && buf[2] == '>') {
+      level = (u8)MIN(buf[1] - '0', KMSG_LVL_DEBUG);
+      text += 3;
+      len -= 3;
+   }
+
+   printk_log_text(level, text, len);
+   return (ssize_t)size;
+}
+
+static offt kmsg_dev_seek(fs_handle h, offt off, int whence)
+{
+   struct fs_handle_base *hb = h;
+
+   if (off != 0)
+      return -EINVAL;
+
+   switch (whence) {
+
+      case SEEK_SET:
+         hb->h_fpos = kmsg_first_seq();
+         break;
+
+      case SEEK_END:
+         hb->h_fpos = kmsg_next_seq();
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   return 0; /* Like on Linux */
+}
+
+static int
+kmsg_create_device_file(int minor,
+                        enum vfs_entry_type *type,
+                        struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_kmsg = {
+
+      .read = kmsg_dev_read,
+      .write = kmsg_dev_write,
+      .seek = kmsg_dev_seek,
+   };
+
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &static_ops_kmsg;
+   return 0;
+}
+
+void init_kmsg_dev(void)
+{
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+   int major, rc;
+
+   if (!di)
+      panic("kmsg: no enough memory for struct driver_info");
+
+   di->name = "kmsg";
+   di->create_dev_file = kmsg_create_device_file;
+   major = register_driver(di, -1);
+
+   if (major < 0)
+      panic("kmsg: register_driver() failed with: %d", major);
+
+   if ((rc = create_dev_file("kmsg", (u16)major, 0, NULL)))
+      panic("kmsg: unable to create /dev/kmsg (error: %d)", rc);
+}
@@ -7,6 +7,24 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/irq.h>
 
+#if KERNEL_LOCKSTAT
+
+static void
+kmutex_lockstat_acquired(struct kmutex *m, ulong site, bool cont, u64 start)
+{
+   if (!(m->flags & KMUTEX_FL_NO_LOCKSTAT))
+      lockstat_acquired(&m->ls_hold, site, LOCKSTAT_KMUTEX, cont, start);
+}
+
+#endif
+
+#if KMUTEX_STATS_ENABLED
+   static struct kmutex_stats stats;
+   #define KMUTEX_STAT_INC(field)         (stats.field++)
+#else
+   #define KMUTEX_STAT_INC(field)         do { } while (0)
+#endif
+
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m)
 {
    return m->owner_task == get_curr_task();
@@ -18,6 +36,94 @@ void kmutex_init(struct kmutex *m, u32 flags)
    bzero(m, sizeof(struct kmutex));
    m->flags = flags;
    list_init(&m->wait_list);
+
+#if KERNEL_SELFTESTS
+   /* Yielding requires preemption to be disabled exactly once */
+   ASSERT(!(flags & KMUTEX_FL_ADAPTIVE) ||
+          !(flags & KMUTEX_FL_ALLOW_LOCK_WITH_PREEMPT_DISABLED));
+#endif
+
+   ASSERT(!(flags & KMUTEX_FL_PI_BOOSTED));
+}
+
+#if KMUTEX_STATS_ENABLED
+void kmutex_get_stats(struct kmutex_stats *s)
+{
+   disable_preemption();
+   {
+      *s = stats;
+   }
+   enable_preemption();
+}
+#endif
+
+/*
+ * Priority inheritance: boost the owner of `m` (if it's a worker thread) to the
+ * highest priority among the worker threads waiting for `m`.
+ */
+static void kmutex_pi_boost_owner(struct kmutex *m)
+{
+   struct task *owner = m->owner_task;
+   struct wait_obj *wo;
+   struct task *ti;
+   int prio = WTH_PRIO_LOWEST + 1;
+
+   if (!is_worker_thread(owner))
+      return;
+
+   list_for_each_ro(wo, &m->wait_list, wait_list_node) {
+
+      ti = CONTAINER_OF(wo, struct task, wobj);
+
+      if (is_worker_thread(ti))
+         prio = MIN(prio, wth_get_eff_priority(ti->worker_thread));
+   }
+
+   if (wth_inherit_priority(owner->worker_thread, prio, m))
+      KMUTEX_STAT_INC(pi_boosts);
+}
+
+/*
+ * Adaptive locking. Tilck runs on a single CPU, so the owner of the mutex can
+ * never be running while we're trying to acquire it: spinning would be just a
+ * waste of time. But if the owner has been preempted (it's runnable), yielding
+ * gives it the chance to complete its critical section and release the mutex,
+ * saving us the cost of sleeping and being woken up. If the owner is sleeping,
+ * instead, there's no point in waiting: it might sleep for a long time.
+ *
+ * Called with preemption disabled once. Returns true if we got the mutex.
+ */
+static bool kmutex_lock_adaptive(struct kmutex *m)
+{
+   struct task *owner;
+
+   for (int i = 0; ; i++) {
+
+      if (!(owner = m->owner_task)) {
+
+         m->owner_task = get_curr_task();
+
+         if (m->flags & KMUTEX_FL_RECURSIVE) {
+            ASSERT(m->lock_count == 0);
+            m->lock_count++;
+         }
+
+         KMUTEX_STAT_INC(adaptive_acquired);
+         KMUTEX_STAT_INC(acquired);
+         return true;
+      }
+
+      if (owner->state != TASK_STATE_RUNNABLE)
+         break;
+
+      if (i == KMUTEX_ADAPTIVE_MAX_YIELDS)
+         break;
+
+      kernel_yield_preempt_disabled();
+      disable_preemption();
+   }
+
+   return false;
 }
 
 void kmutex_destroy(struct kmutex *m)
@@ -38,6 +144,9 @@ kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 
 void kmutex_lock(struct kmutex *m)
 {
+   LOCKSTAT_ONLY(const ulong ls_site = LOCKSTAT_SITE());
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
+
    disable_preemption();
    DEBUG_ONLY(check_not_in_irq_handler());
 
@@ -51,6 +160,8 @@ void kmutex_lock(struct kmutex *m)
          m->lock_count++;
       }
 
+      KMUTEX_STAT_INC(acquired);
+      LOCKSTAT_ONLY(kmutex_lockstat_acquired(m, ls_site, false, ls_start));
       kmutex_lock_enable_preemption_wrapper(m);
       enable_preemption();
       return;
@@ -70,12 +181,28 @@ void kmutex_lock(struct kmutex *m)
       ASSERT(!kmutex_is_curr_task_holding_lock(m));
    }
 
+   KMUTEX_STAT_INC(contended);
+
+   if (m->flags & KMUTEX_FL_ADAPTIVE) {
+
+      if (kmutex_lock_adaptive(m)) {
+         LOCKSTAT_ONLY(kmutex_lockstat_acquired(m, ls_site, true, ls_start));
+         enable_preemption();
+         return;
+      }
+   }
+
 #if KMUTEX_STATS_ENABLED
    m->num_waiters++;
    m->max_num_waiters = MAX(m->num_waiters, m->max_num_waiters);
+   stats.max_num_waiters = MAX(m->num_waiters, stats.max_num_waiters);
 #endif
 
+   KMUTEX_STAT_INC(slept);
+   KMUTEX_STAT_INC(acquired);
+
    prepare_to_wait_on(WOBJ_KMUTEX, m, NO_EXTRA, &m->wait_list);
+   kmutex_pi_boost_owner(m);
    kmutex_lock_enable_preemption_wrapper(m);
 
    /*
@@ -92,6 +219,7 @@ void kmutex_lock(struct kmutex *m)
 
    /* Now for sure this task should hold the mutex */
    ASSERT(kmutex_is_curr_task_holding_lock(m));
+   LOCKSTAT_ONLY(kmutex_lockstat_acquired(m, ls_site, true, ls_start));
 
    /*
     * DEBUG check: in case we went to sleep with a recursive mutex, then the
@@ -118,6 +246,11 @@ bool kmutex_trylock(struct kmutex *m)
       if (m->flags & KMUTEX_FL_RECURSIVE)
          m->lock_count++;
 
+      KMUTEX_STAT_INC(acquired);
+      LOCKSTAT_ONLY(
+         kmutex_lockstat_acquired(m, LOCKSTAT_SITE(), false, lockstat_now())
+      );
+
    } else {
 
       /*
@@ -157,8 +290,12 @@ void kmutex_unlock(struct kmutex *m)
       // m->lock_count == 0: we have to really unlock the mutex
    }
 
+   LOCKSTAT_ONLY(lockstat_released(&m->ls_hold));
    m->owner_task = NULL;
 
+   if (is_worker_thread(get_curr_task()))
+      wth_drop_inherited_priority(get_curr_task()->worker_thread, m);
+
    /* Unlock one task waiting to acquire the mutex 'm' (if any) */
    if (!list_is_empty(&m->wait_list)) {
 
@@ -175,6 +312,9 @@ void kmutex_unlock(struct kmutex *m)
       ASSERT_TASK_STATE(ti->state, TASK_STATE_SLEEPING);
       wake_up(ti);
 
+      /* The new owner might need to inherit the priority of other waiters */
+      kmutex_pi_boost_owner(m);
+
    } // if (!list_is_empty(&m->wait_list))
 
    enable_preemption();
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sort.h>
+#include <tilck/kernel/hal.h>
+
+#if KERNEL_LOCKSTAT
+
+/*
+ * The classes are stored in a fixed-size open addressing hash table, in order
+ * to never allocate memory while locking. When the table is full, the new
+ * classes are just counted in `dropped`. The table is accessed with preemption
+ * disabled.
+ */
+
+STATIC_ASSERT((LOCKSTAT_MAX_CLASSES & (LOCKSTAT_MAX_CLASSES - 1)) == 0);
+
+static struct lockstat_class classes[LOCKSTAT_MAX_CLASSES];
+static u32 dropped;
+
+static const char *lockstat_type_names[] = {
+
+   [LOCKSTAT_KMUTEX]       = "kmutex",
+   [LOCKSTAT_RWLOCK_RP_SH] = "rwlock_rp_sh",
+   [LOCKSTAT_RWLOCK_RP_EX] = "rwlock_rp_ex",
+   [LOCKSTAT_RWLOCK_WP_SH] = "rwlock_wp_sh",
+   [LOCKSTAT_RWLOCK_WP_EX] = "rwlock_wp_ex",
+   [LOCKSTAT_KCOND]        = "kcond",
+};
+
+const char *lockstat_type_str(enum lockstat_type type)
+{
+   return lockstat_type_names[type];
+}
+
+u64 lockstat_now(void)
+{
+   return RDTSC();
+}
+
+static struct lockstat_class *
+lockstat_get_class(ulong site, enum lockstat_type type)
+{
+   u32 h = (u32)((site >> 2) ^ ((ulong)type << 12));
+   struct lockstat_class *c;
+
+   ASSERT(!is_preemption_enabled());
+   h = (h ^ (h >> 11)) & (LOCKSTAT_MAX_CLASSES - 1);
+
+   for (u32 i = 0; i < LOCKSTAT_MAX_CLASSES; i++) {
+
+      c = &classes[(h + i) & (LOCKSTAT_MAX_CLASSES - 1)];
+
+      if (c->site == site && c->type == type)
+         return c;
+
+      if (!c->site) {
+         c->site = site;
+         c->type = type;
+         return c;
+      }
+   }
+
+   dropped++;
+   return NULL;
+}
+
+void
+lockstat_acquired(struct lockstat_hold *h,
+                  ulong site,
+                  enum lockstat_type type,
+                  bool contended,
+                  u64 start)
+{
+   const u64 now = lockstat_now();
+   struct lockstat_class *c;
+
+   disable_preemption();
+   {
+      if ((c = lockstat_get_class(site, type))) {
+
+         c->acquired++;
+
+         if (contended) {
+            c->contended++;
+            c->wait_cycles += now - start;
+         }
+      }
+   }
+   enable_preemption();
+
+   if (h) {
+      h->c = c;
+      h->start = now;
+   }
+}
+
+void lockstat_released(struct lockstat_hold *h)
+{
+   struct lockstat_class *c = h->c;
+   u64 held;
+
+   if (!c)
+      return;
+
+   held = lockstat_now() - h->start;
+   h->c = NULL;
+
+   disable_preemption();
+   {
+      /* Check `site` because lockstat_reset() might have been called */
+      if (c->site && held > c->max_hold_cycles)
+         c->max_hold_cycles = held;
+   }
+   enable_preemption();
+}
+
+static long lockstat_cmp_wait(const void *a, const void *b)
+{
+   const struct lockstat_class *ca = a;
+   const struct lockstat_class *cb = b;
+
+   if (ca->wait_cycles == cb->wait_cycles)
+      return 0;
+
+   return ca->wait_cycles < cb->wait_cycles ? 1 : -1;
+}
+
+int lockstat_get_classes(struct lockstat_class *buf, int max)
+{
+   int n = 0;
+
+   disable_preemption();
+   {
+      for (u32 i = 0; i < LOCKSTAT_MAX_CLASSES && n < max; i++)
+         if (classes[i].site)
+            buf[n++] = classes[i];
+   }
+   enable_preemption();
+
+   insertion_sort_generic(buf, sizeof(buf[0]), (u32)n, &lockstat_cmp_wait);
+   return n;
+}
+
+u32 lockstat_get_dropped(void)
+{
+   return dropped;
+}
+
+void lockstat_reset(void)
+{
+   disable_preemption();
+   {
+      bzero(classes, sizeof(classes));
+      dropped = 0;
+   }
+   enable_preemption();
+}
+
+#endif // KERNEL_LOCKSTAT
@@ -32,6 +32,8 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/kernelfs.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/boot_prof.h>
+#include <tilck/kernel/kmsg.h>
 
 #include <tilck/mods/console.h>
 #include <tilck/mods/fb_console.h>
@@ -324,11 +326,14 @@ static void do_async_init()
    /* declare the show_hello_message() function */
    void show_hello_message(void);
 
-   mount_initrd();
-   init_devfs();
-   init_modules();
-   init_extra_debug_features();
+   BOOT_STEP(mount_initrd);
+   BOOT_STEP(init_devfs);
+   BOOT_STEP(init_kmsg_dev);
+   BOOT_STEP(init_modules);
+   BOOT_STEP(init_extra_debug_features);
+   BOOT_STEP(init_printk_async_flush);
 
+   boot_prof_done();
    show_hello_message();
    run_init_or_selftest();
 }
@@ -343,33 +348,35 @@ async_init(void)
 void
 kmain(u32 multiboot_magic, u32 mbi_addr)
 {
+   init_boot_prof();
    call_kernel_global_ctors();
    save_multiboot_info(multiboot_magic, mbi_addr);
 
-   early_init_serial_ports();
-   init_cpu_exception_handling();
-   early_init_paging();
-   early_init_kmalloc();
-
-   read_multiboot_info();
-   enable_cpu_features();
-   kmain_early_checks();
-   init_segmentation();
-   init_fpu_memcpy();
-   init_kmalloc();
-   init_paging();
-
-   acpi_mod_init_tables();
-
-   init_console();
-   init_self_tests();
-   init_irq_handling();
-   init_sched();
-   init_syscall_interfaces();
-   init_worker_threads();
-   init_timer();
-   init_system_time();
-   init_kernelfs();
+   BOOT_STEP(early_init_serial_ports);
+   BOOT_STEP(init_cpu_exception_handling);
+   BOOT_STEP(early_init_paging);
+   BOOT_STEP(early_init_kmalloc);
+
+   BOOT_STEP(read_multiboot_info);
+   BOOT_STEP(enable_cpu_features);
+   BOOT_STEP(kmain_early_checks);
+   BOOT_STEP(init_segmentation);
+   BOOT_STEP(init_fpu_memcpy);
+   BOOT_STEP(init_kmalloc);
+   BOOT_STEP(init_kernel_symbols_index);
+   BOOT_STEP(init_paging);
+
+   BOOT_STEP(acpi_mod_init_tables);
+
+   BOOT_STEP(init_console);
+   BOOT_STEP(init_self_tests);
+   BOOT_STEP(init_irq_handling);
+   BOOT_STEP(init_sched);
+   BOOT_STEP(init_syscall_interfaces);
+   BOOT_STEP(init_worker_threads);
+   BOOT_STEP(init_timer);
+   BOOT_STEP(init_system_time);
+   BOOT_STEP(init_kernelfs);
 
    async_init();
    do_schedule();
@@ -103,101 +103,72 @@ void *sys_brk(void *new_brk)
    return pi->brk;
 }
 
-static int create_process_mmap_heap(struct process *pi)
+static int create_process_mappings_info(struct process *pi)
 {
-   struct kmalloc_heap *mmap_heap;
+   struct mappings_info *mi;
    ASSERT(!pi->mi);
 
-   if (!(pi->mi = kalloc_obj(struct mappings_info)))
+   if (!(mi = kzalloc_obj(struct mappings_info)))
       return -ENOMEM;
 
-   if (!(mmap_heap = kzmalloc(kmalloc_get_heap_struct_size()))) {
-      kfree_obj(pi->mi, struct mappings_info);
-      return -ENOMEM;
-   }
+   list_init(&mi->mappings);
 
-   list_init(&pi->mi->mappings);
-   pi->mi->mmap_heap = mmap_heap;
-   pi->mi->mmap_heap_size = USER_MMAP_MIN_SZ;
-
-   bool success =
-      kmalloc_create_heap(mmap_heap,
-                          USER_MMAP_BEGIN,
-                          pi->mi->mmap_heap_size,
-                          PAGE_SIZE,
-                          KMALLOC_MAX_ALIGN,    /* alloc block size */
-                          false,                /* linear mapping */
-                          NULL,                 /* metadata_nodes */
-#if MMAP_NO_COW
-                          user_valloc_and_map,
-                          user_vfree_and_unmap);
-#else
-                          user_map_zero_page,
-                          user_unmap_zero_page);
-#endif
-
-   if (!success)
+   if (user_vspace_init(mi)) {
+      kfree_obj(mi, struct mappings_info);
       return -ENOMEM;
+   }
 
+   pi->mi = mi;
    return 0;
 }
 
 static inline void
-mmap_err_case_free(struct process *pi, void *ptr, size_t actual_len)
+mmap_err_case_free(struct process *pi, struct user_mapping *um)
 {
-   per_heap_kfree(pi->mi->mmap_heap,
-                  ptr,
-                  &actual_len,
-                  KFREE_FL_ALLOW_SPLIT |
-                  KFREE_FL_MULTI_STEP  |
-                  KFREE_FL_NO_ACTUAL_FREE);
+   if (!um->h)
+      user_unmap_anon_mem(um->vaddr, um->len >> PAGE_SHIFT, um->big_pages);
+
+   user_vspace_free(pi->mi, um->vaddr, um->len);
+   process_remove_user_mapping(pi, um);
 }
 
 static struct user_mapping *
-mmap_on_user_heap(struct process *pi,
-                  size_t *actual_len_ref,
-                  fs_handle handle,
-                  u32 per_heap_kmalloc_flags,
-                  size_t off,
-                  int prot)
+mmap_in_user_vspace(struct process *pi,
+                    size_t actual_len,
+                    fs_handle handle,
+                    size_t off,
+                    int prot,
+                    bool big_pages)
 {
-   void *res;
+   const size_t align = big_pages ? BIG_PAGE_SIZE : PAGE_SIZE;
    struct user_mapping *um;
+   ulong vaddr;
 
-   while (true) {
-
-      struct kmalloc_heap *new_heap;
-      struct kmalloc_heap *h = pi->mi->mmap_heap;
-      size_t heap_sz = pi->mi->mmap_heap_size;
-
-      res = per_heap_kmalloc(h,
-                             actual_len_ref,
-                             per_heap_kmalloc_flags);
-
-      if (LIKELY(res != NULL))
-         break;        /* great! */
-
-      if (heap_sz == USER_MMAP_MAX_SZ)
-         return NULL; /* cannot expand the heap more than that */
-
-      new_heap = kmalloc_heap_dup_expanded(h, heap_sz * 2);
+   if (!(vaddr = user_vspace_alloc(pi->mi, actual_len, align)))
+      return NULL;
 
-      if (!new_heap)
-         return NULL; /* no enough memory */
+   if (!handle) {
 
-      pi->mi->mmap_heap_size = heap_sz * 2;
-      pi->mi->mmap_heap = new_heap;
-      kmalloc_destroy_heap(h);
+      /* Anonymous mapping: map the zero-page (or real memory) right now */
+      if (!user_map_anon_mem(vaddr, actual_len >> PAGE_SHIFT, big_pages)) {
+         user_vspace_free(pi->mi, vaddr, actual_len);
+         return NULL;
+      }
    }
 
    /* NOTE: here `handle` might be NULL (zero-map case) and that's OK */
-   um = process_add_user_mapping(handle, res, *actual_len_ref, off, prot);
+   um = process_add_user_mapping(handle, TO_PTR(vaddr), actual_len, off, prot);
 
    if (!um) {
-      mmap_err_case_free(pi, res, *actual_len_ref);
+
+      if (!handle)
+         user_unmap_anon_mem(vaddr, actual_len >> PAGE_SHIFT, big_pages);
+
+      user_vspace_free(pi->mi, vaddr, actual_len);
       return NULL;
    }
 
+   um->big_pages = big_pages;
    return um;
 }
 
@@ -205,12 +176,12 @@ long
 sys_mmap_pgoff(void *addr, size_t len, int prot,
                int flags, int fd, size_t pgoffset)
 {
-   u32 per_heap_kmalloc_flags = KMALLOC_FL_MULTI_STEP | PAGE_SIZE;
    struct task *curr = get_curr_task();
    struct process *pi = curr->pi;
    struct fs_handle_base *handle = NULL;
    struct user_mapping *um = NULL;
    size_t actual_len;
+   bool big_pages = false;
    int rc, fl;
 
    if ((flags & MAP_PRIVATE) && (flags & MAP_SHARED))
@@ -244,11 +215,26 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
       if (pgoffset != 0)
          return -EINVAL; /* pgoffset != 0 does not make sense here */
 
+      if (flags & MAP_HUGETLB) {
+
+         /* Explicit request: the length is rounded up, as Linux does */
+         actual_len = pow2_round_up_at(len, BIG_PAGE_SIZE);
+         big_pages = true;
+
+      } else if (MMAP_TRANSP_BIG_PAGES) {
+
+         /* Transparent big pages, for lengths multiple of BIG_PAGE_SIZE */
+         big_pages = !(actual_len & (BIG_PAGE_SIZE - 1));
+      }
+
    } else {
 
       if (!(flags & MAP_SHARED))
          return -EINVAL;
 
+      if (flags & MAP_HUGETLB)
+         return -EINVAL; /* big pages supported only for anonymous mappings */
+
       handle = get_fs_handle(fd);
 
       if (!handle)
@@ -266,30 +252,44 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
          if (!(fl & O_WRONLY) && (fl & O_RDWR) != O_RDWR)
             return -EACCES;
       }
-
-      per_heap_kmalloc_flags |= KMALLOC_FL_NO_ACTUAL_ALLOC;
    }
 
+   if (actual_len > USER_MMAP_MAX_SZ)
+      return -ENOMEM;
+
    if (!pi->mi)
-      if ((rc = create_process_mmap_heap(pi)))
+      if ((rc = create_process_mappings_info(pi)))
          return rc;
 
    disable_preemption();
    {
-      um = mmap_on_user_heap(pi,
-                             &actual_len,
-                             handle,
-                             per_heap_kmalloc_flags,
-                             pgoffset << PAGE_SHIFT,
-                             prot);
+      um = mmap_in_user_vspace(pi,
+                               actual_len,
+                               handle,
+                               pgoffset << PAGE_SHIFT,
+                               prot,
+                               big_pages);
+
+      if (!um && big_pages && !(flags & MAP_HUGETLB)) {
+
+         /*
+          * Transparent big pages are just an optimization: if we couldn't get
+          * a physically-contiguous block or a well aligned virtual range,
+          * fall back to regular pages.
+          */
+         um = mmap_in_user_vspace(pi,
+                                  actual_len,
+                                  handle,
+                                  pgoffset << PAGE_SHIFT,
+                                  prot,
+                                  false);
+      }
    }
    enable_preemption();
 
    if (!um)
       return -ENOMEM;
 
-   ASSERT(actual_len == pow2_round_up_at(len, PAGE_SIZE));
-
    if (handle) {
 
       if ((rc = vfs_mmap(um, pi->pdir, 0))) {
@@ -302,8 +302,7 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
          disable_preemption();
          {
-            mmap_err_case_free(pi, um->vaddrp, actual_len);
-            process_remove_user_mapping(um);
+            mmap_err_case_free(pi, um);
          }
          enable_preemption();
          return rc;
@@ -312,7 +311,7 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
    } else {
 
-      if (MMAP_NO_COW)
+      if (MMAP_NO_COW && !um->big_pages)
          bzero(um->vaddrp, actual_len);
    }
 
@@ -321,7 +320,6 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
 static int munmap_int(struct process *pi, void *vaddrp, size_t len)
 {
-   u32 kfree_flags = KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP;
    struct user_mapping *um = NULL, *um2 = NULL;
    ulong vaddr = (ulong) vaddrp;
    size_t actual_len;
@@ -344,13 +342,28 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
       return 0;
    }
 
+   if (um->big_pages) {
+
+      /* Mappings backed by big pages can be un-mapped only in big chunks */
+      if (vaddr & (BIG_PAGE_SIZE - 1))
+         return -EINVAL;
+
+      actual_len = pow2_round_up_at(len, BIG_PAGE_SIZE);
+   }
+
    const ulong um_vend = um->vaddr + um->len;
+   const bool full_unmap = actual_len == um->len;
 
-   if (actual_len == um->len) {
+   if (vaddr + actual_len > um_vend) {
 
-      process_remove_user_mapping(um);
+      /*
+       * Un-mapping a range spanning over multiple mappings is not supported.
+       * Fail instead of corrupting the state of the user virtual space.
+       */
+      return -EINVAL;
+   }
 
-   } else {
+   if (!full_unmap) {
 
       /* partial un-map */
 
@@ -391,12 +404,13 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
             um->len = um_vend - um->vaddr;
             return -ENOMEM;
          }
+
+         um2->big_pages = um->big_pages;
       }
    }
 
    if (um->h) {
 
-      kfree_flags |= KFREE_FL_NO_ACTUAL_FREE;
       rc = vfs_munmap(um, vaddrp, actual_len);
 
       /*
@@ -410,14 +424,17 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
 
       if (um2)
          vfs_mmap(um2, pi->pdir, VFS_MM_DONT_MMAP);
+
+   } else {
+
+      user_unmap_anon_mem(vaddr, actual_len >> PAGE_SHIFT, um->big_pages);
    }
 
-   per_heap_kfree(pi->mi->mmap_heap,
-                  vaddrp,
-                  &actual_len,
-                  kfree_flags);
+   user_vspace_free(pi->mi, vaddr, actual_len);
+
+   if (full_unmap)
+      process_remove_user_mapping(pi, um);
 
-   ASSERT(actual_len == pow2_round_up_at(len, PAGE_SIZE));
    return 0;
 }
 
@@ -428,15 +445,11 @@ int sys_munmap(void *vaddrp, size_t len)
    ulong vaddr = (ulong) vaddrp;
    int rc;
 
-   if (!len || !pi->mi->mmap_heap)
+   if (!len || !pi->mi)
       return -EINVAL;
 
-   if (!IN_RANGE(vaddr,
-                 USER_MMAP_BEGIN,
-                 USER_MMAP_BEGIN + pi->mi->mmap_heap_size))
-   {
+   if (!IN_RANGE(vaddr, USER_MMAP_BEGIN, USER_MMAP_END))
       return -EINVAL;
-   }
 
    disable_preemption();
    {
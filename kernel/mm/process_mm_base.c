@@ -1,9 +1,36 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/config_mm.h>
+
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/paging_hw.h>
 
+static long user_mapping_insert_remove_cmp(const void *a, const void *b)
+{
+   const struct user_mapping *um1 = a;
+   const struct user_mapping *um2 = b;
+
+   if (um1->vaddr != um2->vaddr)
+      return um1->vaddr < um2->vaddr ? -1 : 1;
+
+   return 0;
+}
+
+static long user_mapping_find_cmp(const void *obj, const void *valptr)
+{
+   const struct user_mapping *um = obj;
+   const ulong vaddr = (ulong)valptr;
+
+   if (vaddr < um->vaddr)
+      return 1;
+
+   if (vaddr >= um->vaddr + um->len)
+      return -1;
+
+   return 0; /* um contains vaddr */
+}
+
 struct user_mapping *
 process_add_user_mapping(fs_handle h,
                          void *vaddr,
@@ -22,6 +49,7 @@ process_add_user_mapping(fs_handle h,
    if (!(um = kzalloc_obj(struct user_mapping)))
       return NULL;
 
+   bintree_node_init(&um->tree_node);
    list_node_init(&um->pi_node);
    list_node_init(&um->inode_node);
 
@@ -33,13 +61,28 @@ process_add_user_mapping(fs_handle h,
    um->prot = prot;
 
    list_add_tail(&pi->mi->mappings, &um->pi_node);
+
+   DEBUG_CHECKED_SUCCESS(
+      bintree_insert(&pi->mi->mappings_tree,
+                     um,
+                     user_mapping_insert_remove_cmp,
+                     struct user_mapping,
+                     tree_node)
+   );
+
    return um;
 }
 
-void process_remove_user_mapping(struct user_mapping *um)
+void process_remove_user_mapping(struct process *pi, struct user_mapping *um)
 {
    ASSERT(!is_preemption_enabled());
 
+   bintree_remove(&pi->mi->mappings_tree,
+                  um,
+                  user_mapping_insert_remove_cmp,
+                  struct user_mapping,
+                  tree_node);
+
    list_remove(&um->pi_node);
    list_remove(&um->inode_node);
    kfree_obj(um, struct user_mapping);
@@ -47,34 +90,28 @@ void process_remove_user_mapping(struct user_mapping *um)
 
 struct user_mapping *process_get_user_mapping(void *vaddrp)
 {
-   const ulong vaddr = (ulong)vaddrp;
    struct process *pi = get_curr_proc();
-   struct user_mapping *pos;
-
    ASSERT(!is_preemption_enabled());
 
-   if (pi->mi) {
-
-      /*
-       * Given that pi->mi->mappings contains at the moment only the memory
-       * mappings done with mmap(), some small processes that don't use dynamic
-       * memory allocation will not even have this field (pi->mi == NULL).
-       *
-       * For the rest, the list is supposed to be *short*, so a linear scan
-       * is acceptable for the moment. If in the future we start to put
-       * there also the mappings for program's text and data and expect to have
-       * more than a few elements, it will be necessary to use a BST to perform
-       * the lookup here below.
-       */
+   /*
+    * Given that pi->mi contains at the moment only the memory mappings done
+    * with mmap(), some small processes that don't use dynamic memory
+    * allocation will not even have this field (pi->mi == NULL).
+    *
+    * NOTE: the mappings never overlap, therefore user_mapping_find_cmp() is
+    * consistent with the order of the tree. Also, partial munmap() calls might
+    * change um->vaddr, but never in a way that alters the relative order of
+    * the mappings, so there's no need to re-insert them in the tree.
+    */
 
-      list_for_each_ro(pos, &pi->mi->mappings, pi_node) {
-
-         if (IN_RANGE(vaddr, pos->vaddr, pos->vaddr + pos->len))
-            return pos;
-      }
-   }
+   if (!pi->mi)
+      return NULL;
 
-   return NULL;
+   return bintree_find(pi->mi->mappings_tree,
+                       vaddrp,
+                       user_mapping_find_cmp,
+                       struct user_mapping,
+                       tree_node);
 }
 
 void remove_all_user_zero_mem_mappings(struct process *pi)
@@ -119,22 +156,15 @@ void remove_all_mappings_of_handle(struct process *pi, fs_handle h)
 void full_remove_user_mapping(struct process *pi, struct user_mapping *um)
 {
    struct mappings_info *mi = pi->mi;
-   size_t actual_len = um->len;
-
    ASSERT(mi);
-   ASSERT(mi->mmap_heap);
 
    if (um->h)
-      vfs_munmap(um, um->vaddrp, actual_len);
-
-   per_heap_kfree(mi->mmap_heap,
-                  um->vaddrp,
-                  &actual_len,
-                  KFREE_FL_ALLOW_SPLIT |
-                  KFREE_FL_MULTI_STEP  |
-                  KFREE_FL_NO_ACTUAL_FREE);
+      vfs_munmap(um, um->vaddrp, um->len);
+   else
+      user_unmap_anon_mem(um->vaddr, um->len >> PAGE_SHIFT, um->big_pages);
 
-   process_remove_user_mapping(um);
+   user_vspace_free(mi, um->vaddr, um->len);
+   process_remove_user_mapping(pi, um);
 }
 
 void remove_all_file_mappings(struct process *pi)
@@ -155,16 +185,17 @@ duplicate_mappings_info(struct process *new_pi, struct mappings_info *mi)
 {
    struct mappings_info *new_mi = NULL;
    struct user_mapping *um, *um2;
+   bool vspace_dup = false;
 
-   if (!(new_mi = kalloc_obj(struct mappings_info)))
+   if (!(new_mi = kzalloc_obj(struct mappings_info)))
       goto oom_case;
 
    list_init(&new_mi->mappings);
 
-   if (!(new_mi->mmap_heap = kmalloc_heap_dup(mi->mmap_heap)))
+   if (user_vspace_dup(new_mi, mi))
       goto oom_case;
 
-   new_mi->mmap_heap_size = mi->mmap_heap_size;
+   vspace_dup = true;
 
    list_for_each_ro(um, &mi->mappings, pi_node) {
 
@@ -178,12 +209,22 @@ duplicate_mappings_info(struct process *new_pi, struct mappings_info *mi)
       um2->pi = new_pi;
 
       /* Re-init the new nodes */
+      bintree_node_init(&um2->tree_node);
       list_node_init(&um2->pi_node);
       list_node_init(&um2->inode_node);
 
       /* Add the pi_node to new process's mappings list */
       list_add_tail(&new_mi->mappings, &um2->pi_node);
 
+      /* Add the mapping to the new process's mappings tree */
+      DEBUG_CHECKED_SUCCESS(
+         bintree_insert(&new_mi->mappings_tree,
+                        um2,
+                        user_mapping_insert_remove_cmp,
+                        struct user_mapping,
+                        tree_node)
+      );
+
       /*
        * If the inode_node belongs to a list (mappings per inode)
        * add the new mapping's inode_node to the same list.
@@ -198,13 +239,12 @@ oom_case:
 
    if (new_mi) {
 
-      if (new_mi->mmap_heap) {
-         kmalloc_destroy_heap(new_mi->mmap_heap);
-         kfree2(new_mi->mmap_heap, kmalloc_get_heap_struct_size());
-      }
+      if (vspace_dup)
+         user_vspace_destroy(new_mi);
 
       list_for_each(um, um2, &new_mi->mappings, pi_node) {
          list_remove(&um->pi_node);
+         list_remove(&um->inode_node);
          kfree_obj(um, struct user_mapping);
       }
 
@@ -310,6 +350,60 @@ bool user_map_zero_page(ulong user_vaddr, size_t page_count)
    return true;
 }
 
+void user_unmap_big_pages(ulong user_vaddr, size_t page_count)
+{
+   pdir_t *pdir = get_curr_pdir();
+   const ulong end = user_vaddr + (page_count << PAGE_SHIFT);
+
+   for (ulong va = user_vaddr; va < end; va += BIG_PAGE_SIZE)
+      unmap_big_page(pdir, (void *)va, true);
+}
+
+bool user_map_big_pages(ulong user_vaddr, size_t page_count)
+{
+   pdir_t *pdir = get_curr_pdir();
+   const ulong end = user_vaddr + (page_count << PAGE_SHIFT);
+   const u32 pg_flags = PAGING_FL_RWUS | PAGING_FL_DO_ALLOC | PAGING_FL_ZERO_PG;
+
+   ASSERT((user_vaddr & (BIG_PAGE_SIZE - 1)) == 0);
+   ASSERT((end & (BIG_PAGE_SIZE - 1)) == 0);
+
+   /*
+    * Big pages are always backed by real memory: the zero-page trick would
+    * require a whole zeroed big page and gain almost nothing, as the first
+    * write would copy the whole big page anyway.
+    */
+   for (ulong va = user_vaddr; va < end; va += BIG_PAGE_SIZE) {
+      if (map_big_page(pdir, (void *)va, 0, pg_flags) != 0) {
+         user_unmap_big_pages(user_vaddr, (va - user_vaddr) >> PAGE_SHIFT);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool user_map_anon_mem(ulong user_vaddr, size_t page_count, bool big_pages)
+{
+   if (big_pages)
+      return user_map_big_pages(user_vaddr, page_count);
+
+   if (MMAP_NO_COW)
+      return user_valloc_and_map(user_vaddr, page_count);
+
+   return user_map_zero_page(user_vaddr, page_count);
+}
+
+void user_unmap_anon_mem(ulong user_vaddr, size_t page_count, bool big_pages)
+{
+   if (big_pages)
+      user_unmap_big_pages(user_vaddr, page_count);
+   else if (MMAP_NO_COW)
+      user_vfree_and_unmap(user_vaddr, page_count);
+   else
+      user_unmap_zero_page(user_vaddr, page_count);
+}
+
 int generic_fs_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 {
    struct fs_handle_base *hb = um->h;
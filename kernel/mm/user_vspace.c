@@ -0,0 +1,343 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_mm.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/bintree.h>
+#include <tilck/kernel/errno.h>
+
+/*
+ * Allocator for the free ranges (gaps) in the mmap area of the user virtual
+ * address space, [USER_MMAP_BEGIN, USER_MMAP_END).
+ *
+ * Each gap lives in two AVL trees at the same time:
+ *
+ *    - `gaps_by_end`, ordered by address. Because the gaps never overlap, the
+ *       order by their `end` is the same as the order by their `start`. Using
+ *       `end` as key allows us to shrink a gap from its beginning (the common
+ *       case, in alloc) without re-inserting it.
+ *
+ *    - `gaps_by_size`, ordered by the pair (size, start). It allows finding the
+ *       smallest gap big enough for a given allocation (best-fit) in O(log n).
+ *
+ * Adjacent gaps are always coalesced, therefore there's never a gap ending
+ * where another one begins.
+ */
+
+struct user_vgap {
+
+   struct bintree_node by_end_node;
+   struct bintree_node by_size_node;
+   ulong start;
+   ulong end;
+};
+
+struct vgap_size_key {
+   size_t size;
+   ulong start;
+};
+
+static ALWAYS_INLINE long ulong_cmp(ulong a, ulong b)
+{
+   return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static long vgap_end_cmp(const void *a, const void *b)
+{
+   const struct user_vgap *g1 = a;
+   const struct user_vgap *g2 = b;
+   return ulong_cmp(g1->end, g2->end);
+}
+
+static long vgap_size_cmp(const void *a, const void *b)
+{
+   const struct user_vgap *g1 = a;
+   const struct user_vgap *g2 = b;
+   const size_t s1 = g1->end - g1->start;
+   const size_t s2 = g2->end - g2->start;
+
+   if (s1 != s2)
+      return ulong_cmp(s1, s2);
+
+   return ulong_cmp(g1->start, g2->start);
+}
+
+static long vgap_size_key_cmp(const void *obj, const void *valptr)
+{
+   const struct user_vgap *g = obj;
+   const struct vgap_size_key *k = valptr;
+   const size_t s = g->end - g->start;
+
+   if (s != k->size)
+      return ulong_cmp(s, k->size);
+
+   return ulong_cmp(g->start, k->start);
+}
+
+/* Finds the gap ending exactly at `*valptr` */
+static long vgap_find_by_end_cmp(const void *obj, const void *valptr)
+{
+   const struct user_vgap *g = obj;
+   return ulong_cmp(g->end, *(const ulong *)valptr);
+}
+
+/*
+ * Finds the gap starting exactly at `*valptr`. It's used on `gaps_by_end` as
+ * well: see the comment above about the order of the gaps.
+ */
+static long vgap_find_by_start_cmp(const void *obj, const void *valptr)
+{
+   const struct user_vgap *g = obj;
+   return ulong_cmp(g->start, *(const ulong *)valptr);
+}
+
+static void vgap_insert_by_size(struct mappings_info *mi, struct user_vgap *g)
+{
+   bintree_node_init(&g->by_size_node);
+
+   DEBUG_CHECKED_SUCCESS(
+      bintree_insert(&mi->gaps_by_size,
+                     g,
+                     vgap_size_cmp,
+                     struct user_vgap,
+                     by_size_node)
+   );
+}
+
+static void vgap_remove_by_size(struct mappings_info *mi, struct user_vgap *g)
+{
+   bintree_remove(&mi->gaps_by_size,
+                  g,
+                  vgap_size_cmp,
+                  struct user_vgap,
+                  by_size_node);
+}
+
+static void vgap_insert(struct mappings_info *mi, struct user_vgap *g)
+{
+   bintree_node_init(&g->by_end_node);
+
+   DEBUG_CHECKED_SUCCESS(
+      bintree_insert(&mi->gaps_by_end,
+                     g,
+                     vgap_end_cmp,
+                     struct user_vgap,
+                     by_end_node)
+   );
+
+   vgap_insert_by_size(mi, g);
+}
+
+static void vgap_remove(struct mappings_info *mi, struct user_vgap *g)
+{
+   bintree_remove(&mi->gaps_by_end,
+                  g,
+                  vgap_end_cmp,
+                  struct user_vgap,
+                  by_end_node);
+
+   vgap_remove_by_size(mi, g);
+}
+
+static struct user_vgap *
+vgap_alloc(ulong start, ulong end)
+{
+   struct user_vgap *g;
+
+   if (!(g = kalloc_obj(struct user_vgap)))
+      return NULL;
+
+   g->start = start;
+   g->end = end;
+   return g;
+}
+
+int user_vspace_init(struct mappings_info *mi)
+{
+   struct user_vgap *g;
+
+   mi->gaps_by_end = NULL;
+   mi->gaps_by_size = NULL;
+
+   if (!(g = vgap_alloc(USER_MMAP_BEGIN, USER_MMAP_END)))
+      return -ENOMEM;
+
+   vgap_insert(mi, g);
+   return 0;
+}
+
+void user_vspace_destroy(struct mappings_info *mi)
+{
+   struct user_vgap *g;
+
+   while ((g = bintree_get_first_obj(mi->gaps_by_end,
+                                     struct user_vgap,
+                                     by_end_node)))
+   {
+      vgap_remove(mi, g);
+      kfree_obj(g, struct user_vgap);
+   }
+
+   ASSERT(!mi->gaps_by_size);
+}
+
+/*
+ * Allocates `len` bytes aligned at `align` (a power of 2, multiple of
+ * PAGE_SIZE). For alignments bigger than PAGE_SIZE, the best-fit search looks
+ * for a gap big enough even in the worst case (`len + align - PAGE_SIZE`):
+ * that might skip a smaller gap which happens to be well aligned, but keeps
+ * the search O(log n).
+ */
+ulong user_vspace_alloc(struct mappings_info *mi, size_t len, size_t align)
+{
+   struct vgap_size_key key = { .size = len + align - PAGE_SIZE, .start = 0 };
+   struct user_vgap *g, *tail;
+   ulong vaddr, vend;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(IS_PAGE_ALIGNED(len));
+   ASSERT(IS_PAGE_ALIGNED(align));
+   ASSERT(roundup_next_power_of_2(align) == align);
+
+   g = bintree_lower_bound(mi->gaps_by_size,
+                           &key,
+                           vgap_size_key_cmp,
+                           struct user_vgap,
+                           by_size_node);
+
+   if (!g)
+      return 0; /* no gap big enough */
+
+   vaddr = pow2_round_up_at(g->start, align);
+   vend = vaddr + len;
+   ASSERT(vend <= g->end);
+
+   if (vaddr == g->start && vend == g->end) {
+
+      /* Perfect fit: the gap disappears */
+      vgap_remove(mi, g);
+      kfree_obj(g, struct user_vgap);
+
+   } else if (vaddr == g->start) {
+
+      /*
+       * Shrink the gap from its beginning: its `end` doesn't change, therefore
+       * its position in `gaps_by_end` doesn't change either.
+       */
+      vgap_remove_by_size(mi, g);
+      g->start = vend;
+      vgap_insert_by_size(mi, g);
+
+   } else if (vend == g->end) {
+
+      /* Shrink the gap from its end: it has to be re-inserted */
+      vgap_remove(mi, g);
+      g->end = vaddr;
+      vgap_insert(mi, g);
+
+   } else {
+
+      /* The allocation is in the middle of the gap: split it */
+      if (!(tail = vgap_alloc(vend, g->end)))
+         return 0;
+
+      vgap_remove(mi, g);
+      g->end = vaddr;
+      vgap_insert(mi, g);
+      vgap_insert(mi, tail);
+   }
+
+   return vaddr;
+}
+
+/*
+ * Returns the range [vaddr, vaddr + len) to the allocator, coalescing it with
+ * the adjacent gaps, if any. The only case requiring a memory allocation is
+ * when the range has no adjacent gaps: in that case, if we're out of memory,
+ * the range is simply left unusable for future mmap() calls (but no memory is
+ * leaked).
+ */
+void user_vspace_free(struct mappings_info *mi, ulong vaddr, size_t len)
+{
+   const ulong vend = vaddr + len;
+   struct user_vgap *prev, *next;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(IS_PAGE_ALIGNED(vaddr));
+   ASSERT(IS_PAGE_ALIGNED(len));
+   ASSERT(IN_RANGE_INC(vend, USER_MMAP_BEGIN, USER_MMAP_END));
+
+   prev = bintree_find(mi->gaps_by_end,
+                       &vaddr,
+                       vgap_find_by_end_cmp,
+                       struct user_vgap,
+                       by_end_node);
+
+   next = bintree_find(mi->gaps_by_end,
+                       &vend,
+                       vgap_find_by_start_cmp,
+                       struct user_vgap,
+                       by_end_node);
+
+   if (next) {
+
+      ulong new_start = vaddr;
+
+      if (prev) {
+         new_start = prev->start;
+         vgap_remove(mi, prev);
+         kfree_obj(prev, struct user_vgap);
+      }
+
+      /* Extend `next` backwards: its `end` does not change */
+      vgap_remove_by_size(mi, next);
+      next->start = new_start;
+      vgap_insert_by_size(mi, next);
+
+   } else if (prev) {
+
+      /* Extend `prev` forward: its `end` changes, we have to re-insert it */
+      vgap_remove(mi, prev);
+      prev->end = vend;
+      vgap_insert(mi, prev);
+
+   } else {
+
+      struct user_vgap *g = vgap_alloc(vaddr, vend);
+
+      if (g)
+         vgap_insert(mi, g);
+   }
+}
+
+int user_vspace_dup(struct mappings_info *dst, struct mappings_info *src)
+{
+   struct bintree_walk_ctx ctx;
+   struct user_vgap *g, *g2;
+
+   dst->gaps_by_end = NULL;
+   dst->gaps_by_size = NULL;
+
+   bintree_in_order_visit_start(&ctx,
+                                src->gaps_by_end,
+                                struct user_vgap,
+                                by_end_node,
+                                false);
+
+   while ((g = bintree_in_order_visit_next(&ctx))) {
+
+      if (!(g2 = vgap_alloc(g->start, g->end))) {
+         user_vspace_destroy(dst);
+         return -ENOMEM;
+      }
+
+      vgap_insert(dst, g2);
+   }
+
+   return 0;
+}
@@ -2,12 +2,34 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sort.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/boot_prof.h>
+#include <tilck/kernel/cmdline.h>
+
+#define MODS_MAX                                32
+
+enum mod_state {
+
+   MOD_PENDING,
+   MOD_RUNNING,
+   MOD_DONE,
+};
 
 static int mods_count;
-static struct module *modules[32];
+static struct module *modules[MODS_MAX];
+static enum mod_state mods_state[MODS_MAX];
+
+/* Used only during init_modules() */
+static struct kmutex mods_mutex;
+static struct kcond mods_cond;
+static struct worker_thread *mods_wth;
+static int mods_running;
 
 void register_module(struct module *m)
 {
@@ -22,13 +44,179 @@ static long mod_cmp_func(const void *a, const void *b)
    return (*ma)->priority - (*mb)->priority;
 }
 
+static int find_module(const char *name)
+{
+   for (int i = 0; i < mods_count; i++)
+      if (!strcmp(modules[i]->name, name))
+         return i;
+
+   return -1;
+}
+
+static bool mod_is_async(struct module *m)
+{
+   return m->async && mods_wth != NULL;
+}
+
+static bool mod_is_ready(int i)
+{
+   struct module *m = modules[i];
+   int dep;
+
+   if (!mod_is_async(m)) {
+
+      /* Wait for all the modules with a lower priority */
+      for (int j = 0; j < i; j++)
+         if (mods_state[j] != MOD_DONE)
+            return false;
+
+      return true;
+   }
+
+   for (int j = 0; j < MOD_MAX_DEPS && m->deps[j]; j++) {
+
+      if ((dep = find_module(m->deps[j])) < 0)
+         continue;     /* Module not compiled-in: ignore the dependency */
+
+      if (mods_state[dep] != MOD_DONE)
+         return false;
+   }
+
+   return true;
+}
+
+static void run_module(struct module *m, u32 bp_flags)
+{
+   int bp;
+
+   printk("*** Init kernel module: %s%s\n",
+          m->name, (bp_flags & BOOT_PH_ASYNC) ? " (async)" : "");
+
+   bp = boot_prof_begin(m->name, BOOT_PH_MODULE | bp_flags);
+   m->init();
+   boot_prof_end(bp);
+}
+
+static void mod_set_done(int i)
+{
+   mods_state[i] = MOD_DONE;
+   mods_running--;
+   kcond_signal_all(&mods_cond);
+}
+
+static void mod_async_init_job(void *arg)
+{
+   const int i = (int)(ulong)arg;
+
+   run_module(modules[i], BOOT_PH_ASYNC);
+
+   kmutex_lock(&mods_mutex);
+   {
+      mod_set_done(i);
+   }
+   kmutex_unlock(&mods_mutex);
+}
+
+/* Runs a module on the init thread. Called holding `mods_mutex`. */
+static void mod_run_inline(int i)
+{
+   kmutex_unlock(&mods_mutex);
+   {
+      run_module(modules[i], 0);
+   }
+   kmutex_lock(&mods_mutex);
+   mod_set_done(i);
+}
+
+/*
+ * Start all the async modules whose dependencies are ready. Returns the number
+ * of modules started. Called holding `mods_mutex`.
+ */
+static int mods_start_async(void)
+{
+   int started = 0;
+
+   for (int i = 0; i < mods_count; i++) {
+
+      if (mods_state[i] != MOD_PENDING || !mod_is_async(modules[i]))
+         continue;
+
+      if (!mod_is_ready(i))
+         continue;
+
+      mods_state[i] = MOD_RUNNING;
+      mods_running++;
+      started++;
+
+      if (!wth_enqueue_on(mods_wth, &mod_async_init_job, TO_PTR(i)))
+         mod_run_inline(i);  /* Should never happen: the queue is big enough */
+   }
+
+   return started;
+}
+
+/* Returns the first non-async module ready to run or -1 */
+static int mods_find_ready(void)
+{
+   for (int i = 0; i < mods_count; i++)
+      if (mods_state[i] == MOD_PENDING && mod_is_ready(i))
+         return i;
+
+   return -1;
+}
+
+static void create_mods_worker(void)
+{
+   disable_preemption();
+   {
+      mods_wth = wth_create_thread("modinit", WTH_PRIO_LOWEST, MODS_MAX);
+   }
+   enable_preemption();
+
+   if (!mods_wth)
+      printk("WARNING: modules: no worker thread, async init disabled\n");
+}
+
 void init_modules(void)
 {
+   int started = 0, i;
+
    insertion_sort_ptr(modules, (u32)mods_count, &mod_cmp_func);
+   kmutex_init(&mods_mutex, 0);
+   kcond_init(&mods_cond);
 
-   for (int i = 0; i < mods_count; i++) {
-      struct module *m = modules[i];
-      printk("*** Init kernel module: %s\n", m->name);
-      m->init();
+   if (!kopt_no_par_mods)
+      create_mods_worker();
+
+   kmutex_lock(&mods_mutex);
+
+   while (started < mods_count) {
+
+      started += mods_start_async();
+
+      if ((i = mods_find_ready()) >= 0) {
+
+         mods_state[i] = MOD_RUNNING;
+         mods_running++;
+         started++;
+         mod_run_inline(i);
+         continue;
+      }
+
+      if (started == mods_count)
+         break;
+
+      if (!mods_running)
+         panic("modules: unsatisfiable dependencies between modules");
+
+      kcond_wait(&mods_cond, &mods_mutex, KCOND_WAIT_FOREVER);
    }
+
+   /* Wait for the async modules still running */
+   while (mods_running)
+      kcond_wait(&mods_cond, &mods_mutex, KCOND_WAIT_FOREVER);
+
+   kmutex_unlock(&mods_mutex);
+   kcond_destory(&mods_cond);
+   kmutex_destroy(&mods_mutex);
 }
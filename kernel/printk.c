@@ -13,6 +13,9 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/worker_thread.h>
 
 #define PRINTK_BUF_SZ                         224
 #define PRINTK_PREFIXBUF_SZ                   32
@@ -26,46 +29,39 @@
 
 
 #define PRINTK_COLOR                          COLOR_GREEN
-#define PRINTK_RINGBUF_FLUSH_COLOR            COLOR_CYAN
-#define PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR    COLOR_MAGENTA
+#define PRINTK_DROPPED_COLOR                  COLOR_MAGENTA
 #define PRINTK_PANIC_COLOR                    COLOR_RED
 
-struct ringbuf_stat {
+/* Max records not flushed yet before printk() starts flushing them inline */
+#define PRINTK_MAX_BACKLOG                    (KMSG_RECORDS / 2)
 
-   union {
+STATIC_ASSERT(PRINTK_BUF_SZ <= KMSG_TEXT_MAX);
 
-      struct {
-         u32 read_pos              : 14;
-         u32 write_pos             : 14;
-         u32 full                  :  1;
-         u32 first_printk          :  1;
-         u32 newline               :  1;
-         u32 unused0               :  1;
-      };
-
-      ATOMIC(u32) raw;
-      u32 __raw;
-   };
-};
-
-#if TINY_KERNEL
-   static char printk_rbuf[2 * KB];
-#else
-   static char printk_rbuf[8 * KB];
-#endif
-
-static volatile struct ringbuf_stat printk_rbuf_stat =
-{
-   .newline = 1
-};
+/*
+ * Console flushing
+ *
+ * printk() appends a record to the kernel log store (see kmsg.c) and then
+ * flushes on the console all the records not written yet. Once the boot is
+ * complete, that is done by a dedicated worker thread: this way, slow consoles
+ * like the serial port or the framebuffer don't slow down the code calling
+ * printk(). Records are flushed synchronously anyway when:
+ *
+ *    - the worker thread doesn't exist (yet)
+ *    - we're in panic or in the kernel shutdown
+ *    - too many records are waiting (see PRINTK_MAX_BACKLOG)
+ *
+ * Only one context at a time can flush (the one owning `console_busy`): the
+ * others just leave their records in the store, because the owner checks for
+ * new records before returning.
+ */
 
 bool __in_printk;
 
-/*
- * NOTE: the ring buf cannot be larger than 16K elems because of the size of the
- * read_pos and write_pos bit-fields.
- */
-STATIC_ASSERT(sizeof(printk_rbuf) <= 16 * KB);
+static ATOMIC(bool) console_busy;
+static ATOMIC(bool) flush_job_pending;
+static ATOMIC(bool) last_had_newline = true;
+static u32 console_seq = 1;                /* next record to flush */
+static struct worker_thread *printk_wth;
 
 static void
 printk_direct_flush_no_tty(const char *buf, size_t size, u8 color)
@@ -85,7 +81,7 @@ printk_direct_flush_no_tty(const char *buf, size_t size, u8 color)
 }
 
 static void
-printk_direct_flush(const char *buf, size_t size, u8 color)
+printk_direct_flush(struct tty *t, const char *buf, size_t size, u8 color)
 {
    if (!size)
       return;
@@ -98,10 +94,10 @@ printk_direct_flush(const char *buf, size_t size, u8 color)
 
          if (UNLIKELY(in_kernel_shutdown()))
             tty_write_on_all_ttys(buf, size);
-         else if (KRN_PRINTK_ON_CURR_TTY || !get_curr_process_tty())
-            term_write(buf, size, color);
+         else if (t)
+            tty_kernel_write(t, buf, size);
          else
-            tty_curr_proc_write(buf, size);
+            term_write(buf, size, color);
 
       } else {
 
@@ -112,150 +108,201 @@ printk_direct_flush(const char *buf, size_t size, u8 color)
    return;
 }
 
-static ALWAYS_INLINE u32
-printk_calc_used(const struct ringbuf_stat *cs)
+static void
+printk_flush_record(const struct kmsg_record *r, char *prefixbuf)
 {
-   u32 used = (cs->write_pos - cs->read_pos) % sizeof(printk_rbuf);
+   int prefix_sz = 0;
+   u8 color = PRINTK_COLOR;
+
+   if (r->level == KMSG_LVL_EMERG && in_panic())
+      color = in_panic_debugger() ? DEFAULT_FG_COLOR : PRINTK_PANIC_COLOR;
 
-   if (!used)
-      used = cs->full ? sizeof(printk_rbuf) : 0;
+   if (!(r->flags & (KMSG_FL_CONT | KMSG_FL_NO_PREFIX))) {
 
-   return used;
+      prefix_sz = snprintk(
+         prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
+         (u32)(r->ts / TS_SCALE),
+         (u32)((r->ts % TS_SCALE) / (TS_SCALE / 1000)),
+         (r->flags & KMSG_FL_LOWSS) ? "[LOWSS] " : ""
+      );
+   }
+
+   printk_direct_flush(r->tty, prefixbuf, (size_t)prefix_sz, color);
+   printk_direct_flush(r->tty, r->text, r->len, color);
 }
 
-static void
-__printk_flush_ringbuf(char *tmpbuf, u32 buf_size)
+static void printk_flush_dropped(u32 count)
 {
-   struct ringbuf_stat cs, ns;
-   u32 used, to_read = 0;
+   char buf[32];
+   int rc = snprintk(buf, sizeof(buf), "{_DROPPED_ %u}\n", count);
+   printk_direct_flush(NULL, buf, (size_t)rc, PRINTK_DROPPED_COLOR);
+}
 
-   while (true) {
+/*
+ * Flushes all the committed records, starting from `console_seq`. Called while
+ * owning `console_busy`, except in panic, when we stop caring about the other
+ * contexts. For the same reason, in panic, records not committed yet are just
+ * skipped: their writers won't ever get the chance to commit them.
+ */
+static void printk_console_drain(void)
+{
+   static struct kmsg_record rec;
+   static char prefixbuf[PRINTK_PREFIXBUF_SZ];
+   u32 first;
+   int rc;
 
-      do {
-         cs = printk_rbuf_stat;
-         ns = printk_rbuf_stat;
-         used = printk_calc_used(&cs);
+   while (true) {
 
-         /* We can read at most 'buf_size' bytes at a time */
-         to_read = UNSAFE_MIN(buf_size, used);
+      first = kmsg_first_seq();
 
-         /* And copy them to our minibuf */
-         for (u32 i = 0; i < to_read; i++)
-            tmpbuf[i] = printk_rbuf[(cs.read_pos + i) % sizeof(printk_rbuf)];
+      if (UNLIKELY(console_seq < first)) {
+         printk_flush_dropped(first - console_seq);
+         console_seq = first;
+      }
 
-         /* Increase read_pos and decrease used */
-         ns.read_pos = (ns.read_pos + to_read) % sizeof(printk_rbuf);
+      disable_preemption();
+      {
+         if (!(rc = kmsg_read(console_seq, &rec)))
+            printk_flush_record(&rec, prefixbuf);
+      }
+      enable_preemption();
 
-         if (!to_read)
-            ns.first_printk = 0;
+      if (rc == -EPIPE)
+         continue;      /* Overwritten: handled at the next iteration */
 
-         /* Repeat that until we were able to do that atomically */
+      if (rc == -ENOENT && (!in_panic() || console_seq >= kmsg_next_seq()))
+         break;
 
-      } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                                &cs.__raw,
-                                ns.__raw,
-                                mo_relaxed,
-                                mo_relaxed));
+      console_seq++;
+   }
+}
 
-      /* Note: we checked that `first_printk` in `cs` was unset! */
-      if (!to_read)
-         break;
+static void printk_console_flush(void)
+{
+   bool busy;
 
-      printk_direct_flush(tmpbuf, to_read, PRINTK_RINGBUF_FLUSH_COLOR);
+   if (UNLIKELY(in_panic())) {
+      printk_console_drain();
+      return;
    }
+
+   do {
+
+      busy = false;
+
+      if (!atomic_cas_strong(&console_busy, &busy, true,
+                             mo_acquire, mo_relaxed))
+      {
+         /* Someone else is flushing: it will take care of our record too */
+         return;
+      }
+
+      printk_console_drain();
+      atomic_store_explicit(&console_busy, false, mo_release);
+
+      /*
+       * Records appended after the drain stopped, but before we released
+       * `console_busy`, have been left to us by their writers.
+       */
+
+   } while (kmsg_peek(console_seq) != -ENOENT);
 }
 
 void
 printk_flush_ringbuf(void)
 {
-   char minibuf[80];
-   __printk_flush_ringbuf(minibuf, sizeof(minibuf));
+   printk_console_flush();
 }
 
-static void printk_append_to_ringbuf(const char *buf, size_t size)
+static void printk_flush_job(void *arg)
 {
-   static const char err_msg[] = "{_DROPPED_}\n";
-   struct ringbuf_stat cs, ns;
-   u32 used;
+   atomic_store_explicit(&flush_job_pending, false, mo_relaxed);
+   printk_console_flush();
+}
 
-   if (!size)
-      return;
+static bool printk_must_flush_sync(void)
+{
+   if (!printk_wth || in_panic() || in_kernel_shutdown())
+      return true;
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      used = printk_calc_used(&cs);
+   if (get_curr_task() == wth_get_task(printk_wth))
+      return true;
 
-      if (used + size >= sizeof(printk_rbuf)) {
+   return kmsg_next_seq() - console_seq >= PRINTK_MAX_BACKLOG;
+}
 
-         /* Corner case: the ring buffer is full */
+static void printk_flush(void)
+{
+   bool pending = false;
 
-         if (term_is_initialized()) {
-            printk_direct_flush(buf, size, PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR);
-            return;
-         }
+   if (!term_is_initialized())
+      return; /* printk_flush_ringbuf() will be called after the term init */
 
-         if (buf != err_msg && used < sizeof(printk_rbuf) - 1) {
-            size = MIN(sizeof(printk_rbuf) - used - 1, sizeof(err_msg));
-            printk_append_to_ringbuf(err_msg, size);
-         }
+   if (printk_must_flush_sync()) {
+      printk_console_flush();
+      return;
+   }
 
-         return;
-      }
+   if (!atomic_cas_strong(&flush_job_pending, &pending, true,
+                          mo_relaxed, mo_relaxed))
+   {
+      return; /* There's already a flush job in the queue */
+   }
+
+   if (!wth_enqueue_on(printk_wth, &printk_flush_job, NULL)) {
+      atomic_store_explicit(&flush_job_pending, false, mo_relaxed);
+      printk_console_flush();
+   }
+}
 
-      ns.write_pos = (ns.write_pos + size) % sizeof(printk_rbuf);
+static struct tty *printk_get_tty(void)
+{
+   if (KRN_PRINTK_ON_CURR_TTY || !get_curr_tty())
+      return NULL;
+
+   return get_curr_process_tty();
+}
 
-      if (ns.write_pos == ns.read_pos)
-         ns.full = 1;
+static void
+printk_log_record(u8 level, u8 flags, const char *buf, u32 len)
+{
+   const bool newline = len > 0 && buf[len - 1] == '\n';
 
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
+   if (!len)
+      return;
 
-   // Now we have some allocated space in the ringbuf
+   if (!atomic_exchange_explicit(&last_had_newline, newline, mo_relaxed))
+      flags |= KMSG_FL_CONT;
 
-   for (u32 i = 0; i < size; i++)
-      printk_rbuf[(cs.write_pos + i) % sizeof(printk_rbuf)] = buf[i];
+   kmsg_append(level, flags, printk_get_tty(), buf, len);
+   printk_flush();
 }
 
-/*
- * Sets atomically first_printk=1 and returns the old ringbuf_stat.
- */
-static struct ringbuf_stat
-try_set_first_printk_on_stack(bool newline)
+void printk_log_text(u8 level, const char *text, u32 len)
 {
-   struct ringbuf_stat cs, ns;
+   char buf[KMSG_TEXT_MAX];
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 1;
-      ns.newline = newline;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
-
-   return cs;
+   /* Each write to /dev/kmsg is a whole line */
+   len = MIN(len, (u32)sizeof(buf) - 1);
+   memcpy(buf, text, len);
+
+   if (!len || buf[len - 1] != '\n')
+      buf[len++] = '\n';
+
+   printk_log_record(level, 0, buf, len);
 }
 
-static void
-restore_first_printk_value(void)
+void init_printk_async_flush(void)
 {
-   struct ringbuf_stat cs, ns;
+   disable_preemption();
+   {
+      printk_wth =
+         wth_create_thread("printk", 3 /* priority */, WTH_PRINTK_QUEUE_SIZE);
+   }
+   enable_preemption();
 
-   do {
-      cs = printk_rbuf_stat;
-      ns = printk_rbuf_stat;
-      ns.first_printk = 0;
-   } while (!atomic_cas_weak(&printk_rbuf_stat.raw,
-                             &cs.__raw,
-                             ns.__raw,
-                             mo_relaxed,
-                             mo_relaxed));
+   if (!printk_wth)
+      printk("WARNING: printk: unable to create the flush thread\n");
 }
 
 STATIC int
@@ -283,17 +330,11 @@ vsnprintk_with_truc_suffix(char *buf, u32 bufsz, const char *fmt, va_list args)
 }
 
 static void
-__tilck_vprintk(char *prefixbuf,
-                char *buf,
-                u32 bufsz,
-                u32 flags,
-                const char *fmt,
-                va_list args)
+__tilck_vprintk(char *buf, u32 bufsz, u32 flags, const char *fmt, va_list args)
 {
-   bool prefix = !in_panic();
-   bool has_newline = false;
-   struct ringbuf_stat old;
-   int written, prefix_sz = 0;
+   u8 level = KMSG_LVL_INFO;
+   u8 kflags = 0;
+   int written;
 
    if (fmt[0] == PRINTK_CTRL_CHAR) {
 
@@ -305,116 +346,46 @@ __tilck_vprintk(char *prefixbuf,
          /* NO_PREFIX is not empty, so we're not in unit tests */
 
          if (cmd == NO_PREFIX[1])
-            prefix = false;
+            kflags |= KMSG_FL_NO_PREFIX;
       }
    }
 
    if (flags & PRINTK_FL_NO_PREFIX)
-      prefix = false;
-
-   written = vsnprintk_with_truc_suffix(buf, bufsz, fmt, args);
-
-   for (int i = 0; i < written; i++) {
-      if (buf[i] == '\n') {
-         has_newline = true;
-         break;
-      }
-   }
-
-   old = try_set_first_printk_on_stack(has_newline);
+      kflags |= KMSG_FL_NO_PREFIX;
 
-   if (prefix && old.newline) {
-
-      const u64 systime = get_sys_time();
-
-      prefix_sz = snprintk(
-         prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
-         (u32)(systime / TS_SCALE),
-         (u32)((systime % TS_SCALE) / (TS_SCALE / 1000)),
-         bufsz < PRINTK_BUF_SZ ? "[LOWSS] " : ""
-      );
-
-   } else {
-
-      prefix = false;
-   }
-
-
-   if (!term_is_initialized()) {
-      printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-      printk_append_to_ringbuf(buf, (size_t) written);
-      restore_first_printk_value();
-      return;
-   }
+   if (bufsz < PRINTK_BUF_SZ)
+      kflags |= KMSG_FL_LOWSS;
 
    if (in_panic()) {
-      u8 color = in_panic_debugger() ? DEFAULT_FG_COLOR : PRINTK_PANIC_COLOR;
-      printk_direct_flush(buf, (size_t) written, color);
-      restore_first_printk_value();
-      return;
+      level = KMSG_LVL_EMERG;
+      kflags |= KMSG_FL_NO_PREFIX;
    }
 
-   disable_preemption();
-   {
-      if (!old.first_printk) {
-
-         /*
-          * OK, we were the first. Now, flush our buffer directly and loop
-          * flushing anything that, in the meanwhile, printk() calls from IRQs
-          * generated.
-          */
-
-         printk_direct_flush(prefixbuf, (size_t) prefix_sz, PRINTK_COLOR);
-         printk_direct_flush(buf, (size_t) written, PRINTK_COLOR);
-         __printk_flush_ringbuf(buf, bufsz);
-
-         /*
-          * No need to call restore_first_printk_value(): printk_flush_ringbuf
-          * clears the `first_printk` bit for us.
-          */
-
-      } else {
-
-         /*
-          * We were NOT the first printk on the stack: we're in an IRQ handler
-          * and can only append our data to the ringbuf. On return, at some
-          * point, the first printk(), in printk_flush_ringbuf() [case above]
-          * will flush our data.
-          */
-
-         printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
-         printk_append_to_ringbuf(buf, (size_t) written);
-      }
-   }
-   enable_preemption();
+   written = vsnprintk_with_truc_suffix(buf, bufsz, fmt, args);
+   printk_log_record(level, kflags, buf, (u32)written);
 }
 
 static void
 __regular_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[PRINTK_BUF_SZ];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 static void
 __low_ssp_tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   char prefixbuf[PRINTK_PREFIXBUF_SZ];
    char buf[64];
-
-   __tilck_vprintk(prefixbuf, buf, sizeof(buf), flags, fmt, args);
+   __tilck_vprintk(buf, sizeof(buf), flags, fmt, args);
 }
 
 void
 tilck_vprintk(u32 flags, const char *fmt, va_list args)
 {
-   static char p_prefixbuf[PRINTK_PREFIXBUF_SZ];
    static char p_buf[PRINTK_BUF_SZ];
 
    if (in_panic())
-      __tilck_vprintk(p_prefixbuf, p_buf, sizeof(p_buf), flags, fmt, args);
+      __tilck_vprintk(p_buf, sizeof(p_buf), flags, fmt, args);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE)
       panic("No stack space for vprintk(\"%s\")", fmt);
    else if (get_rem_stack() < PRINTK_SAFE_STACK_SPACE + 512)
@@ -135,9 +135,7 @@ void process_free_mappings_info(struct process *pi)
    struct mappings_info *mi = pi->mi;
 
    if (mi && !pi->vforked) {
-      ASSERT(mi->mmap_heap);
-      kmalloc_destroy_heap(mi->mmap_heap);
-      kfree2(mi->mmap_heap, kmalloc_get_heap_struct_size());
+      user_vspace_destroy(mi);
       kfree_obj(mi, struct mappings_info);
       pi->mi = NULL;
    }
@@ -248,7 +246,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
       pi->vforked = true;
    }
 
-   pi->inherited_mmap_heap = !!pi->mi;
+   pi->inherited_mi = !!pi->mi;
    ti->pi = pi;
    ti->tid = pid;
    ti->is_main_thread = true;
@@ -266,6 +264,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
 
    /* Reset sched ticks in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
+   SYSCALL_STATS_ONLY(bzero(&ti->sys_stats, sizeof(ti->sys_stats)));
 
    /* Copy parent's `cwd` while retaining the `fs` and the inode obj */
    process_set_cwd2_nolock_raw(pi, &parent_pi->cwd);
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/hal.h>
+
+/*
+ * The samples are written only by the timer IRQ handler. Each one is written
+ * completely before incrementing `count`: readers taking a snapshot of `count`
+ * with the interrupts disabled can safely copy all the samples below it.
+ */
+
+static struct prof_sample *samples;
+static volatile bool enabled;
+static u32 count;
+static u32 lost;
+
+/*
+ * Walk the frame pointers of the interrupted kernel code. Since we're in IRQ
+ * context, we cannot afford to fault: follow only frames inside the kernel
+ * stack of the current task.
+ */
+static u16 prof_backtrace(regs_t *r, ulong *frames)
+{
+   const ulong stack_lo = (ulong)get_curr_task()->kernel_stack;
+   const ulong stack_hi = stack_lo + KERNEL_STACK_SIZE;
+   ulong fp = (ulong)regs_get_frame_ptr(r);
+   ulong ret;
+   u16 n = 0;
+
+   while (n < PROF_MAX_FRAMES) {
+
+      if (fp < stack_lo || fp + 2 * sizeof(ulong) > stack_hi)
+         break;
+
+      if (fp & (sizeof(ulong) - 1))
+         break;
+
+      ret = ((ulong *)fp)[1];
+
+      if (ret < KERNEL_BASE_VA)
+         break;
+
+      frames[n++] = ret;
+
+      if (((ulong *)fp)[0] <= fp)
+         break;   /* the stack grows downwards: the next fp must be higher */
+
+      fp = ((ulong *)fp)[0];
+   }
+
+   return n;
+}
+
+void prof_timer_tick(void)
+{
+   struct prof_sample *s;
+   regs_t *r;
+
+   if (LIKELY(!enabled))
+      return;
+
+   if (count == PROF_MAX_SAMPLES) {
+      lost++;
+      return;
+   }
+
+   r = get_irq_regs();
+   s = &samples[count];
+
+   s->ip = (ulong)regs_get_ip(r);
+   s->tid = get_curr_tid();
+   s->flags = 0;
+   s->depth = 0;
+
+   if (s->ip < KERNEL_BASE_VA)
+      s->flags |= PROF_SAMPLE_USER;
+   else
+      s->depth = prof_backtrace(r, s->frames);
+
+   count++;
+}
+
+int prof_start(void)
+{
+   struct prof_sample *buf = NULL;
+   ulong var;
+
+   if (!samples) {
+      if (!(buf = kalloc_array_obj(struct prof_sample, PROF_MAX_SAMPLES)))
+         return -ENOMEM;
+   }
+
+   disable_interrupts(&var);
+   {
+      if (!samples) {
+         samples = buf;
+         buf = NULL;
+      }
+
+      count = 0;
+      lost = 0;
+      enabled = true;
+   }
+   enable_interrupts(&var);
+
+   if (buf) {
+      /* Somebody else allocated the buffer in the meanwhile */
+      kfree_array_obj(buf, struct prof_sample, PROF_MAX_SAMPLES);
+   }
+
+   return 0;
+}
+
+void prof_stop(void)
+{
+   enabled = false;
+}
+
+void prof_get_info(struct prof_info *info)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      info->enabled = enabled;
+      info->count = count;
+      info->lost = lost;
+   }
+   enable_interrupts(&var);
+}
+
+u32 prof_get_samples(struct prof_sample *buf, u32 start, u32 max)
+{
+   struct prof_info info;
+   u32 n;
+
+   prof_get_info(&info);
+
+   if (start >= info.count)
+      return 0;
+
+   n = MIN(info.count - start, max);
+   memcpy(buf, samples + start, n * sizeof(struct prof_sample));
+   return n;
+}
@@ -5,6 +5,7 @@
 
 #include <tilck/kernel/ringbuf.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/hal.h>
 
 extern inline void ringbuf_reset(struct ringbuf *rb);
 extern inline bool ringbuf_write_elem1(struct ringbuf *rb, u8 val);
@@ -85,7 +86,7 @@ size_t ringbuf_write_bytes(struct ringbuf *rb, u8 *buf, size_t len)
    if (rb->write_pos < rb->read_pos) {
 
       actual_len = MIN(len, rb->read_pos - rb->write_pos);
-      memcpy(rb->buf + rb->write_pos, buf, actual_len);
+      kmemcpy(rb->buf + rb->write_pos, buf, actual_len);
       rb->write_pos += actual_len;
       rb->elems += actual_len;
       return actual_len;
@@ -93,7 +94,7 @@ size_t ringbuf_write_bytes(struct ringbuf *rb, u8 *buf, size_t len)
 
    /* Part one */
    actual_len = MIN(len, rb->max_elems - rb->write_pos);
-   memcpy(rb->buf + rb->write_pos, buf, actual_len);
+   kmemcpy(rb->buf + rb->write_pos, buf, actual_len);
    rb->write_pos = (rb->write_pos + actual_len) % rb->max_elems;
    rb->elems += actual_len;
 
@@ -106,7 +107,7 @@ size_t ringbuf_write_bytes(struct ringbuf *rb, u8 *buf, size_t len)
    /* Part two */
    ASSERT(rb->write_pos == 0);
    actual_len2 = MIN(len - actual_len, rb->read_pos);
-   memcpy(rb->buf, buf + actual_len, actual_len2);
+   kmemcpy(rb->buf, buf + actual_len, actual_len2);
    rb->write_pos += actual_len2;
    rb->elems += actual_len2;
 
@@ -152,7 +153,7 @@ size_t ringbuf_read_bytes(struct ringbuf *rb, u8 *buf, size_t len)
    if (rb->read_pos < rb->write_pos) {
 
       actual_len = MIN(len, rb->write_pos - rb->read_pos);
-      memcpy(buf, rb->buf + rb->read_pos, actual_len);
+      kmemcpy(buf, rb->buf + rb->read_pos, actual_len);
       rb->read_pos += actual_len;
       rb->elems -= actual_len;
       return actual_len;
@@ -160,7 +161,7 @@ size_t ringbuf_read_bytes(struct ringbuf *rb, u8 *buf, size_t len)
 
    /* Part one */
    actual_len = MIN(len, rb->max_elems - rb->read_pos);
-   memcpy(buf, rb->buf + rb->read_pos, actual_len);
+   kmemcpy(buf, rb->buf + rb->read_pos, actual_len);
    rb->read_pos = (rb->read_pos + actual_len) % rb->max_elems;
    rb->elems -= actual_len;
 
@@ -173,7 +174,7 @@ size_t ringbuf_read_bytes(struct ringbuf *rb, u8 *buf, size_t len)
    /* Part two */
    ASSERT(rb->read_pos == 0);
    actual_len2 = MIN(len - actual_len, rb->write_pos);
-   memcpy(buf + actual_len, rb->buf, actual_len2);
+   kmemcpy(buf + actual_len, rb->buf, actual_len2);
    rb->read_pos += actual_len2;
    rb->elems -= actual_len2;
 
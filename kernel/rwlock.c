@@ -3,9 +3,16 @@
 #include <tilck/kernel/rwlock.h>
 #include <tilck/kernel/sched.h>
 
+/*
+ * NOTE: the kmutex objects internal to the rwlocks don't collect statistics
+ * (KMUTEX_FL_NO_LOCKSTAT): all of them would be accounted to call sites in
+ * this file. The rwlock functions collect their own statistics instead, keyed
+ * by their call site.
+ */
+
 void rwlock_rp_init(struct rwlock_rp *r)
 {
-   kmutex_init(&r->readers_lock, 0);
+   kmutex_init(&r->readers_lock, KMUTEX_FL_NO_LOCKSTAT);
    ksem_init(&r->writers_sem, 1, 1);
    r->readers_count = 0;
    DEBUG_ONLY(r->ex_owner = NULL);
@@ -21,12 +28,20 @@ void rwlock_rp_destroy(struct rwlock_rp *r)
 
 void rwlock_rp_shlock(struct rwlock_rp *r)
 {
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
+   LOCKSTAT_ONLY(bool ls_cont);
+
    kmutex_lock(&r->readers_lock);
    {
+      LOCKSTAT_ONLY(ls_cont = !r->readers_count && !r->writers_sem.counter);
+
       if (++r->readers_count == 1)
          ksem_wait(&r->writers_sem, 1, KSEM_WAIT_FOREVER);
    }
    kmutex_unlock(&r->readers_lock);
+
+   LOCKSTAT_ONLY(lockstat_acquired(NULL, LOCKSTAT_SITE(),
+                                   LOCKSTAT_RWLOCK_RP_SH, ls_cont, ls_start));
 }
 
 void rwlock_rp_shunlock(struct rwlock_rp *r)
@@ -41,16 +56,23 @@ void rwlock_rp_shunlock(struct rwlock_rp *r)
 
 void rwlock_rp_exlock(struct rwlock_rp *r)
 {
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
+   LOCKSTAT_ONLY(const bool ls_cont = !r->writers_sem.counter);
+
    ksem_wait(&r->writers_sem, 1, KSEM_WAIT_FOREVER);
 
    ASSERT(r->ex_owner == NULL);
    DEBUG_ONLY(r->ex_owner = get_curr_task());
+
+   LOCKSTAT_ONLY(lockstat_acquired(&r->ls_hold, LOCKSTAT_SITE(),
+                                   LOCKSTAT_RWLOCK_RP_EX, ls_cont, ls_start));
 }
 
 void rwlock_rp_exunlock(struct rwlock_rp *r)
 {
    ASSERT(r->ex_owner == get_curr_task());
    DEBUG_ONLY(r->ex_owner = NULL);
+   LOCKSTAT_ONLY(lockstat_released(&r->ls_hold));
 
    ksem_signal(&r->writers_sem, 1);
 }
@@ -59,7 +81,7 @@ void rwlock_rp_exunlock(struct rwlock_rp *r)
 
 void rwlock_wp_init(struct rwlock_wp *rw, bool recursive)
 {
-   kmutex_init(&rw->m, 0);
+   kmutex_init(&rw->m, KMUTEX_FL_NO_LOCKSTAT);
    kcond_init(&rw->c);
    rw->ex_owner = NULL;
    rw->r = 0;
@@ -78,8 +100,13 @@ void rwlock_wp_destroy(struct rwlock_wp *rw)
 
 void rwlock_wp_shlock(struct rwlock_wp *rw)
 {
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
+   LOCKSTAT_ONLY(bool ls_cont);
+
    kmutex_lock(&rw->m);
    {
+      LOCKSTAT_ONLY(ls_cont = rw->w);
+
       /* Wait until there's at least one writer waiting (they have priority) */
       while (rw->w) {
          kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
@@ -93,6 +120,9 @@ void rwlock_wp_shlock(struct rwlock_wp *rw)
       rw->r++;
    }
    kmutex_unlock(&rw->m);
+
+   LOCKSTAT_ONLY(lockstat_acquired(NULL, LOCKSTAT_SITE(),
+                                   LOCKSTAT_RWLOCK_WP_SH, ls_cont, ls_start));
 }
 
 void rwlock_wp_shunlock(struct rwlock_wp *rw)
@@ -109,14 +139,15 @@ void rwlock_wp_shunlock(struct rwlock_wp *rw)
    kmutex_unlock(&rw->m);
 }
 
-static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
+/* Returns false in case of recursive locking */
+static bool rwlock_wp_exlock_int(struct rwlock_wp *rw)
 {
    if (rw->rec) {
       if (rw->ex_owner == get_curr_task()) {
          ASSERT(rw->w);
          ASSERT(rw->rc >= 1);
          rw->rc++;
-         return;
+         return false;
       }
    }
 
@@ -151,13 +182,24 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
       ASSERT(rw->rc == 0);
       rw->rc++;
    }
+
+   return true;
 }
 
 void rwlock_wp_exlock(struct rwlock_wp *rw)
 {
+   LOCKSTAT_ONLY(const u64 ls_start = lockstat_now());
+   LOCKSTAT_ONLY(bool ls_cont);
+
    kmutex_lock(&rw->m);
    {
-      rwlock_wp_exlock_int(rw);
+      LOCKSTAT_ONLY(ls_cont = rw->w || rw->r > 0);
+
+      if (rwlock_wp_exlock_int(rw)) {
+         LOCKSTAT_ONLY(lockstat_acquired(&rw->ls_hold, LOCKSTAT_SITE(),
+                                         LOCKSTAT_RWLOCK_WP_EX,
+                                         ls_cont, ls_start));
+      }
    }
    kmutex_unlock(&rw->m);
 }
@@ -177,6 +219,7 @@ static void rwlock_wp_exunlock_int(struct rwlock_wp *rw)
          return;
    }
 
+   LOCKSTAT_ONLY(lockstat_released(&rw->ls_hold));
    rw->ex_owner = NULL;
 
    /* The `w` flag must be set */
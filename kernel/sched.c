@@ -40,8 +40,12 @@ const char *const task_state_str[5] = {
 
 void enable_preemption(void)
 {
-   int oldval =
-      atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
+   int oldval;
+
+   if (KERNEL_IRQSOFF_TRACER && get_preempt_disable_count() == 1)
+      irqsoff_preempt_enabled_at((ulong)__builtin_return_address(0));
+
+   oldval = atomic_fetch_sub_explicit(&__disable_preempt, 1, mo_relaxed);
 
    ASSERT(oldval > 0);
 
@@ -25,6 +25,53 @@ void insertion_sort_ptr(void *a, u32 elem_count, cmpfun_ptr cmp)
    }
 }
 
+static void
+heap_sort_sift_down(ulong *arr, u32 root, u32 end, cmpfun_ptr cmp)
+{
+   ulong tmp;
+   u32 child;
+
+   while ((child = 2 * root + 1) < end) {
+
+      if (child + 1 < end && cmp(&arr[child], &arr[child + 1]) < 0)
+         child++;
+
+      if (cmp(&arr[root], &arr[child]) >= 0)
+         break;
+
+      tmp = arr[root];
+      arr[root] = arr[child];
+      arr[child] = tmp;
+      root = child;
+   }
+}
+
+/*
+ * Heap sort for pointer-size "objects". Unlike insertion sort, it's
+ * O(n log n) in the worst case, while still not requiring any extra memory.
+ * NOTE: it's not stable.
+ */
+void heap_sort_ptr(void *a, u32 elem_count, cmpfun_ptr cmp)
+{
+   ulong *arr = a;
+   ulong tmp;
+
+   if (elem_count < 2)
+      return;
+
+   for (u32 i = elem_count / 2; i > 0; i--)
+      heap_sort_sift_down(arr, i - 1, elem_count, cmp);
+
+   for (u32 end = elem_count - 1; end > 0; end--) {
+
+      tmp = arr[0];
+      arr[0] = arr[end];
+      arr[end] = tmp;
+
+      heap_sort_sift_down(arr, 0, end, cmp);
+   }
+}
+
 /*
  * Generic insertion_sort implementation for objects of size 'elem_size'.
  */
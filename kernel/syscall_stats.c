@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+
+#if KERNEL_SYSCALL_STATS
+
+/*
+ * The stats are updated with preemption disabled, which is enough since Tilck
+ * runs on a single CPU. That costs just a few instructions per syscall, while
+ * modules/tracing has to copy the arguments and push an event per call.
+ */
+
+static struct syscall_stats stats[MAX_SYSCALLS];
+
+static inline u32 syscall_hist_bucket(u64 cycles)
+{
+   u32 b;
+
+   if (!cycles)
+      return 0;
+
+   b = 63 - (u32)__builtin_clzll(cycles);
+   return MIN(b, SYSCALL_HIST_BUCKETS - 1);
+}
+
+void syscall_stats_record(u32 sn, u64 start)
+{
+   const u64 cycles = RDTSC() - start;
+   const u32 b = syscall_hist_bucket(cycles);
+   struct task *curr = get_curr_task();
+   struct syscall_stats *s;
+
+   if (sn >= MAX_SYSCALLS)
+      return;
+
+   s = &stats[sn];
+
+   disable_preemption();
+   {
+      s->count++;
+      s->tot_cycles += cycles;
+      s->hist[b]++;
+
+      if (cycles > s->max_cycles)
+         s->max_cycles = cycles;
+
+      curr->sys_stats.count++;
+      curr->sys_stats.tot_cycles += cycles;
+   }
+   enable_preemption();
+}
+
+bool syscall_stats_get(u32 sn, struct syscall_stats *s)
+{
+   if (sn >= MAX_SYSCALLS)
+      return false;
+
+   disable_preemption();
+   {
+      *s = stats[sn];
+   }
+   enable_preemption();
+   return true;
+}
+
+u32 syscall_stats_get_top(u32 *sns, u32 max)
+{
+   u32 n = 0, j;
+
+   if (!max)
+      return 0;
+
+   /*
+    * Keep `sns` sorted while scanning the table: the number of syscalls is
+    * small enough that the O(MAX_SYSCALLS * max) cost does not matter.
+    */
+   disable_preemption();
+   {
+      for (u32 sn = 0; sn < MAX_SYSCALLS; sn++) {
+
+         const u64 tot = stats[sn].tot_cycles;
+
+         if (!stats[sn].count)
+            continue;
+
+         if (n == max && tot <= stats[sns[n - 1]].tot_cycles)
+            continue;
+
+         if (n < max)
+            n++;
+
+         for (j = n - 1; j > 0 && stats[sns[j - 1]].tot_cycles < tot; j--)
+            sns[j] = sns[j - 1];
+
+         sns[j] = sn;
+      }
+   }
+   enable_preemption();
+   return n;
+}
+
+static int reset_task_stats_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   bzero(&ti->sys_stats, sizeof(ti->sys_stats));
+   return 0;
+}
+
+void syscall_stats_reset(void)
+{
+   disable_preemption();
+   {
+      bzero(stats, sizeof(stats));
+      iterate_over_tasks(&reset_task_stats_cb, NULL);
+   }
+   enable_preemption();
+}
+
+#endif // KERNEL_SYSCALL_STATS
@@ -2,6 +2,7 @@
 
 #include <tilck_gen_headers/config_debug.h>
 #include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/self_tests.h>
@@ -13,6 +14,7 @@
 
 typedef int (*tilck_cmd_func)();
 static int sys_tilck_run_selftest(const char *user_selftest);
+static int sys_tilck_find_sym(ulong va, char *u_buf, ulong sz, long *u_off);
 
 static void *tilck_cmds[TILCK_CMD_COUNT] = {
 
@@ -26,6 +28,7 @@ static void *tilck_cmds[TILCK_CMD_COUNT] = {
    [TILCK_CMD_TRACING_TOOL] = NULL,
    [TILCK_CMD_PS_TOOL] = NULL,
    [TILCK_CMD_DEBUGGER_TOOL] = NULL,
+   [TILCK_CMD_FIND_SYM] = sys_tilck_find_sym,
 };
 
 void register_tilck_cmd(int cmd_n, void *func)
@@ -59,6 +62,33 @@ static int sys_tilck_run_selftest(const char *u_selftest)
    return se_run(se);
 }
 
+/*
+ * Resolve the kernel address `va` to the name of the function containing it,
+ * plus the offset from its beginning. Used by user tools like `prof`.
+ */
+static int sys_tilck_find_sym(ulong va, char *u_buf, ulong sz, long *u_off)
+{
+   const char *name;
+   size_t len;
+   long off;
+
+   if (!(name = find_sym_at_addr(va, &off, NULL)))
+      return -ENOENT;
+
+   len = strlen(name) + 1;
+
+   if (len > sz)
+      return -ENAMETOOLONG;
+
+   if (copy_to_user(u_buf, name, len))
+      return -EFAULT;
+
+   if (u_off && copy_to_user(u_off, &off, sizeof(off)))
+      return -EFAULT;
+
+   return 0;
+}
+
 int sys_tilck_cmd(int cmd_n, ulong a1, ulong a2, ulong a3, ulong a4)
 {
    tilck_cmd_func func;
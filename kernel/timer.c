@@ -13,6 +13,8 @@
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/boot_prof.h>
 
 FASTCALL void asm_nop_loop(u32 iters);
 
@@ -335,6 +337,7 @@ static enum irq_action timer_irq_handler(void *ctx)
    enable_interrupts_forced();
 
    sched_account_ticks();
+   prof_timer_tick();
    tick_all_timers();
    return IRQ_HANDLED;
 }
@@ -396,14 +399,17 @@ static void do_bogomips_loop(void *arg)
 {
    void asm_do_bogomips_loop(void);
    struct bogo_measure_ctx *ctx = arg;
+   int bp;
 
    ASSERT(is_preemption_enabled());
+   bp = boot_prof_begin("bogomips", BOOT_PH_ASYNC);
    disable_preemption();
    {
       ctx->started = true;
       asm_do_bogomips_loop();
    }
    enable_preemption();
+   boot_prof_end(bp);
    printk("Tilck bogoMips: %u.%03u\n", loops_per_us, loops_per_ms % 1000);
 }
 
@@ -367,9 +367,9 @@ tty_write_int(struct tty *t,
    return (ssize_t) size;
 }
 
-ssize_t tty_curr_proc_write(const char *buf, size_t size)
+ssize_t tty_kernel_write(struct tty *t, const char *buf, size_t size)
 {
-   return tty_write_int(get_curr_process_tty(), NULL, buf, size);
+   return tty_write_int(t, NULL, buf, size);
 }
 
 void tty_write_on_all_ttys(const char *buf, size_t size)
@@ -244,10 +244,9 @@ tty_keypress_handle_canon_mode(struct tty *t, u32 key, u8 c, bool block)
    }
 }
 
-void tty_send_keyevent(struct tty *t, struct key_event ke, bool block)
+/* Handles a single input char, without waking up the readers in raw mode */
+static void tty_input_char(struct tty *t, u8 c, bool block)
 {
-   u8 c = (u8)ke.print_char;
-
    if (c == '\r') {
 
       if (t->c_term.c_iflag & IGNCR)
@@ -267,14 +266,29 @@ void tty_send_keyevent(struct tty *t, struct key_event ke, bool block)
       return;
 
    if (t->c_term.c_lflag & ICANON) {
-      tty_keypress_handle_canon_mode(t, ke.key, c, block);
+      tty_keypress_handle_canon_mode(t, 0, c, block);
       return;
    }
 
    /* raw mode input handling */
    tty_inbuf_write_elem(t, c, block);
-   kcond_signal_one(&t->input_cond);
-   return;
+}
+
+void tty_send_keyevent(struct tty *t, struct key_event ke, bool block)
+{
+   tty_input_char(t, (u8)ke.print_char, block);
+
+   if (!(t->c_term.c_lflag & ICANON))
+      kcond_signal_one(&t->input_cond);
+}
+
+void tty_send_input(struct tty *t, const char *buf, size_t len, bool block)
+{
+   for (size_t i = 0; i < len; i++)
+      tty_input_char(t, (u8)buf[i], block);
+
+   if (!(t->c_term.c_lflag & ICANON))
+      kcond_signal_one(&t->input_cond);
 }
 
 static int
@@ -4,13 +4,36 @@
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/fault_resumable.h>
 
+/*
+ * Copies `n` bytes where either `dest` or `src` is an user pointer. Large
+ * copies use the FPU: note that the FPU context has to *contain* the
+ * fault-resumable call, because a fault makes the call return immediately,
+ * skipping the code after the copy. CoW faults during the copy are fine too:
+ * in that case, kmemcpy() in handle_potential_cow() won't use the FPU.
+ */
+static int copy_user_buf(void *dest, const void *src, size_t n)
+{
+   u32 r;
+
+   if (fpu_memcpy_begin(dest, src, n)) {
+
+      r = fault_resumable_call(PAGE_FAULT_MASK, fpu_memcpy, 3, dest, src, n);
+      fpu_context_end();
+
+   } else {
+
+      r = fault_resumable_call(PAGE_FAULT_MASK, memcpy, 3, dest, src, n);
+   }
+
+   return !r ? 0 : -1;
+}
+
 int copy_from_user(void *dest, const void *user_ptr, size_t n)
 {
    if (user_out_of_range(user_ptr, n))
       return -1;
 
-   u32 r = fault_resumable_call(PAGE_FAULT_MASK, memcpy, 3, dest, user_ptr, n);
-   return !r ? 0 : -1;
+   return copy_user_buf(dest, user_ptr, n);
 }
 
 int copy_to_user(void *user_ptr, const void *src, size_t n)
@@ -18,8 +41,47 @@ int copy_to_user(void *user_ptr, const void *src, size_t n)
    if (user_out_of_range(user_ptr, n))
       return -1;
 
-   u32 r = fault_resumable_call(PAGE_FAULT_MASK, memcpy, 3, user_ptr, src, n);
-   return !r ? 0 : -1;
+   return copy_user_buf(user_ptr, src, n);
+}
+
+/* Bytes readable at `user_ptr` before reaching the end of the user space */
+static inline size_t user_bytes_avail(const void *user_ptr)
+{
+   return (ulong)user_ptr < KERNEL_BASE_VA
+      ? KERNEL_BASE_VA - (ulong)user_ptr
+      : 0;
+}
+
+static void
+internal_strnlen_user(const char *user_ptr, size_t max_len, size_t *len)
+{
+   ASSERT(in_fault_resumable_code());
+   *len = strnlen(user_ptr, max_len);
+}
+
+/*
+ * Returns the length of the user-space string `user_ptr` (without the final
+ * \0), or `max_len` if there's no \0 in its first `max_len` bytes. Returns -1
+ * if reading the string causes a page fault or if the string goes past the end
+ * of the user space.
+ */
+long strnlen_user(const char *user_ptr, size_t max_len)
+{
+   const size_t avail = user_bytes_avail(user_ptr);
+   size_t len;
+   u32 faults;
+
+   faults = fault_resumable_call(PAGE_FAULT_MASK,
+                                 internal_strnlen_user,
+                                 3,
+                                 user_ptr,
+                                 MIN(max_len, avail),
+                                 &len);
+
+   if (faults || (len == avail && avail < max_len))
+      return -1;
+
+   return (long)len;
 }
 
 static void internal_copy_user_str(void *dest,
@@ -28,30 +90,33 @@ static void internal_copy_user_str(void *dest,
                                    size_t *written_ptr,
                                    int *rc)
 {
-   ASSERT(in_fault_resumable_code());
+   const size_t dest_size = (size_t)((char *)dest_end - (char *)dest);
+   const size_t avail = user_bytes_avail(user_ptr);
+   size_t len;
 
-   const char *ptr = user_ptr;
-   char *d = dest;
+   ASSERT(in_fault_resumable_code());
    *written_ptr = 0;
-   *rc = 0;
 
-   do {
+   len = strnlen(user_ptr, MIN(dest_size, avail));
 
-      if (d >= (char *)dest_end) {
-         *rc = 1;
-         return;
-      }
-
-      if (user_out_of_range(ptr, 1)) {
-         *rc = -1;
-         return;
-      }
+   if (len == dest_size) {
+      /* No space for the final \0: copy what fits, like strncpy() */
+      memcpy(dest, user_ptr, len);
+      *rc = 1;
+      return;
+   }
 
-      *d++ = *ptr; /* NOTE: `ptr` is NOT increased here */
+   if (len == avail) {
+      *rc = -1;   /* The string goes past the end of the user space */
+      return;
+   }
 
-   } while (*ptr++);
+   /* `user_ptr` might be modified meanwhile: don't copy its final \0 */
+   memcpy(dest, user_ptr, len);
+   ((char *)dest)[len] = 0;
 
-   *written_ptr = (size_t)(d - (char *)dest); /* NOTE: counting the final \0 */
+   *written_ptr = len + 1; /* NOTE: counting the final \0 */
+   *rc = 0;
 }
 
 /*
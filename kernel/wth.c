@@ -34,6 +34,52 @@ int wth_get_priority(struct worker_thread *wth)
    return wth->priority;
 }
 
+int wth_get_eff_priority(struct worker_thread *wth)
+{
+   return wth->eff_priority;
+}
+
+bool
+wth_inherit_priority(struct worker_thread *wth, int prio, struct kmutex *m)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (prio >= wth->priority)
+      return false;
+
+   /*
+    * NOTE: we don't keep track of the priority inherited through each mutex:
+    * we just count the mutexes we've inherited a priority from and keep the
+    * highest one until the last of them is released. That might keep us
+    * boosted a little longer than necessary, but never shorter.
+    */
+   if (!(m->flags & KMUTEX_FL_PI_BOOSTED)) {
+      m->flags |= KMUTEX_FL_PI_BOOSTED;
+      wth->pi_mutexes++;
+   }
+
+   if (prio >= wth->eff_priority)
+      return false;
+
+   wth->eff_priority = prio;
+   return true;
+}
+
+void
+wth_drop_inherited_priority(struct worker_thread *wth, struct kmutex *m)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (!(m->flags & KMUTEX_FL_PI_BOOSTED))
+      return;
+
+   m->flags &= ~KMUTEX_FL_PI_BOOSTED;
+   ASSERT(wth->pi_mutexes > 0);
+
+   if (!--wth->pi_mutexes)
+      wth->eff_priority = wth->priority;
+}
+
 const char *
 wth_get_name(struct worker_thread *wth)
 {
@@ -196,7 +242,7 @@ struct task *wth_get_runnable_thread(void)
       struct worker_thread *t = worker_threads[i];
 
       if (t->task->state == TASK_STATE_RUNNABLE)
-         if (!selected || t->priority < selected->priority)
+         if (!selected || t->eff_priority < selected->eff_priority)
             selected = t;
    }
 
@@ -223,6 +269,7 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
    idx = worker_threads_cnt;
    t->name = name;
    t->priority = priority;
+   t->eff_priority = priority;
    t->jobs = kzalloc_array_obj(struct wjob, queue_size);
 
    if (!t->jobs) {
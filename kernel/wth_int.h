@@ -17,6 +17,8 @@ struct worker_thread {
    struct task *task;
    struct kcond completion;
    int priority;              /* 0 is the max priority */
+   int eff_priority;          /* priority, including the inherited one */
+   int pi_mutexes;            /* held mutexes we've inherited a prio from */
    volatile bool waiting_for_jobs;
 };
 
@@ -553,6 +553,8 @@ static struct module acpi_module = {
    .name = "acpi",
    .priority = MOD_acpi_prio,
    .init = &acpi_module_init,
+   .async = true,
+   .deps = { "sysfs", "pci" },
 };
 
 REGISTER_MODULE(&acpi_module);
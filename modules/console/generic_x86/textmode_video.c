@@ -115,6 +115,7 @@ static const struct video_interface ega_text_mode_i =
    NULL, /* redraw_static_elements */
    NULL, /* disable_static_elems_refresh */
    NULL, /* enable_static_elems_refresh */
+   NULL, /* flush_buffers */
 };
 
 void init_textmode_console(void)
@@ -62,13 +62,33 @@ static void term_execute_action(struct vterm *t, struct term_action *a)
    }
 }
 
+/*
+ * Video interfaces drawing on an off-screen buffer need to be told when it's a
+ * good time to make the changes visible. Doing that once per action (instead of
+ * once per char) is what makes such buffers worth it.
+ */
+static ALWAYS_INLINE void term_flush_vi_buffers(struct vterm *t)
+{
+   if (t->vi->flush_buffers)
+      t->vi->flush_buffers();
+}
+
+static void
+term_execute_action_and_flush(struct vterm *t, struct term_action *a)
+{
+   term_execute_action(t, a);
+   term_flush_vi_buffers(t);
+}
+
 static void
 term_execute_or_enqueue_action(struct vterm *t, struct term_action *a)
 {
-   term_execute_or_enqueue_action_template(t,
-                                           &t->rb_data,
-                                           a,
-                                           (void *)&term_execute_action);
+   term_execute_or_enqueue_action_template(
+      t,
+      &t->rb_data,
+      a,
+      (void *)&term_execute_action_and_flush
+   );
 }
 
 static void
@@ -79,6 +99,7 @@ vterm_write(term *t, const char *buf, size_t len, u8 color)
 
    if (in_panic()) {
       term_action_write(t, buf, (u32)len, color);
+      term_flush_vi_buffers(t);
       return;
    }
 
@@ -374,6 +374,7 @@ static void
 term_action_restart_output(struct vterm *const t)
 {
    t->vi = t->saved_vi;
+   render_bind_term(t);
    term_redraw(t);
 
    if (t->scroll == t->max_scroll)
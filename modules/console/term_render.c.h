@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Deferred rendering
+ * --------------------
+ *
+ * When enabled (kopt_deferred_render), video terms don't draw anything while
+ * executing their actions: their `vi` is `deferred_vi`, which just records the
+ * damaged rows and the cursor's state. The actual video interface (render_vi)
+ * is used by a job running on a dedicated worker thread, at most
+ * TERM_RENDER_FPS times per second: it repaints the damaged rows with set_row()
+ * reading their content directly from the term's buffer. This way, the write
+ * throughput of the term does not depend on how expensive is to draw on the
+ * screen and, in particular, to scroll it.
+ *
+ * Until the worker thread exists (early boot) and when we're in panic,
+ * deferred_vi just forwards everything to render_vi.
+ *
+ * NOTE: at most one term at a time uses `deferred_vi` (all the others use
+ * `no_output_vi`), therefore the render state can be global.
+ */
+
+static const struct video_interface *render_vi;
+static struct worker_thread *render_wth;
+
+static struct {
+
+   struct vterm *t;                       /* the term using deferred_vi */
+   bool damaged[TERM_RENDER_MAX_ROWS];
+   bool job_pending;
+
+   bool cursor_enabled;
+   u16 cursor_row;
+   u16 cursor_col;
+   u8 cursor_color;
+
+   u64 last_render_ticks;
+
+} rstate;
+
+static ALWAYS_INLINE bool render_passthrough(void)
+{
+   return !render_wth || in_panic();
+}
+
+static void vterm_render_job(void *arg);
+
+/* NOTE: it must be called with interrupts disabled */
+static void render_schedule(void)
+{
+   if (rstate.job_pending)
+      return;
+
+   /*
+    * In the (theoretical) case the queue is full, the next change to the term
+    * will retry to enqueue the job.
+    */
+   rstate.job_pending = wth_enqueue_on(render_wth, &vterm_render_job, NULL);
+}
+
+static void render_damage_rows(u16 start, u16 end)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      for (u16 r = start; r < end; r++)
+         rstate.damaged[r] = true;
+
+      render_schedule();
+   }
+   enable_interrupts(&var);
+}
+
+static void render_set_cursor(bool enabled, u16 row, u16 col, int color)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      rstate.cursor_enabled = enabled;
+      rstate.cursor_row = row;
+      rstate.cursor_col = col;
+
+      if (color >= 0)
+         rstate.cursor_color = (u8)color;
+
+      if (!render_passthrough())
+         render_schedule();
+   }
+   enable_interrupts(&var);
+}
+
+static void dvi_set_char_at(u16 row, u16 col, u16 entry)
+{
+   if (render_passthrough())
+      return render_vi->set_char_at(row, col, entry);
+
+   render_damage_rows(row, row + 1);
+}
+
+static void dvi_set_row(u16 row, u16 *data, bool fpu_allowed)
+{
+   if (render_passthrough())
+      return render_vi->set_row(row, data, fpu_allowed);
+
+   render_damage_rows(row, row + 1);
+}
+
+static void dvi_clear_row(u16 row, u8 color)
+{
+   if (render_passthrough())
+      return render_vi->clear_row(row, color);
+
+   render_damage_rows(row, row + 1);
+}
+
+static void dvi_move_cursor(u16 row, u16 col, int color)
+{
+   render_set_cursor(rstate.cursor_enabled, row, col, color);
+
+   if (render_passthrough())
+      render_vi->move_cursor(row, col, color);
+}
+
+static void dvi_enable_cursor(void)
+{
+   render_set_cursor(true, rstate.cursor_row, rstate.cursor_col, -1);
+
+   if (render_passthrough())
+      render_vi->enable_cursor();
+}
+
+static void dvi_disable_cursor(void)
+{
+   render_set_cursor(false, rstate.cursor_row, rstate.cursor_col, -1);
+
+   if (render_passthrough())
+      render_vi->disable_cursor();
+}
+
+static void dvi_scroll_one_line_up(void)
+{
+   struct vterm *const t = rstate.t;
+
+   if (!render_passthrough())
+      return render_damage_rows(0, t->rows);
+
+   if (render_vi->scroll_one_line_up)
+      render_vi->scroll_one_line_up();
+   else
+      term_redraw(t);
+}
+
+static void dvi_redraw_static_elements(void)
+{
+   if (render_vi->redraw_static_elements)
+      render_vi->redraw_static_elements();
+}
+
+static void dvi_disable_static_elems_refresh(void)
+{
+   if (render_vi->disable_static_elems_refresh)
+      render_vi->disable_static_elems_refresh();
+}
+
+static void dvi_enable_static_elems_refresh(void)
+{
+   if (render_vi->enable_static_elems_refresh)
+      render_vi->enable_static_elems_refresh();
+}
+
+static void dvi_flush_buffers(void)
+{
+   if (render_passthrough() && render_vi->flush_buffers)
+      render_vi->flush_buffers();
+}
+
+static const struct video_interface deferred_vi =
+{
+   dvi_set_char_at,
+   dvi_set_row,
+   dvi_clear_row,
+   dvi_move_cursor,
+   dvi_enable_cursor,
+   dvi_disable_cursor,
+   dvi_scroll_one_line_up,
+   dvi_redraw_static_elements,
+   dvi_disable_static_elems_refresh,
+   dvi_enable_static_elems_refresh,
+   dvi_flush_buffers,
+};
+
+/* Called when `t` gets back on the screen (see restart_output) */
+static void render_bind_term(struct vterm *t)
+{
+   ulong var;
+
+   if (t->vi != &deferred_vi)
+      return;
+
+   disable_interrupts(&var);
+   {
+      rstate.t = t;
+   }
+   enable_interrupts(&var);
+}
+
+static void
+render_damaged_rows(struct vterm *t, bool *damaged)
+{
+   const bool fpu_allowed = !in_panic();
+   const struct video_interface *const vi = render_vi;
+
+   /*
+    * Hide the cursor while repainting the rows: that's necessary because some
+    * video interfaces (fb_console) save the content under the cursor in order
+    * to restore it later.
+    */
+   vi->disable_cursor();
+
+   if (fpu_allowed)
+      fpu_context_begin();
+
+   for (u16 row = 0; row < t->rows; row++) {
+      if (damaged[row])
+         vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+   }
+
+   if (fpu_allowed)
+      fpu_context_end();
+
+   if (rstate.cursor_enabled) {
+      vi->enable_cursor();
+      vi->move_cursor(rstate.cursor_row,
+                      rstate.cursor_col,
+                      rstate.cursor_color);
+   }
+
+   if (vi->flush_buffers)
+      vi->flush_buffers();
+}
+
+static void vterm_render_job(void *arg)
+{
+   static bool damaged[TERM_RENDER_MAX_ROWS];
+
+   const u64 frame_ticks = MAX(TIMER_HZ / TERM_RENDER_FPS, 1);
+   const u64 elapsed = get_ticks() - rstate.last_render_ticks;
+   struct vterm *t;
+   ulong var;
+
+   /* Bound the frame rate: changes made meanwhile will be rendered together */
+   if (elapsed < frame_ticks)
+      kernel_sleep(frame_ticks - elapsed);
+
+   disable_interrupts(&var);
+   {
+      t = rstate.t;
+      memcpy(damaged, rstate.damaged, sizeof(damaged));
+      bzero(rstate.damaged, sizeof(rstate.damaged));
+      rstate.job_pending = false;
+   }
+   enable_interrupts(&var);
+
+   /*
+    * Holding term's lock guarantees that no regular action is in progress. The
+    * actions executed with preemption disabled (e.g. in IRQ context) don't take
+    * the lock, but all they can do on screen is to damage rows (again), after
+    * having changed the buffer: that will just trigger another render.
+    */
+   kmutex_lock(&t->rb_data.lock);
+   {
+      /* Check that the term is still on screen (see pause_output) */
+      if (t->vi == &deferred_vi)
+         render_damaged_rows(t, damaged);
+   }
+   kmutex_unlock(&t->rb_data.lock);
+
+   rstate.last_render_ticks = get_ticks();
+}
+
+static void init_vterm_render(void)
+{
+   if (!render_vi)
+      return; /* Deferred rendering is not in use */
+
+   disable_preemption();
+   {
+      render_wth =
+         wth_create_thread("vterm", 2 /* priority */, WTH_VTERM_QUEUE_SIZE);
+   }
+   enable_preemption();
+
+   if (!render_wth)
+      printk("WARNING: video_term: unable to create the render thread\n");
+}
+
+static struct module vterm_module = {
+
+   .name = "vterm",
+   .priority = MOD_vterm_prio,
+   .init = &init_vterm_render,
+};
+
+REGISTER_MODULE(&vterm_module);
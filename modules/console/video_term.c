@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/config_kernel.h>
 #include <tilck_gen_headers/mod_console.h>
 
 #include <tilck/common/color_defs.h>
@@ -15,6 +16,9 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/modules.h>
 
 #include "video_term_int.h"
 
@@ -82,6 +86,7 @@ static void no_vi_scroll_one_line_up(void) { }
 static void no_vi_redraw_static_elements(void) { }
 static void no_vi_disable_static_elems_refresh(void) { }
 static void no_vi_enable_static_elems_refresh(void) { }
+static void no_vi_flush_buffers(void) { }
 
 static const struct video_interface no_output_vi =
 {
@@ -94,7 +99,8 @@ static const struct video_interface no_output_vi =
    no_vi_scroll_one_line_up,
    no_vi_redraw_static_elements,
    no_vi_disable_static_elems_refresh,
-   no_vi_enable_static_elems_refresh
+   no_vi_enable_static_elems_refresh,
+   no_vi_flush_buffers
 };
 
 /* --------------------------------------------------------- */
@@ -211,6 +217,8 @@ static inline void term_redraw_scroll_region(struct vterm *t)
    term_redraw2(t, *t->start_scroll_region, *t->end_scroll_region + 1);
 }
 
+#include "term_render.c.h"
+
 static void ts_set_scroll(struct vterm *t, u32 requested_scroll)
 {
    /*
@@ -670,7 +678,17 @@ init_vterm(term *_t,
       t->cols = cols;
       t->rows = rows;
       t->saved_vi = intf;
-      t->vi = (t == &first_instance) ? intf : &no_output_vi;
+
+      if (kopt_deferred_render && !in_panic() && rows <= TERM_RENDER_MAX_ROWS)
+      {
+         render_vi = intf;
+         t->saved_vi = &deferred_vi;
+
+         if (t == &first_instance)
+            rstate.t = t;
+      }
+
+      t->vi = (t == &first_instance) ? t->saved_vi : &no_output_vi;
 
    } else {
 
@@ -9,17 +9,54 @@
 #include "termutil.h"
 #include "dp_int.h"
 
+/* Free blocks, grouped by size: < 4 KB, < 64 KB, >= 64 KB */
+#define FRAG_GROUPS                    3
+
+struct dp_heap_frag {
+
+   size_t free_mem;
+   size_t largest_free_block;
+   size_t groups[FRAG_GROUPS];
+   int percent;
+};
+
 static size_t heaps_alloc[KMALLOC_HEAPS_COUNT];
 static struct debug_kmalloc_heap_info hi;
 static struct debug_kmalloc_stats stats;
+static struct debug_kmalloc_frag_info fi;
+static struct dp_heap_frag heaps_frag[KMALLOC_HEAPS_COUNT];
+static struct dp_heap_frag small_heaps_frag;
 static size_t tot_usable_mem_kb;
 static size_t tot_used_mem_kb;
+static size_t tot_largest_free;
 static long tot_diff;
 
+static void dp_heaps_get_frag(struct dp_heap_frag *f)
+{
+   *f = (struct dp_heap_frag) {
+      .free_mem = fi.free_mem,
+      .largest_free_block = fi.largest_free_block,
+      .percent = debug_kmalloc_frag_percent(&fi),
+   };
+
+   for (u32 i = 0; i < KMALLOC_FRAG_ORDERS; i++) {
+
+      const size_t size = (size_t)1 << i;
+
+      if (size < 4 * KB)
+         f->groups[0] += fi.free_blocks[i];
+      else if (size < 64 * KB)
+         f->groups[1] += fi.free_blocks[i];
+      else
+         f->groups[2] += fi.free_blocks[i];
+   }
+}
+
 static void dp_heaps_on_enter(void)
 {
    tot_usable_mem_kb = 0;
    tot_used_mem_kb = 0;
+   tot_largest_free = 0;
    tot_diff = 0;
 
    for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
@@ -34,12 +71,69 @@ static void dp_heaps_on_enter(void)
       tot_usable_mem_kb += size_kb;
       tot_used_mem_kb += allocated_kb;
       tot_diff += diff;
+
+      if (debug_kmalloc_get_heap_frag(i, &fi)) {
+         dp_heaps_get_frag(&heaps_frag[i]);
+         tot_largest_free = MAX(tot_largest_free, fi.largest_free_block);
+      }
    }
 
    // SA: avoid division by zero warning
    ASSERT(tot_usable_mem_kb > 0);
 
    debug_kmalloc_get_stats(&stats);
+   debug_kmalloc_get_small_heaps_frag(&fi);
+   dp_heaps_get_frag(&small_heaps_frag);
+}
+
+static void dp_show_frag_table(int *row_ref)
+{
+   int row = *row_ref;
+
+   dp_writeln(
+      " H# "
+      TERM_VLINE " free KB"
+      TERM_VLINE " largest "
+      TERM_VLINE " frag "
+      TERM_VLINE " blocks < 4K "
+      TERM_VLINE " < 64K "
+      TERM_VLINE " >= 64K "
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqnqqqqqqqqnqqqqqqqqqnqqqqqqnqqqqqqqqqqqqqnqqqqqqqnqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_info(i, &hi))
+         break;
+
+      const struct dp_heap_frag *f = &heaps_frag[i];
+      const size_t largest_kb = f->largest_free_block / KB;
+
+      dp_writeln(
+         " %2d "
+         TERM_VLINE " %7zu"
+         TERM_VLINE " %4zu %s "
+         TERM_VLINE " %3d%% "
+         TERM_VLINE " %11zu "
+         TERM_VLINE " %5zu "
+         TERM_VLINE " %6zu ",
+         i,
+         f->free_mem / KB,
+         largest_kb < 1024 ? largest_kb : largest_kb / 1024,
+         largest_kb < 1024 ? "KB" : "MB",
+         f->percent,
+         f->groups[0],
+         f->groups[1],
+         f->groups[2]
+      );
+   }
+
+   *row_ref = row;
 }
 
 static void dp_show_kmalloc_heaps(void)
@@ -54,6 +148,9 @@ static void dp_show_kmalloc_heaps(void)
    dp_writeln2("non-full: %3d [peak: %3d]",
                stats.small_heaps.not_full_count,
                stats.small_heaps.peak_not_full_count);
+   dp_writeln2("frag:     %3d%% [free: %zu KB]",
+               small_heaps_frag.percent,
+               small_heaps_frag.free_mem / KB);
 
    row = dp_screen_start_row;
 
@@ -65,6 +162,7 @@ static void dp_show_kmalloc_heaps(void)
               tot_diff > 0 ? "+" : " ",
               tot_diff / (long)KB,
               tot_diff);
+   dp_writeln("Largest: %6zu KB (max alloc)", tot_largest_free / KB);
 
    dp_writeln("");
 
@@ -121,6 +219,8 @@ static void dp_show_kmalloc_heaps(void)
    }
 
    dp_writeln("");
+   dp_show_frag_table(&row);
+   dp_writeln("");
 }
 
 static void dp_heaps_on_exit(void)
@@ -4,11 +4,14 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/kb.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/irqsoff.h>
+#include <tilck/kernel/elf_utils.h>
 
 #include "termutil.h"
 
@@ -72,6 +75,55 @@ static void debug_dump_masked_irqs(void)
    dp_writeln("");
 }
 
+#if KERNEL_IRQSOFF_TRACER
+
+#define DP_IRQSOFF_TOP        6
+
+static void dp_irqsoff_site_str(ulong site, char *buf, size_t buf_sz)
+{
+   const char *sym;
+   long off;
+
+   if ((sym = find_sym_at_addr(site, &off, NULL)))
+      snprintk(buf, buf_sz, "%s+%ld", sym, off);
+   else
+      snprintk(buf, buf_sz, "%p", TO_PTR(site));
+}
+
+static void debug_dump_irqsoff(enum irqsoff_type t)
+{
+   static struct irqsoff_offender arr[DP_IRQSOFF_TOP];
+   const int n = irqsoff_get_offenders(t, arr, ARRAY_SIZE(arr));
+   struct irqsoff_info info;
+   char start[33], end[33];
+
+   irqsoff_get_info(t, &info);
+
+   dp_writeln("");
+   dp_writeln("Longest %s-off sections (KERNEL_IRQSOFF_TRACER)",
+              irqsoff_type_str(t));
+
+   dp_writeln("   Sections: %" PRIu64 ", avg cycles: %" PRIu64
+              ", max cycles: %" PRIu64,
+              info.sections,
+              info.sections ? info.tot_cycles / info.sections : 0,
+              info.max_cycles);
+
+   dp_writeln("   %-32s %-32s %10s %12s",
+              "Start", "End", "Count", "Max cycles");
+
+   for (int i = 0; i < n; i++) {
+
+      dp_irqsoff_site_str(arr[i].start_site, start, sizeof(start));
+      dp_irqsoff_site_str(arr[i].end_site, end, sizeof(end));
+
+      dp_writeln("   %-32s %-32s %10" PRIu64 " %12" PRIu64,
+                 start, end, arr[i].count, arr[i].max_cycles);
+   }
+}
+
+#endif
+
 static void dp_show_irq_stats(void)
 {
    row = dp_screen_start_row;
@@ -81,6 +133,11 @@ static void dp_show_irq_stats(void)
    debug_dump_spur_irq_count();
    debug_dump_unhandled_irq_count();
    debug_dump_masked_irqs();
+
+#if KERNEL_IRQSOFF_TRACER
+   debug_dump_irqsoff(IRQSOFF_IRQS);
+   debug_dump_irqsoff(IRQSOFF_PREEMPT);
+#endif
 }
 
 static struct dp_screen dp_irqs_screen =
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/elf_utils.h>
+
+#include "termutil.h"
+
+static int row;
+
+static void dp_dump_kmutex_stats(void)
+{
+#if KMUTEX_STATS_ENABLED
+
+   struct kmutex_stats s;
+   kmutex_get_stats(&s);
+
+   dp_writeln("   Acquired:                %10" PRIu64, s.acquired);
+   dp_writeln("   Contended:               %10" PRIu64, s.contended);
+   dp_writeln("   Acquired after yielding: %10" PRIu64, s.adaptive_acquired);
+   dp_writeln("   Had to sleep:            %10" PRIu64, s.slept);
+   dp_writeln("   Priority inheritances:   %10" PRIu64, s.pi_boosts);
+   dp_writeln("   Max waiters:             %10u", s.max_num_waiters);
+
+   if (s.acquired > 0) {
+      dp_writeln("   Contention rate:         %7u.%u%%",
+                 (u32)(s.contended * 100 / s.acquired),
+                 (u32)(s.contended * 1000 / s.acquired % 10));
+   }
+
+#else
+
+   dp_writeln("   Not available: KMUTEX_STATS_ENABLED is 0 (config_debug.h)");
+
+#endif
+}
+
+#if KERNEL_LOCKSTAT
+
+#define DP_LOCKSTAT_TOP       16
+
+static void dp_dump_lockstat(void)
+{
+   static struct lockstat_class arr[DP_LOCKSTAT_TOP];
+   const int n = lockstat_get_classes(arr, ARRAY_SIZE(arr));
+   const char *sym;
+   long off;
+
+   dp_writeln("   %-34s %-12s %10s %10s %14s",
+              "Site", "Type", "Acquired", "Contended", "Wait cycles");
+
+   for (int i = 0; i < n; i++) {
+
+      struct lockstat_class *c = &arr[i];
+      char site[35];
+
+      if ((sym = find_sym_at_addr(c->site, &off, NULL)))
+         snprintk(site, sizeof(site), "%s+%ld", sym, off);
+      else
+         snprintk(site, sizeof(site), "%p", TO_PTR(c->site));
+
+      dp_writeln("   %-34s %-12s %10" PRIu64 " %10" PRIu64 " %14" PRIu64,
+                 site, lockstat_type_str(c->type),
+                 c->acquired, c->contended, c->wait_cycles);
+   }
+
+   if (lockstat_get_dropped())
+      dp_writeln("   Dropped classes: %u", lockstat_get_dropped());
+}
+
+#endif
+
+static void dp_show_locks(void)
+{
+   row = dp_screen_start_row;
+
+   dp_writeln("Kernel mutexes (kmutex) counters");
+   dp_dump_kmutex_stats();
+   dp_writeln("");
+
+#if KERNEL_LOCKSTAT
+   dp_writeln("Top lock classes by wait time (KERNEL_LOCKSTAT)");
+   dp_dump_lockstat();
+   dp_writeln("");
+#endif
+}
+
+static struct dp_screen dp_locks_screen =
+{
+   .index = 6,
+   .label = "Locks",
+   .draw_func = dp_show_locks,
+   .on_keypress_func = NULL,
+};
+
+__attribute__((constructor))
+static void dp_locks_init(void)
+{
+   dp_register_screen(&dp_locks_screen);
+}
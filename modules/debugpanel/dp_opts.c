@@ -71,6 +71,7 @@ static void dp_show_opts(void)
    DUMP_INT_OPT(FBCON_BIGFONT_THR);
    DUMP_BOOL_OPT(FB_CONSOLE_BANNER);
    DUMP_BOOL_OPT(FB_CONSOLE_CURSOR_BLINK);
+   DUMP_BOOL_OPT(FB_CONSOLE_SHADOW_BUF);
    DUMP_BOOL_OPT(FB_CONSOLE_USE_ALT_FONTS);
    DUMP_BOOL_OPT(KERNEL_SHOW_LOGO);
    DUMP_BOOL_OPT(PCI_VENDORS_LIST);
@@ -87,12 +88,14 @@ static void dp_show_opts(void)
    DUMP_BOOL_OPT(BOOT_INTERACTIVE);
    DUMP_BOOL_OPT(KERNEL_64BIT_OFFT);
    DUMP_BOOL_OPT(KRN_CLOCK_DRIFT_COMP);
+   DUMP_BOOL_OPT(FORK_LAZY_PT_COPY);
 
    DUMP_LABEL("Disabled by default");
    DUMP_BOOL_OPT(KRN_NO_SYS_WARN);
    DUMP_BOOL_OPT(KRN_PAGE_FAULT_PRINTK);
    DUMP_BOOL_OPT(KERNEL_UBSAN);
    DUMP_BOOL_OPT(TERM_BIG_SCROLL_BUF);
+   DUMP_BOOL_OPT(TERM_DEFERRED_RENDER);
    DUMP_BOOL_OPT(KRN_RESCHED_ENABLE_PREEMPT);
    DUMP_BOOL_OPT(KERNEL_BIG_IO_BUF);
    DUMP_BOOL_OPT(PS2_DO_SELFTEST);
@@ -100,7 +103,11 @@ static void dp_show_opts(void)
    DUMP_BOOL_OPT(KERNEL_GCOV);
    DUMP_BOOL_OPT(FORK_NO_COW);
    DUMP_BOOL_OPT(MMAP_NO_COW);
+   DUMP_BOOL_OPT(MMAP_TRANSP_BIG_PAGES);
    DUMP_BOOL_OPT(PANIC_SHOW_REGS);
+   DUMP_BOOL_OPT(KERNEL_LOCKSTAT);
+   DUMP_BOOL_OPT(KERNEL_SYSCALL_STATS);
+   DUMP_BOOL_OPT(KERNEL_IRQSOFF_TRACER);
    DUMP_BOOL_OPT(KMALLOC_HEAVY_STATS);
    DUMP_BOOL_OPT(KMALLOC_FREE_MEM_POISONING);
    DUMP_BOOL_OPT(KMALLOC_SUPPORT_DEBUG_LOG);
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/sched.h>
+
+#include "termutil.h"
+
+static int row;
+
+#if KERNEL_SYSCALL_STATS
+
+#define DP_SYSCALLS_TOP       16
+#define DP_TASKS_TOP          8
+
+static void dp_dump_syscall(const char *name, struct syscall_stats *s)
+{
+   char buf[64];
+   char *p = buf;
+   u32 lo = SYSCALL_HIST_BUCKETS, hi = 0;
+
+   for (u32 b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+      if (s->hist[b]) {
+         lo = MIN(lo, b);
+         hi = b;
+      }
+   }
+
+   /* Show the distribution as percentages, one digit per bucket */
+   for (u32 b = lo; b <= hi && p < buf + sizeof(buf) - 1; b++) {
+
+      const u64 pc = (u64)s->hist[b] * 10 / s->count;
+      *p++ = s->hist[b] ? (pc >= 10 ? '*' : (char)('0' + pc)) : '.';
+   }
+
+   *p = 0;
+   dp_writeln("   %-24s %8" PRIu64 " %12" PRIu64 " %12" PRIu64 "  2^%-2u %s",
+              name, s->count, s->tot_cycles / s->count, s->max_cycles, lo, buf);
+}
+
+static void dp_dump_syscalls(void)
+{
+   static u32 sns[DP_SYSCALLS_TOP];
+   const u32 n = syscall_stats_get_top(sns, ARRAY_SIZE(sns));
+   struct syscall_stats s;
+   const char *sym;
+   char name[25];
+
+   dp_writeln("   %-24s %8s %12s %12s  %s",
+              "Syscall", "Count", "Avg cycles", "Max cycles", "Histogram");
+
+   for (u32 i = 0; i < n; i++) {
+
+      syscall_stats_get(sns[i], &s);
+      sym = find_sym_at_addr((ulong)get_syscall_func_ptr(sns[i]), NULL, NULL);
+
+      if (sym)
+         snprintk(name, sizeof(name), "%s", sym);
+      else
+         snprintk(name, sizeof(name), "syscall_%u", sns[i]);
+
+      dp_dump_syscall(name, &s);
+   }
+}
+
+struct dp_syscalls_task {
+   int tid;
+   const char *name;
+   struct syscall_task_stats s;
+};
+
+struct dp_syscalls_tasks_ctx {
+   struct dp_syscalls_task arr[DP_TASKS_TOP];
+   int n;
+};
+
+static int dp_syscalls_task_cb(void *obj, void *arg)
+{
+   struct dp_syscalls_tasks_ctx *ctx = arg;
+   struct task *ti = obj;
+   const u64 tot = ti->sys_stats.tot_cycles;
+   int j;
+
+   if (!ti->sys_stats.count)
+      return 0;
+
+   if (ctx->n == DP_TASKS_TOP && tot <= ctx->arr[ctx->n - 1].s.tot_cycles)
+      return 0;
+
+   if (ctx->n < DP_TASKS_TOP)
+      ctx->n++;
+
+   for (j = ctx->n - 1; j > 0 && ctx->arr[j - 1].s.tot_cycles < tot; j--)
+      ctx->arr[j] = ctx->arr[j - 1];
+
+   ctx->arr[j].tid = ti->tid;
+   ctx->arr[j].s = ti->sys_stats;
+   ctx->arr[j].name = ti->kthread_name;
+
+   if (!ctx->arr[j].name)
+      ctx->arr[j].name = ti->pi->debug_cmdline;
+
+   return 0;
+}
+
+static void dp_dump_syscalls_tasks(void)
+{
+   static struct dp_syscalls_tasks_ctx ctx;
+
+   ctx.n = 0;
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&dp_syscalls_task_cb, &ctx);
+   }
+   enable_preemption();
+
+   dp_writeln("   %6s %10s %14s  %s", "Tid", "Syscalls", "Tot cycles", "Name");
+
+   for (int i = 0; i < ctx.n; i++) {
+
+      struct dp_syscalls_task *t = &ctx.arr[i];
+
+      dp_writeln("   %6d %10" PRIu64 " %14" PRIu64 "  %.40s",
+                 t->tid, t->s.count, t->s.tot_cycles,
+                 t->name ? t->name : "<n/a>");
+   }
+}
+
+#endif
+
+static void dp_show_syscalls(void)
+{
+   row = dp_screen_start_row;
+
+#if KERNEL_SYSCALL_STATS
+
+   dp_writeln("Top syscalls by total time (histogram: log2(cycles) buckets "
+              "from 2^N, tenths of calls)");
+   dp_dump_syscalls();
+   dp_writeln("");
+
+   dp_writeln("Top tasks by time spent in syscalls");
+   dp_dump_syscalls_tasks();
+   dp_writeln("");
+
+#else
+
+   dp_writeln("Not available: KERNEL_SYSCALL_STATS is 0 (config_debug.h)");
+
+#endif
+}
+
+static struct dp_screen dp_syscalls_screen =
+{
+   .index = 7,
+   .label = "Syscalls",
+   .draw_func = dp_show_syscalls,
+   .on_keypress_func = NULL,
+};
+
+__attribute__((constructor))
+static void dp_syscalls_init(void)
+{
+   dp_register_screen(&dp_syscalls_screen);
+}
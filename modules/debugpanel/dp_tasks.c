@@ -198,9 +198,14 @@ static int debug_per_task_cb(void *obj, void *arg)
 
       if (is_worker_thread(ti)) {
          int p = wth_get_priority(ti->worker_thread);
+         int ep = wth_get_eff_priority(ti->worker_thread);
          const char *wth_name = wth_get_name(ti->worker_thread);
          name = wth_name ? wth_name : "generic";
-         snprintk(buf, sizeof(buf), "<wth:%s(%d)>", name, p);
+
+         if (ep != p)
+            snprintk(buf, sizeof(buf), "<wth:%s(%d->%d)>", name, p, ep);
+         else
+            snprintk(buf, sizeof(buf), "<wth:%s(%d)>", name, p);
       } else {
          snprintk(buf, sizeof(buf), "<%s>", name);
       }
@@ -9,6 +9,7 @@
 
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/hal.h>
+#include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/timer.h>
@@ -16,6 +17,7 @@
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/boot_prof.h>
 
 #include <tilck/mods/fb_console.h>
 #include <tilck/mods/acpi.h>
@@ -203,6 +205,26 @@ static void fb_set_row_optimized(u16 row, u16 *data, bool fpu_allowed)
 
 void fb_draw_banner(void);
 
+static void fb_flush_buffers(void)
+{
+   const bool fpu_allowed = !in_irq() && !in_panic();
+
+   if (fpu_allowed)
+      fpu_context_begin();
+
+   fb_flush_shadow_buffer(fpu_allowed);
+
+   if (fpu_allowed)
+      fpu_context_end();
+}
+
+/* For the callers outside of the term layer: it flushes after each action */
+static void fb_flush_if_needed(void)
+{
+   if (framebuffer_vi.flush_buffers)
+      framebuffer_vi.flush_buffers();
+}
+
 static void fb_disable_banner_refresh(void)
 {
    banner_refresh_disabled = true;
@@ -228,6 +250,7 @@ static struct video_interface framebuffer_vi =
    fb_draw_banner,
    fb_disable_banner_refresh,
    fb_enable_banner_refresh,
+   NULL,  /* flush_buffers: used only with the shadow buffer */
 };
 
 
@@ -238,6 +261,7 @@ static void fb_blink_thread()
       if (cursor_enabled) {
          cursor_visible = !cursor_visible;
          fb_move_cursor(cursor_row, cursor_col, -1);
+         fb_flush_if_needed();
       }
 
       kernel_sleep(blink_half_period);
@@ -427,6 +451,7 @@ static void fb_update_banner()
       if (!banner_refresh_disabled) {
          fb_banner_update_battery_pm();
          fb_draw_banner();
+         fb_flush_if_needed();
       }
 
       kernel_sleep(30 * TIMER_HZ);
@@ -435,8 +460,10 @@ static void fb_update_banner()
 
 static u32 fb_console_on_acpi_full_init_func(void *ctx)
 {
-   if (!banner_refresh_disabled)
+   if (!banner_refresh_disabled) {
       fb_draw_banner();
+      fb_flush_if_needed();
+   }
 
    return 0;
 }
@@ -462,18 +489,56 @@ static void fb_scroll_one_line_up(void)
       fb_enable_cursor();
 }
 
+static bool fb_try_alloc_shadow_buffer(void)
+{
+   const size_t min_free = FBCON_OPT_FUNCS_MIN_FREE_HEAP + fb_size;
+
+   if (kmalloc_get_max_tot_heap_free() < min_free) {
+      printk("fb_console: Not using a shadow buffer in order to save memory\n");
+      return false;
+   }
+
+   if (!fb_alloc_shadow_buffer()) {
+      printk("fb_console: WARNING: unable to allocate the shadow buffer\n");
+      return false;
+   }
+
+   return true;
+}
+
 static void async_pre_render_scanlines()
 {
+   bool shadow_buf = false;
+   int bp = boot_prof_begin("fb_pre_render_char_scanlines", BOOT_PH_ASYNC);
+
    if (!fb_pre_render_char_scanlines()) {
       printk("fb_console: WARNING: fb_pre_render_char_scanlines failed.\n");
+      boot_prof_end(bp);
       return;
    }
 
+   boot_prof_end(bp);
+
+   if (FB_CONSOLE_SHADOW_BUF)
+      shadow_buf = fb_try_alloc_shadow_buffer();
+
    disable_interrupts_forced();
    {
       use_optimized = true;
       framebuffer_vi.set_char_at = fb_set_char_at_optimized;
       framebuffer_vi.set_row = fb_set_row_optimized;
+
+      if (shadow_buf) {
+
+         fb_use_shadow_buffer();
+         framebuffer_vi.flush_buffers = fb_flush_buffers;
+
+         /*
+          * Scrolling by moving the pixels is cheap when there are no reads
+          * from the video memory. Use it even outside of VMs.
+          */
+         framebuffer_vi.scroll_one_line_up = fb_scroll_one_line_up;
+      }
    }
    enable_interrupts_forced();
 }
@@ -6,6 +6,7 @@ extern u32 font_w;
 extern u32 font_h;
 extern u32 vga_rgb_colors[16];
 extern bool __use_framebuffer;
+extern u32 fb_size;
 
 u32 fb_get_width(void);
 u32 fb_get_height(void);
@@ -22,6 +23,10 @@ void fb_copy_to_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf);
 void fb_lines_shift_up(u32 src_y, u32 dst_y, u32 lines_count);
 bool fb_pre_render_char_scanlines(void);
 bool fb_alloc_shadow_buffer(void);
+void fb_use_shadow_buffer(void);
+bool fb_is_using_shadow_buffer(void);
+void fb_mark_all_dirty(void);
+void fb_flush_shadow_buffer(bool use_fpu);
 void fb_raw_perf_screen_redraw(u32 color, bool use_fpu);
 void fb_set_font(void *font);
 void fb_draw_banner(void);
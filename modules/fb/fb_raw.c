@@ -52,6 +52,35 @@ static u32 fb_line_length;
 ulong fb_vaddr;
 static u32 *fb_w8_char_scanlines;
 
+/*
+ * Where all the drawing functions below write: the shadow buffer, when in use,
+ * or the framebuffer itself (fb_vaddr) otherwise.
+ */
+static ulong fb_draw_vaddr;
+
+/*
+ * Shadow buffer
+ * ---------------
+ *
+ * A copy of the framebuffer in regular RAM, having exactly the same layout
+ * (pitch included). When it's in use, nothing reads from the video memory
+ * anymore: reads from VRAM are extremely slow on real hardware, in particular
+ * when the memory is mapped as write-combining. The parts of the shadow buffer
+ * changed since the last flush are tracked per pixel line, as a [x0, x1) span
+ * and fb_flush_shadow_buffer() copies only them to the framebuffer.
+ */
+
+struct fb_dirty_span {
+   u16 x0;        /* first dirty pixel */
+   u16 x1;        /* last dirty pixel + 1. When 0, the line is clean */
+};
+
+static void *fb_shadow_buf;
+static bool use_shadow_buf;
+static struct fb_dirty_span *fb_dirty;
+static u32 fb_dirty_y0;          /* first dirty line */
+static u32 fb_dirty_y1;          /* last dirty line + 1 */
+
 u32 font_w;
 u32 font_h;
 static u32 font_width_bytes;
@@ -186,11 +215,160 @@ void set_framebuffer_info_from_mbi(multiboot_info_t *mbi)
    });
 }
 
+static void __fb_mark_dirty(u32 x, u32 y, u32 w, u32 h)
+{
+   const u16 x0 = (u16)x;
+   const u16 x1 = (u16)(x + w);
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      for (u32 i = y; i < y + h; i++) {
+
+         struct fb_dirty_span *s = &fb_dirty[i];
+
+         if (!s->x1) {
+            s->x0 = x0;
+            s->x1 = x1;
+         } else {
+            s->x0 = MIN(s->x0, x0);
+            s->x1 = MAX(s->x1, x1);
+         }
+      }
+
+      fb_dirty_y0 = MIN(fb_dirty_y0, y);
+      fb_dirty_y1 = MAX(fb_dirty_y1, y + h);
+   }
+   enable_interrupts(&var);
+}
+
+static ALWAYS_INLINE void fb_mark_dirty(u32 x, u32 y, u32 w, u32 h)
+{
+   if (use_shadow_buf)
+      __fb_mark_dirty(x, y, w, h);
+}
+
+void fb_mark_all_dirty(void)
+{
+   fb_mark_dirty(0, 0, fb_width, fb_height);
+}
+
+bool fb_alloc_shadow_buffer(void)
+{
+   ASSERT(fb_bpp == 32);
+   ASSERT(!fb_shadow_buf);
+
+   if (!(fb_dirty = kzalloc_array_obj(struct fb_dirty_span, fb_height)))
+      return false;
+
+   if (!(fb_shadow_buf = kmalloc(fb_size))) {
+      kfree_array_obj(fb_dirty, struct fb_dirty_span, fb_height);
+      fb_dirty = NULL;
+      return false;
+   }
+
+   /* Required by fpu_cpy_single_256_nt() */
+   ASSERT(((ulong)fb_shadow_buf & 31) == 0);
+   return true;
+}
+
+void fb_use_shadow_buffer(void)
+{
+   ASSERT(!are_interrupts_enabled());
+   ASSERT(fb_shadow_buf != NULL);
+
+   /* The last read from the video memory */
+   memcpy32(fb_shadow_buf, (void *)fb_vaddr, fb_size >> 2);
+
+   fb_dirty_y0 = fb_height;
+   fb_dirty_y1 = 0;
+   fb_draw_vaddr = (ulong)fb_shadow_buf;
+   use_shadow_buf = true;
+}
+
+bool fb_is_using_shadow_buffer(void)
+{
+   return use_shadow_buf;
+}
+
+static void fb_flush_span(u32 y, u32 x0, u32 x1, bool use_fpu)
+{
+   /*
+    * Extend the span to a multiple of 8 pixels (32 bytes), in order to always
+    * use whole fpu_cpy_single_256_nt() copies, with both the source and the
+    * destination aligned at 32 bytes. Only the very last chunk of a line might
+    * be smaller than that, when fb_width is not a multiple of 8.
+    */
+   const u32 b0 = (x0 & ~7u) << 2;
+   const u32 b1 = MIN(pow2_round_up_at(x1, 8), fb_width) << 2;
+   const u32 off = fb_pitch * y + b0;
+   void *dst = (void *)(fb_vaddr + off);
+   void *src = fb_shadow_buf + off;
+   u32 n = (b1 - b0) >> 5;
+
+   if (use_fpu) {
+
+      for (; n > 0; n--, dst += 32, src += 32)
+         fpu_cpy_single_256_nt(dst, src);
+
+   } else {
+
+      memcpy32(dst, src, n << 3);
+      dst += n << 5;
+      src += n << 5;
+   }
+
+   memcpy32(dst, src, ((b1 - b0) & 31) >> 2);
+}
+
+/*
+ * Copies all the dirty parts of the shadow buffer to the framebuffer. It's safe
+ * to draw (even from IRQ context) while a flush is in progress: a line changed
+ * after it has been flushed just remains dirty for the next flush.
+ *
+ * NOTE: use_fpu requires the caller to be in a FPU context.
+ */
+void fb_flush_shadow_buffer(bool use_fpu)
+{
+   struct fb_dirty_span s;
+   u32 y0, y1;
+   ulong var;
+
+   if (!use_shadow_buf)
+      return;
+
+   use_fpu = use_fpu && !(fb_pitch % 32);
+
+   disable_interrupts(&var);
+   {
+      y0 = fb_dirty_y0;
+      y1 = fb_dirty_y1;
+      fb_dirty_y0 = fb_height;
+      fb_dirty_y1 = 0;
+   }
+   enable_interrupts(&var);
+
+   for (u32 y = y0; y < y1; y++) {
+
+      disable_interrupts(&var);
+      {
+         s = fb_dirty[y];
+         fb_dirty[y].x1 = 0;
+      }
+      enable_interrupts(&var);
+
+      if (s.x1)
+         fb_flush_span(y, s.x0, s.x1, use_fpu);
+   }
+}
+
 void fb_lines_shift_up(u32 src_y, u32 dst_y, u32 lines_count)
 {
-   memcpy32((void *)(fb_vaddr + fb_pitch * dst_y),
-            (void *)(fb_vaddr + fb_pitch * src_y),
+   memcpy32((void *)(fb_draw_vaddr + fb_pitch * dst_y),
+            (void *)(fb_draw_vaddr + fb_pitch * src_y),
             (fb_pitch * lines_count) >> 2);
+
+   fb_mark_dirty(0, dst_y, fb_width, lines_count);
 }
 
 u32 fb_get_width(void)
@@ -223,6 +401,10 @@ void fb_map_in_kernel_space(void)
                                       0,
                                       fb_size,
                                       false);
+
+   /* In case of panic, draw directly on the framebuffer */
+   fb_draw_vaddr = fb_vaddr;
+   use_shadow_buf = false;
 }
 
 /*
@@ -237,12 +419,12 @@ static inline void fb_draw_pixel(u32 x, u32 y, u32 color)
    if (fb_bpp == 32) {
 
       *(volatile u32 *)
-         (fb_vaddr + (fb_pitch * y) + (x << 2)) = color;
+         (fb_draw_vaddr + (fb_pitch * y) + (x << 2)) = color;
 
    } else {
 
       // Assumption: bpp is 24
-      memcpy((void *) (fb_vaddr + (fb_pitch * y) + (x * 3)), &color, 3);
+      memcpy((void *) (fb_draw_vaddr + (fb_pitch * y) + (x * 3)), &color, 3);
    }
 }
 
@@ -250,7 +432,7 @@ void fb_raw_color_lines(u32 iy, u32 h, u32 color)
 {
    if (LIKELY(fb_bpp == 32)) {
 
-      ulong v = fb_vaddr + (fb_pitch * iy);
+      ulong v = fb_draw_vaddr + (fb_pitch * iy);
 
       if (LIKELY(fb_pitch == fb_line_length)) {
 
@@ -262,6 +444,8 @@ void fb_raw_color_lines(u32 iy, u32 h, u32 color)
             memset((void *)v, (int)color, fb_line_length);
       }
 
+      fb_mark_dirty(0, iy, fb_width, h);
+
    } else {
 
       /*
@@ -283,11 +467,13 @@ void fb_draw_cursor_raw(u32 ix, u32 iy, u32 color)
 
       for (u32 y = iy; y < (iy + font_h); y++) {
 
-         memset32((u32 *)(fb_vaddr + (fb_pitch * y) + ix),
+         memset32((u32 *)(fb_draw_vaddr + (fb_pitch * y) + ix),
                   color,
                   font_w);
       }
 
+      fb_mark_dirty(ix >> 2, iy, font_w, font_h);
+
    } else {
 
       /*
@@ -303,7 +489,7 @@ void fb_draw_cursor_raw(u32 ix, u32 iy, u32 color)
 
 void fb_copy_from_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf)
 {
-   ulong vaddr = fb_vaddr + (fb_pitch * iy) + (ix * fb_bytes_per_pixel);
+   ulong vaddr = fb_draw_vaddr + fb_pitch * iy + ix * fb_bytes_per_pixel;
 
    if (LIKELY(fb_bpp == 32)) {
 
@@ -326,13 +512,15 @@ void fb_copy_from_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf)
 
 void fb_copy_to_screen(u32 ix, u32 iy, u32 w, u32 h, u32 *buf)
 {
-   ulong vaddr = fb_vaddr + (fb_pitch * iy) + (ix * fb_bytes_per_pixel);
+   ulong vaddr = fb_draw_vaddr + fb_pitch * iy + ix * fb_bytes_per_pixel;
 
    if (LIKELY(fb_bpp == 32)) {
 
       for (u32 y = 0; y < h; y++, vaddr += fb_pitch)
          memcpy32((void *)vaddr, &buf[y * w], w);
 
+      fb_mark_dirty(ix, iy, w, h);
+
    } else {
 
       /*
@@ -431,6 +619,8 @@ void fb_draw_char_failsafe(u32 x, u32 y, u16 e)
          }
       }
    }
+
+   fb_mark_dirty(x, y, font_w, font_h);
 }
 
 
@@ -497,7 +687,7 @@ void fb_draw_char_optimized(u32 x, u32 y, u16 e)
    ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
    ASSUME_WITHOUT_CHECK(font_bytes_per_glyph==16 || font_bytes_per_glyph==64);
 
-   void *vaddr = (void *)fb_vaddr + (fb_pitch * y) + (x << 2);
+   void *vaddr = (void *)fb_draw_vaddr + (fb_pitch * y) + (x << 2);
    u8 *d = font_glyph_data + font_bytes_per_glyph * c;
    const u32 c_off = (u32)(
       (vgaentry_get_fg(e) << 15) + (vgaentry_get_bg(e) << 11)
@@ -510,6 +700,7 @@ void fb_draw_char_optimized(u32 x, u32 y, u16 e)
       for (u32 r = 0; r < font_h; r++, d++, vaddr += fb_pitch)
          memcpy32(vaddr,      &scanlines[d[0] << 3], SL_SIZE);
 
+      fb_mark_dirty(x, y, font_w, font_h);
       return;
 
    width2:
@@ -519,6 +710,7 @@ void fb_draw_char_optimized(u32 x, u32 y, u16 e)
          memcpy32(vaddr + 32, &scanlines[d[1] << 3], SL_SIZE);
       }
 
+      fb_mark_dirty(x, y, font_w, font_h);
       return;
 }
 
@@ -533,7 +725,7 @@ void fb_draw_row_optimized(u32 y, u16 *entries, u32 count, bool fpu)
    const void *const op = ops[(font_w == 16) * 2 + fpu];       // ops[0..3]
 
    /* -------------- Regular variables --------------- */
-   const ulong vaddr_base = fb_vaddr + (fb_pitch * y);
+   const ulong vaddr_base = fb_draw_vaddr + (fb_pitch * y);
 
    ASSUME_WITHOUT_CHECK(font_w == 8 || font_w == 16);
    ASSUME_WITHOUT_CHECK(font_h == 16 || font_h == 32);
@@ -582,6 +774,8 @@ void fb_draw_row_optimized(u32 y, u16 *entries, u32 count, bool fpu)
 
          continue;
    }
+
+   fb_mark_dirty(0, y, count * font_w, font_h);
 }
 
 
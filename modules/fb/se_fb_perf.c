@@ -46,6 +46,10 @@ void internal_selftest_fb_perf(bool use_fpu)
    printk("use_fpu: %d\n", use_fpu);
 
    fb_draw_banner();
+
+   /* Restore the screen's content from the shadow buffer, if any */
+   fb_mark_all_dirty();
+   fb_flush_shadow_buffer(false);
 }
 
 void selftest_fbperf_nofpu(void)
@@ -58,7 +62,38 @@ void selftest_fbperf_fpu(void)
    internal_selftest_fb_perf(true);
 }
 
+void selftest_fbperf_flush(void)
+{
+   const int iters = 30;
+   u64 start, duration;
+
+   if (!use_framebuffer())
+      panic("Unable to test framebuffer's performance: we're in text-mode");
+
+   if (!fb_is_using_shadow_buffer()) {
+      printk("fb_console: not using a shadow buffer\n");
+      return;
+   }
+
+   fpu_context_begin();
+   {
+      start = RDTSC();
+
+      for (int i = 0; i < iters; i++) {
+         fb_mark_all_dirty();
+         fb_flush_shadow_buffer(true);
+      }
+
+      duration = RDTSC() - start;
+   }
+   fpu_context_end();
+
+   printk("cycles per full shadow buffer flush: %" PRIu64 "\n",
+          duration / iters);
+}
+
 REGISTER_SELF_TEST(fbperf_nofpu, se_manual, &selftest_fbperf_nofpu)
 REGISTER_SELF_TEST(fbperf_fpu, se_manual, &selftest_fbperf_fpu)
+REGISTER_SELF_TEST(fbperf_flush, se_manual, &selftest_fbperf_flush)
 
 #endif // #if KERNEL_SELFTESTS
@@ -489,6 +489,8 @@ static struct module kb_ps2_module = {
    .name = "kb8042",
    .priority = MOD_kb_prio,
    .init = &init_kb,
+   .async = true,
+   .deps = { "acpi" },     /* for get_acpi_init_status() */
 };
 
 REGISTER_MODULE(&kb_ps2_module);
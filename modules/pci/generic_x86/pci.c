@@ -845,6 +845,8 @@ static struct module pci_module = {
    .name = "pci",
    .priority = MOD_pci_prio,
    .init = &init_pci,
+   .async = true,
+   .deps = { "sysfs" },
 };
 
 REGISTER_MODULE(&pci_module);
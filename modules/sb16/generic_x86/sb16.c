@@ -9,15 +9,21 @@
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/paging.h>
+#include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/fs/devfs.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/worker_thread.h>
 
 #include "sb16.h"
 
+#define SB16_BUF_SIZE                       (64 * KB)
+#define SB16_MIN_PERIOD                      (1 * KB)
+
 /* One-time sb16 configuration shared with sb16_hw.c */
 struct sb16_info sb16_info;
 
@@ -29,17 +35,35 @@ static u16 sb16_major;
  *
  * NOTE: it's not necessary to use atomics because most of the time we disable
  * the interrupts while accessing the following state variables. In other cases,
- * like in sb16_ioctl_wait_for_completion() do just poll on sb16_playing:
+ * like in sb16_ioctl_wait_for_completion() we just read sb16_playing:
  * volatile is mandatory, but no need for atomics. It's worth remarking that
  * in the simple model used by this driver, only ONE task at a time can acquire
  * and use this sound device. Therefore, no need for need for any kind of fancy
  * synchronization mechanisms.
  */
-static volatile bool producer_is_sleeping;
 static volatile bool sb16_have_slot[2];
 static volatile bool sb16_playing;
 static volatile u8 sb16_slot;
 
+/* Ring-buffer mode state, see TILCK_IOCTL_SOUND_RING_SETUP */
+static bool ring_mode;
+static u32 ring_period;
+static volatile u32 ring_hw_pos;       /* advanced by the IRQ handler */
+static volatile u32 ring_appl_pos;     /* advanced by the commit ioctl */
+static volatile u32 ring_xruns;
+static volatile bool ring_paused;      /* paused because of an underrun */
+static volatile bool ring_draining;
+
+/*
+ * Tasks waiting for the IRQ handler (writers, poll(), wait for completion)
+ * sleep on `sb16_cond`. Because a kcond cannot be signalled in IRQ context,
+ * the IRQ handler enqueues a bottom half which does that. The mutex, held by
+ * the waiters while checking the state, guarantees no wake-up is lost.
+ */
+static struct kmutex sb16_lock = STATIC_KMUTEX_INIT(sb16_lock, 0);
+static struct kcond sb16_cond = STATIC_KCOND_INIT(sb16_cond);
+static volatile bool sb16_bh_pending;
+
 /* DSP config */
 static struct tilck_sound_params dsp_params;
 static u32 curr_buf_sz;
@@ -47,10 +71,16 @@ static u32 curr_buf_sz;
 /* The task currently owning the sound device */
 static struct task *owner;
 
+/*
+ * All the user mappings of the DMA buffer, including the ones inherited by
+ * forked children. See sb16_revoke_mappings().
+ */
+static struct list sb16_mappings = STATIC_LIST_INIT(sb16_mappings);
+
 static int
 sb16_alloc_buf(void)
 {
-   size_t sz = 64 * KB;
+   size_t sz = SB16_BUF_SIZE;
    sb16_info.buf = general_kmalloc(&sz, KMALLOC_FL_DMA);
 
    if (!sb16_info.buf)
@@ -59,13 +89,68 @@ sb16_alloc_buf(void)
    sb16_info.buf_paddr = KERNEL_VA_TO_PA(sb16_info.buf);
 
    /* The buffer must be aligned at 64-KB boundary */
-   ASSERT((sb16_info.buf_paddr & (64 * KB - 1)) == 0);
+   ASSERT((sb16_info.buf_paddr & (SB16_BUF_SIZE - 1)) == 0);
+
+   /*
+    * The buffer can be mapped in user space (ring-buffer mode): keep its
+    * pageframes referenced, so that dropping the last user mapping won't free
+    * them.
+    */
+   retain_pageframes_mapped_at(get_kernel_pdir(), sb16_info.buf, SB16_BUF_SIZE);
    return 0;
 }
 
+static void
+sb16_wakeup_bh(void *ctx)
+{
+   sb16_bh_pending = false;
+
+   kmutex_lock(&sb16_lock);
+   {
+      kcond_signal_all(&sb16_cond);
+   }
+   kmutex_unlock(&sb16_lock);
+}
+
+static void
+sb16_schedule_wakeup(void)
+{
+   if (sb16_bh_pending)
+      return;
+
+   /* If all the queues are full, we'll retry on the next IRQ */
+   sb16_bh_pending =
+      wth_enqueue_anywhere(WTH_PRIO_HIGHEST, &sb16_wakeup_bh, NULL);
+}
+
+static void
+sb16_ring_handle_irq(void)
+{
+   /* The card just completed a period and started playing the next one */
+   ring_hw_pos += ring_period;
+
+   if (ring_appl_pos - ring_hw_pos < ring_period) {
+
+      /* The next period hasn't been fully committed: pause */
+      SB16_DBG("sb16, irq, ring: no data at %u: PAUSE\n", ring_hw_pos);
+      sb16_pause();
+      ring_paused = true;
+
+      if (!ring_draining)
+         ring_xruns++;
+   }
+}
+
 static enum irq_action
 sb16_handle_irq(void *ctx)
 {
+   if (ring_mode) {
+      sb16_irq_ack();
+      sb16_ring_handle_irq();
+      sb16_schedule_wakeup();
+      return IRQ_HANDLED;
+   }
+
    SB16_DBG("sb16, irq, completed slot: %u\n", sb16_slot);
 
    /* Mark the current slot as "used" */
@@ -89,11 +174,7 @@ sb16_handle_irq(void *ctx)
       SB16_DBG("sb16, irq, switch to slot: %u\n", sb16_slot);
    }
 
-   if (producer_is_sleeping) {
-      if (owner && owner->state == TASK_STATE_SLEEPING)
-         task_change_state(owner, TASK_STATE_RUNNABLE);
-   }
-
+   sb16_schedule_wakeup();
    return IRQ_HANDLED;
 }
 
@@ -161,8 +242,8 @@ do_start_play(u8 next_slot, u32 sz)
       curr_buf_sz = MAX(sz, played_anything ? 4 * KB : 8 * KB);
       played_anything = true;
 
-      sb16_program_dma(dsp_params.bits, sz < 32 * KB ? sz : 64 * KB);
-      sb16_program(&dsp_params, curr_buf_sz);
+      sb16_program_dma(dsp_params.bits, sz < 32 * KB ? sz : SB16_BUF_SIZE);
+      sb16_program(&dsp_params, curr_buf_sz, curr_buf_sz == 32 * KB);
 
    } else {
 
@@ -170,6 +251,51 @@ do_start_play(u8 next_slot, u32 sz)
    }
 }
 
+/*
+ * Legacy (double-buffered) mode: returns true if there's a free 32 KB slot,
+ * writing its number in `slot`.
+ */
+static bool
+sb16_get_free_slot(u8 *slot)
+{
+   bool ret = true;
+
+   disable_interrupts_forced();
+   {
+      if (sb16_playing) {
+
+         *slot = !sb16_slot;
+
+         if (sb16_have_slot[*slot] || curr_buf_sz < 32 * KB) {
+
+            if (curr_buf_sz < 32 * KB)
+               SB16_DBG("force sleep on write() because buf < 32KB\n");
+
+            ret = false;
+         }
+
+      } else {
+         *slot = 0;
+      }
+   }
+   enable_interrupts_forced();
+   return ret;
+}
+
+/* Ring-buffer mode: returns the number of bytes committed, but not played */
+static u32
+sb16_ring_get_used(void)
+{
+   u32 used;
+
+   disable_interrupts_forced();
+   {
+      used = ring_appl_pos - ring_hw_pos;
+   }
+   enable_interrupts_forced();
+   return used;
+}
+
 static ssize_t
 sb16_write(fs_handle h, char *user_buf, size_t size, offt *pos)
 {
@@ -184,48 +310,28 @@ sb16_write(fs_handle h, char *user_buf, size_t size, offt *pos)
    }
 
    const size_t sz = MIN(size, 32 * KB);
-   bool must_sleep;
    u8 next_slot;
    u8 *dest_buf;
 
-   do {
-
-      must_sleep = false;
-      disable_interrupts_forced();
-      {
-         if (sb16_playing) {
-
-            next_slot = !sb16_slot;
-
-            if (sb16_have_slot[next_slot] || curr_buf_sz < 32 * KB) {
-
-               if (curr_buf_sz < 32 * KB)
-                  SB16_DBG("force sleep on write() because buf < 32KB\n");
-
-               must_sleep = true;
-            }
-
-         } else {
-            next_slot = 0;
-         }
-      }
-      enable_interrupts_forced();
+   if (ring_mode) {
+      /* In ring-buffer mode, the data is written directly via mmap() */
+      return -EINVAL;
+   }
 
-      if (must_sleep) {
+   kmutex_lock(&sb16_lock);
+   {
+      while (!sb16_get_free_slot(&next_slot)) {
 
          SB16_DBG("write() requires to sleep (waiting for slot)\n");
+         kcond_wait(&sb16_cond, &sb16_lock, KCOND_WAIT_FOREVER);
 
-         producer_is_sleeping = true;
-         kernel_sleep_ms(100);
-         task_cancel_wakeup_timer(get_curr_task());
-
-         if (pending_signals())
+         if (pending_signals()) {
+            kmutex_unlock(&sb16_lock);
             return -EINTR;
-
-         producer_is_sleeping = false;
+         }
       }
-
-   } while (must_sleep);
+   }
+   kmutex_unlock(&sb16_lock);
 
    SB16_DBG("write(): using slot: %u\n", next_slot);
    dest_buf = sb16_info.buf + (next_slot << 15);
@@ -253,6 +359,31 @@ sb16_write(fs_handle h, char *user_buf, size_t size, offt *pos)
    return (ssize_t)sz;
 }
 
+/* Not playing or, in ring-buffer mode, paused because of an underrun */
+static bool
+sb16_is_idle(void)
+{
+   return !sb16_playing || (ring_mode && ring_paused);
+}
+
+/* Resets the ring-buffer state. Must be called with the device idle. */
+static void
+sb16_ring_reset(bool enable_ring_mode)
+{
+   ASSERT(sb16_is_idle());
+
+   disable_interrupts_forced();
+   {
+      sb16_playing = false;
+      ring_mode = enable_ring_mode;
+      ring_paused = false;
+      ring_draining = false;
+      ring_hw_pos = 0;
+      ring_appl_pos = 0;
+   }
+   enable_interrupts_forced();
+}
+
 static int
 sb16_ioctl_sound_setup(struct tilck_sound_params *user_params)
 {
@@ -261,9 +392,11 @@ sb16_ioctl_sound_setup(struct tilck_sound_params *user_params)
       return -EPERM;
    }
 
-   if (sb16_playing)
+   if (!sb16_is_idle())
       return -EBUSY;
 
+   sb16_ring_reset(false);
+
    if (copy_from_user(&dsp_params, user_params, sizeof(dsp_params)))
       return -EFAULT;
 
@@ -283,6 +416,30 @@ sb16_ioctl_sound_setup(struct tilck_sound_params *user_params)
    return -EINVAL;
 }
 
+/*
+ * Unmaps the DMA buffer from all of its user mappings. Called when the owner
+ * releases the device, because the buffer will be used by the next owner: from
+ * now on, touching any of the old mappings will cause a SIGBUS. Re-acquiring
+ * the device requires mapping the buffer again.
+ */
+static void
+sb16_revoke_mappings(void)
+{
+   struct user_mapping *um, *tmp;
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each(um, tmp, &sb16_mappings, inode_node) {
+
+      unmap_pages_permissive(um->pi->pdir,
+                             um->vaddrp,
+                             um->len >> PAGE_SHIFT,
+                             false);
+
+      list_remove(&um->inode_node);
+      list_node_init(&um->inode_node);
+   }
+}
+
 static void
 sb16_release_on_exit(struct task *ti)
 {
@@ -292,6 +449,7 @@ sb16_release_on_exit(struct task *ti)
       owner = NULL;
    }
    enable_interrupts_forced();
+   sb16_revoke_mappings();
    SB16_DBG("sb16: release ownership from TID: %d\n", ti->tid);
 }
 
@@ -333,6 +491,7 @@ sb16_ioctl_release(void)
 
          unregister_on_task_exit_cb(&sb16_release_on_exit);
          owner = NULL;
+         sb16_revoke_mappings();
       }
    }
    enable_preemption();
@@ -356,28 +515,218 @@ sb16_ioctl_get_info(struct tilck_sound_card_info *user_info)
 }
 
 static int
-sb16_ioctl_wait_for_completion(void)
+sb16_ioctl_ring_setup(struct tilck_sound_ring_params *user_params)
 {
+   struct tilck_sound_ring_params p;
+
    if (get_curr_task() != owner) {
       /* The current task does not own the resource */
       return -EPERM;
    }
 
-   while (sb16_playing) {
+   if (!dsp_params.bits) {
+      /* Audio hasn't been configured with TILCK_IOCTL_SOUND_SETUP yet */
+      return -EINVAL;
+   }
 
-      producer_is_sleeping = true;
-      kernel_sleep_ms(100);
-      task_cancel_wakeup_timer(get_curr_task());
+   if (!sb16_is_idle())
+      return -EBUSY;
 
-      if (pending_signals())
-         return -EINTR;
+   if (copy_from_user(&p, user_params, sizeof(p)))
+      return -EFAULT;
 
-      producer_is_sleeping = false;
+   if (p.period_size < SB16_MIN_PERIOD ||
+       p.period_size > SB16_BUF_SIZE / 2 ||
+       (p.period_size & (p.period_size - 1)))
+   {
+      return -EINVAL;
    }
 
+   sb16_ring_reset(true);
+   ring_period = p.period_size;
+   ring_xruns = 0;         /* The device is idle: no IRQ can touch it */
+   sb16_fill_buf_with_mute(sb16_info.buf, SB16_BUF_SIZE);
+
+   p.ring_size = SB16_BUF_SIZE;
+
+   if (copy_to_user(user_params, &p, sizeof(p)))
+      return -EFAULT;
+
    return 0;
 }
 
+static void
+sb16_ring_start(void)
+{
+   SB16_DBG("sb16: ring: START, period: %u\n", ring_period);
+
+   /* The DMA loops over the whole buffer, the DSP raises an IRQ per period */
+   sb16_playing = true;
+   sb16_program_dma(dsp_params.bits, SB16_BUF_SIZE);
+   sb16_program(&dsp_params, ring_period, true);
+}
+
+static int
+sb16_ring_commit(u32 count)
+{
+   const u32 frame_size = (u32)(dsp_params.bits / 8) * dsp_params.channels;
+   bool start = false;
+   int rc = 0;
+
+   if (count % frame_size)
+      return -EINVAL;
+
+   disable_interrupts_forced();
+   {
+      const u32 used = ring_appl_pos - ring_hw_pos;
+
+      if (count > SB16_BUF_SIZE - used) {
+
+         rc = -EINVAL; /* That would overwrite data not played yet */
+
+      } else {
+
+         ring_appl_pos += count;
+
+         if (used + count >= ring_period) {
+
+            if (!sb16_playing) {
+
+               start = true;
+
+            } else if (ring_paused) {
+
+               SB16_DBG("sb16: ring: CONTINUE at %u\n", ring_hw_pos);
+               ring_paused = false;
+               sb16_continue();
+            }
+         }
+      }
+   }
+   enable_interrupts_forced();
+
+   if (start)
+      sb16_ring_start();
+
+   return rc;
+}
+
+static int
+sb16_ioctl_ring_commit(u32 *user_count)
+{
+   u32 count;
+
+   if (get_curr_task() != owner) {
+      /* The current task does not own the resource */
+      return -EPERM;
+   }
+
+   if (!ring_mode)
+      return -EINVAL;
+
+   if (copy_from_user(&count, user_count, sizeof(count)))
+      return -EFAULT;
+
+   ring_draining = false;
+   return sb16_ring_commit(count);
+}
+
+static int
+sb16_ioctl_get_pos(struct tilck_sound_pos *user_pos)
+{
+   struct tilck_sound_pos pos;
+
+   if (!ring_mode)
+      return -EINVAL;
+
+   disable_interrupts_forced();
+   {
+      pos = (struct tilck_sound_pos) {
+         .hw_pos = ring_hw_pos,
+         .appl_pos = ring_appl_pos,
+         .period_size = ring_period,
+         .xruns = ring_xruns,
+      };
+   }
+   enable_interrupts_forced();
+
+   if (copy_to_user(user_pos, &pos, sizeof(pos)))
+      return -EFAULT;
+
+   return 0;
+}
+
+/*
+ * Ring-buffer mode: pads the last period with silence and waits for the card
+ * to play everything that has been committed.
+ */
+static int
+sb16_ring_drain(void)
+{
+   const u32 rem = ring_appl_pos % ring_period;
+   int rc = 0;
+
+   if (rem) {
+
+      const u32 pad = ring_period - rem;
+      sb16_fill_buf_with_mute(sb16_info.buf + ring_appl_pos % SB16_BUF_SIZE,
+                              pad);
+
+      if ((rc = sb16_ring_commit(pad)))
+         return rc;
+   }
+
+   ring_draining = true;
+
+   kmutex_lock(&sb16_lock);
+   {
+      while (!sb16_is_idle()) {
+
+         kcond_wait(&sb16_cond, &sb16_lock, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            break;
+         }
+      }
+   }
+   kmutex_unlock(&sb16_lock);
+
+   if (!rc)
+      sb16_ring_reset(true);
+
+   return rc;
+}
+
+static int
+sb16_ioctl_wait_for_completion(void)
+{
+   int rc = 0;
+
+   if (get_curr_task() != owner) {
+      /* The current task does not own the resource */
+      return -EPERM;
+   }
+
+   if (ring_mode)
+      return sb16_ring_drain();
+
+   kmutex_lock(&sb16_lock);
+   {
+      while (sb16_playing) {
+
+         kcond_wait(&sb16_cond, &sb16_lock, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            break;
+         }
+      }
+   }
+   kmutex_unlock(&sb16_lock);
+   return rc;
+}
+
 static int
 sb16_ioctl(fs_handle h, ulong request, void *user_argp)
 {
@@ -398,11 +747,77 @@ sb16_ioctl(fs_handle h, ulong request, void *user_argp)
       case TILCK_IOCTL_SOUND_WAIT_COMPLETION:
          return sb16_ioctl_wait_for_completion();
 
+      case TILCK_IOCTL_SOUND_RING_SETUP:
+         return sb16_ioctl_ring_setup(user_argp);
+
+      case TILCK_IOCTL_SOUND_RING_COMMIT:
+         return sb16_ioctl_ring_commit(user_argp);
+
+      case TILCK_IOCTL_SOUND_GET_POS:
+         return sb16_ioctl_get_pos(user_argp);
+
       default:
          return -EINVAL;
    }
 }
 
+static int
+sb16_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   const size_t pg_count = um->len >> PAGE_SHIFT;
+   size_t mapped;
+
+   ASSERT(IS_PAGE_ALIGNED(um->len));
+
+   if (flags & VFS_MM_DONT_MMAP)
+      goto register_mapping;   /* Part of an existing mapping */
+
+   if (get_curr_task() != owner)
+      return -EPERM;
+
+   if (um->off != 0 || um->len > SB16_BUF_SIZE)
+      return -EINVAL;
+
+   mapped = map_pages(pdir,
+                      um->vaddrp,
+                      sb16_info.buf_paddr,
+                      pg_count,
+                      PAGING_FL_RWUS | PAGING_FL_SHARED);
+
+   if (mapped != pg_count) {
+      unmap_pages_permissive(pdir, um->vaddrp, mapped, false);
+      return -ENOMEM;
+   }
+
+register_mapping:
+   if (!(flags & VFS_MM_DONT_REGISTER)) {
+      disable_preemption();
+      {
+         list_add_tail(&sb16_mappings, &um->inode_node);
+      }
+      enable_preemption();
+   }
+
+   return 0;
+}
+
+static int
+sb16_write_ready(fs_handle h)
+{
+   u8 slot;
+
+   if (ring_mode)
+      return SB16_BUF_SIZE - sb16_ring_get_used() >= ring_period;
+
+   return sb16_get_free_slot(&slot);
+}
+
+static struct kcond *
+sb16_get_wready_cond(fs_handle h)
+{
+   return &sb16_cond;
+}
+
 static int
 create_sb16_device(int minor,
                    enum vfs_entry_type *type,
@@ -412,11 +827,15 @@ create_sb16_device(int minor,
       .read = sb16_read,
       .write = sb16_write,
       .ioctl = sb16_ioctl,
+      .mmap = sb16_mmap,
+      .munmap = generic_fs_munmap,
+      .write_ready = sb16_write_ready,
+      .get_wready_cond = sb16_get_wready_cond,
    };
 
    *type = VFS_CHAR_DEV;
    nfo->fops = &static_ops_sb16;
-   nfo->spec_flags = VFS_SPFL_NO_USER_COPY;
+   nfo->spec_flags = VFS_SPFL_NO_USER_COPY | VFS_SPFL_MMAP_SUPPORTED;
    return 0;
 }
 
@@ -472,6 +891,7 @@ static struct module sb16_module = {
    .name = "sb16",
    .priority = MOD_sb16_prio,
    .init = &init_sb16,
+   .async = true,
 };
 
 REGISTER_MODULE(&sb16_module);
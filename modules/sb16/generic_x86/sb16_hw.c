@@ -180,7 +180,7 @@ sb16_set_sample_rate(u16 sample_rate)
 }
 
 void
-sb16_program(struct tilck_sound_params *p, u32 buf_sz)
+sb16_program(struct tilck_sound_params *p, u32 buf_sz, bool ainit)
 {
    u8 prog_mode = 0;
    u8 sound_fmt = 0;
@@ -188,7 +188,7 @@ sb16_program(struct tilck_sound_params *p, u32 buf_sz)
 
    prog_mode |= DSP_PLAY;
 
-   if (buf_sz == 32 * KB) {
+   if (ainit) {
       SB16_DBG("prog DSP in AUTO_INIT mode\n");
       prog_mode |= DSP_AUTO_INIT;
    } else {
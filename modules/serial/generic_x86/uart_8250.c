@@ -31,6 +31,10 @@
 #define IER_SLEEP_MODE_INTR        0b00010000
 #define IER_LOW_PWR_INTR           0b00100000
 
+/* Interrupt Identification Register (IIR) */
+#define IIR_NO_INTR_PENDING        0b00000001
+#define IIR_FIFO_ENABLED           0b11000000 /* Both bits set on 16550A */
+
 /* Line Status Register (LSR) */
 #define LSR_DATA_READY             0b00000001
 #define LSR_OVERRUN_ERROR          0b00000010
@@ -96,6 +100,9 @@
 #define MSR_RI                     0b01000000 /* Ring Indicator */
 #define MSR_CD                     0b10000000 /* Carrier Detect */
 
+/* Size of the TX FIFO on 16550A UARTs */
+#define UART_FIFO_SIZE             16
+
 /* Set DLAB [Divisor Latch Access Bit] to `value` */
 static void uart_set_dlab(u16 port, bool value)
 {
@@ -129,6 +136,22 @@ void init_serial_port(u16 port)
    outb(port + UART_IER, IER_RCV_AVAIL_INTR);
 }
 
+/*
+ * Checks that there's an UART at `port` by using its scratch register. Reading
+ * from a missing device's I/O ports returns 0xFF, which would look like an UART
+ * always having data ready.
+ */
+bool serial_port_exists(u16 port)
+{
+   outb(port + UART_SR, 0x5A);
+
+   if (inb(port + UART_SR) != 0x5A)
+      return false;
+
+   outb(port + UART_SR, 0xA5);
+   return inb(port + UART_SR) == 0xA5;
+}
+
 bool serial_read_ready(u16 port)
 {
    return !!(inb(port + UART_LSR) & LSR_DATA_READY);
@@ -160,3 +183,44 @@ void serial_write(u16 port, char c)
    serial_wait_for_write(port);
    outb(port, (u8)c);
 }
+
+void serial_write_no_wait(u16 port, char c)
+{
+   outb(port, (u8)c);
+}
+
+/*
+ * Returns how many bytes can be written to the UART at once, each time the
+ * transmitter holding register becomes empty: the whole FIFO on 16550A UARTs
+ * (init_serial_port() enables it) and just 1 byte on older UARTs, because
+ * their FIFO is either missing or unusable.
+ */
+u32 serial_get_tx_fifo_size(u16 port)
+{
+   const u8 iir = inb(port + UART_IIR);
+   return (iir & IIR_FIFO_ENABLED) == IIR_FIFO_ENABLED ? UART_FIFO_SIZE : 1;
+}
+
+void serial_enable_tx_intr(u16 port, bool enabled)
+{
+   u8 ier = inb(port + UART_IER);
+
+   if (enabled)
+      ier |= IER_TR_EMPTY_INTR;
+   else
+      ier &= (u8)~IER_TR_EMPTY_INTR;
+
+   outb(port + UART_IER, ier);
+}
+
+void serial_enable_rx_intr(u16 port, bool enabled)
+{
+   u8 ier = inb(port + UART_IER);
+
+   if (enabled)
+      ier |= IER_RCV_AVAIL_INTR;
+   else
+      ier &= (u8)~IER_RCV_AVAIL_INTR;
+
+   outb(port + UART_IER, ier);
+}
@@ -11,18 +11,46 @@
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/safe_ringbuf.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/interrupts.h>
 
 #include <tilck/mods/serial.h>
 
+#define SERIAL_TX_BUF_SIZE                      (2 * KB)
+#define SERIAL_RX_BUF_SIZE                      (4 * KB)
+#define SERIAL_RX_CHUNK_SIZE                    64
+
 /* NOTE: hw-specific stuff in generic code. TODO: fix that. */
 
 struct serial_device {
 
    const char *name;
    u16 ioport;
+   bool present;
    struct tty *tty;
-   ATOMIC(int) jobs_cnt;
    struct worker_thread *wth;
+
+   /*
+    * RX state. The IRQ handler drains the whole UART's FIFO into `rx_rb` and
+    * enqueues a single bottom half (`rx_bh_pending`), pushing the data to the
+    * tty in chunks. When `rx_rb` is full, the RX interrupt is disabled leaving
+    * the data in the UART (`rx_throttled`), until the bottom half makes room.
+    */
+   struct safe_ringbuf rx_rb;
+   ATOMIC(bool) rx_bh_pending;
+   bool rx_throttled;         /* protected by disabling the interrupts */
+
+   /*
+    * TX state. The ring buffer is drained by the THRE (transmitter holding
+    * register empty) interrupt handler, writing up to `tx_fifo_size` bytes at
+    * a time. Everything here is protected by disabling the interrupts.
+    */
+   struct ringbuf tx_rb;
+   u32 tx_fifo_size;
+   bool tx_active;            /* THRE interrupt enabled */
 };
 
 struct serial_device legacy_serial_ports[] =
@@ -45,31 +73,194 @@ struct serial_device legacy_serial_ports[] =
    },
 };
 
-static void ser_bh_handler(void *ctx)
+static struct serial_device *serial_get_dev(u16 port)
+{
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+      if (legacy_serial_ports[i].ioport == port)
+         return &legacy_serial_ports[i];
+
+   return NULL;
+}
+
+static ALWAYS_INLINE bool ser_tx_is_ready(struct serial_device *dev)
+{
+   return dev && dev->tx_rb.buf != NULL;
+}
+
+/*
+ * Moves data from the ring buffer to the UART, if it's ready to accept it, and
+ * enables the THRE interrupt only while there's something left to transmit.
+ * Must be called with interrupts disabled.
+ */
+static void ser_tx_fill_fifo(struct serial_device *dev)
 {
-   struct serial_device *const dev = ctx;
-   struct tty *const t = dev->tty;
    const u16 p = dev->ioport;
-   char c;
+   bool pending;
+   u8 c;
 
-   while (serial_read_ready(p)) {
+   ASSERT(!are_interrupts_enabled());
 
-      c = serial_read(p);
-      tty_send_keyevent(t, make_key_event(0, c, true), true);
+   if (serial_write_ready(p)) {
+
+      for (u32 i = 0; i < dev->tx_fifo_size; i++) {
+
+         if (!ringbuf_read_elem1(&dev->tx_rb, &c))
+            break;
+
+         serial_write_no_wait(p, (char)c);
+      }
    }
 
-   dev->jobs_cnt--;
+   pending = !ringbuf_is_empty(&dev->tx_rb);
+
+   if (pending != dev->tx_active) {
+      serial_enable_tx_intr(p, pending);
+      dev->tx_active = pending;
+   }
 }
 
-static enum irq_action serial_con_irq_handler(void *ctx)
+static bool ser_tx_irq_handler(struct serial_device *dev)
+{
+   ulong var;
+
+   if (!dev->tx_active || !serial_write_ready(dev->ioport))
+      return false;
+
+   disable_interrupts(&var);
+   {
+      ser_tx_fill_fifo(dev);
+   }
+   enable_interrupts(&var);
+   return true;
+}
+
+static bool ser_tx_can_sleep(void)
+{
+   return !in_irq() && is_preemption_enabled() && are_interrupts_enabled();
+}
+
+/*
+ * Wait until there's some free space in the ring buffer. Sleeping for a tick
+ * is enough for the THRE interrupt handler to transmit several FIFOs worth of
+ * data. We don't rely on a wake-up from the interrupt handler because that
+ * would require a job on the serial worker thread, which might be blocked
+ * pushing input to a tty nobody is reading from.
+ */
+static void ser_tx_wait(struct serial_device *dev)
+{
+   ulong var;
+
+   if (ser_tx_can_sleep())
+      kernel_sleep(1);
+
+   disable_interrupts(&var);
+   {
+      if (ringbuf_is_full(&dev->tx_rb)) {
+
+         /*
+          * We cannot sleep or the THRE interrupt didn't arrive in time. Move
+          * some data manually.
+          */
+         serial_wait_for_write(dev->ioport);
+         ser_tx_fill_fifo(dev);
+      }
+   }
+   enable_interrupts(&var);
+}
+
+static void
+ser_tx_write_polled(struct serial_device *dev,
+                    u16 port,
+                    const char *buf,
+                    size_t len)
+{
+   ulong var;
+   u8 c;
+
+   if (ser_tx_is_ready(dev)) {
+
+      /* Data still in the ring buffer must be written first */
+      disable_interrupts(&var);
+      {
+         while (ringbuf_read_elem1(&dev->tx_rb, &c))
+            serial_write(port, (char)c);
+      }
+      enable_interrupts(&var);
+   }
+
+   for (size_t i = 0; i < len; i++)
+      serial_write(port, buf[i]);
+}
+
+void serial_tx_write(u16 port, const char *buf, size_t len)
+{
+   struct serial_device *dev = serial_get_dev(port);
+   ulong var;
+   size_t n;
+
+   if (!ser_tx_is_ready(dev) || UNLIKELY(in_panic())) {
+      ser_tx_write_polled(dev, port, buf, len);
+      return;
+   }
+
+   while (true) {
+
+      disable_interrupts(&var);
+      {
+         n = ringbuf_write_bytes(&dev->tx_rb, (u8 *)buf, len);
+         ser_tx_fill_fifo(dev);
+      }
+      enable_interrupts(&var);
+
+      buf += n;
+      len -= n;
+
+      if (!len)
+         break;
+
+      ser_tx_wait(dev);
+   }
+}
+
+static u32 ser_rx_read_chunk(struct serial_device *dev, char *buf, u32 size)
+{
+   u32 n = 0;
+
+   while (n < size && safe_ringbuf_read_1(&dev->rx_rb, &buf[n]))
+      n++;
+
+   return n;
+}
+
+static void ser_rx_bh(void *ctx)
 {
    struct serial_device *const dev = ctx;
+   char buf[SERIAL_RX_CHUNK_SIZE];
+   ulong var;
+   u32 n;
 
-   if (!serial_read_ready(dev->ioport))
-      return IRQ_NOT_HANDLED; /* Not an IRQ from this "device" [irq sharing] */
+   /* From now on, the IRQ handler will have to enqueue a new job */
+   atomic_store_explicit(&dev->rx_bh_pending, false, mo_relaxed);
 
-   if (dev->jobs_cnt >= 2)
-      return IRQ_HANDLED;
+   while ((n = ser_rx_read_chunk(dev, buf, sizeof(buf))) > 0) {
+
+      /* We made some room in `rx_rb`: let the UART interrupt us again */
+      disable_interrupts(&var);
+      {
+         if (dev->rx_throttled) {
+            dev->rx_throttled = false;
+            serial_enable_rx_intr(dev->ioport, true);
+         }
+      }
+      enable_interrupts(&var);
+
+      tty_send_input(dev->tty, buf, n, true);
+   }
+}
+
+static void ser_rx_schedule_bh(struct serial_device *dev)
+{
+   bool exp = false;
 
    if (UNLIKELY(in_panic())) {
 
@@ -77,19 +268,69 @@ static enum irq_action serial_con_irq_handler(void *ctx)
       ulong val;
       disable_interrupts(&val);
       {
-         dev->jobs_cnt++;
-         ser_bh_handler(dev);
+         ser_rx_bh(dev);
       }
       enable_interrupts(&val);
-      return IRQ_HANDLED;
+      return;
+   }
+
+   if (!atomic_cas_strong(&dev->rx_bh_pending, &exp, true,
+                          mo_relaxed, mo_relaxed))
+   {
+      return; /* The bottom half will consume our data as well */
    }
 
-   if (!wth_enqueue_on(dev->wth, &ser_bh_handler, dev)) {
+   if (!wth_enqueue_on(dev->wth, &ser_rx_bh, dev)) {
+
+      /* The data stays in `rx_rb`: the next IRQ will retry */
+      atomic_store_explicit(&dev->rx_bh_pending, false, mo_relaxed);
       printk("Serial: WARNING: hit job queue limit\n");
-      return IRQ_HANDLED;
    }
+}
+
+/* Moves everything in the UART's RX FIFO to `rx_rb` */
+static bool ser_rx_irq_handler(struct serial_device *dev)
+{
+   const u16 p = dev->ioport;
+   bool was_empty;
+   char c;
+
+   if (!serial_read_ready(p))
+      return false;
+
+   do {
+
+      if (safe_ringbuf_is_full(&dev->rx_rb)) {
+
+         /* Leave the data in the UART: the bottom half will resume RX */
+         serial_enable_rx_intr(p, false);
+         dev->rx_throttled = true;
+         break;
+      }
+
+      c = serial_read(p);
+      safe_ringbuf_write_1(&dev->rx_rb, &c, &was_empty);
+
+   } while (serial_read_ready(p));
+
+   ser_rx_schedule_bh(dev);
+   return true;
+}
+
+static enum irq_action serial_con_irq_handler(void *ctx)
+{
+   struct serial_device *const dev = ctx;
+   bool tx_handled, rx_handled;
+
+   if (!dev->present)
+      return IRQ_NOT_HANDLED;
+
+   tx_handled = ser_tx_irq_handler(dev);
+   rx_handled = ser_rx_irq_handler(dev);
+
+   if (!tx_handled && !rx_handled)
+      return IRQ_NOT_HANDLED; /* Not an IRQ from this "device" [irq sharing] */
 
-   dev->jobs_cnt++;
    return IRQ_HANDLED;
 }
 
@@ -106,9 +347,39 @@ DEFINE_IRQ_HANDLER_NODE(com2, serial_con_irq_handler, &legacy_serial_ports[1]);
 DEFINE_IRQ_HANDLER_NODE(com3, serial_con_irq_handler, &legacy_serial_ports[2]);
 DEFINE_IRQ_HANDLER_NODE(com4, serial_con_irq_handler, &legacy_serial_ports[3]);
 
+static void ser_tx_init(struct serial_device *dev)
+{
+   void *buf;
+   ulong var;
+
+   if (!(buf = kmalloc(SERIAL_TX_BUF_SIZE))) {
+      printk("Serial: no memory for the %s TX buffer\n", dev->name);
+      return;  /* Fall back to polled writes */
+   }
+
+   dev->tx_fifo_size = serial_get_tx_fifo_size(dev->ioport);
+
+   disable_interrupts(&var);
+   {
+      ringbuf_init(&dev->tx_rb, SERIAL_TX_BUF_SIZE, 1, buf);
+   }
+   enable_interrupts(&var);
+}
+
+static void ser_rx_init(struct serial_device *dev)
+{
+   void *buf;
+
+   if (!(buf = kmalloc(SERIAL_RX_BUF_SIZE)))
+      panic("Serial: no memory for the %s RX buffer", dev->name);
+
+   safe_ringbuf_init(&dev->rx_rb, SERIAL_RX_BUF_SIZE, 1, buf);
+}
+
 static void init_serial_comm(void)
 {
    struct worker_thread *wth;
+   ulong var;
 
    disable_preemption();
    {
@@ -125,12 +396,37 @@ static void init_serial_comm(void)
 
       dev->tty = get_serial_tty((int)i);
       dev->wth = wth;
+      dev->present = serial_port_exists(dev->ioport);
+
+      if (dev->present)
+         ser_rx_init(dev);
    }
 
    irq_install_handler(X86_PC_COM1_COM3_IRQ, &com1);
    irq_install_handler(X86_PC_COM1_COM3_IRQ, &com3);
    irq_install_handler(X86_PC_COM2_COM4_IRQ, &com2);
    irq_install_handler(X86_PC_COM2_COM4_IRQ, &com4);
+
+   /*
+    * Switch to the IRQ-driven TX only after installing the IRQ handlers and
+    * only for the ports having an UART: the others keep the polled writes.
+    */
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+      if (legacy_serial_ports[i].present)
+         ser_tx_init(&legacy_serial_ports[i]);
+
+   /*
+    * Data received before installing the IRQ handlers might be still in the
+    * FIFOs, with its interrupt already signalled and lost: with edge-triggered
+    * IRQs, we'd never get another one. Drain the FIFOs once, manually.
+    */
+   disable_interrupts(&var);
+   {
+      for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+         if (legacy_serial_ports[i].present)
+            ser_rx_irq_handler(&legacy_serial_ports[i]);
+   }
+   enable_interrupts(&var);
 }
 
 static struct module serial_module = {
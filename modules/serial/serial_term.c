@@ -56,14 +56,21 @@ static void
 sterm_action_write(term *_t, const char *buf, size_t len)
 {
    struct sterm *const t = _t;
+   const u16 port = t->serial_port_fwd;
+   size_t start = 0;
 
-   for (u32 i = 0; i < len; i++) {
+   for (size_t i = 0; i < len; i++) {
 
-      if (buf[i] == '\n')
-         serial_write(t->serial_port_fwd, '\r');
+      if (buf[i] == '\n') {
 
-      serial_write(t->serial_port_fwd, buf[i]);
+         /* Translate \n to \r\n: the \n gets written with the next chunk */
+         serial_tx_write(port, buf + start, i - start);
+         serial_tx_write(port, "\r", 1);
+         start = i;
+      }
    }
+
+   serial_tx_write(port, buf + start, len - start);
 }
 
 static ALWAYS_INLINE void
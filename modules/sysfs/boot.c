@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_prof.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/boot: boot-time profiler
+ *
+ *    info        [ro] total boot time, estimated TSC frequency, phases count
+ *    phases      [ro] one line per boot phase (see below)
+ *
+ * Each line in `phases` has the format:
+ *
+ *    <start> <duration> <start_us> <duration_us> <tid> <flags> <name>
+ *
+ * Where start and duration are in TSC cycles since the beginning of kmain(),
+ * the _us fields are 0 if the TSC frequency is still unknown and <flags> is
+ * a combination of 'm' (kernel module) and 'a' (async), or '-'.
+ */
+
+#define PHASE_LINE_MAX_LEN          160
+
+static offt
+boot_info_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   struct boot_prof_info info;
+   boot_prof_get_info(&info);
+
+   return snprintk(buf, (size_t)sz,
+                   "total_cycles: %" PRIu64 "\n"
+                   "total_us: %" PRIu64 "\n"
+                   "tsc_hz: %" PRIu64 "\n"
+                   "phases: %u\n"
+                   "lost: %u\n",
+                   info.total_cycles,
+                   boot_prof_cycles_to_us(info.total_cycles, info.tsc_hz),
+                   info.tsc_hz,
+                   info.count,
+                   info.lost);
+}
+
+static const struct sysobj_prop_type boot_info_ptype = {
+   .load = &boot_info_load,
+};
+
+static offt
+boot_phases_get_buf_sz(struct sysobj *obj, void *data)
+{
+   struct boot_prof_info info;
+   boot_prof_get_info(&info);
+   return PHASE_LINE_MAX_LEN * (offt)info.count;
+}
+
+static offt
+boot_phases_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   struct boot_prof_info info;
+   struct boot_phase ph;
+   char *p = buf;
+   char *end = p + sz;
+   char flags[3];
+   char *f;
+
+   ASSERT(off == 0);
+   boot_prof_get_info(&info);
+
+   for (u32 i = 0; end - p >= PHASE_LINE_MAX_LEN; i++) {
+
+      if (!boot_prof_get_phases(&ph, i, 1))
+         break;
+
+      f = flags;
+
+      if (ph.flags & BOOT_PH_MODULE)
+         *f++ = 'm';
+
+      if (ph.flags & BOOT_PH_ASYNC)
+         *f++ = 'a';
+
+      if (f == flags)
+         *f++ = '-';
+
+      *f = 0;
+
+      p += snprintk(p, (size_t)(end - p),
+                    "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+                    " %d %s %.40s\n",
+                    ph.start, ph.cycles,
+                    boot_prof_cycles_to_us(ph.start, info.tsc_hz),
+                    boot_prof_cycles_to_us(ph.cycles, info.tsc_hz),
+                    ph.tid, flags, ph.name);
+   }
+
+   return p - (char *)buf;
+}
+
+static const struct sysobj_prop_type boot_phases_ptype = {
+   .get_buf_sz = &boot_phases_get_buf_sz,
+   .load = &boot_phases_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(info, &boot_info_ptype);
+DEF_STATIC_SYSOBJ_PROP(phases, &boot_phases_ptype);
+
+void sysfs_create_boot_obj(void)
+{
+   struct sysobj *boot;
+
+   boot = sysfs_create_custom_obj(
+      "boot",
+      NULL,       /* hooks */
+      &prop_info, NULL,
+      &prop_phases, NULL,
+      NULL
+   );
+
+   if (!boot)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "boot", boot))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs boot obj");
+}
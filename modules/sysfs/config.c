@@ -37,6 +37,9 @@ DEF_STATIC_CONF_RO(ULONG, user_stack_pages,        USER_STACK_PAGES);
 DEF_STATIC_CONF_RO(BOOL,  track_nested_int,        KRN_TRACK_NESTED_INTERR);
 DEF_STATIC_CONF_RO(BOOL,  panic_backtrace,         PANIC_SHOW_STACKTRACE);
 DEF_STATIC_CONF_RO(BOOL,  panic_regs,              PANIC_SHOW_REGS);
+DEF_STATIC_CONF_RO(BOOL,  lockstat,                KERNEL_LOCKSTAT);
+DEF_STATIC_CONF_RO(BOOL,  syscall_stats,           KERNEL_SYSCALL_STATS);
+DEF_STATIC_CONF_RO(BOOL,  irqsoff_tracer,          KERNEL_IRQSOFF_TRACER);
 DEF_STATIC_CONF_RO(BOOL,  selftests,               KERNEL_SELFTESTS);
 DEF_STATIC_CONF_RO(BOOL,  stack_isolation,         KERNEL_STACK_ISOLATION);
 DEF_STATIC_CONF_RO(BOOL,  symbols,                 KERNEL_SYMBOLS);
@@ -45,7 +48,9 @@ DEF_STATIC_CONF_RO(BOOL,  resched_enable_preempt,  KRN_RESCHED_ENABLE_PREEMPT);
 DEF_STATIC_CONF_RO(BOOL,  big_io_buf,              KERNEL_BIG_IO_BUF);
 DEF_STATIC_CONF_RO(BOOL,  gcov,                    KERNEL_GCOV);
 DEF_STATIC_CONF_RO(BOOL,  fork_no_cow,             FORK_NO_COW);
+DEF_STATIC_CONF_RO(BOOL,  fork_lazy_pt_copy,       FORK_LAZY_PT_COPY);
 DEF_STATIC_CONF_RO(BOOL,  mmap_no_cow,             MMAP_NO_COW);
+DEF_STATIC_CONF_RO(BOOL,  mmap_transp_big_pages,   MMAP_TRANSP_BIG_PAGES);
 DEF_STATIC_CONF_RO(BOOL,  ubsan,                   KERNEL_UBSAN);
 DEF_STATIC_CONF_RO(BOOL,  kernel_64bit_offt,       KERNEL_64BIT_OFFT);
 DEF_STATIC_CONF_RO(BOOL,  clock_drift_comp,        KRN_CLOCK_DRIFT_COMP);
@@ -54,9 +59,11 @@ DEF_STATIC_CONF_RO(BOOL,  clock_drift_comp,        KRN_CLOCK_DRIFT_COMP);
 DEF_STATIC_CONF_RO(ULONG, big_font_threshold,      FBCON_BIGFONT_THR);
 DEF_STATIC_CONF_RO(BOOL,  banner,                  FB_CONSOLE_BANNER);
 DEF_STATIC_CONF_RO(BOOL,  cursor_blink,            FB_CONSOLE_CURSOR_BLINK);
+DEF_STATIC_CONF_RO(BOOL,  shadow_buf,              FB_CONSOLE_SHADOW_BUF);
 DEF_STATIC_CONF_RO(BOOL,  use_alt_fonts,           FB_CONSOLE_USE_ALT_FONTS);
 DEF_STATIC_CONF_RO(BOOL,  show_logo,               KERNEL_SHOW_LOGO);
 DEF_STATIC_CONF_RO(BOOL,  big_scroll_buf,          TERM_BIG_SCROLL_BUF);
+DEF_STATIC_CONF_RO(BOOL,  deferred_render,         TERM_DEFERRED_RENDER);
 DEF_STATIC_CONF_RO(BOOL,  failsafe_opt,            FB_CONSOLE_FAILSAFE_OPT);
 
 /* config/modules */
@@ -101,6 +108,9 @@ void sysfs_create_config_obj(void)
       SYSOBJ_CONF_PROP_PAIR(track_nested_int),
       SYSOBJ_CONF_PROP_PAIR(panic_backtrace),
       SYSOBJ_CONF_PROP_PAIR(panic_regs),
+      SYSOBJ_CONF_PROP_PAIR(lockstat),
+      SYSOBJ_CONF_PROP_PAIR(syscall_stats),
+      SYSOBJ_CONF_PROP_PAIR(irqsoff_tracer),
       SYSOBJ_CONF_PROP_PAIR(selftests),
       SYSOBJ_CONF_PROP_PAIR(stack_isolation),
       SYSOBJ_CONF_PROP_PAIR(symbols),
@@ -109,7 +119,9 @@ void sysfs_create_config_obj(void)
       SYSOBJ_CONF_PROP_PAIR(big_io_buf),
       SYSOBJ_CONF_PROP_PAIR(gcov),
       SYSOBJ_CONF_PROP_PAIR(fork_no_cow),
+      SYSOBJ_CONF_PROP_PAIR(fork_lazy_pt_copy),
       SYSOBJ_CONF_PROP_PAIR(mmap_no_cow),
+      SYSOBJ_CONF_PROP_PAIR(mmap_transp_big_pages),
       SYSOBJ_CONF_PROP_PAIR(ubsan),
       SYSOBJ_CONF_PROP_PAIR(kernel_64bit_offt),
       SYSOBJ_CONF_PROP_PAIR(clock_drift_comp),
@@ -128,9 +140,11 @@ void sysfs_create_config_obj(void)
       SYSOBJ_CONF_PROP_PAIR(big_font_threshold),
       SYSOBJ_CONF_PROP_PAIR(banner),
       SYSOBJ_CONF_PROP_PAIR(cursor_blink),
+      SYSOBJ_CONF_PROP_PAIR(shadow_buf),
       SYSOBJ_CONF_PROP_PAIR(use_alt_fonts),
       SYSOBJ_CONF_PROP_PAIR(show_logo),
       SYSOBJ_CONF_PROP_PAIR(big_scroll_buf),
+      SYSOBJ_CONF_PROP_PAIR(deferred_render),
       SYSOBJ_CONF_PROP_PAIR(failsafe_opt),
       NULL
    );
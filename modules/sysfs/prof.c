@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/profiler.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * /syst/prof: sampling profiler
+ *
+ *    enabled     [rw] writing 1 (re)starts the profiler, writing 0 stops it
+ *    info        [ro] number of samples in the buffer and lost samples
+ *    samples     [ro] one fixed-width line per sample (see below)
+ *
+ * Each line in `samples` has the format:
+ *
+ *    <flags> <tid> <ip> <frame 0> ... <frame PROF_MAX_FRAMES - 1>
+ *
+ * Where all the fields are hex numbers and the missing frames are zero. The
+ * addresses are NOT symbolized here: the `prof` user app does that.
+ */
+
+#if NBITS == 32
+   #define ADDR_FMT                   " %08lx"
+#else
+   #define ADDR_FMT                   " %016lx"
+#endif
+
+#define ADDR_LEN                   ((int)sizeof(ulong) * 2)
+#define SAMPLE_LINE_LEN            (10 + (PROF_MAX_FRAMES + 1) * (ADDR_LEN + 1))
+
+static offt
+prof_enabled_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   struct prof_info info;
+   prof_get_info(&info);
+   return snprintk(buf, (size_t)sz, "%u\n", info.enabled);
+}
+
+static offt
+prof_enabled_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   char *s = buf;
+   int rc;
+
+   if (s[0] != '0' && s[0] != '1')
+      return -EINVAL;
+
+   if (s[1] && s[1] != '\n' && s[1] != '\r')
+      return -EINVAL;
+
+   if (s[0] == '1') {
+
+      if ((rc = prof_start()))
+         return rc;
+
+   } else {
+
+      prof_stop();
+   }
+
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type prof_enabled_ptype = {
+   .load = &prof_enabled_load,
+   .store = &prof_enabled_store,
+};
+
+static offt
+prof_info_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   struct prof_info info;
+   prof_get_info(&info);
+
+   return snprintk(buf, (size_t)sz,
+                   "samples: %u\nlost: %u\nmax_samples: %u\nmax_frames: %u\n",
+                   info.count, info.lost, PROF_MAX_SAMPLES, PROF_MAX_FRAMES);
+}
+
+static const struct sysobj_prop_type prof_info_ptype = {
+   .load = &prof_info_load,
+};
+
+/*
+ * NOTE: the samples file is loaded in a per-handle buffer at open() time and
+ * it's sized by the number of samples at that moment (see sysfs.h): readers
+ * get a consistent snapshot, even if the profiler keeps running or it's
+ * restarted while reading. The buffer is never empty, because a size of 0
+ * would make sysfs call load() on each read() instead.
+ */
+static offt
+prof_samples_get_buf_sz(struct sysobj *obj, void *data)
+{
+   struct prof_info info;
+   prof_get_info(&info);
+   return (offt)MAX(info.count, 1u) * SAMPLE_LINE_LEN;
+}
+
+/* Writes exactly SAMPLE_LINE_LEN chars in `line`, without a NUL terminator */
+static void prof_sample_to_line(struct prof_sample *s, char *line)
+{
+   char *p = line;
+
+   p += snprintk(p, 11, "%1x %08x", s->flags, s->tid);
+   p += snprintk(p, (size_t)ADDR_LEN + 2, ADDR_FMT, s->ip);
+
+   for (int i = 0; i < PROF_MAX_FRAMES; i++) {
+      ulong f = i < s->depth ? s->frames[i] : 0;
+      p += snprintk(p, (size_t)ADDR_LEN + 2, ADDR_FMT, f);
+   }
+
+   *p++ = '\n';
+   ASSERT(p - line == SAMPLE_LINE_LEN);
+}
+
+static offt
+prof_samples_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   struct prof_sample s;
+   char *p = buf;
+   char *end = p + sz;
+
+   ASSERT(off == 0);
+
+   for (u32 i = 0; end - p >= SAMPLE_LINE_LEN; i++) {
+
+      if (prof_get_samples(&s, i, 1) != 1)
+         break;
+
+      prof_sample_to_line(&s, p);
+      p += SAMPLE_LINE_LEN;
+   }
+
+   return p - (char *)buf;
+}
+
+static const struct sysobj_prop_type prof_samples_ptype = {
+   .get_buf_sz = &prof_samples_get_buf_sz,
+   .load = &prof_samples_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(enabled, &prof_enabled_ptype);
+DEF_STATIC_SYSOBJ_PROP(info, &prof_info_ptype);
+DEF_STATIC_SYSOBJ_PROP(samples, &prof_samples_ptype);
+
+void sysfs_create_prof_obj(void)
+{
+   struct sysobj *prof;
+
+   prof = sysfs_create_custom_obj(
+      "prof",
+      NULL,       /* hooks */
+      &prop_enabled, NULL,
+      &prop_info, NULL,
+      &prop_samples, NULL,
+      NULL
+   );
+
+   if (!prof)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "prof", prof))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs prof obj");
+}
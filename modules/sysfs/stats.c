@@ -0,0 +1,682 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/config_kmalloc.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/irqsoff.h>
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
+#include <tilck/kernel/errno.h>
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/* Formats a code address as <symbol>+<offset> or, if unknown, as a pointer */
+static void
+stats_fmt_site(ulong va, char *buf, size_t buf_sz)
+{
+   const char *sym;
+   long off;
+
+   if ((sym = find_sym_at_addr(va, &off, NULL)))
+      snprintk(buf, buf_sz, "%s+%ld", sym, off);
+   else
+      snprintk(buf, buf_sz, "%p", TO_PTR(va));
+}
+
+#if KERNEL_LOCKSTAT
+
+#define LOCKSTAT_LINE_MAX_LEN          128
+
+/*
+ * /syst/stats/locks/classes
+ *
+ * One line per lock class, sorted by total wait time. The file is loaded once
+ * at open(), so each reader gets a consistent snapshot.
+ */
+
+static offt
+lockstat_classes_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return LOCKSTAT_LINE_MAX_LEN * (LOCKSTAT_MAX_CLASSES + 2);
+}
+
+static offt
+lockstat_classes_load(struct sysobj *obj,
+                      void *data, void *buf, offt buf_sz, offt off)
+{
+   struct lockstat_class *arr;
+   char *p = buf;
+   char *end = p + buf_sz;
+   int n;
+
+   ASSERT(off == 0);
+
+   if (!(arr = kalloc_array_obj(struct lockstat_class, LOCKSTAT_MAX_CLASSES)))
+      return -ENOMEM;
+
+   n = lockstat_get_classes(arr, LOCKSTAT_MAX_CLASSES);
+
+   p += snprintk(p, (size_t)(end - p),
+                 "%-32s %-12s %10s %10s %14s %14s\n",
+                 "site", "type", "acquired", "contended",
+                 "wait_cycles", "max_hold");
+
+   for (int i = 0; i < n; i++) {
+
+      struct lockstat_class *c = &arr[i];
+      char site[40];
+
+      stats_fmt_site(c->site, site, sizeof(site));
+
+      p += snprintk(p, (size_t)(end - p),
+                    "%-32s %-12s %10" PRIu64 " %10" PRIu64
+                    " %14" PRIu64 " %14" PRIu64 "\n",
+                    site, lockstat_type_str(c->type),
+                    c->acquired, c->contended,
+                    c->wait_cycles, c->max_hold_cycles);
+   }
+
+   p += snprintk(p, (size_t)(end - p),
+                 "dropped: %u\n", lockstat_get_dropped());
+
+   kfree_array_obj(arr, struct lockstat_class, LOCKSTAT_MAX_CLASSES);
+   return p - (char *)buf;
+}
+
+static const struct sysobj_prop_type lockstat_classes_ptype = {
+   .get_buf_sz = &lockstat_classes_get_buf_sz,
+   .load = &lockstat_classes_load,
+};
+
+/* Writing anything to /syst/stats/locks/reset clears all the counters */
+static offt
+lockstat_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   lockstat_reset();
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type lockstat_reset_ptype = {
+   .store = &lockstat_reset_store,
+};
+
+DEF_STATIC_SYSOBJ_PROP(classes, &lockstat_classes_ptype);
+DEF_STATIC_SYSOBJ_PROP(reset, &lockstat_reset_ptype);
+
+static int sysfs_create_lockstat_obj(struct sysobj *stats)
+{
+   struct sysobj *locks;
+
+   locks = sysfs_create_custom_obj(
+      "locks",
+      NULL,       /* hooks */
+      &prop_classes, NULL,
+      &prop_reset, NULL,
+      NULL
+   );
+
+   if (!locks)
+      return -ENOMEM;
+
+   return sysfs_register_obj(NULL, stats, "locks", locks);
+}
+
+#endif // KERNEL_LOCKSTAT
+
+#if KERNEL_SYSCALL_STATS
+
+#define SYSCALLS_TABLE_LINE_MAX_LEN    96
+#define SYSCALLS_HIST_LINE_MAX_LEN     (40 + 14 * SYSCALL_HIST_BUCKETS)
+#define SYSCALLS_TASKS_LINE_MAX_LEN    96
+
+/*
+ * /syst/stats/syscalls/table     count, total, avg and max cycles per syscall
+ * /syst/stats/syscalls/hist      log2 latency histogram per syscall
+ * /syst/stats/syscalls/tasks     number of syscalls and total cycles per task
+ * /syst/stats/syscalls/reset     [wo] clear all the counters
+ *
+ * The syscalls are sorted by total time. In the histograms, each non-empty
+ * bucket is printed as <log2(cycles)>:<count>.
+ *
+ * All the files are loaded once at open(), sized according to the number of
+ * syscalls (or tasks) at that time: the lines that do not fit anymore at load
+ * time are simply omitted.
+ */
+
+static void get_syscall_name(u32 sn, char *buf, size_t buf_sz)
+{
+   const char *sym = NULL;
+   void *func = get_syscall_func_ptr(sn);
+
+   if (func)
+      sym = find_sym_at_addr((ulong)func, NULL, NULL);
+
+   if (sym)
+      snprintk(buf, buf_sz, "%s", sym);
+   else
+      snprintk(buf, buf_sz, "syscall_%u", sn);
+}
+
+static u32 count_called_syscalls(void)
+{
+   struct syscall_stats s;
+   u32 n = 0;
+
+   for (u32 sn = 0; sn < MAX_SYSCALLS; sn++)
+      if (syscall_stats_get(sn, &s) && s.count)
+         n++;
+
+   return n;
+}
+
+static offt
+syscalls_table_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return SYSCALLS_TABLE_LINE_MAX_LEN * (count_called_syscalls() + 2);
+}
+
+static offt
+syscalls_hist_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return SYSCALLS_HIST_LINE_MAX_LEN * (count_called_syscalls() + 1);
+}
+
+static offt
+syscalls_dump(void *buf, offt buf_sz, offt line_max_len, bool hist)
+{
+   struct syscall_stats s;
+   char *p = buf;
+   char *end = p + buf_sz;
+   char name[32];
+   u32 *sns;
+   u32 n;
+
+   if (!(sns = kalloc_array_obj(u32, MAX_SYSCALLS)))
+      return -ENOMEM;
+
+   n = syscall_stats_get_top(sns, MAX_SYSCALLS);
+
+   if (!hist) {
+      p += snprintk(p, (size_t)(end - p),
+                    "%-24s %10s %14s %12s %12s\n",
+                    "syscall", "count", "tot_cycles", "avg", "max");
+   }
+
+   for (u32 i = 0; i < n && end - p >= line_max_len; i++) {
+
+      syscall_stats_get(sns[i], &s);
+      get_syscall_name(sns[i], name, sizeof(name));
+
+      if (!hist) {
+
+         p += snprintk(p, (size_t)(end - p),
+                       "%-24s %10" PRIu64 " %14" PRIu64
+                       " %12" PRIu64 " %12" PRIu64 "\n",
+                       name, s.count, s.tot_cycles,
+                       s.tot_cycles / s.count, s.max_cycles);
+         continue;
+      }
+
+      p += snprintk(p, (size_t)(end - p), "%-24s", name);
+
+      for (u32 b = 0; b < SYSCALL_HIST_BUCKETS; b++)
+         if (s.hist[b])
+            p += snprintk(p, (size_t)(end - p), " %u:%u", b, s.hist[b]);
+
+      p += snprintk(p, (size_t)(end - p), "\n");
+   }
+
+   kfree_array_obj(sns, u32, MAX_SYSCALLS);
+   return p - (char *)buf;
+}
+
+static offt
+syscalls_table_load(struct sysobj *obj,
+                    void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return syscalls_dump(buf, buf_sz, SYSCALLS_TABLE_LINE_MAX_LEN, false);
+}
+
+static offt
+syscalls_hist_load(struct sysobj *obj,
+                   void *data, void *buf, offt buf_sz, offt off)
+{
+   ASSERT(off == 0);
+   return syscalls_dump(buf, buf_sz, SYSCALLS_HIST_LINE_MAX_LEN, true);
+}
+
+static int count_tasks_cb(void *obj, void *arg)
+{
+   (*(u32 *)arg)++;
+   return 0;
+}
+
+static offt
+syscalls_tasks_get_buf_sz(struct sysobj *obj, void *data)
+{
+   u32 n = 0;
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&count_tasks_cb, &n);
+   }
+   enable_preemption();
+   return SYSCALLS_TASKS_LINE_MAX_LEN * (n + 1);
+}
+
+struct syscalls_tasks_ctx {
+   char *p;
+   char *end;
+};
+
+static int syscalls_tasks_cb(void *obj, void *arg)
+{
+   struct syscalls_tasks_ctx *ctx = arg;
+   struct task *ti = obj;
+   const struct syscall_task_stats *s = &ti->sys_stats;
+   const char *name = ti->kthread_name;
+
+   if (!s->count)
+      return 0;
+
+   if (ctx->end - ctx->p < SYSCALLS_TASKS_LINE_MAX_LEN)
+      return 0;
+
+   if (!name)
+      name = ti->pi->debug_cmdline ? ti->pi->debug_cmdline : "<n/a>";
+
+   ctx->p += snprintk(ctx->p, (size_t)(ctx->end - ctx->p),
+                      "%6d %10" PRIu64 " %14" PRIu64 " %.48s\n",
+                      ti->tid, s->count, s->tot_cycles, name);
+   return 0;
+}
+
+static offt
+syscalls_tasks_load(struct sysobj *obj,
+                    void *data, void *buf, offt buf_sz, offt off)
+{
+   struct syscalls_tasks_ctx ctx = { buf, (char *)buf + buf_sz };
+
+   ASSERT(off == 0);
+
+   ctx.p += snprintk(ctx.p, (size_t)(ctx.end - ctx.p),
+                     "%6s %10s %14s %s\n",
+                     "tid", "syscalls", "tot_cycles", "name");
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&syscalls_tasks_cb, &ctx);
+   }
+   enable_preemption();
+   return ctx.p - (char *)buf;
+}
+
+static offt
+syscalls_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   syscall_stats_reset();
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type syscalls_table_ptype = {
+   .get_buf_sz = &syscalls_table_get_buf_sz,
+   .load = &syscalls_table_load,
+};
+
+static const struct sysobj_prop_type syscalls_hist_ptype = {
+   .get_buf_sz = &syscalls_hist_get_buf_sz,
+   .load = &syscalls_hist_load,
+};
+
+static const struct sysobj_prop_type syscalls_tasks_ptype = {
+   .get_buf_sz = &syscalls_tasks_get_buf_sz,
+   .load = &syscalls_tasks_load,
+};
+
+static const struct sysobj_prop_type syscalls_reset_ptype = {
+   .store = &syscalls_reset_store,
+};
+
+DEF_STATIC_SYSOBJ_PROP(table, &syscalls_table_ptype);
+DEF_STATIC_SYSOBJ_PROP(hist, &syscalls_hist_ptype);
+DEF_STATIC_SYSOBJ_PROP(tasks, &syscalls_tasks_ptype);
+DEF_STATIC_SYSOBJ_PROP2(prop_syscalls_reset, reset, &syscalls_reset_ptype);
+
+static int sysfs_create_syscalls_obj(struct sysobj *stats)
+{
+   struct sysobj *syscalls;
+
+   syscalls = sysfs_create_custom_obj(
+      "syscalls",
+      NULL,       /* hooks */
+      &prop_table, NULL,
+      &prop_hist, NULL,
+      &prop_tasks, NULL,
+      &prop_syscalls_reset, NULL,
+      NULL
+   );
+
+   if (!syscalls)
+      return -ENOMEM;
+
+   return sysfs_register_obj(NULL, stats, "syscalls", syscalls);
+}
+
+#endif // KERNEL_SYSCALL_STATS
+
+#if KERNEL_IRQSOFF_TRACER
+
+#define IRQSOFF_LINE_MAX_LEN           128
+
+/*
+ * /syst/stats/irqsoff/report     worst IRQs-off and preempt-off sections
+ * /syst/stats/irqsoff/reset      [wo] clear all the counters
+ *
+ * For each type of section, the report contains a summary line followed by
+ * the worst offenders, sorted by their longest section.
+ */
+
+static offt
+irqsoff_report_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return IRQSOFF_LINE_MAX_LEN *
+          IRQSOFF_TYPES_COUNT * (IRQSOFF_MAX_OFFENDERS + 3);
+}
+
+static offt
+irqsoff_report_load(struct sysobj *obj,
+                    void *data, void *buf, offt buf_sz, offt off)
+{
+   struct irqsoff_offender arr[IRQSOFF_MAX_OFFENDERS];
+   struct irqsoff_info info;
+   char *p = buf;
+   char *end = p + buf_sz;
+   char start[40], stop[40];
+   int n;
+
+   ASSERT(off == 0);
+
+   for (int t = 0; t < IRQSOFF_TYPES_COUNT; t++) {
+
+      irqsoff_get_info(t, &info);
+      n = irqsoff_get_offenders(t, arr, ARRAY_SIZE(arr));
+
+      p += snprintk(p, (size_t)(end - p),
+                    "%s: sections: %" PRIu64 " avg: %" PRIu64
+                    " max: %" PRIu64 "\n",
+                    irqsoff_type_str(t), info.sections,
+                    info.sections ? info.tot_cycles / info.sections : 0,
+                    info.max_cycles);
+
+      p += snprintk(p, (size_t)(end - p),
+                    "   %-36s %-36s %10s %14s\n",
+                    "start", "end", "count", "max_cycles");
+
+      for (int i = 0; i < n; i++) {
+
+         stats_fmt_site(arr[i].start_site, start, sizeof(start));
+         stats_fmt_site(arr[i].end_site, stop, sizeof(stop));
+
+         p += snprintk(p, (size_t)(end - p),
+                       "   %-36s %-36s %10" PRIu64 " %14" PRIu64 "\n",
+                       start, stop, arr[i].count, arr[i].max_cycles);
+      }
+   }
+
+   return p - (char *)buf;
+}
+
+static offt
+irqsoff_reset_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   irqsoff_reset();
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type irqsoff_report_ptype = {
+   .get_buf_sz = &irqsoff_report_get_buf_sz,
+   .load = &irqsoff_report_load,
+};
+
+static const struct sysobj_prop_type irqsoff_reset_ptype = {
+   .store = &irqsoff_reset_store,
+};
+
+DEF_STATIC_SYSOBJ_PROP(report, &irqsoff_report_ptype);
+DEF_STATIC_SYSOBJ_PROP2(prop_irqsoff_reset, reset, &irqsoff_reset_ptype);
+
+static int sysfs_create_irqsoff_obj(struct sysobj *stats)
+{
+   struct sysobj *irqsoff;
+
+   irqsoff = sysfs_create_custom_obj(
+      "irqsoff",
+      NULL,       /* hooks */
+      &prop_report, NULL,
+      &prop_irqsoff_reset, NULL,
+      NULL
+   );
+
+   if (!irqsoff)
+      return -ENOMEM;
+
+   return sysfs_register_obj(NULL, stats, "irqsoff", irqsoff);
+}
+
+#endif // KERNEL_IRQSOFF_TRACER
+
+#define KMALLOC_HEAPS_LINE_MAX_LEN     (64 + 14 * KMALLOC_FRAG_ORDERS)
+#define KMALLOC_SITES_LINE_MAX_LEN     96
+#define KMALLOC_SITES_MAX             256
+
+/*
+ * /syst/stats/kmalloc/heaps      fragmentation of each heap
+ * /syst/stats/kmalloc/sites      allocations per call site (heavy stats only)
+ *
+ * For each heap (and for all the small heaps together), `heaps` contains the
+ * free memory, the largest free block (= the largest allocation that can
+ * succeed), the percentage of free memory not usable for such an allocation
+ * and the free blocks histogram, with each non-empty bucket printed as
+ * <log2(size)>:<count>. The last line is about all the heaps: when its
+ * `largest` gets small compared to `free`, large allocations are about to
+ * fail, even if there is plenty of free memory.
+ */
+
+static offt
+kmalloc_heaps_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return KMALLOC_HEAPS_LINE_MAX_LEN * (KMALLOC_HEAPS_COUNT + 3);
+}
+
+static char *
+kmalloc_heaps_dump_line(char *p, char *end, const char *name,
+                        struct debug_kmalloc_frag_info *fi)
+{
+   p += snprintk(p, (size_t)(end - p),
+                 "%-6s %10zu %10zu %4d%% %8zu ",
+                 name, fi->free_mem, fi->largest_free_block,
+                 debug_kmalloc_frag_percent(fi), fi->free_blocks_count);
+
+   for (u32 i = 0; i < KMALLOC_FRAG_ORDERS; i++)
+      if (fi->free_blocks[i])
+         p += snprintk(p, (size_t)(end - p), " %u:%zu", i, fi->free_blocks[i]);
+
+   p += snprintk(p, (size_t)(end - p), "\n");
+   return p;
+}
+
+static offt
+kmalloc_heaps_load(struct sysobj *obj,
+                   void *data, void *buf, offt buf_sz, offt off)
+{
+   struct debug_kmalloc_frag_info *fi;
+   struct debug_kmalloc_frag_info tot = {0};
+   char *p = buf;
+   char *end = p + buf_sz;
+   char name[8];
+
+   ASSERT(off == 0);
+
+   if (!(fi = kalloc_obj(struct debug_kmalloc_frag_info)))
+      return -ENOMEM;
+
+   p += snprintk(p, (size_t)(end - p),
+                 "%-6s %10s %10s %5s %8s  %s\n",
+                 "heap", "free", "largest", "frag", "blocks",
+                 "free blocks (log2(size):count)");
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_frag(i, fi))
+         break;
+
+      snprintk(name, sizeof(name), "%d", i);
+      p = kmalloc_heaps_dump_line(p, end, name, fi);
+
+      tot.free_mem += fi->free_mem;
+      tot.free_blocks_count += fi->free_blocks_count;
+      tot.largest_free_block =
+         MAX(tot.largest_free_block, fi->largest_free_block);
+
+      for (u32 j = 0; j < KMALLOC_FRAG_ORDERS; j++)
+         tot.free_blocks[j] += fi->free_blocks[j];
+   }
+
+   debug_kmalloc_get_small_heaps_frag(fi);
+   p = kmalloc_heaps_dump_line(p, end, "small", fi);
+   p = kmalloc_heaps_dump_line(p, end, "total", &tot);
+
+   kfree_obj(fi, struct debug_kmalloc_frag_info);
+   return p - (char *)buf;
+}
+
+static offt
+kmalloc_sites_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return KMALLOC_SITES_LINE_MAX_LEN * (KMALLOC_SITES_MAX + 2);
+}
+
+static offt
+kmalloc_sites_load(struct sysobj *obj,
+                   void *data, void *buf, offt buf_sz, offt off)
+{
+   struct debug_kmalloc_site *arr;
+   char *p = buf;
+   char *end = p + buf_sz;
+   char site[48];
+   int n;
+
+   ASSERT(off == 0);
+
+   if (!KMALLOC_HEAVY_STATS) {
+      p += snprintk(p, (size_t)(end - p),
+                    "Not available: KMALLOC_HEAVY_STATS is disabled\n");
+      return p - (char *)buf;
+   }
+
+   arr = kalloc_array_obj(struct debug_kmalloc_site, KMALLOC_SITES_MAX);
+
+   if (!arr)
+      return -ENOMEM;
+
+   n = debug_kmalloc_get_sites(arr, KMALLOC_SITES_MAX);
+
+   p += snprintk(p, (size_t)(end - p),
+                 "%-40s %10s %14s\n", "site", "count", "bytes");
+
+   for (int i = 0; i < n; i++) {
+
+      stats_fmt_site(arr[i].site, site, sizeof(site));
+
+      p += snprintk(p, (size_t)(end - p),
+                    "%-40s %10zu %14zu\n",
+                    site, arr[i].count, arr[i].bytes);
+   }
+
+   p += snprintk(p, (size_t)(end - p),
+                 "dropped: %zu\n", debug_kmalloc_get_sites_dropped());
+
+   kfree_array_obj(arr, struct debug_kmalloc_site, KMALLOC_SITES_MAX);
+   return p - (char *)buf;
+}
+
+static const struct sysobj_prop_type kmalloc_heaps_ptype = {
+   .get_buf_sz = &kmalloc_heaps_get_buf_sz,
+   .load = &kmalloc_heaps_load,
+};
+
+static const struct sysobj_prop_type kmalloc_sites_ptype = {
+   .get_buf_sz = &kmalloc_sites_get_buf_sz,
+   .load = &kmalloc_sites_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(heaps, &kmalloc_heaps_ptype);
+DEF_STATIC_SYSOBJ_PROP(sites, &kmalloc_sites_ptype);
+
+static int sysfs_create_kmalloc_obj(struct sysobj *stats)
+{
+   struct sysobj *kmalloc_obj;
+
+   kmalloc_obj = sysfs_create_custom_obj(
+      "kmalloc",
+      NULL,       /* hooks */
+      &prop_heaps, NULL,
+      &prop_sites, NULL,
+      NULL
+   );
+
+   if (!kmalloc_obj)
+      return -ENOMEM;
+
+   return sysfs_register_obj(NULL, stats, "kmalloc", kmalloc_obj);
+}
+
+void sysfs_create_stats_obj(void)
+{
+   struct sysobj *stats;
+
+   stats = sysfs_create_empty_obj();
+
+   if (!stats)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "stats", stats))
+      goto fail;
+
+#if KERNEL_LOCKSTAT
+   if (sysfs_create_lockstat_obj(stats))
+      goto fail;
+#endif
+
+#if KERNEL_SYSCALL_STATS
+   if (sysfs_create_syscalls_obj(stats))
+      goto fail;
+#endif
+
+#if KERNEL_IRQSOFF_TRACER
+   if (sysfs_create_irqsoff_obj(stats))
+      goto fail;
+#endif
+
+   if (sysfs_create_kmalloc_obj(stats))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs stats obj");
+}
@@ -25,6 +25,9 @@
 #include "lock_and_retain.c.h"
 
 void sysfs_create_config_obj(void);
+void sysfs_create_stats_obj(void);
+void sysfs_create_prof_obj(void);
+void sysfs_create_boot_obj(void);
 static struct mnt_fs *sysfs;
 
 static int
@@ -756,6 +759,9 @@ init_sysfs(void)
       panic("Unable to create default objects");
 
    sysfs_create_config_obj();
+   sysfs_create_stats_obj();
+   sysfs_create_prof_obj();
+   sysfs_create_boot_obj();
 }
 
 static struct module sysfs_module = {
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/self_tests.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/irqsoff.h>
+#include <tilck/kernel/elf_utils.h>
+
+#if KERNEL_IRQSOFF_TRACER
+
+#define SE_IRQSOFF_DELAY_US           (10 * 1000)
+
+/*
+ * Inject a long IRQs-off or preempt-off section. Keep it as a separate
+ * function, in order to check the call site recorded by the tracer.
+ */
+static NO_INLINE u64 se_irqsoff_long_section(enum irqsoff_type t)
+{
+   u64 start, cycles;
+   ulong var;
+
+   if (t == IRQSOFF_IRQS)
+      disable_interrupts(&var);
+   else
+      disable_preemption();
+
+   start = RDTSC();
+   delay_us(SE_IRQSOFF_DELAY_US);
+   cycles = RDTSC() - start;
+
+   if (t == IRQSOFF_IRQS)
+      enable_interrupts(&var);
+   else
+      enable_preemption();
+
+   return cycles;
+}
+
+static void se_irqsoff_check(enum irqsoff_type t)
+{
+   struct irqsoff_offender arr[IRQSOFF_MAX_OFFENDERS];
+   const char *sym;
+   u64 cycles;
+   int n, i;
+
+   cycles = se_irqsoff_long_section(t);
+   n = irqsoff_get_offenders(t, arr, ARRAY_SIZE(arr));
+
+   for (i = 0; i < n; i++) {
+
+      if (arr[i].max_cycles < cycles)
+         continue;
+
+      if (!KERNEL_SYMBOLS)
+         break;
+
+      sym = find_sym_at_addr(arr[i].start_site, NULL, NULL);
+
+      if (sym && !strcmp(sym, "se_irqsoff_long_section"))
+         break;
+   }
+
+   printk("%s-off section of %" PRIu64 " cycles: %s\n",
+          irqsoff_type_str(t), cycles, i < n ? "detected" : "NOT detected");
+
+   VERIFY(i < n);
+}
+
+void selftest_irqsoff(void)
+{
+   VERIFY(are_interrupts_enabled());
+   VERIFY(is_preemption_enabled());
+
+   se_irqsoff_check(IRQSOFF_IRQS);
+   se_irqsoff_check(IRQSOFF_PREEMPT);
+   se_regular_end();
+}
+
+#else
+
+void selftest_irqsoff(void)
+{
+   printk("Skipping the test: KERNEL_IRQSOFF_TRACER is 0\n");
+   se_regular_end();
+}
+
+#endif
+
+REGISTER_SELF_TEST(irqsoff, se_short, &selftest_irqsoff)
@@ -6,6 +6,7 @@
 
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/self_tests.h>
 
@@ -49,6 +50,51 @@ static void kmalloc_perf_per_size(u32 size)
           size, duration / (u64) iters);
 }
 
+/*
+ * Short bursts of allocations followed by the frees in reverse order: the
+ * typical pattern of the small, short-lived, allocations that the kmalloc
+ * magazines are designed for.
+ */
+static u64 kmalloc_perf_burst_per_size(u32 size)
+{
+   const int bursts = 1000;
+   const int burst_len = 8;
+   u64 start = RDTSC();
+
+   for (int i = 0; i < bursts; i++) {
+
+      for (int j = 0; j < burst_len; j++) {
+
+         allocations[j] = kmalloc(size);
+
+         if (!allocations[j])
+            panic("We were unable to allocate %u bytes\n", size);
+      }
+
+      for (int j = burst_len - 1; j >= 0; j--)
+         kfree2(allocations[j], size);
+   }
+
+   return (RDTSC() - start) / (u64)(bursts * burst_len);
+}
+
+static void kmalloc_perf_magazines(void)
+{
+   u64 with_mags, without_mags;
+
+   for (u32 s = 16; s <= 256; s *= 2) {
+
+      debug_kmalloc_set_magazines(false);
+      without_mags = kmalloc_perf_burst_per_size(s);
+      debug_kmalloc_set_magazines(true);
+      with_mags = kmalloc_perf_burst_per_size(s);
+
+      printk("Cycles per kmalloc(%3u) + kfree in bursts: "
+             "%4" PRIu64 " -> %4" PRIu64 " with magazines\n",
+             s, without_mags, with_mags);
+   }
+}
+
 void selftest_kmalloc_perf(void)
 {
    const int iters = 1000;
@@ -82,6 +128,8 @@ void selftest_kmalloc_perf(void)
    printk(NO_PREFIX
           "Cycles per kmalloc(RANDOM) + kfree: %" PRIu64 "\n", duration);
 
+   kmalloc_perf_magazines();
+
    for (u32 s = 32; s <= 256*KB; s *= 2) {
 
       if (se_is_stop_requested())
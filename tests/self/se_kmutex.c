@@ -8,6 +8,7 @@
 
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/self_tests.h>
 #include <tilck/kernel/timer.h>
@@ -76,11 +77,11 @@ static void sek_thread(void *unused)
    } // for (int iter = 0; iter < KMUTEX_SEK_TH_ITERS; iter++)
 }
 
-void selftest_kmutex()
+static void do_selftest_kmutex(u32 flags)
 {
    int local_tids[3];
 
-   kmutex_init(&test_mutex, 0);
+   kmutex_init(&test_mutex, flags);
    sek_set_vars(sek_set_1);
 
    debug_reset_no_deadlock_set();
@@ -103,8 +104,20 @@ void selftest_kmutex()
       se_regular_end();
 }
 
+void selftest_kmutex()
+{
+   do_selftest_kmutex(0);
+}
+
 REGISTER_SELF_TEST(kmutex, se_med, &selftest_kmutex)
 
+void selftest_kmutex_adaptive()
+{
+   do_selftest_kmutex(KMUTEX_FL_ADAPTIVE);
+}
+
+REGISTER_SELF_TEST(kmutex_adaptive, se_med, &selftest_kmutex_adaptive)
+
 /* -------------------------------------------------- */
 /*               Recursive mutex test                 */
 /* -------------------------------------------------- */
@@ -427,3 +440,168 @@ end:
 }
 
 REGISTER_SELF_TEST(kmutex_ord, se_med, &selftest_kmutex_ord)
+
+/* -------------------------------------------------- */
+/*            Priority inheritance test               */
+/* -------------------------------------------------- */
+
+static struct kmutex pi_mutex;
+static struct worker_thread *pi_low_wth;
+static volatile bool pi_low_locked;
+static volatile bool pi_high_waiting;
+static volatile int pi_eff_prio_locked;
+static volatile int pi_eff_prio_unlocked;
+
+static void kmutex_pi_low_job(void *arg)
+{
+   kmutex_lock(&pi_mutex);
+   {
+      pi_low_locked = true;
+
+      /*
+       * Wait for the high-priority worker to block on `pi_mutex`. Until then,
+       * being runnable, it always runs before us.
+       */
+      while (!pi_high_waiting)
+         kernel_yield();
+
+      pi_eff_prio_locked = wth_get_eff_priority(pi_low_wth);
+   }
+   kmutex_unlock(&pi_mutex);
+   pi_eff_prio_unlocked = wth_get_eff_priority(pi_low_wth);
+}
+
+static void kmutex_pi_high_job(void *arg)
+{
+   struct kmutex *m = arg;
+
+   pi_high_waiting = true;
+   kmutex_lock(m);
+   kmutex_unlock(m);
+}
+
+static void pi_create_worker(struct worker_thread **wth, const char *name,
+                             int prio)
+{
+   if (*wth)
+      return;
+
+   /* Worker threads cannot be destroyed: create ours just once */
+   disable_preemption();
+   {
+      *wth = wth_create_thread(name, prio, 4);
+   }
+   enable_preemption();
+   VERIFY(*wth != NULL);
+}
+
+void selftest_kmutex_pi()
+{
+   struct worker_thread *high_wth = wth_find_worker(WTH_PRIO_HIGHEST);
+
+   pi_create_worker(&pi_low_wth, "se_pi", WTH_PRIO_LOWEST);
+   kmutex_init(&pi_mutex, 0);
+   pi_low_locked = false;
+   pi_high_waiting = false;
+   pi_eff_prio_locked = -1;
+   pi_eff_prio_unlocked = -1;
+
+   VERIFY(wth_enqueue_on(pi_low_wth, &kmutex_pi_low_job, NULL));
+
+   while (!pi_low_locked)
+      kernel_sleep(1);
+
+   VERIFY(wth_enqueue_on(high_wth, &kmutex_pi_high_job, &pi_mutex));
+
+   wth_wait_for_completion(pi_low_wth);
+   wth_wait_for_completion(high_wth);
+   kmutex_destroy(&pi_mutex);
+
+   printk("low prio worker eff. prio: %d (locked), %d (unlocked)\n",
+          pi_eff_prio_locked, pi_eff_prio_unlocked);
+
+   VERIFY(pi_eff_prio_locked == wth_get_priority(high_wth));
+   VERIFY(pi_eff_prio_unlocked == WTH_PRIO_LOWEST);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(kmutex_pi, se_short, &selftest_kmutex_pi)
+
+/*
+ * Nested priority inheritance: the low priority worker holds `pi_mutex` and
+ * `pi_mutex2`, inheriting a priority from a waiter on each one of them. After
+ * releasing the inner mutex, it must still be boosted, because of the waiter
+ * on the outer one.
+ */
+
+static struct kmutex pi_mutex2;
+static struct worker_thread *pi_mid_wth;
+static volatile bool pi_mid_waiting;
+static volatile int pi_eff_prio_inner_unlocked;
+
+static void kmutex_pi_nested_low_job(void *arg)
+{
+   kmutex_lock(&pi_mutex);
+   kmutex_lock(&pi_mutex2);
+   {
+      pi_low_locked = true;
+
+      while (!pi_mid_waiting || !pi_high_waiting)
+         kernel_yield();
+
+      pi_eff_prio_locked = wth_get_eff_priority(pi_low_wth);
+   }
+   kmutex_unlock(&pi_mutex2);
+   pi_eff_prio_inner_unlocked = wth_get_eff_priority(pi_low_wth);
+   kmutex_unlock(&pi_mutex);
+   pi_eff_prio_unlocked = wth_get_eff_priority(pi_low_wth);
+}
+
+static void kmutex_pi_mid_job(void *arg)
+{
+   pi_mid_waiting = true;
+   kmutex_lock(&pi_mutex);
+   kmutex_unlock(&pi_mutex);
+}
+
+void selftest_kmutex_pi_nested()
+{
+   struct worker_thread *high_wth = wth_find_worker(WTH_PRIO_HIGHEST);
+
+   pi_create_worker(&pi_low_wth, "se_pi", WTH_PRIO_LOWEST);
+   pi_create_worker(&pi_mid_wth, "se_pi_mid", WTH_PRIO_LOWEST / 2);
+
+   kmutex_init(&pi_mutex, 0);
+   kmutex_init(&pi_mutex2, 0);
+   pi_low_locked = false;
+   pi_mid_waiting = false;
+   pi_high_waiting = false;
+   pi_eff_prio_locked = -1;
+   pi_eff_prio_inner_unlocked = -1;
+   pi_eff_prio_unlocked = -1;
+
+   VERIFY(wth_enqueue_on(pi_low_wth, &kmutex_pi_nested_low_job, NULL));
+
+   while (!pi_low_locked)
+      kernel_sleep(1);
+
+   VERIFY(wth_enqueue_on(pi_mid_wth, &kmutex_pi_mid_job, NULL));
+   VERIFY(wth_enqueue_on(high_wth, &kmutex_pi_high_job, &pi_mutex2));
+
+   wth_wait_for_completion(pi_low_wth);
+   wth_wait_for_completion(pi_mid_wth);
+   wth_wait_for_completion(high_wth);
+   kmutex_destroy(&pi_mutex2);
+   kmutex_destroy(&pi_mutex);
+
+   printk("low prio worker eff. prio: %d (locked), %d (inner unlocked), "
+          "%d (unlocked)\n", pi_eff_prio_locked, pi_eff_prio_inner_unlocked,
+          pi_eff_prio_unlocked);
+
+   VERIFY(pi_eff_prio_locked == wth_get_priority(high_wth));
+   VERIFY(pi_eff_prio_inner_unlocked <= wth_get_priority(pi_mid_wth));
+   VERIFY(pi_eff_prio_unlocked == WTH_PRIO_LOWEST);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(kmutex_pi_nested, se_short, &selftest_kmutex_pi_nested)
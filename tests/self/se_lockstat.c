@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/self_tests.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/elf_utils.h>
+
+#if KERNEL_LOCKSTAT
+
+#define SE_LOCKSTAT_ITERS              100
+#define SE_LOCKSTAT_HOLD_TICKS         2
+
+static struct kmutex se_lockstat_mutex;
+static volatile bool se_lockstat_holding;
+static u64 se_lockstat_hold_cycles;
+
+/*
+ * The functions locking the mutex are kept separate and not inlined, because
+ * lockstat keys the classes by the call site of kmutex_lock().
+ */
+static NO_INLINE void se_lockstat_holder(void *unused)
+{
+   u64 start;
+
+   kmutex_lock(&se_lockstat_mutex);
+   {
+      start = RDTSC();
+      se_lockstat_holding = true;
+      kernel_sleep(SE_LOCKSTAT_HOLD_TICKS);
+      se_lockstat_hold_cycles = RDTSC() - start;
+   }
+   kmutex_unlock(&se_lockstat_mutex);
+}
+
+static NO_INLINE void se_lockstat_lock_loop(void)
+{
+   for (int i = 0; i < SE_LOCKSTAT_ITERS; i++) {
+      kmutex_lock(&se_lockstat_mutex);
+      kmutex_unlock(&se_lockstat_mutex);
+   }
+}
+
+static struct lockstat_class *
+se_lockstat_find(struct lockstat_class *arr, int n, const char *func)
+{
+   const char *sym;
+
+   for (int i = 0; i < n; i++) {
+
+      if (arr[i].type != LOCKSTAT_KMUTEX)
+         continue;
+
+      sym = find_sym_at_addr(arr[i].site, NULL, NULL);
+
+      if (sym && !strcmp(sym, func))
+         return &arr[i];
+   }
+
+   return NULL;
+}
+
+void selftest_lockstat(void)
+{
+   struct lockstat_class *arr, *c;
+   int tid, n;
+
+   if (!KERNEL_SYMBOLS) {
+      printk("Skipping the test: KERNEL_SYMBOLS is 0\n");
+      se_regular_end();
+      return;
+   }
+
+   kmutex_init(&se_lockstat_mutex, 0);
+   se_lockstat_holding = false;
+   lockstat_reset();
+
+   /* Make the first acquisition in se_lockstat_lock_loop() contended */
+   tid = kthread_create(&se_lockstat_holder, 0, NULL);
+   VERIFY(tid > 0);
+
+   while (!se_lockstat_holding)
+      kernel_yield();
+
+   se_lockstat_lock_loop();
+   kthread_join(tid, true);
+
+   arr = kalloc_array_obj(struct lockstat_class, LOCKSTAT_MAX_CLASSES);
+   VERIFY(arr != NULL);
+
+   n = lockstat_get_classes(arr, LOCKSTAT_MAX_CLASSES);
+
+   c = se_lockstat_find(arr, n, "se_lockstat_lock_loop");
+   VERIFY(c != NULL);
+
+   printk("lock loop: acquired: %" PRIu64 ", contended: %" PRIu64
+          ", wait_cycles: %" PRIu64 "\n",
+          c->acquired, c->contended, c->wait_cycles);
+
+   VERIFY(c->acquired == SE_LOCKSTAT_ITERS);
+   VERIFY(c->contended == 1);
+   VERIFY(c->wait_cycles > 0);
+
+   c = se_lockstat_find(arr, n, "se_lockstat_holder");
+   VERIFY(c != NULL);
+
+   printk("holder: acquired: %" PRIu64 ", max_hold: %" PRIu64
+          " (measured: %" PRIu64 ")\n",
+          c->acquired, c->max_hold_cycles, se_lockstat_hold_cycles);
+
+   VERIFY(c->acquired == 1);
+   VERIFY(c->contended == 0);
+   VERIFY(c->max_hold_cycles >= se_lockstat_hold_cycles);
+
+   kfree_array_obj(arr, struct lockstat_class, LOCKSTAT_MAX_CLASSES);
+   kmutex_destroy(&se_lockstat_mutex);
+   se_regular_end();
+}
+
+#else
+
+void selftest_lockstat(void)
+{
+   printk("Skipping the test: KERNEL_LOCKSTAT is 0\n");
+   se_regular_end();
+}
+
+#endif
+
+REGISTER_SELF_TEST(lockstat, se_short, &selftest_lockstat)
@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_kernel.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/self_tests.h>
+
+#define MEMCPY_PERF_BUF_SIZE        (256 * KB)
+
+static u8 *src_buf;
+static u8 *dest_buf;
+
+static void memcpy_perf_check(u32 dest_off, u32 src_off, u32 size)
+{
+   for (u32 i = 0; i < size + 64; i++) {
+      src_buf[i] = (u8)(i * 7 + 3);
+      dest_buf[i] = 0xcc;
+   }
+
+   kmemcpy(dest_buf + dest_off, src_buf + src_off, size);
+
+   for (u32 i = 0; i < size + 64; i++) {
+
+      const bool in = i >= dest_off && i < dest_off + size;
+      const u8 exp = in ? src_buf[i - dest_off + src_off] : 0xcc;
+
+      if (dest_buf[i] != exp) {
+         panic("kmemcpy(+%u, +%u, %u): wrong byte at %u: 0x%x vs 0x%x",
+               dest_off, src_off, size, i, dest_buf[i], exp);
+      }
+   }
+
+   kmemset(dest_buf + dest_off, 0x5a, size);
+
+   for (u32 i = 0; i < size + 64; i++) {
+
+      const bool in = i >= dest_off && i < dest_off + size;
+      const u8 exp = in ? 0x5a : 0xcc;
+
+      if (dest_buf[i] != exp) {
+         panic("kmemset(+%u, %u): wrong byte at %u: 0x%x vs 0x%x",
+               dest_off, size, i, dest_buf[i], exp);
+      }
+   }
+}
+
+static u64 memcpy_perf_run(u32 size, int iters, bool fpu)
+{
+   u64 start = RDTSC();
+
+   for (int i = 0; i < iters; i++) {
+
+      if (fpu)
+         kmemcpy(dest_buf, src_buf, size);
+      else
+         memcpy(dest_buf, src_buf, size);
+   }
+
+   return (RDTSC() - start) / (u64)iters;
+}
+
+static u64 memset_perf_run(u32 size, int iters, bool fpu)
+{
+   u64 start = RDTSC();
+
+   for (int i = 0; i < iters; i++) {
+
+      if (fpu)
+         kmemset(dest_buf, i, size);
+      else
+         memset(dest_buf, i, size);
+   }
+
+   return (RDTSC() - start) / (u64)iters;
+}
+
+void selftest_memcpy_perf(void)
+{
+   static const u32 offsets[] = { 0, 1, 16, 31, 32 };
+
+   src_buf = kmalloc(MEMCPY_PERF_BUF_SIZE);
+   dest_buf = kmalloc(MEMCPY_PERF_BUF_SIZE);
+
+   if (!src_buf || !dest_buf)
+      panic("No enough memory for the memcpy_perf buffers");
+
+   /* Correctness, with both the same and different alignments */
+   for (u32 i = 0; i < ARRAY_SIZE(offsets); i++) {
+      for (u32 j = 0; j < ARRAY_SIZE(offsets); j++) {
+         memcpy_perf_check(offsets[i], offsets[j], KMEMCPY_FPU_MIN_SIZE - 1);
+         memcpy_perf_check(offsets[i], offsets[j], KMEMCPY_FPU_MIN_SIZE + 33);
+         memcpy_perf_check(offsets[i], offsets[j], 3 * PAGE_SIZE + 5);
+      }
+   }
+
+   for (u32 s = 1 * KB; s <= MEMCPY_PERF_BUF_SIZE; s *= 4) {
+
+      const int iters = s <= 16 * KB ? 1000 : 100;
+
+      if (se_is_stop_requested())
+         break;
+
+      printk("size: %6u, memcpy: %7" PRIu64 " -> %7" PRIu64
+             ", memset: %7" PRIu64 " -> %7" PRIu64 " cycles\n", s,
+             memcpy_perf_run(s, iters, false),
+             memcpy_perf_run(s, iters, true),
+             memset_perf_run(s, iters, false),
+             memset_perf_run(s, iters, true));
+   }
+
+   kfree2(src_buf, MEMCPY_PERF_BUF_SIZE);
+   kfree2(dest_buf, MEMCPY_PERF_BUF_SIZE);
+
+   if (se_is_stop_requested())
+      se_interrupted_end();
+   else
+      se_regular_end();
+}
+
+REGISTER_SELF_TEST(memcpy_perf, se_short, &selftest_memcpy_perf)
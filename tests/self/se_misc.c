@@ -8,6 +8,7 @@
 #include <tilck/kernel/paging.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/elf_utils.h>
 
 void simple_test_kthread(void *arg)
 {
@@ -107,3 +108,48 @@ void selftest_join()
 }
 
 REGISTER_SELF_TEST(join, se_med, &selftest_join)
+
+static int se_kernel_syms_cb(struct elf_symbol_info *info, void *arg)
+{
+   ulong va = (ulong)info->vaddr;
+   const char *name;
+   u32 sym_size;
+   long off;
+
+   if (!info->size || !info->name[0])
+      return 0;
+
+   /* The last byte of each symbol must resolve to a symbol containing it */
+   name = find_sym_at_addr(va + info->size - 1, &off, &sym_size);
+   VERIFY(name != NULL);
+   VERIFY(off >= 0 && (ulong)off < sym_size);
+
+   /* Symbols with the same name may exist: just check it's resolvable */
+   VERIFY(find_addr_of_symbol(info->name) != 0);
+
+   (*(u32 *)arg)++;
+   return 0;
+}
+
+void selftest_kernel_syms(void)
+{
+   u32 count = 0;
+   u64 start, cycles;
+
+   if (!KERNEL_SYMBOLS) {
+      printk("Skipping the test: KERNEL_SYMBOLS is 0\n");
+      se_regular_end();
+      return;
+   }
+
+   start = RDTSC();
+   foreach_symbol(se_kernel_syms_cb, &count);
+   cycles = RDTSC() - start;
+
+   printk("Checked %u symbols, avg cycles per symbol: %" PRIu64 "\n",
+          count, count ? cycles / count : 0);
+
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(kernel_syms, se_short, &selftest_kernel_syms)
@@ -16,6 +16,7 @@ CMD_ENTRY(fpu_loop,     TT_LONG,  false)
 
 CMD_ENTRY(fork0,        TT_MED,    true)
 CMD_ENTRY(fork1,        TT_SHORT,  true)
+CMD_ENTRY(fork2,        TT_SHORT,  true)
 CMD_ENTRY(sysenter,     TT_SHORT,  true)
 CMD_ENTRY(fork_se,      TT_MED,    true)
 CMD_ENTRY(bad_read,     TT_SHORT,  true)
@@ -23,10 +24,14 @@ CMD_ENTRY(bad_write,    TT_SHORT,  true)
 CMD_ENTRY(fork_perf,    TT_LONG,   true)
 CMD_ENTRY(vfork_perf,   TT_LONG,   true)
 CMD_ENTRY(syscall_perf, TT_MED,    true)
+CMD_ENTRY(sys_stats,    TT_SHORT,  true)
 CMD_ENTRY(fpu,          TT_SHORT,  true)
+CMD_ENTRY(fpu_init,     TT_SHORT,  true)
 CMD_ENTRY(brk,          TT_SHORT,  true)
 CMD_ENTRY(mmap,         TT_MED,    true)
 CMD_ENTRY(mmap2,        TT_SHORT,  true)
+CMD_ENTRY(mmap3,        TT_SHORT,  true)
+CMD_ENTRY(mmap_bigpg,   TT_SHORT,  true)
 CMD_ENTRY(kcow,         TT_SHORT,  true)
 CMD_ENTRY(wpid1,        TT_SHORT,  true)
 CMD_ENTRY(wpid2,        TT_SHORT,  true)
@@ -50,8 +55,10 @@ CMD_ENTRY(fs4,          TT_SHORT,  true)
 CMD_ENTRY(fs5,          TT_SHORT,  true)
 CMD_ENTRY(fs6,          TT_SHORT,  true)
 CMD_ENTRY(fs7,          TT_SHORT,  true)
+CMD_ENTRY(fs8,          TT_SHORT,  true)
 CMD_ENTRY(fs_perf1,     TT_SHORT,  true)
 CMD_ENTRY(fs_perf2,     TT_SHORT,  true)
+CMD_ENTRY(fs_perf3,     TT_MED,    true)
 CMD_ENTRY(fmmap1,       TT_SHORT,  true)
 CMD_ENTRY(fmmap2,       TT_SHORT,  true)
 CMD_ENTRY(fmmap3,       TT_SHORT,  true)
@@ -96,3 +103,4 @@ CMD_ENTRY(sigsegv3,     TT_SHORT,  true)
 CMD_ENTRY(sigsegv4,     TT_SHORT,  true)
 CMD_ENTRY(sigsegv5,     TT_SHORT,  true)
 CMD_ENTRY(getuids,      TT_SHORT,  true)
+CMD_ENTRY(serial_stream, TT_MED,   true)
@@ -240,6 +240,94 @@ int cmd_fork1(int argc, char **argv)
    return 0;
 }
 
+/*
+ * Check that the page tables shared between parent and child(ren) after fork()
+ * are correctly un-shared on write, mmap() and munmap(), in both directions.
+ */
+int cmd_fork2(int argc, char **argv)
+{
+   const size_t len = 4 * MB;
+   int rc, pid, wstatus;
+   char *buf;
+
+   buf = mmap(NULL,
+              len,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+
+   for (size_t off = 0; off < len; off += 4 * KB)
+      buf[off] = 'p';
+
+   pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid) {
+
+      /* Write in the first half */
+      for (size_t off = 0; off < len / 2; off += 4 * KB)
+         buf[off] = 'c';
+
+      /* Unmap the second half, in a page table we never wrote to */
+      if ((rc = munmap(buf + len / 2, len / 2))) {
+         perror("munmap failed in the child");
+         exit(1);
+      }
+
+      /* Fork again: now the page tables are shared by three processes */
+      pid = fork();
+
+      if (pid < 0) {
+         perror("fork failed in the child");
+         exit(1);
+      }
+
+      if (!pid) {
+
+         for (size_t off = 0; off < len / 2; off += 4 * KB) {
+            if (buf[off] != 'c')
+               exit(1);
+            buf[off] = 'g';
+         }
+
+         exit(0);
+      }
+
+      if (waitpid(pid, &wstatus, 0) != pid || !WIFEXITED(wstatus))
+         exit(1);
+
+      if (WEXITSTATUS(wstatus) != 0)
+         exit(1);
+
+      for (size_t off = 0; off < len / 2; off += 4 * KB) {
+         if (buf[off] != 'c')
+            exit(1);
+      }
+
+      exit(0);
+   }
+
+   rc = waitpid(pid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+
+   for (size_t off = 0; off < len; off += 4 * KB) {
+
+      if (buf[off] != 'p') {
+         printf(STR_PARENT "buf[%zu]: '%c', expected 'p'\n", off, buf[off]);
+         return 1;
+      }
+   }
+
+   rc = munmap(buf, len);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
 int cmd_vfork0(int argc, char **argv)
 {
    static const char child_hello[] = "Hello from the child!!";
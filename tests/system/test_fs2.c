@@ -14,6 +14,7 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/statfs.h>
 #include <dirent.h>
 
 #include "devshell.h"
@@ -40,6 +41,49 @@ int cmd_fs7(int argc, char **argv)
    return 0;
 }
 
+/* Test statfs() and fstatfs() */
+int cmd_fs8(int argc, char **argv)
+{
+   static char buf[4 * 4096];
+   struct statfs st1, st2;
+   int rc, fd;
+
+   rc = statfs("/tmp", &st1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("type: %#lx, bsize: %ld\n", (ulong)st1.f_type, (long)st1.f_bsize);
+   printf("blocks: %llu, bfree: %llu, bavail: %llu\n",
+          (ull_t)st1.f_blocks, (ull_t)st1.f_bfree, (ull_t)st1.f_bavail);
+   printf("files: %llu, ffree: %llu\n",
+          (ull_t)st1.f_files, (ull_t)st1.f_ffree);
+
+   DEVSHELL_CMD_ASSERT(st1.f_bsize == 4096);
+   DEVSHELL_CMD_ASSERT(st1.f_bfree <= st1.f_blocks);
+   DEVSHELL_CMD_ASSERT(st1.f_bavail <= st1.f_bfree);
+   DEVSHELL_CMD_ASSERT(st1.f_ffree <= st1.f_files);
+
+   fd = open("/tmp/test1", O_CREAT | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = write(fd, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(buf));
+
+   rc = fstatfs(fd, &st2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* The new file used (at least) one inode and 4 blocks */
+   DEVSHELL_CMD_ASSERT(st2.f_bfree + 4 <= st1.f_bfree);
+   DEVSHELL_CMD_ASSERT(st2.f_ffree + 1 <= st1.f_ffree);
+
+   close(fd);
+   rc = unlink("/tmp/test1");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = statfs("/tmp/not_existing_file", &st2);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ENOENT);
+   return 0;
+}
+
 static const char test_str[] = "this is a test string\n";
 static const char test_str2[] = "hello from the 2nd page";
 static const char test_str_exp[] = "This is a test string\n";
@@ -14,6 +14,7 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <dirent.h>
 
 #include "devshell.h"
 #include "sysenter.h"
@@ -109,3 +110,101 @@ int cmd_fs_perf2(int argc, char **argv)
    DEVSHELL_CMD_ASSERT(rc == 0);
    return 0;
 }
+
+/*
+ * Measure the cost of the operations on a directory with many entries:
+ * creat(), stat() (lookup), a full readdir() walk, seekdir() to random
+ * positions followed by readdir() and, finally, unlink().
+ */
+int cmd_fs_perf3(int argc, char **argv)
+{
+   const int n = 50 * 1000;
+   const int n_seeks = 1000;
+   const char *dest_dir = argc > 0 ? argv[0] : "/tmp";
+   char dir[256], path[256];
+   u64 start, end, elapsed;
+   struct stat statbuf;
+   struct dirent *de;
+   long *dposs;
+   DIR *d;
+   int rc, cnt;
+
+   printf("Using '%s' as test dir\n", dest_dir);
+   sprintf(dir, "%s/fs_perf3", dest_dir);
+
+   rc = mkdir(dir, 0755);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   dposs = malloc(sizeof(long) * (n + 3));
+   DEVSHELL_CMD_ASSERT(dposs != NULL);
+
+   start = RDTSC();
+
+   for (int i = 0; i < n; i++)
+      create_test_file(dir, i);
+
+   end = RDTSC();
+   elapsed = (end - start) / n;
+   printf("Avg. creat() cost:     %6" PRIu64 " cycles\n", elapsed);
+
+   start = RDTSC();
+
+   for (int i = 0; i < n; i++) {
+      sprintf(path, "%s/test_%03d", dir, i);
+      rc = stat(path, &statbuf);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   end = RDTSC();
+   elapsed = (end - start) / n;
+   printf("Avg. stat() cost:      %6" PRIu64 " cycles\n", elapsed);
+
+   d = opendir(dir);
+   DEVSHELL_CMD_ASSERT(d != NULL);
+
+   start = RDTSC();
+
+   for (cnt = 0; ; cnt++) {
+
+      dposs[cnt] = telldir(d);
+
+      if (!(de = readdir(d)))
+         break;
+   }
+
+   end = RDTSC();
+   elapsed = (end - start) / (u64)cnt;
+   DEVSHELL_CMD_ASSERT(cnt == n + 2);
+   printf("Avg. readdir() cost:   %6" PRIu64 " cycles\n", elapsed);
+
+   start = RDTSC();
+
+   for (int i = 0; i < n_seeks; i++) {
+
+      const int k = (int)(((u64)i * 7919) % (u64)cnt);
+
+      seekdir(d, dposs[k]);
+      de = readdir(d);
+      DEVSHELL_CMD_ASSERT(de != NULL);
+   }
+
+   end = RDTSC();
+   elapsed = (end - start) / n_seeks;
+   printf("Avg. seekdir() + readdir() cost: %6" PRIu64 " cycles\n", elapsed);
+
+   closedir(d);
+   free(dposs);
+
+   start = RDTSC();
+
+   for (int i = 0; i < n; i++)
+      remove_test_file_expecting_success(dir, i);
+
+   end = RDTSC();
+   elapsed = (end - start) / n;
+   printf("Avg. unlink() cost:    %6" PRIu64 " cycles\n", elapsed);
+
+   rc = rmdir(dir);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
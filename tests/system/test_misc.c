@@ -147,6 +147,138 @@ int cmd_syscall_perf(int argc, char **argv)
    return 0;
 }
 
+#define SYS_STATS_DIR          "/syst/stats/syscalls"
+#define SYS_STATS_ITERS        1000
+
+static char sys_stats_buf[32 * KB];
+
+static void read_sys_stats_file(const char *name)
+{
+   char path[64];
+   size_t tot = 0;
+   int fd, rc;
+
+   sprintf(path, SYS_STATS_DIR "/%s", name);
+   fd = open(path, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   while ((rc = read(fd, sys_stats_buf + tot,
+                     sizeof(sys_stats_buf) - 1 - tot)) > 0)
+   {
+      tot += (size_t)rc;
+   }
+
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   sys_stats_buf[tot] = 0;
+   close(fd);
+}
+
+/* Returns the line of `sys_stats_buf` whose first field is `name` */
+static const char *find_sys_stats_line(const char *name)
+{
+   const size_t len = strlen(name);
+   const char *p = sys_stats_buf;
+
+   for (; *p; p = strchr(p, '\n') + 1) {
+
+      if (!strncmp(p, name, len) && (p[len] == ' ' || p[len] == '\n'))
+         return p;
+
+      if (!strchr(p, '\n'))
+         break;
+   }
+
+   return NULL;
+}
+
+static const char *find_getppid_line(void)
+{
+   char name[32];
+   const char *line;
+
+   if ((line = find_sys_stats_line("sys_getppid")))
+      return line;
+
+   /* The kernel has no symbols */
+   sprintf(name, "syscall_%d", SYS_getppid);
+   return find_sys_stats_line(name);
+}
+
+/*
+ * Check that the syscall stats exposed in /syst/stats/syscalls account for
+ * exactly the syscalls made after a reset.
+ */
+int cmd_sys_stats(int argc, char **argv)
+{
+   unsigned long long count, tot_cycles;
+   unsigned int b, c, hist_tot = 0;
+   const char *line;
+   int fd, n, tid;
+
+   if (access(SYS_STATS_DIR "/table", R_OK)) {
+      printf(PFX "[SKIP] because " SYS_STATS_DIR " is not available\n");
+      return 0;
+   }
+
+#ifndef __i386__
+   printf(PFX "[SKIP] because the syscalls are instrumented only on i386\n");
+   return 0;
+#endif
+
+   fd = open(SYS_STATS_DIR "/reset", O_WRONLY);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+   DEVSHELL_CMD_ASSERT(write(fd, "1", 1) == 1);
+   close(fd);
+
+   for (int i = 0; i < SYS_STATS_ITERS; i++)
+      syscall(SYS_getppid);
+
+   /* table: count, tot_cycles, avg and max per syscall */
+   read_sys_stats_file("table");
+   printf("%s", sys_stats_buf);
+
+   line = find_getppid_line();
+   DEVSHELL_CMD_ASSERT(line != NULL);
+   DEVSHELL_CMD_ASSERT(sscanf(line, "%*s %llu %llu",
+                              &count, &tot_cycles) == 2);
+   DEVSHELL_CMD_ASSERT(count == SYS_STATS_ITERS);
+   DEVSHELL_CMD_ASSERT(tot_cycles > 0);
+
+   /* hist: the buckets must add up to the count */
+   read_sys_stats_file("hist");
+   line = find_getppid_line();
+   DEVSHELL_CMD_ASSERT(line != NULL);
+   line += strcspn(line, " \n");
+
+   while (sscanf(line, " %u:%u%n", &b, &c, &n) == 2) {
+      hist_tot += c;
+      line += n;
+   }
+
+   DEVSHELL_CMD_ASSERT(hist_tot == SYS_STATS_ITERS);
+
+   /* tasks: our own task must have made at least all the getppid calls */
+   read_sys_stats_file("tasks");
+   printf("%s", sys_stats_buf);
+
+   count = 0;
+   line = sys_stats_buf;
+
+   for (; *line; line = strchr(line, '\n') + 1) {
+
+      if (sscanf(line, "%d %llu", &tid, &count) == 2 && tid == getpid())
+         break;
+
+      count = 0;
+
+      if (!strchr(line, '\n'))
+         break;
+   }
+
+   DEVSHELL_CMD_ASSERT(count >= SYS_STATS_ITERS);
+   return 0;
+}
+
 int cmd_fpu(int argc, char **argv)
 {
    long double e = 1.0;
@@ -161,6 +293,61 @@ int cmd_fpu(int argc, char **argv)
    return 0;
 }
 
+static int fpu_init_check(void)
+{
+   unsigned int mxcsr;
+   unsigned short fcw;
+
+   /*
+    * The devshell does not use the FPU before running the command: this is
+    * the first FPU use of the process, which loads its initial FPU state.
+    */
+   asmVolatile("stmxcsr %0" : "=m" (mxcsr));
+   asmVolatile("fnstcw %0" : "=m" (fcw));
+
+   printf("[execve child] MXCSR: %#x, FCW: %#x\n", mxcsr, fcw);
+
+   /* All the exceptions masked, round to nearest, extended precision */
+   DEVSHELL_CMD_ASSERT(mxcsr == 0x1f80);
+   DEVSHELL_CMD_ASSERT(fcw == 0x37f);
+   return 0;
+}
+
+/*
+ * Check that a new process starts with the FPU control words in their initial
+ * state, even if its parent changed them.
+ */
+int cmd_fpu_init(int argc, char **argv)
+{
+   int rc, pid, wstatus;
+   const char *devshell_path = get_devshell_path();
+
+   if (argc > 0 && !strcmp(argv[0], "--check"))
+      return fpu_init_check();
+
+   pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid) {
+
+      unsigned int mxcsr = 0x9fc0;     /* FTZ and DAZ set */
+      unsigned short fcw = 0x27f;      /* Double precision */
+
+      asmVolatile("ldmxcsr %0" : : "m" (mxcsr));
+      asmVolatile("fldcw %0" : : "m" (fcw));
+
+      execl(devshell_path, "devshell", "-c", "fpu_init", "--check", NULL);
+      perror("execl");
+      exit(123);
+   }
+
+   rc = waitpid(pid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+   return 0;
+}
+
 int cmd_fpu_loop(int argc, char **argv)
 {
    register double num = 0;
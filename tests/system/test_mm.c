@@ -159,6 +159,160 @@ int cmd_mmap2(int argc, char **argv)
    return 0;
 }
 
+/*
+ * Fragment the mmap area with many small mappings and check that the holes
+ * left by munmap() get re-used and coalesced correctly.
+ */
+int cmd_mmap3(int argc, char **argv)
+{
+   const int count = 64;
+   const size_t chunk = 64 * KB;
+   char *arr[64];
+   char *big;
+   int rc;
+
+   for (int i = 0; i < count; i++) {
+
+      arr[i] = mmap(NULL,
+                    chunk,
+                    PROT_READ | PROT_WRITE,
+                    MAP_ANONYMOUS | MAP_PRIVATE,
+                    -1,
+                    0);
+
+      DEVSHELL_CMD_ASSERT(arr[i] != (void *) -1);
+      memset(arr[i], i, chunk);
+   }
+
+   /* Make holes by un-mapping all the even chunks */
+   for (int i = 0; i < count; i += 2) {
+      rc = munmap(arr[i], chunk);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   /* The odd chunks must be untouched */
+   for (int i = 1; i < count; i += 2)
+      DEVSHELL_CMD_ASSERT(arr[i][0] == i && arr[i][chunk - 1] == i);
+
+   /* Re-map the even chunks: they must fit exactly in the holes */
+   for (int i = 0; i < count; i += 2) {
+
+      char *p = mmap(NULL,
+                     chunk,
+                     PROT_READ | PROT_WRITE,
+                     MAP_ANONYMOUS | MAP_PRIVATE,
+                     -1,
+                     0);
+
+      bool found = false;
+      DEVSHELL_CMD_ASSERT(p != (void *) -1);
+      DEVSHELL_CMD_ASSERT(p[0] == 0);
+
+      for (int j = 0; j < count; j += 2) {
+         if (arr[j] == p) {
+            found = true;
+            break;
+         }
+      }
+
+      DEVSHELL_CMD_ASSERT(found);
+      memset(p, 0xaa, chunk);
+   }
+
+   /* Un-map the middle of an odd chunk and check its two remaining parts */
+   rc = munmap(arr[1] + 16 * KB, 32 * KB);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(arr[1][0] == 1);
+   DEVSHELL_CMD_ASSERT(arr[1][chunk - 1] == 1);
+
+   rc = munmap(arr[1], 16 * KB);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = munmap(arr[1] + 48 * KB, 16 * KB);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < count; i++) {
+
+      if (i == 1)
+         continue;
+
+      rc = munmap(arr[i], chunk);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   /* Now all the holes must have been coalesced */
+   big = mmap(NULL,
+              count * chunk,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(big != (void *) -1);
+   memset(big, 0xbb, count * chunk);
+
+   rc = munmap(big, count * chunk);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* Anonymous mappings backed by big (4 MB) pages, with fork() and CoW */
+int cmd_mmap_bigpg(int argc, char **argv)
+{
+   const size_t big_page = 4 * MB;
+   const size_t len = 2 * big_page;
+   int child, wstatus, rc;
+   char *p;
+
+   p = mmap(NULL,
+            len,
+            PROT_READ | PROT_WRITE,
+            MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB,
+            -1,
+            0);
+
+   DEVSHELL_CMD_ASSERT(p != (void *) -1);
+   DEVSHELL_CMD_ASSERT(((unsigned long)p & (big_page - 1)) == 0);
+   DEVSHELL_CMD_ASSERT(p[0] == 0 && p[len - 1] == 0);
+
+   memset(p, 'a', len);
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      if (p[0] != 'a' || p[len - 1] != 'a') {
+         printf(STR_CHILD "Unexpected content in the big pages\n");
+         exit(1);
+      }
+
+      /* Trigger a CoW copy of the first big page */
+      memset(p, 'b', big_page);
+      exit(p[big_page] == 'a' ? 0 : 1);
+   }
+
+   waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   /* The child's writes must not be visible here */
+   DEVSHELL_CMD_ASSERT(p[0] == 'a' && p[big_page - 1] == 'a');
+
+   /* Now the pages are not shared anymore: no copy needed */
+   memset(p, 'c', len);
+
+   /* Big-page mappings cannot be split in the middle of a big page */
+   rc = munmap(p + 4 * KB, 4 * KB);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = munmap(p, big_page);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(p[big_page] == 'c');
+
+   rc = munmap(p + big_page, big_page);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
 static size_t fork_oom_alloc_size;
 
 static void fork_oom_child(void *buf)
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+/*
+ * Stream test for the serial RX path. The test runner connects COM2 (ttyS1)
+ * to a file generated with the same pattern as serial_stream_fill_line()
+ * below, which QEMU feeds to the UART as fast as the guest accepts it. Since
+ * the data starts flowing at boot, long before we open ttyS1, the kernel has
+ * to apply back-pressure instead of dropping input.
+ *
+ * Without data on ttyS1 (e.g. when running all the tests in a single VM), the
+ * test is skipped.
+ */
+
+#define STREAM_LINES              4096
+#define STREAM_LINE_LEN             64
+#define STREAM_FIRST_DATA_MS      2000
+#define STREAM_TIMEOUT_MS         5000
+
+static void serial_stream_fill_line(char *buf, unsigned n)
+{
+   int i = sprintf(buf, "%08u:", n);
+
+   for (; i < STREAM_LINE_LEN - 1; i++)
+      buf[i] = (char)('a' + (n + (unsigned)i) % 26);
+
+   buf[STREAM_LINE_LEN - 1] = '\n';
+}
+
+static u64 get_ms(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (u64)tv.tv_sec * 1000 + (u64)tv.tv_usec / 1000;
+}
+
+int cmd_serial_stream(int argc, char **argv)
+{
+   const size_t tot = STREAM_LINES * STREAM_LINE_LEN;
+   char expected[STREAM_LINE_LEN];
+   char buf[STREAM_LINE_LEN];
+   struct pollfd pfd;
+   struct termios t;
+   size_t line_off = 0;
+   size_t done = 0;
+   unsigned line = 0;
+   u64 start, elapsed;
+   int fd, rc;
+
+   if (!running_on_tilck()) {
+      not_on_tilck_message();
+      return 0;
+   }
+
+   fd = open("/dev/ttyS1", O_RDWR);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   /* Raw mode, without flushing the data already received */
+   rc = tcgetattr(fd, &t);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   t.c_iflag &= ~(ICRNL | INLCR | IGNCR | IXON);
+   t.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+   t.c_cc[VMIN] = 1;
+   t.c_cc[VTIME] = 0;
+
+   rc = tcsetattr(fd, TCSANOW, &t);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+   rc = poll(&pfd, 1, STREAM_FIRST_DATA_MS);
+   DEVSHELL_CMD_ASSERT(rc >= 0);
+
+   if (rc == 0) {
+      printf("No data on ttyS1: SKIP\n");
+      close(fd);
+      return 0;
+   }
+
+   serial_stream_fill_line(expected, line);
+   start = get_ms();
+
+   while (done < tot) {
+
+      rc = poll(&pfd, 1, STREAM_TIMEOUT_MS);
+      DEVSHELL_CMD_ASSERT(rc >= 0);
+
+      if (rc == 0) {
+         printf("Timeout after %zu/%zu bytes\n", done, tot);
+         close(fd);
+         return 1;
+      }
+
+      rc = read(fd, buf, MIN(sizeof(buf), tot - done));
+      DEVSHELL_CMD_ASSERT(rc > 0);
+
+      for (int i = 0; i < rc; i++) {
+
+         if (buf[i] != expected[line_off]) {
+
+            printf("Mismatch at line %u, col %zu: got 0x%02x, expected '%c'\n",
+                   line, line_off, (unsigned char)buf[i], expected[line_off]);
+            close(fd);
+            return 1;
+         }
+
+         if (++line_off == STREAM_LINE_LEN) {
+            line_off = 0;
+            serial_stream_fill_line(expected, ++line);
+         }
+      }
+
+      done += (size_t)rc;
+   }
+
+   elapsed = get_ms() - start;
+   printf("Received %zu bytes in %llu ms\n", tot, (unsigned long long)elapsed);
+   close(fd);
+   return 0;
+}
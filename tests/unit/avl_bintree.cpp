@@ -411,6 +411,35 @@ TEST(avl_bintree, first_last_obj)
    ASSERT_TRUE(l == &arr[elems - 1]);
 }
 
+TEST(avl_bintree, lower_bound)
+{
+   constexpr const int elems = 32;
+   int_struct arr[elems];
+   int_struct *root = NULL;
+   int_struct *res;
+
+   /* Insert only the even numbers: 2, 4, 6, ..., 64 */
+   for (int i = 0; i < elems; i++)
+      arr[i] = int_struct(2 * (i + 1));
+
+   for (int i = 0; i < elems; i++)
+      bintree_insert(&root, &arr[i], my_cmpfun, int_struct, node);
+
+   for (int v = 0; v <= 2 * elems + 1; v++) {
+
+      res = (int_struct *)
+         bintree_lower_bound(root, &v, cmpfun_objval, int_struct, node);
+
+      if (v > 2 * elems) {
+         ASSERT_TRUE(res == NULL);
+         continue;
+      }
+
+      ASSERT_TRUE(res != NULL);
+      ASSERT_EQ(res->val, max(2, v + (v & 1)));
+   }
+}
+
 static void test_insert_rand_data(int iters, int elems, bool slow_checks)
 {
    random_device rdev;
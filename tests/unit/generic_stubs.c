@@ -48,7 +48,12 @@ void arch_specific_new_proc_setup() { NOT_REACHED(); }
 void arch_specific_free_proc() { NOT_REACHED(); }
 void fpu_context_begin() { }
 void fpu_context_end() { }
+bool fpu_context_try_begin() { return false; }
+bool fpu_memcpy_begin() { return false; }
+void fpu_memcpy() { NOT_REACHED(); }
 void map_zero_pages() { NOT_REACHED(); }
+void map_big_page() { NOT_REACHED(); }
+void unmap_big_page() { NOT_REACHED(); }
 void dump_var_mtrrs() { }
 void set_page_rw() { }
 void poweroff() { NOT_REACHED(); }
@@ -56,12 +61,16 @@ int get_irq_num(void *ctx) { return -1; }
 int get_int_num(void *ctx) { return -1; }
 void retain_pageframes_mapped_at() { }
 void release_pageframes_mapped_at() { }
+u32 get_pageframe_ref_count_at() { return 1; }
 bool irq_is_masked() { NOT_REACHED(); return false; }
 
 void *hi_vmem_reserve(size_t size) { return NULL; }
 void hi_vmem_release(void *ptr, size_t size) { }
 void on_first_pdir_update(void) { }
 
+void kmemcpy(void *dest, const void *src, size_t n) { memcpy(dest, src, n); }
+void kmemset(void *dest, int c, size_t n) { memset(dest, c, n); }
+
 void *get_syscall_func_ptr(u32 n) { return NULL; }
 int get_syscall_num(void *func) { return -1; }
 
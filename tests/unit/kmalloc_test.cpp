@@ -2,6 +2,7 @@
 #include <cstdio>
 #include <cstdint>
 #include <cstdlib>
+#include <csignal>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -19,8 +20,10 @@
 extern "C" {
 
    #include <tilck/common/utils.h>
+   #include <tilck_gen_headers/config_kmalloc.h>
 
    #include <tilck/kernel/kmalloc.h>
+   #include <tilck/kernel/kmalloc_debug.h>
    #include <tilck/kernel/paging.h>
    #include <tilck/kernel/self_tests.h>
 
@@ -122,6 +125,8 @@ void kmalloc_chaos_test_sub(default_random_engine &eng,
    for (const auto& e : allocations) {
       kfree2(e.first, e.second);
    }
+
+   kmalloc_flush_magazines();
 }
 
 class kmalloc_test : public Test {
@@ -183,6 +188,155 @@ TEST_F(kmalloc_test, chaos_test)
    }
 }
 
+TEST_F(kmalloc_test, magazines)
+{
+   unique_ptr<u8[]> meta_before[KMALLOC_HEAPS_COUNT];
+   void *ptrs[KMALLOC_MAG_SIZE + 1];
+   void *p1, *p2;
+
+   for (int h = 0; h < KMALLOC_HEAPS_COUNT && heaps[h]; h++)
+      meta_before[h].reset(new u8[heaps[h]->metadata_size]);
+
+   save_heaps_metadata(meta_before);
+
+   /* A freed block is reused by the next allocation of the same class */
+   p1 = kmalloc(40);
+   ASSERT_TRUE(p1 != NULL);
+   kfree2(p1, 40);
+
+   p2 = kmalloc(64);
+   EXPECT_EQ(p1, p2);
+   kfree2(p2, 64);
+
+   /* But not by allocations of a different class */
+   p2 = kmalloc(16);
+   ASSERT_TRUE(p2 != NULL);
+   EXPECT_NE(p1, p2);
+   kfree2(p2, 16);
+
+   /* LIFO order, also when the magazine overflows */
+   for (int i = 0; i < KMALLOC_MAG_SIZE + 1; i++) {
+      ptrs[i] = kmalloc(128);
+      ASSERT_TRUE(ptrs[i] != NULL);
+   }
+
+   for (int i = 0; i < KMALLOC_MAG_SIZE + 1; i++)
+      kfree2(ptrs[i], 128);
+
+   EXPECT_EQ(kmalloc(128), ptrs[KMALLOC_MAG_SIZE]);
+   kfree2(ptrs[KMALLOC_MAG_SIZE], 128);
+
+   /* After a flush, the heaps are exactly as they were at the beginning */
+   kmalloc_flush_magazines();
+   ASSERT_NO_FATAL_FAILURE({ check_heaps_metadata(meta_before); });
+
+   /* With the magazines disabled, nothing is cached */
+   EXPECT_TRUE(debug_kmalloc_set_magazines(false));
+   p1 = kmalloc(32);
+   kfree2(p1, 32);
+   ASSERT_NO_FATAL_FAILURE({ check_heaps_metadata(meta_before); });
+   EXPECT_FALSE(debug_kmalloc_set_magazines(true));
+}
+
+#if DEBUG_CHECKS
+
+TEST_F(kmalloc_test, magazines_bad_kfree)
+{
+   void *p = kmalloc(64);
+   ASSERT_TRUE(p != NULL);
+
+   /* Wrong size: the block would land in the 128 bytes magazine */
+   EXPECT_EXIT(kfree2(p, 128), KilledBySignal(SIGABRT), "");
+
+   /* Double free: the block is already in the magazine */
+   kfree2(p, 64);
+   EXPECT_EXIT(kfree2(p, 64), KilledBySignal(SIGABRT), "");
+
+   /* Double free, after the block has been released to its heap */
+   kmalloc_flush_magazines();
+   EXPECT_EXIT(kfree2(p, 64), KilledBySignal(SIGABRT), "");
+}
+
+#endif
+
+static void check_frag_info(const struct debug_kmalloc_frag_info &fi)
+{
+   size_t tot = 0, count = 0;
+
+   for (size_t i = 0; i < KMALLOC_FRAG_ORDERS; i++) {
+
+      tot += fi.free_blocks[i] << i;
+      count += fi.free_blocks[i];
+
+      if (fi.free_blocks[i]) {
+         EXPECT_LE((size_t)1 << i, fi.largest_free_block);
+      }
+   }
+
+   EXPECT_EQ(tot, fi.free_mem);
+   EXPECT_EQ(count, fi.free_blocks_count);
+}
+
+TEST_F(kmalloc_test, frag_info)
+{
+   struct debug_kmalloc_frag_info fi;
+   void *ptrs[2];
+
+   for (int h = 0; h < KMALLOC_HEAPS_COUNT && heaps[h]; h++) {
+      ASSERT_TRUE(debug_kmalloc_get_heap_frag(h, &fi));
+      check_frag_info(fi);
+      EXPECT_EQ(fi.free_mem, heaps[h]->size - heaps[h]->mem_allocated);
+      EXPECT_GT(fi.largest_free_block, 0u);
+   }
+
+   /* Use a fresh heap, in order to know exactly where the blocks are */
+   struct kmalloc_heap h;
+   kmalloc_create_heap(&h,
+                       MB,                           /* vaddr */
+                       KMALLOC_MIN_HEAP_SIZE,        /* heap size */
+                       1 * KB,                       /* min block size */
+                       0,    /* alloc block size: 0 because linear_mapping=1 */
+                       true, /* linear mapping */
+                       NULL, NULL, NULL);
+
+   for (int i = 0; i < 2; i++) {
+      size_t s = 1 * KB;
+      ptrs[i] = per_heap_kmalloc(&h, &s, 0);
+      ASSERT_TRUE(ptrs[i] != NULL);
+   }
+
+   /* Freeing ptrs[1] leaves a 1 KB hole only if its buddy is allocated */
+   ASSERT_EQ((ulong)ptrs[1], (ulong)ptrs[0] ^ (1 * KB));
+
+   debug_kmalloc_get_heap_frag_by_ptr(&h, &fi);
+   check_frag_info(fi);
+   EXPECT_EQ(fi.free_mem, h.size - 2 * KB);
+   EXPECT_EQ(fi.free_blocks[10], 0u);
+   EXPECT_EQ(fi.largest_free_block, h.size / 2);
+
+   size_t s = 1 * KB;
+   per_heap_kfree(&h, ptrs[1], &s, 0);
+
+   debug_kmalloc_get_heap_frag_by_ptr(&h, &fi);
+   check_frag_info(fi);
+   EXPECT_EQ(fi.free_mem, h.size - 1 * KB);
+   EXPECT_EQ(fi.free_blocks[10], 1u);
+   EXPECT_EQ(fi.largest_free_block, h.size / 2);
+   EXPECT_GT(debug_kmalloc_frag_percent(&fi), 0);
+
+   s = 1 * KB;
+   per_heap_kfree(&h, ptrs[0], &s, 0);
+
+   /* Now the whole heap is a single free block */
+   debug_kmalloc_get_heap_frag_by_ptr(&h, &fi);
+   check_frag_info(fi);
+   EXPECT_EQ(fi.free_mem, h.size);
+   EXPECT_EQ(fi.free_blocks_count, 1u);
+   EXPECT_EQ(debug_kmalloc_frag_percent(&fi), 0);
+
+   kmalloc_destroy_heap(&h);
+}
+
 #define COLOR_RED           "\033[31m"
 #define COLOR_YELLOW        "\033[93m"
 #define COLOR_BRIGHT_GREEN  "\033[92m"
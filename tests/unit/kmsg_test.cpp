@@ -0,0 +1,72 @@
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace testing;
+
+extern "C" {
+   #include <tilck/kernel/kmsg.h>
+   #include <tilck/kernel/errno.h>
+}
+
+static u32 append_str(const string &s, u8 level = KMSG_LVL_INFO, u8 fl = 0)
+{
+   return kmsg_append(level, fl, NULL, s.c_str(), (u32)s.length());
+}
+
+TEST(kmsg, appendAndRead)
+{
+   struct kmsg_record r;
+   const u32 next = kmsg_next_seq();
+   const u32 seq = append_str("hello\n", KMSG_LVL_WARN, KMSG_FL_NO_PREFIX);
+
+   ASSERT_EQ(seq, next);
+   ASSERT_EQ(kmsg_next_seq(), next + 1);
+   ASSERT_EQ(kmsg_read(seq, &r), 0);
+
+   EXPECT_EQ(r.seq, seq);
+   EXPECT_EQ(r.level, KMSG_LVL_WARN);
+   EXPECT_EQ(r.flags, KMSG_FL_NO_PREFIX);
+   EXPECT_EQ(r.len, 6);
+   EXPECT_STREQ(r.text, "hello\n");
+   EXPECT_TRUE(r.tty == NULL);
+
+   /* The next record does not exist yet */
+   EXPECT_EQ(kmsg_read(seq + 1, &r), -ENOENT);
+   EXPECT_EQ(kmsg_peek(seq + 1), -ENOENT);
+   EXPECT_EQ(kmsg_peek(seq), 0);
+}
+
+TEST(kmsg, truncation)
+{
+   struct kmsg_record r;
+   const string s(KMSG_TEXT_MAX * 2, 'x');
+   const u32 seq = append_str(s);
+
+   ASSERT_EQ(kmsg_read(seq, &r), 0);
+   EXPECT_EQ(r.len, KMSG_TEXT_MAX - 1);
+   EXPECT_EQ(string(r.text), s.substr(0, KMSG_TEXT_MAX - 1));
+}
+
+TEST(kmsg, overwrite)
+{
+   struct kmsg_record r;
+   const u32 seq0 = append_str("first");
+   u32 last = seq0;
+
+   for (int i = 0; i < KMSG_RECORDS; i++)
+      last = append_str(to_string(i));
+
+   /* The first record has been overwritten */
+   EXPECT_EQ(kmsg_read(seq0, &r), -EPIPE);
+   EXPECT_EQ(kmsg_peek(seq0), -EPIPE);
+   EXPECT_EQ(kmsg_first_seq(), seq0 + 1);
+   EXPECT_EQ(kmsg_next_seq(), last + 1);
+
+   /* All the others are still there */
+   for (u32 seq = seq0 + 1; seq <= last; seq++) {
+      ASSERT_EQ(kmsg_read(seq, &r), 0);
+      EXPECT_EQ(r.seq, seq);
+      EXPECT_EQ(string(r.text), to_string(seq - seq0 - 1));
+   }
+}
@@ -99,6 +99,36 @@ TEST(insertion_sort_generic, random)
    ASSERT_TRUE(my_is_sorted((ulong *)&vec[0], vec.size(), less_than_cmp_int));
 }
 
+TEST(heap_sort_ptr, basic_test)
+{
+   long vec[] = { 3, 4, 1, 0, -3, 10, 2 };
+
+   heap_sort_ptr((ulong *)&vec, ARRAY_SIZE(vec), less_than_cmp_int);
+   ASSERT_TRUE(my_is_sorted((ulong *)vec, ARRAY_SIZE(vec), less_than_cmp_int));
+
+   heap_sort_ptr((ulong *)&vec, 1, less_than_cmp_int);
+   heap_sort_ptr((ulong *)&vec, 0, less_than_cmp_int);
+}
+
+TEST(heap_sort_ptr, random)
+{
+   random_device rdev;
+   const auto seed = rdev();
+   default_random_engine e(seed);
+   lognormal_distribution<> dist(5.0, 3);
+   cout << "[ INFO     ] random seed: " << seed << endl;
+
+   vector<long> vec;
+
+   for (u32 n : { 2u, 3u, 100u, 1000u, 10000u }) {
+      random_fill_vec(e, dist, vec, n);
+      heap_sort_ptr((ulong *)&vec[0], vec.size(), less_than_cmp_int);
+      ASSERT_TRUE(
+         my_is_sorted((ulong *)&vec[0], vec.size(), less_than_cmp_int)
+      );
+   }
+}
+
 bool array_reverse_ptr_check(const vector<ulong> &vec)
 {
    vector<ulong> copy = vec;
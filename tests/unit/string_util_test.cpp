@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <chrono>
 #include <gtest/gtest.h>
 
 extern "C" {
@@ -63,3 +64,234 @@ TEST(str_reverse, basic)
    str_reverse(short_string, 3);
    ASSERT_STREQ(short_string, "cba");
 }
+
+static int sign(int v)
+{
+   return (v > 0) - (v < 0);
+}
+
+/*
+ * Trivial byte-at-a-time implementations, used as reference. NOTE: libc's
+ * functions cannot be used for that, because the kernel's strlen(), strcmp()
+ * etc. (aliases of the tilck_* ones) override them in the unit tests.
+ */
+
+static NO_INLINE size_t bytewise_strlen(const char *s)
+{
+   const char *p = s;
+
+   while (*p)
+      p++;
+
+   return (size_t)(p - s);
+}
+
+static NO_INLINE int bytewise_strcmp(const char *s1, const char *s2)
+{
+   while (*s1 && *s1 == *s2) {
+      s1++; s2++;
+   }
+
+   return (int)(u8)*s1 - (int)(u8)*s2;
+}
+
+static NO_INLINE int bytewise_strncmp(const char *s1, const char *s2, size_t n)
+{
+   for (; n > 0; n--, s1++, s2++) {
+      if (!*s1 || *s1 != *s2)
+         return (int)(u8)*s1 - (int)(u8)*s2;
+   }
+
+   return 0;
+}
+
+static NO_INLINE int bytewise_memcmp(const void *a, const void *b, size_t n)
+{
+   const u8 *p1 = (const u8 *)a;
+   const u8 *p2 = (const u8 *)b;
+
+   for (size_t i = 0; i < n; i++) {
+      if (p1[i] != p2[i])
+         return (int)p1[i] - (int)p2[i];
+   }
+
+   return 0;
+}
+
+/*
+ * The word-at-a-time functions have different code paths depending on the
+ * alignment of the buffers and on where the interesting byte falls inside a
+ * word: check all the combinations against the reference functions above.
+ */
+
+TEST(strlen, word_at_a_time)
+{
+   alignas(16) char buf[96];
+
+   for (int off = 0; off < 16; off++) {
+      for (int len = 0; len < 64; len++) {
+
+         memset(buf, 'x', sizeof(buf));
+         buf[off + len] = 0;
+
+         ASSERT_EQ(tilck_strlen(buf + off), (size_t)len);
+
+         for (int max = 0; max < len + 10; max++)
+            ASSERT_EQ(tilck_strnlen(buf + off, max), (size_t)MIN(max, len));
+      }
+   }
+
+   ASSERT_EQ(tilck_strnlen(buf, (size_t)-1), bytewise_strlen(buf));
+}
+
+TEST(strcmp, word_at_a_time)
+{
+   alignas(16) char a[96];
+   alignas(16) char b[96];
+
+   for (int off_a = 0; off_a < 9; off_a++) {
+      for (int off_b = 0; off_b < 9; off_b++) {
+         for (int len = 0; len < 40; len++) {
+
+            memset(a, 'x', sizeof(a));
+            memset(b, 'x', sizeof(b));
+            a[off_a + len] = 0;
+            b[off_b + len] = 0;
+
+            const char *sa = a + off_a;
+            const char *sb = b + off_b;
+
+            ASSERT_EQ(tilck_strcmp(sa, sb), 0);
+            ASSERT_EQ(tilck_strncmp(sa, sb, len + 5), 0);
+
+            for (int diff = 0; diff < len; diff++) {
+
+               b[off_b + diff] = 'y';
+               ASSERT_EQ(sign(tilck_strcmp(sa, sb)),
+                         sign(bytewise_strcmp(sa, sb)));
+               ASSERT_EQ(sign(tilck_strcmp(sb, sa)),
+                         sign(bytewise_strcmp(sb, sa)));
+
+               for (int n = 0; n < len + 2; n++) {
+                  ASSERT_EQ(sign(tilck_strncmp(sa, sb, n)),
+                            sign(bytewise_strncmp(sa, sb, n)));
+               }
+
+               b[off_b + diff] = 'x';
+            }
+
+            /* `sb` is a prefix of `sa` */
+            if (len > 0) {
+               b[off_b + len - 1] = 0;
+               ASSERT_GT(tilck_strcmp(sa, sb), 0);
+               ASSERT_LT(tilck_strcmp(sb, sa), 0);
+               ASSERT_EQ(tilck_strncmp(sa, sb, len - 1), 0);
+               ASSERT_GT(tilck_strncmp(sa, sb, len), 0);
+            }
+         }
+      }
+   }
+
+   /* Bytes >= 0x80 must compare as unsigned chars */
+   ASSERT_GT(tilck_strcmp("\xff", "a"), 0);
+   ASSERT_LT(tilck_strncmp("a", "\xff", 1), 0);
+}
+
+TEST(memcmp, word_at_a_time)
+{
+   alignas(16) u8 a[96];
+   alignas(16) u8 b[96];
+
+   for (int off_a = 0; off_a < 9; off_a++) {
+      for (int off_b = 0; off_b < 9; off_b++) {
+         for (int len = 0; len < 40; len++) {
+
+            for (int i = 0; i < (int)sizeof(a); i++)
+               a[i] = b[i] = (u8)(i * 13);
+
+            memmove(b + off_b, a + off_a, len);
+            ASSERT_EQ(tilck_memcmp(a + off_a, b + off_b, len), 0);
+
+            for (int diff = 0; diff < len; diff++) {
+
+               b[off_b + diff] ^= 0x80;
+
+               ASSERT_EQ(sign(tilck_memcmp(a + off_a, b + off_b, len)),
+                         sign(bytewise_memcmp(a + off_a, b + off_b, len)));
+
+               ASSERT_EQ(tilck_memcmp(a + off_a, b + off_b, diff), 0);
+               b[off_b + diff] ^= 0x80;
+            }
+         }
+      }
+   }
+}
+
+TEST(memchr, word_at_a_time)
+{
+   alignas(16) u8 buf[96];
+
+   for (int off = 0; off < 16; off++) {
+      for (int len = 0; len < 64; len++) {
+
+         memset(buf, 0xaa, sizeof(buf));
+         ASSERT_EQ(tilck_memchr(buf + off, 0x55, len), (void *)NULL);
+
+         for (int pos = 0; pos < len; pos++) {
+
+            buf[off + pos] = 0x55;
+            buf[off + len] = 0x55;    /* past the end: must be ignored */
+
+            ASSERT_EQ(tilck_memchr(buf + off, 0x55, len), buf + off + pos);
+            ASSERT_EQ(tilck_memchr(buf + off, 0x55 + 256, len),
+                      buf + off + pos);
+
+            buf[off + pos] = 0xaa;
+         }
+      }
+   }
+}
+
+/*
+ * Benchmark, comparing the word-at-a-time functions with trivial byte-at-a-time
+ * ones on a typical path component length and on a long string.
+ */
+
+template <typename F>
+static long long measure_ns(int iters, F func)
+{
+   auto start = std::chrono::steady_clock::now();
+
+   for (int i = 0; i < iters; i++)
+      func();
+
+   auto end = std::chrono::steady_clock::now();
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end - start
+   ).count();
+}
+
+TEST(string_util, perf)
+{
+   const int iters = 20000;
+   static char s1[4096], s2[4096];
+   size_t sink = 0;
+
+   for (size_t len : { (size_t)12, (size_t)4000 }) {
+
+      memset(s1, 'a', len);
+      memset(s2, 'a', len);
+      s1[len] = s2[len] = 0;
+
+      auto t1 = measure_ns(iters, [&] { sink += bytewise_strlen(s1); });
+      auto t2 = measure_ns(iters, [&] { sink += tilck_strlen(s1); });
+      auto t3 = measure_ns(iters, [&] { sink += bytewise_strcmp(s1, s2); });
+      auto t4 = measure_ns(iters, [&] { sink += tilck_strcmp(s1, s2); });
+
+      printf("len %4zu: strlen %6lld -> %6lld ns, strcmp %6lld -> %6lld ns\n",
+             len, t1, t2, t3, t4);
+   }
+
+   /* Both the strlen() versions, for both the lengths */
+   ASSERT_EQ(sink, 2u * iters * (12 + 4000));
+}
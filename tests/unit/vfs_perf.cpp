@@ -1,5 +1,9 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <chrono>
+#include <vector>
+#include <cinttypes>
+
 #include "vfs_test.h"
 
 using namespace std;
@@ -45,3 +49,138 @@ TEST_F(ramfs_perf, creat)
    for (int i = 0; i < 100; i++)
       create_test_file(i);
 }
+
+class ramfs_large_file_perf : public ramfs_perf {
+
+protected:
+   static const size_t file_size = 32 * MB;
+   static const size_t chunk_size = 64 * KB;
+
+   fs_handle h;
+   vector<char> buf;
+
+   void SetUp() override {
+
+      ramfs_perf::SetUp();
+      buf.resize(chunk_size);
+
+      int rc = vfs_open("/large_file", &h, O_CREAT | O_RDWR, 0644);
+      ASSERT_EQ(rc, 0);
+   }
+
+   void TearDown() override {
+
+      vfs_close(h);
+      ramfs_perf::TearDown();
+   }
+
+   void fill_chunk(size_t off) {
+
+      for (size_t i = 0; i < chunk_size; i += sizeof(u32))
+         *(u32 *)&buf[i] = (u32)(off + i);
+   }
+
+   void check_chunk(size_t off, size_t len) {
+
+      for (size_t i = 0; i < len; i += sizeof(u32))
+         ASSERT_EQ(*(u32 *)&buf[i], (u32)(off + i));
+   }
+
+   void write_file() {
+
+      for (size_t off = 0; off < file_size; off += chunk_size) {
+         fill_chunk(off);
+         ASSERT_EQ(vfs_write(h, &buf[0], chunk_size), (ssize_t)chunk_size);
+      }
+   }
+
+   void report(const char *what, chrono::steady_clock::time_point start) {
+
+      auto end = chrono::steady_clock::now();
+      auto us = chrono::duration_cast<chrono::microseconds>(end - start);
+      printf("[ INFO     ] %s: %" PRIu64 " us\n", what, (u64)us.count());
+   }
+};
+
+TEST_F(ramfs_large_file_perf, seq_write)
+{
+   auto start = chrono::steady_clock::now();
+   write_file();
+   report("sequential write, 32 MB", start);
+}
+
+TEST_F(ramfs_large_file_perf, seq_read)
+{
+   write_file();
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_SET), 0);
+
+   auto start = chrono::steady_clock::now();
+
+   for (size_t off = 0; off < file_size; off += chunk_size)
+      ASSERT_EQ(vfs_read(h, &buf[0], chunk_size), (ssize_t)chunk_size);
+
+   report("sequential read, 32 MB", start);
+   ASSERT_EQ(vfs_read(h, &buf[0], chunk_size), 0);
+
+   /* Now, check the contents of the file */
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_SET), 0);
+
+   for (size_t off = 0; off < file_size; off += chunk_size) {
+      ASSERT_EQ(vfs_read(h, &buf[0], chunk_size), (ssize_t)chunk_size);
+      check_chunk(off, chunk_size);
+   }
+}
+
+TEST_F(ramfs_large_file_perf, strided_read)
+{
+   const size_t stride = 3 * PAGE_SIZE + 512;
+   const size_t len = 256;
+
+   write_file();
+   auto start = chrono::steady_clock::now();
+
+   for (int iter = 0; iter < 16; iter++) {
+      for (size_t off = 0; off + len <= file_size; off += stride) {
+         ASSERT_EQ(vfs_seek(h, (offt)off, SEEK_SET), (offt)off);
+         ASSERT_EQ(vfs_read(h, &buf[0], len), (ssize_t)len);
+      }
+   }
+
+   report("strided read, 16 passes", start);
+
+   for (size_t off = 0; off + len <= file_size; off += stride) {
+      ASSERT_EQ(vfs_seek(h, (offt)off, SEEK_SET), (offt)off);
+      ASSERT_EQ(vfs_read(h, &buf[0], len), (ssize_t)len);
+      check_chunk(off, len);
+   }
+}
+
+TEST_F(ramfs_large_file_perf, sparse_write_and_truncate)
+{
+   const size_t stride = 257 * PAGE_SIZE;
+   struct k_stat64 st;
+
+   /* Write a few pages far apart from each other, creating holes */
+   for (size_t off = 0; off < 4 * file_size; off += stride) {
+      fill_chunk(off);
+      ASSERT_EQ(vfs_seek(h, (offt)off, SEEK_SET), (offt)off);
+      ASSERT_EQ(vfs_write(h, &buf[0], PAGE_SIZE), (ssize_t)PAGE_SIZE);
+   }
+
+   /* Holes must read as zeros */
+   ASSERT_EQ(vfs_seek(h, PAGE_SIZE, SEEK_SET), (offt)PAGE_SIZE);
+   ASSERT_EQ(vfs_read(h, &buf[0], PAGE_SIZE), (ssize_t)PAGE_SIZE);
+
+   for (size_t i = 0; i < PAGE_SIZE; i++)
+      ASSERT_EQ(buf[i], 0);
+
+   ASSERT_EQ(vfs_ftruncate(h, file_size + 1), 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_size, (offt)file_size + 1);
+   ASSERT_EQ((size_t)st.st_blocks,
+             (file_size / stride + 1) * (PAGE_SIZE / 512));
+
+   ASSERT_EQ(vfs_ftruncate(h, 0), 0);
+   ASSERT_EQ(vfs_fstat64(h, &st), 0);
+   ASSERT_EQ(st.st_blocks, 0);
+}
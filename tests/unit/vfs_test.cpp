@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <random>
+#include <set>
 
 #include "vfs_test.h"
 
@@ -56,6 +57,69 @@ TEST_F(vfs_fat32, read_content_of_longname_file)
    ASSERT_STREQ("Content of file with a long name\n", data);
 }
 
+TEST_F(vfs_fat32, mmap_via_page_cache)
+{
+   struct user_mapping um = {};
+   struct pcache_stats s0, s1;
+   struct fat_fs_device_data *d;
+   const ulong va = 0x10000000;
+   const struct file_ops *fops;
+   char *page;
+   fs_handle h;
+   int r;
+
+   const char *file_path =
+      "/testdir/This_is_a_file_with_a_veeeery_long_name.txt";
+   const char *exp = "Content of file with a long name\n";
+
+   /* In the unit tests, our clusters are never considered mmap-able */
+   d = (struct fat_fs_device_data *)fat_fs->device_data;
+   ASSERT_FALSE(d->mmap_support);
+
+   r = vfs_open(file_path, &h, 0, O_RDONLY);
+   ASSERT_EQ(r, 0);
+   fops = ((struct fs_handle_base *)h)->fops;
+
+   um.h = h;
+   um.vaddr = va;
+   um.off = 0;
+   um.len = 2 * PAGE_SIZE;
+
+   pcache_get_stats(&s0);
+   r = fops->mmap(&um, NULL, 0);
+   ASSERT_EQ(r, 0);
+   pcache_get_stats(&s1);
+
+   EXPECT_EQ(s1.pages, s0.pages + 1);
+   EXPECT_EQ(s1.misses, s0.misses + 1);
+
+   /* Only the first page is mapped: the second one is past EOF */
+   ASSERT_NE(get_mapping(NULL, (void *)va), 0ul);
+   EXPECT_EQ(get_mapping(NULL, (void *)(va + PAGE_SIZE)), 0ul);
+
+   page = (char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)va));
+   EXPECT_EQ(memcmp(page, exp, strlen(exp)), 0);
+
+   for (size_t i = strlen(exp); i < PAGE_SIZE; i++)
+      ASSERT_EQ(page[i], 0) << "at offset " << i;
+
+   /* Mapping the file again must re-use the same page */
+   r = fops->mmap(&um, NULL, 0);
+   ASSERT_EQ(r, 0);
+   pcache_get_stats(&s1);
+
+   EXPECT_EQ(s1.pages, s0.pages + 1);
+   EXPECT_EQ(s1.hits, s0.hits + 1);
+   EXPECT_EQ((char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)va)), page);
+
+   unmap_pages_permissive(NULL, (void *)va, 1, false);
+   vfs_close(h);
+
+   EXPECT_EQ(pcache_shrink(), 1u);
+   pcache_get_stats(&s1);
+   EXPECT_EQ(s1.pages, s0.pages);
+}
+
 TEST_F(vfs_fat32, fseek)
 {
    random_device rdev;
@@ -425,6 +489,284 @@ TEST_F(vfs_ramfs, seek)
    ASSERT_NO_FATAL_FAILURE({ test_pread_pwrite_seek(true); });
 }
 
+static int
+collect_dent_cb(struct vfs_dent64 *vde, void *arg)
+{
+   auto *entries = (vector<pair<string, u64>> *)arg;
+   entries->emplace_back(vde->name, (u64)vde->next_off);
+   return 0;
+}
+
+/*
+ * Call directly fs' getdents() because vfs_getdents64() requires an user
+ * buffer. Like vfs_getdents64(), update handle's position.
+ */
+static void
+read_dir_entries(fs_handle h, vector<pair<string, u64>> &entries)
+{
+   struct fs_handle_base *hb = (struct fs_handle_base *)h;
+   size_t cnt = entries.size();
+
+   ASSERT_EQ(hb->fs->fsops->getdents(h, &collect_dent_cb, &entries), 0);
+
+   if (entries.size() > cnt)
+      hb->dir_pos = (offt)entries.back().second;
+}
+
+TEST_F(vfs_ramfs, dir_positions)
+{
+   const int n = 3000;
+   vector<pair<string, u64>> entries, entries2;
+   set<string> names;
+   char path[64];
+   fs_handle h;
+   size_t mid;
+
+   ASSERT_EQ(vfs_mkdir("/dir", 0755), 0);
+
+   for (int i = 0; i < n; i++) {
+      sprintf(path, "/dir/file_%d", i);
+      ASSERT_EQ(vfs_open(path, &h, O_CREAT | O_RDWR, 0644), 0);
+      vfs_close(h);
+   }
+
+   ASSERT_EQ(vfs_open("/dir", &h, O_RDONLY, 0), 0);
+   ASSERT_NO_FATAL_FAILURE({ read_dir_entries(h, entries); });
+   ASSERT_EQ(entries.size(), (size_t)n + 2);
+
+   for (const auto &e : entries)
+      names.insert(e.first);
+
+   ASSERT_EQ(names.size(), (size_t)n + 2);
+
+   /* Remove half of the files, then resume the walk from the middle */
+   for (int i = 0; i < n; i += 2) {
+      sprintf(path, "/dir/file_%d", i);
+      ASSERT_EQ(vfs_unlink(path), 0);
+      names.erase(path + 5);
+   }
+
+   mid = entries.size() / 2;
+   ASSERT_EQ(vfs_seek(h, (offt)entries[mid].second, SEEK_SET),
+             (offt)entries[mid].second);
+
+   ASSERT_NO_FATAL_FAILURE({ read_dir_entries(h, entries2); });
+
+   size_t j = 0;
+
+   for (size_t i = mid + 1; i < entries.size(); i++) {
+
+      if (!names.count(entries[i].first))
+         continue; /* removed */
+
+      ASSERT_LT(j, entries2.size());
+      ASSERT_EQ(entries2[j].first, entries[i].first);
+      ASSERT_EQ(entries2[j].second, entries[i].second);
+      j++;
+   }
+
+   ASSERT_EQ(j, entries2.size());
+   vfs_close(h);
+
+   /*
+    * Remove all the remaining files while keeping a handle open on the dir,
+    * then check the dir is empty, both before and after closing it (the dir
+    * tables get shrunk at that point).
+    */
+   ASSERT_EQ(vfs_open("/dir", &h, O_RDONLY, 0), 0);
+
+   for (int i = 1; i < n; i += 2) {
+      sprintf(path, "/dir/file_%d", i);
+      ASSERT_EQ(vfs_unlink(path), 0);
+   }
+
+   entries.clear();
+   ASSERT_NO_FATAL_FAILURE({ read_dir_entries(h, entries); });
+   vfs_close(h);
+
+   ASSERT_EQ(entries.size(), 2u);
+
+   entries.clear();
+   ASSERT_EQ(vfs_open("/dir", &h, O_RDONLY, 0), 0);
+   ASSERT_NO_FATAL_FAILURE({ read_dir_entries(h, entries); });
+   vfs_close(h);
+
+   ASSERT_EQ(entries.size(), 2u);
+   ASSERT_EQ(vfs_rmdir("/dir"), 0);
+}
+
+static const size_t max_pages = 16;
+static const size_t max_inodes = 8;
+
+class vfs_ramfs_quota : public vfs_test_base {
+
+protected:
+   struct mnt_fs *mnt_fs;
+
+   void SetUp() override {
+
+      vfs_test_base::SetUp();
+
+      mnt_fs = ramfs_create_with_quota(max_pages * PAGE_SIZE, max_inodes);
+      ASSERT_TRUE(mnt_fs != NULL);
+      mp_init(mnt_fs);
+   }
+
+   void TearDown() override {
+
+      // TODO: destroy ramfs
+      vfs_test_base::TearDown();
+   }
+};
+
+TEST_F(vfs_ramfs_quota, statfs)
+{
+   struct k_statfs64 sfs;
+
+   ASSERT_EQ(vfs_statfs("/", &sfs), 0);
+   ASSERT_EQ(sfs.f_bsize, (u32)PAGE_SIZE);
+   ASSERT_EQ(sfs.f_blocks, max_pages);
+   ASSERT_EQ(sfs.f_bfree, max_pages);
+   ASSERT_EQ(sfs.f_bavail, max_pages);
+   ASSERT_EQ(sfs.f_files, max_inodes);
+   ASSERT_EQ(sfs.f_ffree, max_inodes - 1); /* the root dir */
+   ASSERT_EQ(vfs_statfs("/not_existing", &sfs), -ENOENT);
+}
+
+TEST_F(vfs_ramfs_quota, blocks)
+{
+   char buf[PAGE_SIZE] = {0};
+   struct k_statfs64 sfs;
+   fs_handle h;
+
+   ASSERT_EQ(vfs_open("/file", &h, O_CREAT | O_RDWR, 0644), 0);
+
+   for (size_t i = 0; i < max_pages - 1; i++)
+      ASSERT_EQ(vfs_write(h, buf, PAGE_SIZE), (ssize_t)PAGE_SIZE);
+
+   /* Only one page is left: the write must be short */
+   ASSERT_EQ(vfs_write(h, buf, 2 * PAGE_SIZE), (ssize_t)PAGE_SIZE);
+   ASSERT_EQ(vfs_write(h, buf, 1), -ENOSPC);
+
+   /* Writing on already allocated blocks is fine */
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_SET), 0);
+   ASSERT_EQ(vfs_write(h, buf, PAGE_SIZE), (ssize_t)PAGE_SIZE);
+
+   ASSERT_EQ(vfs_fstatfs(h, &sfs), 0);
+   ASSERT_EQ(sfs.f_bfree, 0u);
+   ASSERT_EQ(sfs.f_bavail, 0u);
+
+   /* Truncate must give back the blocks to the fs */
+   ASSERT_EQ(vfs_ftruncate(h, PAGE_SIZE + 1), 0);
+   ASSERT_EQ(vfs_fstatfs(h, &sfs), 0);
+   ASSERT_EQ(sfs.f_bfree, max_pages - 2);
+
+   vfs_close(h);
+   ASSERT_EQ(vfs_unlink("/file"), 0);
+   ASSERT_EQ(vfs_statfs("/", &sfs), 0);
+   ASSERT_EQ(sfs.f_bfree, max_pages);
+}
+
+TEST_F(vfs_ramfs_quota, inodes)
+{
+   struct k_statfs64 sfs;
+   char path[32];
+   fs_handle h;
+
+   /* The root dir already uses one inode */
+   for (size_t i = 0; i < max_inodes - 1; i++) {
+      sprintf(path, "/file_%zu", i);
+      ASSERT_EQ(vfs_open(path, &h, O_CREAT | O_RDWR, 0644), 0);
+      vfs_close(h);
+   }
+
+   ASSERT_EQ(vfs_open("/one_more", &h, O_CREAT | O_RDWR, 0644), -ENOSPC);
+   ASSERT_EQ(vfs_mkdir("/dir", 0755), -ENOSPC);
+   ASSERT_EQ(vfs_statfs("/", &sfs), 0);
+   ASSERT_EQ(sfs.f_ffree, 0u);
+
+   ASSERT_EQ(vfs_unlink("/file_0"), 0);
+   ASSERT_EQ(vfs_mkdir("/dir", 0755), 0);
+   ASSERT_EQ(vfs_rmdir("/dir"), 0);
+
+   for (size_t i = 1; i < max_inodes - 1; i++) {
+      sprintf(path, "/file_%zu", i);
+      ASSERT_EQ(vfs_unlink(path), 0);
+   }
+
+   ASSERT_EQ(vfs_statfs("/", &sfs), 0);
+   ASSERT_EQ(sfs.f_ffree, max_inodes - 1);
+}
+
+static int fill_calls;
+
+static int
+test_pcache_fill(struct mnt_fs *fs,
+                 vfs_inode_ptr_t inode,
+                 ulong pg,
+                 void *buf,
+                 void *arg)
+{
+   fill_calls++;
+   memset(buf, (int)('a' + pg), PAGE_SIZE);
+   return 0;
+}
+
+TEST_F(vfs_test_base, page_cache)
+{
+   struct mnt_fs *fs = (struct mnt_fs *)0x1000;
+   vfs_inode_ptr_t ino1 = (vfs_inode_ptr_t)0x2000;
+   vfs_inode_ptr_t ino2 = (vfs_inode_ptr_t)0x3000;
+   const ulong va = 0x20000000;
+   struct user_mapping um = {};
+   struct pcache_stats s;
+   char *p0, *p1;
+
+   fill_calls = 0;
+   um.vaddr = va;
+   um.off = 0;
+   um.len = 4 * PAGE_SIZE;
+
+   /* The file has 2 pages and a half: the 4th page must not be mapped */
+   ASSERT_EQ(pcache_mmap(fs, ino1, 5 * PAGE_SIZE / 2, &um, NULL,
+                         &test_pcache_fill, NULL), 0);
+   ASSERT_EQ(fill_calls, 3);
+   EXPECT_EQ(get_mapping(NULL, (void *)(va + 3 * PAGE_SIZE)), 0ul);
+
+   p0 = (char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)va));
+   p1 = (char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)(va + PAGE_SIZE)));
+   EXPECT_EQ(p0[0], 'a');
+   EXPECT_EQ(p1[PAGE_SIZE - 1], 'b');
+
+   /* Mapping again a part of the same file must not call fill() */
+   um.off = PAGE_SIZE;
+   um.len = PAGE_SIZE;
+   ASSERT_EQ(pcache_mmap(fs, ino1, 5 * PAGE_SIZE / 2, &um, NULL,
+                         &test_pcache_fill, NULL), 0);
+   ASSERT_EQ(fill_calls, 3);
+   EXPECT_EQ((char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)va)), p1);
+
+   /* A different inode has its own pages */
+   ASSERT_EQ(pcache_mmap(fs, ino2, PAGE_SIZE, &um, NULL,
+                         &test_pcache_fill, NULL), 0);
+   ASSERT_EQ(fill_calls, 3); /* page #1 is past the EOF of ino2 */
+
+   um.off = 0;
+   ASSERT_EQ(pcache_mmap(fs, ino2, PAGE_SIZE, &um, NULL,
+                         &test_pcache_fill, NULL), 0);
+   ASSERT_EQ(fill_calls, 4);
+   EXPECT_NE((char *)KERNEL_PA_TO_VA(get_mapping(NULL, (void *)va)), p0);
+
+   pcache_get_stats(&s);
+   EXPECT_EQ(s.pages, 4u);
+
+   unmap_pages_permissive(NULL, (void *)va, 3, false);
+   pcache_drop_fs(fs);
+
+   pcache_get_stats(&s);
+   EXPECT_EQ(s.pages, 0u);
+}
+
 class compute_abs_path_test :
    public TestWithParam<
       tuple<const char *, const char *, const char *>
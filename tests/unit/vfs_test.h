@@ -9,6 +9,8 @@ extern "C" {
    #include <tilck/kernel/sched.h>
    #include <tilck/kernel/process.h>
    #include <tilck/kernel/fs/fat32.h>
+   #include <tilck/kernel/fs/page_cache.h>
+   #include <tilck/kernel/process_mm.h>
    #include <tilck/kernel/test/vfs.h>
    #include "kernel/fs/fs_int.h"
 }
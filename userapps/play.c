@@ -8,10 +8,12 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include <tilck/common/tilck_sound.h>
 
@@ -23,13 +25,14 @@ static bool opt_file_passed;
 static u8 opt_test_short;
 static u8 opt_test_bits = 8;
 static u8 opt_test_channels = 1;
+static u32 opt_period = 4 * KB;
 
 static void
 show_help(void)
 {
    printf("syntax:\n");
    printf("    play [-d device] --test [-b 8|16] [-ch 1|2] [-s]\n");
-   printf("    play [-d device] <WAVE FILE>\n");
+   printf("    play [-d device] [-p period_bytes] <WAVE FILE>\n");
 }
 
 static void
@@ -54,6 +57,14 @@ parse_args(int argc, char **argv)
          argc--; argv++;
          strncpy(opt_device, argv[0], sizeof(opt_device)-1);
 
+      } else if (!strcmp(arg, "-p")) {
+
+         if (argc < 2)
+            show_help_and_exit();
+
+         argc--; argv++;
+         opt_period = (u32)atoi(argv[0]);
+
       } else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
 
          show_help_and_exit();
@@ -364,14 +375,103 @@ check_wav_header(struct wav_header *hdr)
    return 0;
 }
 
+static void
+show_play_time(struct wav_header *hdr, u32 tot_read)
+{
+   static u32 last_sec = (u32) -1;
+   const u32 sec = tot_read / hdr->ByteRate;
+   const u32 tot_sec = hdr->Subchunk2Size / hdr->ByteRate;
+
+   if (sec != last_sec) {
+      printf("\033[2K\033[G");
+      printf("Time: %02u:%02u / %02u:%02u",
+             sec / 60, sec % 60, tot_sec / 60, tot_sec % 60);
+      fflush(stdout);
+      last_sec = sec;
+   }
+}
+
+/*
+ * Play the data in `fd` using the sound device in ring-buffer mode: read the
+ * file directly in the (memory-mapped) ring buffer, one period at a time, and
+ * wait with poll() for the card to free some space.
+ */
+static int
+play_wav_data(int devfd, int fd, struct wav_header *hdr)
+{
+   struct tilck_sound_ring_params rp = { .period_size = opt_period };
+   struct pollfd pfd = { .fd = devfd, .events = POLLOUT };
+   struct tilck_sound_pos pos;
+   u32 tot_read = 0, off, len;
+   u8 *ring;
+   int rc;
+
+   rc = ioctl(devfd, TILCK_IOCTL_SOUND_RING_SETUP, &rp);
+
+   if (rc < 0) {
+      printf("Unable to setup the ring buffer: %s\n", strerror(errno));
+      return rc;
+   }
+
+   ring = mmap(NULL, rp.ring_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED, devfd, 0);
+
+   if (ring == MAP_FAILED) {
+      printf("mmap() on sound device failed: %s\n", strerror(errno));
+      return -1;
+   }
+
+   while (true) {
+
+      show_play_time(hdr, tot_read);
+
+      if ((rc = poll(&pfd, 1, -1)) < 0) {
+         printf("\npoll() on sound device failed: %s\n", strerror(errno));
+         break;
+      }
+
+      if ((rc = ioctl(devfd, TILCK_IOCTL_SOUND_GET_POS, &pos)) < 0) {
+         printf("\nUnable to get the position: %s\n", strerror(errno));
+         break;
+      }
+
+      /* Fill one period: the periods never cross the end of the ring */
+      off = pos.appl_pos % rp.ring_size;
+      len = 0;
+
+      while ((rc = read(fd, ring + off + len, rp.period_size - len)) > 0)
+         len += rc;
+
+      if (rc < 0) {
+         printf("\nread() on WAV file failed with: %s\n", strerror(errno));
+         break;
+      }
+
+      if (!len)
+         break; /* EOF */
+
+      if ((rc = ioctl(devfd, TILCK_IOCTL_SOUND_RING_COMMIT, &len)) < 0) {
+         printf("\nUnable to commit data: %s\n", strerror(errno));
+         break;
+      }
+
+      tot_read += len;
+   }
+
+   printf("\n");
+
+   if (!ioctl(devfd, TILCK_IOCTL_SOUND_GET_POS, &pos) && pos.xruns)
+      printf("Underruns: %u\n", pos.xruns);
+
+   munmap(ring, rp.ring_size);
+   return rc;
+}
+
 static int
 play_wav_file(int devfd)
 {
    int fd = open(opt_file, O_RDONLY);
-   u32 tot_read = 0, data_read;
-   u32 last_sec = (u32) -1;
    struct wav_header hdr;
-   u8 *buf = NULL;
    int rc = 0;
 
    if (fd < 0) {
@@ -393,14 +493,6 @@ play_wav_file(int devfd)
    printf("%u bits/sample, %u channels at %u Hz\n",
           hdr.BitsPerSample, hdr.NumChannels, hdr.SampleRate);
 
-   buf = malloc(32 * KB);
-
-   if (!buf) {
-      printf("Out of memory\n");
-      rc = 1;
-      goto out;
-   }
-
    struct tilck_sound_params params = {
       .sample_rate = hdr.SampleRate,
       .bits = hdr.BitsPerSample,
@@ -415,52 +507,9 @@ play_wav_file(int devfd)
       goto out;
    }
 
-   do {
-
-      const u32 sec = tot_read / hdr.ByteRate;
-      const u32 tot_sec = hdr.Subchunk2Size / hdr.ByteRate;
-      u32 written = 0;
-      data_read = 0;
-
-      if (sec != last_sec) {
-         printf("\033[2K\033[G");
-         printf("Time: %02u:%02u / %02u:%02u",
-                sec / 60, sec % 60, tot_sec / 60, tot_sec % 60);
-         fflush(stdout);
-         last_sec = sec;
-      }
-
-      /* Read 32 KB */
-      while ((rc = read(fd, buf + data_read, 32 * KB - data_read)) > 0) {
-         data_read += rc;
-      }
-
-      if (rc < 0) {
-         printf("\nread() on WAV file failed with: %s\n", strerror(errno));
-         goto out;
-      }
-
-      while (written < data_read) {
-
-         rc = write(devfd, buf + written, data_read - written);
-
-         if (rc < 0) {
-            printf("\nwrite() on sound device failed: %s\n", strerror(errno));
-            goto out;
-         }
-
-         written += rc;
-      }
-
-      tot_read += data_read;
-
-   } while (data_read == 32 * KB);
-
-   printf("\n");
-   rc = 0;
+   rc = play_wav_data(devfd, fd, &hdr);
 
 out:
-   free(buf);
    close(fd);
    return !!rc;
 }
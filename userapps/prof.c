@@ -0,0 +1,328 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Front-end for the kernel's sampling profiler (see /syst/prof).
+ *
+ *    prof start          (re)start sampling on every timer tick
+ *    prof stop           stop sampling
+ *    prof info           show the number of samples collected
+ *    prof report [-c]    print the flat profile [and the call graph]
+ *
+ * Kernel addresses are resolved to function names through the
+ * TILCK_CMD_FIND_SYM command, which uses the kernel's symbol table.
+ */
+
+#include <tilck/common/syscalls.h>
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define PROF_ENABLED_FILE        "/syst/prof/enabled"
+#define PROF_INFO_FILE           "/syst/prof/info"
+#define PROF_SAMPLES_FILE        "/syst/prof/samples"
+
+#define MAX_FUNCS                1024
+#define MAX_EDGES                4096
+#define ADDR_CACHE_SIZE          4096     /* must be a power of 2 */
+#define MAX_CHAIN                64
+#define SAMPLE_USER              (1 << 0)
+
+struct func {
+   char name[64];
+   unsigned self;
+   unsigned total;
+};
+
+struct edge {
+   int caller;
+   int callee;
+   unsigned count;
+};
+
+struct addr_ent {
+   unsigned long addr;
+   int func;
+};
+
+static struct func funcs[MAX_FUNCS];
+static struct edge edges[MAX_EDGES];
+static struct addr_ent addr_cache[ADDR_CACHE_SIZE];
+static int funcs_count;
+static int edges_count;
+static unsigned samples_count;
+
+static int write_file(const char *path, const char *str)
+{
+   FILE *fh = fopen(path, "w");
+   int rc;
+
+   if (!fh) {
+      perror(path);
+      return 1;
+   }
+
+   rc = fputs(str, fh) < 0;
+   rc |= fclose(fh) != 0;
+
+   if (rc)
+      perror(path);
+
+   return rc;
+}
+
+static int cat_file(const char *path)
+{
+   char buf[128];
+   FILE *fh = fopen(path, "r");
+
+   if (!fh) {
+      perror(path);
+      return 1;
+   }
+
+   while (fgets(buf, sizeof(buf), fh))
+      fputs(buf, stdout);
+
+   fclose(fh);
+   return 0;
+}
+
+static int get_func_by_name(const char *name)
+{
+   for (int i = 0; i < funcs_count; i++)
+      if (!strcmp(funcs[i].name, name))
+         return i;
+
+   if (funcs_count == MAX_FUNCS)
+      return -1;
+
+   strncpy(funcs[funcs_count].name, name, sizeof(funcs[0].name) - 1);
+   return funcs_count++;
+}
+
+static int get_func(unsigned long addr)
+{
+   unsigned h = (unsigned)(addr ^ (addr >> 12)) & (ADDR_CACHE_SIZE - 1);
+   char name[64];
+   long off;
+   int rc;
+
+   for (unsigned i = 0; i < ADDR_CACHE_SIZE; i++) {
+
+      struct addr_ent *e = &addr_cache[(h + i) & (ADDR_CACHE_SIZE - 1)];
+
+      if (e->addr == addr)
+         return e->func;
+
+      if (!e->addr) {
+
+         rc = syscall(TILCK_CMD_SYSCALL, TILCK_CMD_FIND_SYM,
+                      addr, name, sizeof(name), &off);
+
+         if (rc < 0)
+            snprintf(name, sizeof(name), "%#lx", addr);
+
+         e->addr = addr;
+         e->func = get_func_by_name(name);
+         return e->func;
+      }
+   }
+
+   return -1;
+}
+
+static void add_edge(int caller, int callee)
+{
+   for (int i = 0; i < edges_count; i++) {
+      if (edges[i].caller == caller && edges[i].callee == callee) {
+         edges[i].count++;
+         return;
+      }
+   }
+
+   if (edges_count < MAX_EDGES)
+      edges[edges_count++] = (struct edge) { caller, callee, 1 };
+}
+
+static void process_sample(char *line)
+{
+   int chain[MAX_CHAIN];
+   unsigned long flags, addr;
+   int n = 0, f;
+   char *p = line;
+
+   flags = strtoul(p, &p, 16);
+   strtoul(p, &p, 16);                          /* tid, unused for now */
+   addr = strtoul(p, &p, 16);
+
+   samples_count++;
+
+   if (flags & SAMPLE_USER) {
+
+      if ((f = get_func_by_name("[user]")) >= 0) {
+         funcs[f].self++;
+         funcs[f].total++;
+      }
+
+      return;
+   }
+
+   /*
+    * The frames are return addresses: subtract 1 in order to resolve the
+    * function containing the call instruction, not the following one.
+    */
+   for (; addr && n < MAX_CHAIN; addr = strtoul(p, &p, 16)) {
+
+      if ((f = get_func(n ? addr - 1 : addr)) < 0)
+         break;
+
+      chain[n++] = f;
+   }
+
+   if (!n)
+      return;
+
+   funcs[chain[0]].self++;
+
+   for (int i = 0; i < n; i++) {
+
+      bool dup = false;
+
+      /* Count recursive functions just once per sample */
+      for (int j = 0; j < i && !dup; j++)
+         dup = chain[j] == chain[i];
+
+      if (!dup)
+         funcs[chain[i]].total++;
+
+      if (i > 0)
+         add_edge(chain[i], chain[i - 1]);
+   }
+}
+
+static int cmp_funcs_self(const void *a, const void *b)
+{
+   const struct func *fa = &funcs[*(const int *)a];
+   const struct func *fb = &funcs[*(const int *)b];
+
+   if (fa->self != fb->self)
+      return (int)fb->self - (int)fa->self;
+
+   return (int)fb->total - (int)fa->total;
+}
+
+static int cmp_edges(const void *a, const void *b)
+{
+   const struct edge *ea = a, *eb = b;
+   return (int)eb->count - (int)ea->count;
+}
+
+static void dump_flat_profile(void)
+{
+   static int order[MAX_FUNCS];
+
+   for (int i = 0; i < funcs_count; i++)
+      order[i] = i;
+
+   qsort(order, (size_t)funcs_count, sizeof(order[0]), cmp_funcs_self);
+
+   printf("Flat profile (%u samples)\n\n", samples_count);
+   printf("%7s %7s %7s %7s  %s\n",
+          "self%", "self", "total%", "total", "function");
+
+   for (int i = 0; i < funcs_count; i++) {
+
+      struct func *f = &funcs[order[i]];
+
+      if (!f->self && !f->total)
+         continue;
+
+      printf("%6.2f%% %7u %6.2f%% %7u  %s\n",
+             100.0 * f->self / samples_count, f->self,
+             100.0 * f->total / samples_count, f->total,
+             f->name);
+   }
+}
+
+static void dump_callgraph(void)
+{
+   printf("\nCall graph (caller -> callee)\n\n");
+
+   for (int i = 0; i < edges_count; i++) {
+      printf("%7u  %s -> %s\n",
+             edges[i].count,
+             funcs[edges[i].caller].name,
+             funcs[edges[i].callee].name);
+   }
+}
+
+static int report(bool callgraph)
+{
+   char line[512];
+   FILE *fh = fopen(PROF_SAMPLES_FILE, "r");
+
+   if (!fh) {
+      perror(PROF_SAMPLES_FILE);
+      return 1;
+   }
+
+   while (fgets(line, sizeof(line), fh))
+      process_sample(line);
+
+   fclose(fh);
+
+   if (!samples_count) {
+      printf("No samples. Run `prof start` first.\n");
+      return 0;
+   }
+
+   dump_flat_profile();
+
+   if (callgraph) {
+      qsort(edges, (size_t)edges_count, sizeof(edges[0]), cmp_edges);
+      dump_callgraph();
+   }
+
+   return 0;
+}
+
+static void show_help(void)
+{
+   printf("Usage:\n");
+   printf("   prof start          start sampling (discarding old samples)\n");
+   printf("   prof stop           stop sampling\n");
+   printf("   prof info           show the number of samples\n");
+   printf("   prof report [-c]    flat profile [and call graph]\n");
+}
+
+int main(int argc, char **argv)
+{
+   if (!getenv("TILCK")) {
+      printf("ERROR: the kernel profiler exists only on Tilck!\n");
+      return 1;
+   }
+
+   if (argc < 2) {
+      show_help();
+      return 1;
+   }
+
+   if (!strcmp(argv[1], "start"))
+      return write_file(PROF_ENABLED_FILE, "1");
+
+   if (!strcmp(argv[1], "stop"))
+      return write_file(PROF_ENABLED_FILE, "0");
+
+   if (!strcmp(argv[1], "info"))
+      return cat_file(PROF_INFO_FILE);
+
+   if (!strcmp(argv[1], "report"))
+      return report(argc > 2 && !strcmp(argv[2], "-c"));
+
+   show_help();
+   return 1;
+}